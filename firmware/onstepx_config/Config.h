@@ -18,6 +18,7 @@
 // SERIAL PORTS
 // =============================================================================
 #define SERIAL_A_BAUD_DEFAULT       9600       // LX200 protocol
+#define SERIAL_BAUD_MAX             921600     // Host may negotiate up to this with :NWBR# (nightwatch/SerialTransport.h)
 #define SERIAL_B_BAUD_DEFAULT       57600      // Debugging
 #define SERIAL_B                    Serial     // USB serial
 
@@ -45,16 +46,22 @@
 #define AXIS1_DRIVER_DECAY_GOTO     SPREADCYCLE
 #define AXIS1_DRIVER_STEALTHCHOP_THRESHOLD 100 // POS: steps/sec threshold for mode switch
 #define AXIS1_DRIVER_STALLGUARD     ON         // POS: Enable stall detection for safety
-#define AXIS1_DRIVER_STALLGUARD_THRESHOLD 50   // POS: Sensitivity (lower = more sensitive)
+#define AXIS1_DRIVER_STALLGUARD_THRESHOLD 50   // POS: Sensitivity (lower = more sensitive); fallback until :NWSC calibration
+
+// Drive train (nightwatch/AxisGeometry.h derives all step rates from these)
+#define AXIS1_MOTOR_STEPS_PER_REV   200        // NEMA17 1.8°/step
+#define AXIS1_GEARBOX_RATIO         27         // Planetary gearbox
+#define AXIS1_HARMONIC_RATIO        100        // CSF-32-100
 
 // Steps per degree calculation:
 // (200 steps/rev × 16 microsteps × 27 gearbox × 100 harmonic) / 360° = 24,000 steps/°
-#define AXIS1_STEPS_PER_DEGREE      24000.0
+#define AXIS1_STEPS_PER_DEGREE      24000.0    // Checked against the drive train above (nightwatch/AxisGeometry.h)
 
 #define AXIS1_REVERSE               OFF        // Adjust based on motor wiring
 #define AXIS1_POWER_DOWN            OFF        // Keep motor powered
 #define AXIS1_SLEW_RATE_DESIRED     4.0        // degrees/second
 #define AXIS1_ACCELERATION_TIME     3          // seconds to reach slew rate
+#define AXIS1_JERK                  4.0        // degrees/second³ for S-curve gotos (nightwatch/SCurvePlanner.h)
 #define AXIS1_RAPID_STOP_TIME       2          // seconds for emergency stop
 
 // RA Limits
@@ -65,6 +72,9 @@
 #define AXIS1_ENCODER               AB
 #define AXIS1_ENCODER_ORIGIN        0
 #define AXIS1_ENCODER_PPR           8192
+#define AXIS1_ENCODER_DECODER       ENCODER_DECODER_QUAD_HW // ENC1 via XBAR (nightwatch/QuadEncoder.h)
+#define AXIS1_ENCODER_A_PIN         7          // XBAR-capable pins only with QUAD_HW
+#define AXIS1_ENCODER_B_PIN         8
 
 // =============================================================================
 // AXIS 2 (DEC) CONFIGURATION
@@ -84,16 +94,22 @@
 #define AXIS2_DRIVER_DECAY_GOTO     SPREADCYCLE
 #define AXIS2_DRIVER_STEALTHCHOP_THRESHOLD 100 // POS: steps/sec threshold
 #define AXIS2_DRIVER_STALLGUARD     ON         // POS: Enable stall detection
-#define AXIS2_DRIVER_STALLGUARD_THRESHOLD 50   // POS: Sensitivity
+#define AXIS2_DRIVER_STALLGUARD_THRESHOLD 50   // POS: Sensitivity; fallback until :NWSC calibration
+
+// Drive train (nightwatch/AxisGeometry.h derives all step rates from these)
+#define AXIS2_MOTOR_STEPS_PER_REV   200        // NEMA17 1.8°/step
+#define AXIS2_GEARBOX_RATIO         27         // Planetary gearbox
+#define AXIS2_HARMONIC_RATIO        80         // CSF-25-80
 
 // Steps per degree calculation:
 // (200 steps/rev × 16 microsteps × 27 gearbox × 80 harmonic) / 360° = 19,200 steps/°
-#define AXIS2_STEPS_PER_DEGREE      19200.0
+#define AXIS2_STEPS_PER_DEGREE      19200.0    // Checked against the drive train above (nightwatch/AxisGeometry.h)
 
 #define AXIS2_REVERSE               OFF
 #define AXIS2_POWER_DOWN            OFF
 #define AXIS2_SLEW_RATE_DESIRED     4.0
 #define AXIS2_ACCELERATION_TIME     3
+#define AXIS2_JERK                  4.0        // degrees/second³ for S-curve gotos (nightwatch/SCurvePlanner.h)
 #define AXIS2_RAPID_STOP_TIME       2
 
 // DEC Limits
@@ -104,13 +120,61 @@
 #define AXIS2_ENCODER               AB
 #define AXIS2_ENCODER_ORIGIN        0
 #define AXIS2_ENCODER_PPR           8192
+#define AXIS2_ENCODER_DECODER       ENCODER_DECODER_QUAD_HW // ENC2 via XBAR (nightwatch/QuadEncoder.h)
+#define AXIS2_ENCODER_A_PIN         30         // XBAR-capable pins only with QUAD_HW
+#define AXIS2_ENCODER_B_PIN         31
+
+// =============================================================================
+// STEP GENERATION
+// =============================================================================
+// STEP_ENGINE_TMC_RAMP hands pulse generation to the TMC5160 ramp generators
+// (nightwatch/StepEngine.h): no MCU step interrupts and full 256-microstep
+// gotos. Requires SD_MODE strapped low on both driver boards.
+#define STEP_ENGINE                 STEP_ENGINE_SOFTWARE // or STEP_ENGINE_TMC_RAMP
+#define TMC5160_CLOCK_HZ            12000000   // Internal clock (CLK grounded, see note 1)
+
+// AXIS*_DRIVER_STATUS queries (:GXU, :NWS, :NWDS) are answered from a cached
+// DRV_STATUS snapshot polled over DMA SPI (nightwatch/DriverStatusCache.h)
+#define DRIVER_STATUS_POLL_HZ       20         // Background reads per axis
+
+// StallGuard calibration (nightwatch/StallGuardCal.h, :NWSC<axis>#): measured
+// per-velocity stall thresholds and StealthChop→SpreadCycle crossover replace
+// AXIS*_DRIVER_STALLGUARD_THRESHOLD / _STEALTHCHOP_THRESHOLD once calibrated
+#define STALLGUARD_CAL_POINTS       8          // Sweep velocities
+#define STALLGUARD_CAL_RATE_MIN     0.25       // degrees/second
+#define STALLGUARD_CAL_RATE_MAX     6.0        // degrees/second (headroom above GOTO_RATE)
+#define STALLGUARD_CAL_MARGIN       0.5        // Threshold = margin × unloaded SG_RESULT minimum
+
+// Load-adaptive current (nightwatch/CoolStep.h): AXIS*_DRIVER_IHOLD/IRUN/IGOTO
+// become bounds. Hardware CoolStep on gotos, encoder-error trim while tracking.
+#define COOLSTEP                    ON
+#define COOLSTEP_TRACK_STEP_MA      50         // mA per tracking trim step
+#define COOLSTEP_TRACK_INTERVAL_MS  10000      // Slow walk down toward IHOLD
+#define COOLSTEP_TRACK_LAG_ARCSEC   2.0        // Following error that raises current again
 
 // =============================================================================
 // TRACKING
 // =============================================================================
 #define TRACK_AUTOSTART             ON         // Start tracking automatically
 #define TRACK_REFRACTION_TYPE       REFRAC_CALC_FULL
-#define TRACK_BACKLASH_RATE         25         // x sidereal for backlash takeup
+#define REFRACTION_TABLE            ON         // Table-driven full refraction, weather pushed with :NWRW# (nightwatch/RefractionTable.h)
+#define TRACK_BACKLASH_RATE         25         // x sidereal for backlash takeup until StallGuard is calibrated
+// Backlash compensation (nightwatch/BacklashComp.h, :NWLC<axis>#): slack
+// measured from the AMT103-V against the AS5600, taken up on reversal at the
+// fastest StallGuard-calibrated rate
+#define BACKLASH_COMP               ON
+#define BACKLASH_CAL_RATE           0.1        // degrees/second measurement sweep
+#define BACKLASH_TAKEUP_RATE_MAX    200        // x sidereal, cap on the unramped takeup
+#define TRACK_RATE_FIXED_POINT      ON         // 64-bit DDS phase accumulator, no floats in the step ISR
+#define TRACK_DDS_CLOCK_HZ          50000      // DDS update rate (hardware timer), 20 µs step jitter
+
+// Encoder closed loop (nightwatch/EncoderLoop.h): PI on step vs AXIS*_ENCODER position
+#define ENCODER_LOOP                ON         // Correct tracking on the MCU from the AB encoders
+#define ENCODER_LOOP_HZ             500        // Control loop rate
+#define ENCODER_LOOP_KP             4.0        // Correction steps/s per step of error
+#define ENCODER_LOOP_KI             1.0        // Correction steps/s per step·s of integrated error
+#define ENCODER_LOOP_MAX_ARCSEC_S   30.0       // Correction rate limit (~2x sidereal)
+#define ENCODER_LOOP_SLIP_ARCSEC    20.0       // Error treated as slip: stop and flag
 
 // =============================================================================
 // GOTO BEHAVIOR
@@ -118,7 +182,10 @@
 #define GOTO_FEATURE                ON
 #define GOTO_RATE                   4.0        // degrees/second max
 #define GOTO_ACCELERATION           2.0        // degrees/second²
+#define GOTO_SCURVE                 ON         // Jerk-limited profile from AXIS*_JERK instead of trapezoidal
+#define GOTO_COORDINATED            ON         // Time-scale both axes to arrive together (nightwatch/CoordinatedGoto.h)
 #define GOTO_OFFSET_ALIGN           AUTO
+#define POINTING_MODEL              ON         // Multi-term model uploaded via :NWU# (nightwatch/PointingModel.h)
 
 // =============================================================================
 // PIER SIDE / MERIDIAN FLIP
@@ -127,18 +194,22 @@
 #define PIER_SIDE_SYNC_CHANGE       OFF
 #define AXIS1_PAST_MERIDIAN_LIMIT_E 15         // degrees past meridian (east)
 #define AXIS1_PAST_MERIDIAN_LIMIT_W 15         // degrees past meridian (west)
+#define GOTO_FLIP_OVERLAP           ON         // Merge the flip waypoint leg with the Dec move when safe
+#define GOTO_FLIP_OVERLAP_AXIS2_MIN -30        // degrees Dec; below this the tube can reach the pier
 
 // =============================================================================
 // PARK POSITIONS
 // =============================================================================
 #define PARK_STRICT                 ON
 #define PARK_STATUS_PRESERVED       ON
+#define FLASH_STORE                 ON         // Park, PEC, pointing and StallGuard records in QSPI flash (nightwatch/FlashStore.h)
 
 // =============================================================================
 // HOMING (with absolute encoders)
 // =============================================================================
 #define HOME_AUTOMATIC              ON
-// AS5600 absolute encoders on output shafts will be configured separately
+#define WARM_START                  ON         // AS5600 output-shaft check skips homing after a reset (nightwatch/WarmStart.h)
+#define WARM_START_TOLERANCE_COUNTS 3          // ~0.26° of output shaft
 
 // =============================================================================
 // SITE LOCATION (Central Nevada)
@@ -151,6 +222,8 @@
 // TIMEZONE
 // =============================================================================
 #define TIME_ZONE_DEFAULT           -8         // PST
+#define TIME_DISCIPLINE             ON         // Controller clock locked to UTC over SNTP (nightwatch/TimeDiscipline.h)
+#define TIME_NTP_SERVER             {192, 168, 1, 1} // LAN NTP server (adjust for your network)
 
 // =============================================================================
 // NETWORK (Ethernet on Teensy 4.1)
@@ -166,13 +239,31 @@
 #define ETHERNET_SUBNET             {255, 255, 255, 0}
 #define ETHERNET_DNS                {8, 8, 8, 8}
 #define ETHERNET_HTTP_PORT          80
+#define METRICS_ENDPOINT            ON         // GET /metrics for nightwatch/health.py (nightwatch/MetricsEndpoint.h)
+#define TELEMETRY_STREAM            ON         // UDP push of position/step/encoder samples
+#define TELEMETRY_STREAM_PORT       9998       // Clients send "NWSUB" here to subscribe
+#define TELEMETRY_STREAM_HZ         20         // Samples per second to each subscriber
 #define ETHERNET_CMD_PORT           9999
+#define CMD_SERVER                  ON         // Concurrent prioritized sessions (nightwatch/CommandServer.h)
+#define CMD_SERVER_SESSIONS         4          // Orchestrator, safety monitor, INDI, Alpaca
+#define STATUS_FRAME_BINARY         ON         // :NWS# returns one binary status frame (nightwatch/StatusFrame.h)
+#define GUIDE_CHANNEL               GUIDE_CHANNEL_UDP // Binary guide pulses off the command socket (nightwatch/GuideChannel.h)
+#define GUIDE_CHANNEL_PORT          9997       // services/guiding/guide_channel.py sends here
+#define GUIDE_CHANNEL_MAX_LATENCY_US 3000      // Short planetary exposures: drop pulses older than this
+#define TARGET_QUEUE                ON         // Survey targets run back to back (nightwatch/TargetQueue.h)
+#define TARGET_QUEUE_SIZE           32         // One upload covers a busy survey hour
+#define SPLINE_TRACK                ON         // Satellite / bolide paths followed on the controller (nightwatch/SplineTrack.h)
+#define SPLINE_TRACK_KNOTS          512        // A full LEO pass at 1 s knot spacing
 
 // =============================================================================
 // WEATHER SAFETY (integration hooks)
 // =============================================================================
-// Weather integration handled by external DGX Spark automation
-// Mount will respond to park commands from safety controller
+// Weather policy stays with the DGX Spark safety monitor; the controller
+// parks by itself on the rain relay input or when the monitor goes silent
+// (nightwatch/SafetyPark.h)
+#define SAFETY_PARK                 ON
+#define SAFETY_PARK_PIN             2          // Rain sensor relay, contact to ground
+#define SAFETY_HEARTBEAT_TIMEOUT_MS 30000      // Three missed SafetyMonitor polls
 
 // =============================================================================
 // PERIODIC ERROR CORRECTION
@@ -181,6 +272,15 @@
 #define PEC_SENSE_ON                OFF        // No PEC sense hardware
 #define PEC_BUFFER_SIZE             824        // Steps for one worm revolution
                                                // Adjust based on actual worm gear
+                                               // (unused while PEC_MODEL is LUT/FOURIER)
+
+// Harmonic drive PEC model (nightwatch/PecModel.h)
+// Indexed by output-shaft angle from AXIS*_ENCODER, so it is not tied to a
+// worm period. Upload/download as one frame with :NWU# / :NWPD<axis>#.
+#define PEC_MODEL                   PEC_MODEL_LUT // PEC_MODEL_FLAT, PEC_MODEL_LUT, PEC_MODEL_FOURIER
+#define PEC_LUT_POINTS              8192       // Interpolated entries per axis (2 bytes each)
+#define PEC_FOURIER_TERMS           24         // Harmonic terms per axis (6 bytes each)
+#define PEC_AXIS2                   ON         // Also correct the DEC harmonic drive
 
 // =============================================================================
 // ROTATOR (not installed - future expansion)
@@ -208,6 +308,10 @@
 #define DEBUG_ECHO_COMMANDS         OFF
 #define DEBUG_SERVO                 OFF
 #define DEBUG_STEPPER               OFF
+#define TRACE_RECORDER              ON         // Binary motion trace instead of debug prints (nightwatch/TraceRecorder.h)
+#define TRACE_RECORDER_PSRAM        ON         // Needs a PSRAM chip on the Teensy 4.1 underside pads
+#define TRACE_RECORDER_RECORDS      65536      // ~65 s of both axes at 500 Hz plus events
+#define BENCHMARK                   OFF        // ON: timing-budget build with DWT probes (nightwatch/Benchmark.h)
 
 // =============================================================================
 // NOTES FOR NIGHTWATCH BUILD
@@ -219,12 +323,17 @@
 //    - BigTreeTech TMC5160 v1.2: Only cut CLK pin
 //
 // 2. ENCODER WIRING:
-//    - AMT103-V: A/B quadrature signals to Teensy GPIO
-//    - AS5600: I2C bus (future axis-side absolute encoders)
+//    - AMT103-V: A/B quadrature signals to XBAR-capable Teensy pins
+//      (RA 7/8, DEC 30/31), decoded by the ENC1/ENC2 hardware
+//    - AS5600: output shafts, axis 1 on Wire (SDA 18 / SCL 19), axis 2
+//      on Wire1 (SDA 17 / SCL 16); both chips answer at 0x36
 //
 // 3. MOTOR CALCULATIONS VERIFIED:
 //    - RA tracking: 24000 steps/° × 360° / 86164s = 100.3 steps/s
 //    - Well within Teensy/TMC5160 capability
+//    - nightwatch/AxisGeometry.h re-derives these at compile time and
+//      static_asserts the tracking and goto step rates (including the
+//      16→4 microstep switch) against the Teensy 4.1 step-rate ceiling
 //
 // 4. HARMONIC DRIVE NOTES:
 //    - CSF-32-100: RA axis, 127 Nm torque rating
@@ -235,6 +344,11 @@
 //    - Ethernet preferred for reliability
 //    - LX200 protocol on port 9999
 //    - HTTP web interface on port 80
+//    - UDP telemetry stream on port 9998 (nightwatch/TelemetryStream.h)
 //    - WiFi backup possible with external module
 //
 // =============================================================================
+
+// NIGHTWATCH option defaults and the AxisGeometry.h drive-train
+// static_asserts, in every translation unit that reads this file
+#include "nightwatch/NightwatchConfig.h"
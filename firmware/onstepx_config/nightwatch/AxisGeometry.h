@@ -0,0 +1,139 @@
+// NIGHTWATCH Firmware Extensions - Axis Geometry
+//
+// Compile-time drive-train math for both axes. Everything the step ISR needs
+// (steps/degree, sidereal tracking rate, goto step rates for both microstep
+// modes) is derived here from the motor, gearbox and harmonic drive ratios in
+// Config.h, and checked against the Teensy 4.1 step-rate ceiling with
+// static_assert. A gearbox swap is now a Config.h edit, not a hand calculation.
+//
+// The ISR only ever reads the integer / fixed-point members (trackingInterval*,
+// gotoInterval*); the double members exist for static_asserts and reporting.
+
+#pragma once
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+// =============================================================================
+// CONSTANTS
+// =============================================================================
+constexpr double SIDEREAL_DAY_SECONDS = 86164.0905;   // Mean sidereal day
+constexpr uint64_t Q32_ONE = 1ULL << 32;              // 1.0 in Q32.32
+
+constexpr uint32_t roundToU32(double value) { return (uint32_t)(value + 0.5); }
+constexpr uint64_t toQ32(double value) { return (uint64_t)(value * (double)Q32_ONE + 0.5); }
+
+// =============================================================================
+// AXIS GEOMETRY
+// =============================================================================
+// MotorSteps      full steps per motor revolution (200 for 1.8°)
+// Microsteps      driver microsteps while tracking
+// MicrostepsGoto  driver microsteps while slewing
+// GearboxRatio    planetary gearbox reduction
+// HarmonicRatio   harmonic drive reduction
+template <uint32_t MotorSteps, uint32_t Microsteps, uint32_t MicrostepsGoto,
+          uint32_t GearboxRatio, uint32_t HarmonicRatio>
+struct AxisGeometry {
+  static_assert(MotorSteps > 0 && GearboxRatio > 0 && HarmonicRatio > 0,
+                "Drive train ratios must be non-zero");
+  static_assert(MicrostepsGoto > 0 && MicrostepsGoto <= Microsteps,
+                "Goto microsteps must be between 1 and the tracking microsteps");
+  static_assert(Microsteps % MicrostepsGoto == 0,
+                "Tracking/goto microstep ratio must be an integer or position is lost on the mode switch");
+
+  // Reduction from motor shaft to output shaft
+  static constexpr uint32_t reduction = GearboxRatio * HarmonicRatio;
+
+  // Tracking-mode steps
+  static constexpr uint64_t stepsPerRev = (uint64_t)MotorSteps * Microsteps * reduction;
+  static constexpr double stepsPerDegree = stepsPerRev / 360.0;
+
+  // Goto-mode steps (each goto step moves gotoStepMultiplier tracking steps)
+  static constexpr uint32_t gotoStepMultiplier = Microsteps / MicrostepsGoto;
+  static constexpr uint64_t stepsPerRevGoto = (uint64_t)MotorSteps * MicrostepsGoto * reduction;
+  static constexpr double stepsPerDegreeGoto = stepsPerRevGoto / 360.0;
+
+  // Sidereal tracking rate
+  static constexpr double trackingStepsPerSecond = stepsPerRev / SIDEREAL_DAY_SECONDS;
+
+  // Step rate required to slew at degreesPerSecond
+  static constexpr double slewStepsPerSecond(double degreesPerSecond) {
+    return stepsPerDegree * degreesPerSecond;
+  }
+  static constexpr double gotoStepsPerSecond(double degreesPerSecond) {
+    return stepsPerDegreeGoto * degreesPerSecond;
+  }
+
+  // Fixed-point constants for the step ISR (timer ticks at NW_STEP_TIMER_HZ)
+  static constexpr uint32_t trackingIntervalTicks =
+    roundToU32(NW_STEP_TIMER_HZ / trackingStepsPerSecond);
+  static constexpr uint64_t trackingIntervalQ32 =
+    toQ32(NW_STEP_TIMER_HZ / trackingStepsPerSecond);
+  static constexpr uint64_t trackingRateQ32 = toQ32(trackingStepsPerSecond);
+
+  static constexpr uint32_t gotoIntervalTicks(double degreesPerSecond) {
+    return roundToU32(NW_STEP_TIMER_HZ / gotoStepsPerSecond(degreesPerSecond));
+  }
+
+  // True when the step rate at degreesPerSecond fits the ISR in the given mode
+  static constexpr bool fitsTracking(double degreesPerSecond) {
+    return slewStepsPerSecond(degreesPerSecond) <= NW_STEP_RATE_MAX_HZ;
+  }
+  static constexpr bool fitsGoto(double degreesPerSecond) {
+    return gotoStepsPerSecond(degreesPerSecond) <= NW_STEP_RATE_MAX_HZ;
+  }
+};
+
+using Axis1Geometry = AxisGeometry<AXIS1_MOTOR_STEPS_PER_REV, AXIS1_DRIVER_MICROSTEPS,
+                                   AXIS1_DRIVER_MICROSTEPS_GOTO, AXIS1_GEARBOX_RATIO,
+                                   AXIS1_HARMONIC_RATIO>;
+using Axis2Geometry = AxisGeometry<AXIS2_MOTOR_STEPS_PER_REV, AXIS2_DRIVER_MICROSTEPS,
+                                   AXIS2_DRIVER_MICROSTEPS_GOTO, AXIS2_GEARBOX_RATIO,
+                                   AXIS2_HARMONIC_RATIO>;
+
+// =============================================================================
+// BUILD-TIME CHECKS
+// =============================================================================
+// Config.h steps/degree is a literal, as OnStepX expects; it must agree with
+// the drive train Config.h documents, so a gearbox or microstep change that
+// forgets it fails the build
+static_assert(Axis1Geometry::stepsPerDegree == AXIS1_STEPS_PER_DEGREE,
+              "AXIS1_STEPS_PER_DEGREE does not match the AXIS1 drive train");
+static_assert(Axis2Geometry::stepsPerDegree == AXIS2_STEPS_PER_DEGREE,
+              "AXIS2_STEPS_PER_DEGREE does not match the AXIS2 drive train");
+
+// Tracking interval must fit the 32-bit PIT and resolve to better than 10 ppm
+static_assert(Axis1Geometry::trackingIntervalTicks >= 100000UL,
+              "AXIS1 tracking interval too short for 10 ppm rate resolution");
+static_assert(Axis2Geometry::trackingIntervalTicks >= 100000UL,
+              "AXIS2 tracking interval too short for 10 ppm rate resolution");
+
+// Backlash takeup runs at tracking microsteps
+static_assert(Axis1Geometry::trackingStepsPerSecond * TRACK_BACKLASH_RATE <= NW_STEP_RATE_MAX_HZ,
+              "AXIS1 backlash takeup rate exceeds the step-rate ceiling");
+static_assert(Axis2Geometry::trackingStepsPerSecond * TRACK_BACKLASH_RATE <= NW_STEP_RATE_MAX_HZ,
+              "AXIS2 backlash takeup rate exceeds the step-rate ceiling");
+
+// Software step generation only: with STEP_ENGINE_TMC_RAMP the driver makes
+// every pulse and these ceilings do not apply.
+#if STEP_ENGINE == STEP_ENGINE_SOFTWARE
+// Goto at the desired slew rate must fit in goto microstep mode
+static_assert(Axis1Geometry::fitsGoto(AXIS1_SLEW_RATE_DESIRED),
+              "AXIS1_SLEW_RATE_DESIRED exceeds the step-rate ceiling at AXIS1_DRIVER_MICROSTEPS_GOTO");
+static_assert(Axis2Geometry::fitsGoto(AXIS2_SLEW_RATE_DESIRED),
+              "AXIS2_SLEW_RATE_DESIRED exceeds the step-rate ceiling at AXIS2_DRIVER_MICROSTEPS_GOTO");
+static_assert(Axis1Geometry::fitsGoto(GOTO_RATE) && Axis2Geometry::fitsGoto(GOTO_RATE),
+              "GOTO_RATE exceeds the step-rate ceiling at goto microsteps");
+
+// If the goto rate would not fit at tracking microsteps, the 16→4 style
+// microstep switch is mandatory; make sure one is actually configured.
+static_assert(Axis1Geometry::fitsTracking(AXIS1_SLEW_RATE_DESIRED) ||
+              AXIS1_DRIVER_MICROSTEPS_GOTO < AXIS1_DRIVER_MICROSTEPS,
+              "AXIS1 slew rate requires a lower AXIS1_DRIVER_MICROSTEPS_GOTO");
+static_assert(Axis2Geometry::fitsTracking(AXIS2_SLEW_RATE_DESIRED) ||
+              AXIS2_DRIVER_MICROSTEPS_GOTO < AXIS2_DRIVER_MICROSTEPS,
+              "AXIS2 slew rate requires a lower AXIS2_DRIVER_MICROSTEPS_GOTO");
+#endif
+
+} // namespace nightwatch
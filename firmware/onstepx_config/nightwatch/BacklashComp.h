@@ -0,0 +1,330 @@
+// NIGHTWATCH Firmware Extensions - Backlash Compensation
+//
+// TRACK_BACKLASH_RATE was the only backlash control: a takeup rate with no
+// measured amount behind it, so a Dec guide reversal from PHD2 waited out the
+// gearbox slack at the guide rate, seconds of stalled star. BacklashComp
+// measures the slack per axis and takes it up as soon as the axis reverses.
+//
+// Measurement (:NWLC<axis>#, mount idle) compares the motor-side AMT103-V
+// count with the AS5600 on the output shaft. The axis runs forward at
+// BACKLASH_CAL_RATE over BACKLASH_CAL_LEAD_CODES + BACKLASH_CAL_SPAN_CODES +
+// BACKLASH_CAL_LEAD_CODES AS5600 codes of motor travel, then back to where
+// it started. Inside the span (the lead-in has taken up the slack either
+// way) each sweep fits output code against motor count with the slope fixed
+// by the reduction, and
+//
+//   backlash = (reverse intercept - forward intercept) / slope    motor counts
+//
+// One AS5600 code is 316" of output, far coarser than the slack, but over a
+// span of whole codes its quantization averages to the same half code both
+// ways, and harmonic-drive error and AS5600 nonlinearity follow output angle,
+// which both sweeps cover alike; all three cancel in the difference. A fitted
+// slope more than BACKLASH_CAL_SLOPE_TOLERANCE off the reduction (wrong bus,
+// slipping magnet) fails the sweep.
+//
+// Compensation: tick() runs in the DDS ISR after TrackingDds and GuideAxis
+// with the steps they produced that tick, and follows where the motor sits
+// inside the slack. When motion turns round it adds takeup steps in the new
+// direction until the slack is crossed, so the output follows the first
+// tracking or guide step after a reversal. Takeup runs at
+// takeupStepsPerSecond(): the fastest rate of the StallGuard calibration
+// sweep (the axis ran that fast unloaded without a stall), capped at
+// BACKLASH_TAKEUP_RATE_MAX and by the DDS clock; TRACK_BACKLASH_RATE until
+// StallGuard is calibrated. Takeup steps turn the motor, not the output: the
+// glue counts them into the EncoderLoop step position (the encoder sees
+// them) but not into the OnStepX axis position.
+//
+// The result is the STORE_BACKLASH_AXIS* record with FLASH_STORE ON. The host
+// can also set it from its own measurement (:NWLS), e.g. a guider calibration.
+//
+// Commands (LX200 channel):
+//   :NWLC<axis>#        start a measurement sweep (mount idle)             -> 1# or 0#
+//   :NWLS<axis><mas>#   set the backlash; 0 turns compensation off         -> 1# or 0#
+//   :NWLQ<axis>#        state,backlash steps,backlash mas,takeup steps/s,takeups#
+//
+// Python side: OnStepXExtended.start_backlash_calibration(), get_backlash_status().
+
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+
+#include "AxisGeometry.h"
+#include "Frame.h"
+#include "TrackingDds.h"
+
+#if BACKLASH_COMP == ON && TRACK_RATE_FIXED_POINT != ON
+  #error "BACKLASH_COMP takes up slack in the TRACK_RATE_FIXED_POINT DDS ISR"
+#endif
+
+namespace nightwatch {
+
+constexpr uint16_t AS5600_CODES = 4096;
+
+static_assert(BACKLASH_CAL_RATE > 0, "BACKLASH_CAL_RATE must be positive");
+static_assert(BACKLASH_CAL_SPAN_CODES >= 4, "BACKLASH_CAL_SPAN_CODES must be at least 4 codes");
+static_assert(BACKLASH_MAX_ARCSEC > 0 && BACKLASH_MAX_ARCSEC < BACKLASH_CAL_LEAD_CODES * 1296000.0 / AS5600_CODES,
+              "BACKLASH_CAL_LEAD_CODES must cover BACKLASH_MAX_ARCSEC of slack");
+static_assert(BACKLASH_TAKEUP_RATE_MAX >= TRACK_BACKLASH_RATE, "BACKLASH_TAKEUP_RATE_MAX is below TRACK_BACKLASH_RATE");
+
+enum BacklashCalState : uint8_t {
+  BL_CAL_NONE = 0,               // not measured; :NWLS value if any
+  BL_CAL_RUNNING = 1,
+  BL_CAL_DONE = 2,               // measured backlash in use
+  BL_CAL_FAILED = 3,             // slope off, too few AS5600 samples, too large or timed out
+};
+
+constexpr uint16_t BACKLASH_RECORD_MAGIC = 0x424C;   // "BL"
+constexpr uint16_t BACKLASH_RECORD_SIZE = 8;
+constexpr uint32_t BACKLASH_CAL_MIN_SAMPLES = 64;    // per sweep
+
+// Geometry is an AxisGeometry<> instantiation, EncoderPpr AXIS*_ENCODER_PPR
+// (counts per motor revolution)
+template <typename Geometry, uint32_t EncoderPpr>
+class BacklashComp {
+  public:
+    static constexpr double countsPerRev = (double)EncoderPpr * Geometry::reduction;
+    static constexpr double countsPerCode = countsPerRev / AS5600_CODES;
+    static constexpr double stepsPerCount = (double)Geometry::stepsPerRev / countsPerRev;
+    static constexpr double masPerStep = 1296000000.0 / Geometry::stepsPerRev;
+    static constexpr int32_t leadCounts = (int32_t)(BACKLASH_CAL_LEAD_CODES * countsPerCode);
+    static constexpr int32_t spanCounts = (int32_t)(BACKLASH_CAL_SPAN_CODES * countsPerCode);
+    static constexpr uint32_t maxLashSteps = (uint32_t)(BACKLASH_MAX_ARCSEC * 1000.0 / masPerStep);
+    // One takeup step per DDS tick at most, and never on consecutive ticks
+    static constexpr double maxTakeupStepsPerSecond = TRACK_DDS_CLOCK_HZ / 2.0;
+
+    static_assert(leadCounts > 0, "AS5600 code shorter than one encoder count");
+
+    // Takeup rate from StallGuardCal::maxRateDeg() (0 until calibrated)
+    static double takeupStepsPerSecond(double stallGuardMaxRateDeg) {
+      double rate = stallGuardMaxRateDeg > 0 ? stallGuardMaxRateDeg * Geometry::stepsPerDegree
+                                             : Geometry::trackingStepsPerSecond * TRACK_BACKLASH_RATE;
+      const double cap = Geometry::trackingStepsPerSecond * BACKLASH_TAKEUP_RATE_MAX;
+      if (rate > cap) rate = cap;
+      if (rate > maxTakeupStepsPerSecond) rate = maxTakeupStepsPerSecond;
+      return rate;
+    }
+
+    // ---- measurement (main loop) ------------------------------------------
+
+    bool start(uint32_t nowMs, int32_t motorCounts) {
+      if (state_ == BL_CAL_RUNNING) return false;
+      forward_ = Fit();
+      reverse_ = Fit();
+      startMs_ = nowMs;
+      startCounts_ = motorCounts;
+      haveRaw_ = false;
+      sweepForward_ = true;
+      state_ = BL_CAL_RUNNING;
+      publish();   // no takeup while sweeping
+      return true;
+    }
+
+    void abort() { if (state_ == BL_CAL_RUNNING) end(measured_ ? BL_CAL_DONE : BL_CAL_NONE); }
+
+    // Call every main loop pass while calibrating() with the axis encoder
+    // count and the AS5600 raw angle (rawValid false on a bus error). Runs at
+    // a steady commandRate(), so samples are uniform in motor count. Returns
+    // true when a new backlash was just measured and should be saved.
+    bool poll(uint32_t nowMs, int32_t motorCounts, bool rawValid, uint16_t raw) {
+      if (state_ != BL_CAL_RUNNING) return false;
+      if (nowMs - startMs_ > BACKLASH_CAL_TIMEOUT_MS) return end(BL_CAL_FAILED);
+
+      const int32_t m = motorCounts - startCounts_;
+      if (rawValid) {
+        if (!haveRaw_) { firstRaw_ = raw; haveRaw_ = true; }
+        // Output code unwrapped about the first reading; a sweep is far under half a turn
+        int32_t code = ((int32_t)raw - (int32_t)firstRaw_) & (AS5600_CODES - 1);
+        if (code >= AS5600_CODES / 2) code -= AS5600_CODES;
+        if (m >= leadCounts && m <= leadCounts + spanCounts)
+          (sweepForward_ ? forward_ : reverse_).add(m - leadCounts, code);
+      }
+
+      if (sweepForward_) {
+        if (m >= 2 * leadCounts + spanCounts) sweepForward_ = false;
+        return false;
+      }
+      if (m > 0) return false;
+      return finish();
+    }
+
+    // Signed rate the glue should run the axis at (deg/s, 0 when idle)
+    double commandRate() const {
+      if (state_ != BL_CAL_RUNNING) return 0;
+      return sweepForward_ ? BACKLASH_CAL_RATE : -BACKLASH_CAL_RATE;
+    }
+    bool calibrating() const { return state_ == BL_CAL_RUNNING; }
+
+    // ---- runtime (main loop) ----------------------------------------------
+
+    // :NWLS; false above BACKLASH_MAX_ARCSEC
+    bool setLashMas(uint32_t mas) {
+      const double steps = mas / masPerStep;
+      if (steps > maxLashSteps) return false;
+      setLashSteps((uint32_t)(steps + 0.5));
+      return true;
+    }
+
+    void setLashSteps(uint32_t steps) {
+      lashSteps_ = steps;
+      publish();
+    }
+
+    void setTakeupRate(double stepsPerSecond) {
+      if (stepsPerSecond > maxTakeupStepsPerSecond) stepsPerSecond = maxTakeupStepsPerSecond;
+      takeupRate_ = stepsPerSecond;
+      publish();
+    }
+
+    // The gear is known to be engaged on this side (+1/-1), e.g. after an
+    // OnStepX goto's final approach; taken by the next tick()
+    void engage(int8_t direction) { engage_ = direction < 0 ? -1 : 1; }
+
+    BacklashCalState state() const { return state_; }
+    uint32_t lashSteps() const { return lashSteps_; }
+    uint32_t lashMas() const { return (uint32_t)(lashSteps_ * masPerStep + 0.5); }
+    double takeupRate() const { return takeupRate_; }
+    uint32_t takeups() const { return takeups_; }
+    // Net takeup steps issued since boot
+    int32_t steps() const { return steps_; }
+
+    // Reply for :NWLQ<axis>#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%lu,%lu,%lu,%lu#", (unsigned)state_, (unsigned long)lashSteps_,
+                      (unsigned long)lashMas(), (unsigned long)(takeupRate_ + 0.5), (unsigned long)takeups_);
+    }
+
+    // ---- persistence (STORE_BACKLASH_AXIS*) -------------------------------
+
+    void serialize(uint8_t *out) const {
+      uint8_t *p = putU16(out, BACKLASH_RECORD_MAGIC);
+      p = putU32(p, lashSteps_);
+      putU16(p, crc16(out, BACKLASH_RECORD_SIZE - 2));
+    }
+
+    bool deserialize(const uint8_t *in, uint16_t length) {
+      if (length != BACKLASH_RECORD_SIZE || getU16(in) != BACKLASH_RECORD_MAGIC) return false;
+      if (getU16(in + BACKLASH_RECORD_SIZE - 2) != crc16(in, BACKLASH_RECORD_SIZE - 2)) return false;
+      const uint32_t steps = getU32(in + 2);
+      if (steps > maxLashSteps) return false;
+      lashSteps_ = steps;
+      measured_ = true;
+      return end(BL_CAL_DONE);
+    }
+
+    // ---- ISR side (DDS clock) ---------------------------------------------
+
+    // stepped: net steps TrackingDds, GuideAxis and the encoder loop issued
+    // this tick. Returns -1, 0 or +1 takeup steps to add to the step train.
+    inline int8_t tick(int8_t stepped) {
+      const volatile Slot &slot = slots_[active_];
+      const int32_t lash = (int32_t)slot.lashSteps;
+      if (engage_ != 0) {
+        pushing_ = engage_;
+        slack_ = engage_ > 0 ? lash : 0;
+        engage_ = 0;
+      }
+      if (stepped != 0) {
+        const int8_t direction = stepped > 0 ? 1 : -1;
+        if (pushing_ == 0) slack_ = direction > 0 ? lash : 0;   // first motion: assume engaged
+        else if (direction != pushing_ && lash > 0) takeups_++;
+        pushing_ = direction;
+        slack_ += stepped;
+      }
+      if (slack_ < 0) slack_ = 0;
+      if (slack_ > lash) slack_ = lash;
+      if (pushing_ == 0 || slack_ == (pushing_ > 0 ? lash : 0)) return 0;
+
+      const uint64_t previous = phase_;
+      phase_ += slot.increment;
+      if (phase_ >= previous) return 0;
+      slack_ += pushing_;
+      steps_ += pushing_;
+      return pushing_;
+    }
+
+  private:
+    // Least-squares sums of AS5600 code against motor count over one sweep
+    struct Fit {
+      uint32_t n = 0;
+      double sm = 0, sy = 0, smm = 0, smy = 0;
+
+      void add(int32_t m, int32_t y) {
+        n++;
+        sm += m;
+        sy += y;
+        smm += (double)m * m;
+        smy += (double)m * y;
+      }
+      double slope() const {
+        const double var = smm - sm * sm / n;
+        return var > 0 ? (smy - sm * sy / n) / var : 0;
+      }
+      double intercept(double slope) const { return (sy - slope * sm) / n; }
+    };
+
+    bool finish() {
+      if (forward_.n < BACKLASH_CAL_MIN_SAMPLES || reverse_.n < BACKLASH_CAL_MIN_SAMPLES) return end(BL_CAL_FAILED);
+      const double fitted = forward_.slope();
+      const double slope = (fitted < 0 ? -1.0 : 1.0) / countsPerCode;   // AS5600 may count either way
+      if (fabs(fitted / slope - 1) > BACKLASH_CAL_SLOPE_TOLERANCE ||
+          fabs(reverse_.slope() / slope - 1) > BACKLASH_CAL_SLOPE_TOLERANCE) return end(BL_CAL_FAILED);
+      // The output lags the motor by the slack in either direction
+      double counts = (reverse_.intercept(slope) - forward_.intercept(slope)) / slope;
+      if (counts < 0) counts = 0;   // noise on a slack-free axis
+      const double steps = counts * stepsPerCount;
+      if (steps > maxLashSteps) return end(BL_CAL_FAILED);
+      lashSteps_ = (uint32_t)(steps + 0.5);
+      measured_ = true;
+      return end(BL_CAL_DONE);
+    }
+
+    bool end(BacklashCalState state) {
+      state_ = state;
+      publish();
+      return state == BL_CAL_DONE;
+    }
+
+    struct Slot {
+      uint64_t increment;
+      uint32_t lashSteps;
+    };
+
+    // Idle slot then flip, as TrackingDds::publish()
+    void publish() {
+      const uint8_t idle = active_ ^ 1;
+      slots_[idle].increment = ddsIncrement(takeupRate_);
+      slots_[idle].lashSteps = state_ == BL_CAL_RUNNING ? 0 : lashSteps_;
+      active_ = idle;
+    }
+
+    // Main loop copies
+    uint32_t lashSteps_ = 0;
+    double takeupRate_ = Geometry::trackingStepsPerSecond * TRACK_BACKLASH_RATE;
+    bool measured_ = false;
+    BacklashCalState state_ = BL_CAL_NONE;
+
+    // Measurement
+    Fit forward_;
+    Fit reverse_;
+    uint32_t startMs_ = 0;
+    int32_t startCounts_ = 0;
+    uint16_t firstRaw_ = 0;
+    bool haveRaw_ = false;
+    bool sweepForward_ = true;
+
+    // ISR state
+    volatile Slot slots_[2] = {};
+    volatile uint8_t active_ = 0;
+    volatile int8_t engage_ = 0;
+    int8_t pushing_ = 0;               // direction of the last motion, 0 before any
+    int32_t slack_ = 0;                // 0 engaged negative .. lash engaged positive
+    uint64_t phase_ = 0;
+    volatile int32_t steps_ = 0;
+    volatile uint32_t takeups_ = 0;
+};
+
+using Axis1BacklashComp = BacklashComp<Axis1Geometry, AXIS1_ENCODER_PPR>;
+using Axis2BacklashComp = BacklashComp<Axis2Geometry, AXIS2_ENCODER_PPR>;
+
+} // namespace nightwatch
@@ -0,0 +1,331 @@
+// NIGHTWATCH Firmware Extensions - Timing Budget Benchmark
+//
+// Until now a Config.h change (microsteps, StallGuard, refraction tables,
+// another extension) was a guess about whether the MCU still meets its
+// deadlines. BENCHMARK ON builds the timing-budget firmware: the hot paths
+// are wrapped in NW_BENCH_SCOPE / NW_BENCH_PERIOD probes timed with the
+// Cortex-M7 DWT cycle counter (ARM_DWT_CYCCNT, 1.67 ns at 600 MHz), a
+// synthetic LX200 load runs alongside normal operation, and the results are
+// read back over the command channel. With BENCHMARK OFF the probes compile
+// to nothing.
+//
+// Each probe keeps count, min, max, mean and a log-linear histogram (16
+// buckets per power of two, so percentiles are within 6.25%, reported as the
+// bucket's upper bound) plus the number of samples over its budget:
+//
+//   probe             measured where                          budget
+//   0 step_isr        SCurvePlanner / SplineAxis pop(), once  1 / NW_STEP_RATE_MAX_HZ
+//                     per step interrupt
+//   1 dds_tick        TrackingDds and GuideAxis tick()        1 / TRACK_DDS_CLOCK_HZ
+//   2 encoder         QuadEncoder::read(), EncoderLoop        BENCHMARK_ISR_SHARE % of 1 / ENCODER_LOOP_HZ
+//                     update()
+//   3 spi_poll        DriverStatusCache::poll()               BENCHMARK_MAIN_BUDGET_US
+//   4 lx200_parse     CommandServer / BenchLoad, one command  BENCHMARK_MAIN_BUDGET_US
+//                     through the handler to its reply
+//   5 eth_turnaround  CommandServer, '#' received to reply    BENCHMARK_TURNAROUND_US
+//                     written, queueing included
+//   6 tick_jitter     |TrackingDds::tick() period - nominal|  BENCHMARK_JITTER_US
+//   7 main_loop       BenchLoad::poll() to the next call      BENCHMARK_MAIN_BUDGET_US
+//
+// Probes are written from whichever context runs the code they wrap: axis 1
+// and axis 2 step interrupts, the DDS interrupt and the main loop may all
+// feed one probe. record() therefore updates a probe with interrupts masked
+// (a few dozen cycles, part of what the probe itself measures). Reports are
+// read from the main loop without locking; one taken mid-update can be off
+// by one sample, which does not matter for statistics. Each periodic context
+// keeps its own previous-tick timestamp for NW_BENCH_PERIOD.
+//
+// BenchLoad replays a fixed script of status, position and driver queries
+// through the command handler at BENCHMARK_LOAD_HZ into a discarding sink,
+// so the parser and the handlers it reaches are timed under the polling load
+// of every host service at once.
+//
+// Commands (LX200 channel):
+//   :NWBQ#          probe count                                  -> n#
+//   :NWBQ<probe>#   name,count,overruns,min,p50,p99,p999,max,mean,budget#
+//                   (times in ns)
+//   :NWBZ#          reset all probes                             -> 1#
+//
+// Python side: OnStepXExtended.get_benchmark_report().
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AxisGeometry.h"
+
+#if BENCHMARK == ON && defined(ARDUINO) && defined(PINMAP_TEENSY41) && PINMAP != PINMAP_TEENSY41
+  #error "BENCHMARK needs the DWT cycle counter of PINMAP_TEENSY41"
+#endif
+
+namespace nightwatch {
+
+static_assert(BENCHMARK_ISR_SHARE > 0 && BENCHMARK_ISR_SHARE <= 100, "BENCHMARK_ISR_SHARE is a percentage");
+static_assert(BENCHMARK_LOAD_HZ > 0 && BENCHMARK_LOAD_HZ <= 10000, "BENCHMARK_LOAD_HZ must be between 1 and 10000");
+
+#if defined(F_CPU_ACTUAL)
+  #define NW_BENCH_CPU_HZ F_CPU_ACTUAL
+#else
+  #define NW_BENCH_CPU_HZ 600000000UL
+#endif
+
+// DWT cycle counter; Teensyduino enables it at startup
+inline uint32_t benchCycles() {
+#if defined(ARM_DWT_CYCCNT)
+  return ARM_DWT_CYCCNT;
+#else
+  return 0;
+#endif
+}
+
+inline uint32_t cyclesToNs(uint32_t cycles) { return (uint32_t)((uint64_t)cycles * 1000000000ULL / NW_BENCH_CPU_HZ); }
+inline uint32_t usToCycles(double us) { return (uint32_t)(us * 1e-6 * NW_BENCH_CPU_HZ + 0.5); }
+
+enum BenchProbe : uint8_t {
+  BENCH_STEP_ISR,
+  BENCH_DDS_TICK,
+  BENCH_ENCODER,
+  BENCH_SPI_POLL,
+  BENCH_LX200_PARSE,
+  BENCH_ETH_TURNAROUND,
+  BENCH_TICK_JITTER,
+  BENCH_MAIN_LOOP,
+  BENCH_PROBE_COUNT,
+};
+
+inline const char *benchProbeName(uint8_t probe) {
+  static const char *const names[BENCH_PROBE_COUNT] = {
+    "step_isr", "dds_tick", "encoder", "spi_poll", "lx200_parse", "eth_turnaround", "tick_jitter", "main_loop",
+  };
+  return probe < BENCH_PROBE_COUNT ? names[probe] : "";
+}
+
+// Budgets in cycles
+inline uint32_t benchBudgetCycles(uint8_t probe) {
+  switch (probe) {
+    case BENCH_STEP_ISR:       return usToCycles(1e6 / NW_STEP_RATE_MAX_HZ);
+    case BENCH_DDS_TICK:       return usToCycles(1e6 / TRACK_DDS_CLOCK_HZ);
+    case BENCH_ENCODER:        return usToCycles(1e6 / ENCODER_LOOP_HZ * BENCHMARK_ISR_SHARE / 100.0);
+    case BENCH_ETH_TURNAROUND: return usToCycles(BENCHMARK_TURNAROUND_US);
+    case BENCH_TICK_JITTER:    return usToCycles(BENCHMARK_JITTER_US);
+    default:                   return usToCycles(BENCHMARK_MAIN_BUDGET_US);
+  }
+}
+
+// =============================================================================
+// TIMING STATISTICS
+// =============================================================================
+class TimingStats {
+  public:
+    static constexpr uint8_t SUB_BITS = 4;
+    static constexpr uint32_t SUB = 1UL << SUB_BITS;
+    static constexpr uint8_t MAX_EXPONENT = 27;             // 2^28 cycles, ~450 ms
+    static constexpr uint16_t BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) * SUB;
+
+    void reset(uint32_t budget) {
+      memset(buckets_, 0, sizeof(buckets_));
+      count_ = overruns_ = max_ = 0;
+      min_ = 0xFFFFFFFFUL;
+      sum_ = 0;
+      budget_ = budget;
+    }
+
+    void record(uint32_t cycles) {
+      buckets_[bucket(cycles)]++;
+      count_++;
+      sum_ += cycles;
+      if (cycles < min_) min_ = cycles;
+      if (cycles > max_) max_ = cycles;
+      if (cycles > budget_) overruns_++;
+    }
+
+    // Upper bound of the bucket holding the perMille-th sample, cycles
+    uint32_t percentile(uint16_t perMille) const {
+      if (count_ == 0) return 0;
+      const uint64_t rank = ((uint64_t)count_ * perMille + 999) / 1000;
+      uint64_t seen = 0;
+      for (uint16_t i = 0; i < BUCKETS; i++) {
+        seen += buckets_[i];
+        if (seen >= rank) { const uint32_t upper = bucketUpper(i); return upper < max_ ? upper : max_; }
+      }
+      return max_;
+    }
+
+    uint32_t count() const { return count_; }
+    uint32_t overruns() const { return overruns_; }
+    uint32_t min() const { return count_ == 0 ? 0 : min_; }
+    uint32_t max() const { return max_; }
+    uint32_t mean() const { return count_ == 0 ? 0 : (uint32_t)(sum_ / count_); }
+    uint32_t budget() const { return budget_; }
+
+    static uint16_t bucket(uint32_t v) {
+      if (v < SUB) return (uint16_t)v;
+      const uint8_t e = (uint8_t)(31 - __builtin_clz(v));
+      if (e > MAX_EXPONENT) return BUCKETS - 1;
+      return (uint16_t)((e - SUB_BITS + 1) * SUB + ((v >> (e - SUB_BITS)) & (SUB - 1)));
+    }
+
+    static uint32_t bucketUpper(uint16_t i) {
+      if (i < SUB) return i;
+      const uint8_t e = (uint8_t)(i / SUB + SUB_BITS - 1);
+      const uint32_t lower = (SUB + (i % SUB)) << (e - SUB_BITS);
+      return lower + (1UL << (e - SUB_BITS)) - 1;
+    }
+
+  private:
+    uint32_t buckets_[BUCKETS];
+    uint32_t count_ = 0;
+    uint32_t overruns_ = 0;
+    uint32_t min_ = 0xFFFFFFFFUL;
+    uint32_t max_ = 0;
+    uint64_t sum_ = 0;
+    uint32_t budget_ = 0;
+};
+
+// =============================================================================
+// PROBES
+// =============================================================================
+class Benchmark {
+  public:
+    void begin() { reset(); }
+
+    void reset() {
+      NW_ISR_LOCK();
+      for (uint8_t i = 0; i < BENCH_PROBE_COUNT; i++) stats_[i].reset(benchBudgetCycles(i));
+      NW_ISR_UNLOCK();
+      ddsPeriodCycles_ = usToCycles(1e6 / TRACK_DDS_CLOCK_HZ);
+    }
+
+    // Safe from any interrupt priority
+    void record(uint8_t probe, uint32_t cycles) {
+      NW_ISR_LOCK();
+      stats_[probe].record(cycles);
+      NW_ISR_UNLOCK();
+    }
+
+    // Periodic entry: records |cycles since the caller's previous entry -
+    // nominalCycles| into probe. last is the caller's own timestamp (0 until
+    // the first entry), so contexts never share one.
+    void period(uint8_t probe, uint32_t &last, uint32_t nominalCycles) {
+      const uint32_t now = benchCycles();
+      const uint32_t previous = last;
+      last = now;
+      if (previous == 0) return;
+      const uint32_t elapsed = now - previous;
+      record(probe, elapsed > nominalCycles ? elapsed - nominalCycles : nominalCycles - elapsed);
+    }
+
+    uint32_t ddsPeriodCycles() const { return ddsPeriodCycles_; }
+
+    const TimingStats &stats(uint8_t probe) const { return stats_[probe]; }
+
+    // :NWBQ / :NWBZ with the "NWB" stripped; false for anything else
+    bool handle(const char *arg, char *reply, size_t replySize) {
+      if (arg[0] == 'Z' && arg[1] == 0) { reset(); snprintf(reply, replySize, "1#"); return true; }
+      if (arg[0] != 'Q') return false;
+      if (arg[1] == 0) { snprintf(reply, replySize, "%u#", (unsigned)BENCH_PROBE_COUNT); return true; }
+      const int probe = atoi(arg + 1);
+      if (probe < 0 || probe >= BENCH_PROBE_COUNT) { snprintf(reply, replySize, "0#"); return true; }
+      const TimingStats &s = stats_[probe];
+      snprintf(reply, replySize, "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu#", benchProbeName(probe),
+               (unsigned long)s.count(), (unsigned long)s.overruns(),
+               (unsigned long)cyclesToNs(s.min()), (unsigned long)cyclesToNs(s.percentile(500)),
+               (unsigned long)cyclesToNs(s.percentile(990)), (unsigned long)cyclesToNs(s.percentile(999)),
+               (unsigned long)cyclesToNs(s.max()), (unsigned long)cyclesToNs(s.mean()),
+               (unsigned long)cyclesToNs(s.budget()));
+      return true;
+    }
+
+    // Table for SERIAL_A at boot or on demand; Print is any Arduino Print
+    template <typename Print>
+    void report(Print &out) const {
+      char line[112];
+      out.print("probe           count  over   p50ns   p99ns  p999ns   maxns  budget\r\n");
+      for (uint8_t i = 0; i < BENCH_PROBE_COUNT; i++) {
+        const TimingStats &s = stats_[i];
+        snprintf(line, sizeof(line), "%-14s %6lu %5lu %7lu %7lu %7lu %7lu %7lu\r\n", benchProbeName(i),
+                 (unsigned long)s.count(), (unsigned long)s.overruns(),
+                 (unsigned long)cyclesToNs(s.percentile(500)), (unsigned long)cyclesToNs(s.percentile(990)),
+                 (unsigned long)cyclesToNs(s.percentile(999)), (unsigned long)cyclesToNs(s.max()),
+                 (unsigned long)cyclesToNs(s.budget()));
+        out.print(line);
+      }
+    }
+
+  private:
+    TimingStats stats_[BENCH_PROBE_COUNT];
+    uint32_t ddsPeriodCycles_ = 0;
+};
+
+// Times the enclosing scope into one probe
+class BenchScope {
+  public:
+    BenchScope(Benchmark &bench, uint8_t probe) : bench_(bench), probe_(probe), start_(benchCycles()) {}
+    ~BenchScope() { bench_.record(probe_, benchCycles() - start_); }
+  private:
+    Benchmark &bench_;
+    uint8_t probe_;
+    uint32_t start_;
+};
+
+#if BENCHMARK == ON
+  inline Benchmark bench;
+  #define NW_BENCH_CONCAT2(a, b) a##b
+  #define NW_BENCH_CONCAT(a, b) NW_BENCH_CONCAT2(a, b)
+  #define NW_BENCH_SCOPE(probe) nightwatch::BenchScope NW_BENCH_CONCAT(nwBench, __LINE__)(nightwatch::bench, probe)
+  #define NW_BENCH_PERIOD(probe, last, nominalCycles) nightwatch::bench.period(probe, last, nominalCycles)
+  #define NW_BENCH_START() nightwatch::benchCycles()
+  #define NW_BENCH_SINCE(probe, startCycles) nightwatch::bench.record(probe, nightwatch::benchCycles() - (startCycles))
+#else
+  #define NW_BENCH_SCOPE(probe)
+  #define NW_BENCH_PERIOD(probe, last, nominalCycles)
+  #define NW_BENCH_START() 0
+  #define NW_BENCH_SINCE(probe, startCycles)
+#endif
+
+// =============================================================================
+// SYNTHETIC LOAD
+// =============================================================================
+// Discards replies; stands in for an EthernetClient in the command handler
+struct BenchSink {
+  size_t write(const uint8_t *, size_t n) { return n; }
+  size_t write(uint8_t) { return 1; }
+};
+
+// Sink is the reply type the command handler takes
+template <typename Sink>
+class BenchLoad {
+  public:
+    typedef void (*CommandHandler)(const char *command, Sink &reply);
+
+    void begin(CommandHandler handler) { handler_ = handler; }
+
+    // Call every main loop pass; at most one command per call. The time
+    // between calls is the main_loop probe.
+    void poll(uint32_t nowUs) {
+      NW_BENCH_PERIOD(BENCH_MAIN_LOOP, loopCycles_, 0);
+      if (handler_ == nullptr || nowUs - lastUs_ < 1000000UL / BENCHMARK_LOAD_HZ) return;
+      lastUs_ = nowUs;
+      static const char *const script[] = {"GR", "GD", "GU", "NWS", "GA", "GZ", "GXU1", "GXU2", "NWDS", "NWEQ1", "GT"};
+      const char *command = script[next_++ % (sizeof(script) / sizeof(script[0]))];
+      {
+        NW_BENCH_SCOPE(BENCH_LX200_PARSE);
+        handler_(command, sink_);
+      }
+      sent_++;
+    }
+
+    uint32_t sent() const { return sent_; }
+
+  private:
+    CommandHandler handler_ = nullptr;
+    Sink sink_;
+    uint32_t lastUs_ = 0;
+    uint32_t next_ = 0;
+    uint32_t sent_ = 0;
+    uint32_t loopCycles_ = 0;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,382 @@
+// NIGHTWATCH Firmware Extensions - Multi-Session Command Server
+//
+// Replaces the single-client ETHERNET_CMD_PORT channel. The orchestrator,
+// safety monitor, INDI adapter and Alpaca client each hold their own TCP
+// session (up to CMD_SERVER_SESSIONS) instead of taking turns on one socket
+// behind LX200Client._lock on the host.
+//
+// Every session has its own non-blocking parser: bytes are read as they
+// arrive (at most CMD_SERVER_READ_BUDGET per session per pass), complete
+// ":...#" commands go to a per-session queue of CMD_SERVER_QUEUE entries, and
+// a full queue simply stops reading that socket until it drains. Commands of
+// one session always run in order. Between sessions the dispatcher takes the
+// highest priority class with work, round-robin inside a class, and runs at
+// most CMD_SERVER_DISPATCH_BUDGET commands per main loop pass.
+//
+// Priority classes, set per session with :NWCP<n>#:
+//   0  safety    safety monitor
+//   1  control   default for new sessions
+//   2  query     pollers; only run when no safety or control work is queued
+//
+// Urgent commands never queue. :Q# (and :Qe/:Qw/:Qn/:Qs) from any session and
+// :hP# from a safety session run the moment their '#' is parsed, and safety
+// sessions are re-read before every dispatched command. An emergency park
+// therefore waits for at most one command already executing, however many
+// queries are queued. An urgent command also drops every motion command
+// still queued in any session (see isMotionCommand()), so a goto sent before
+// the stop does not run after it. Dropped commands get no reply: a client
+// times out on them rather than reading a refusal as a started goto.
+//
+// :NWU# uploads share one FrameReceiver of CMD_SERVER_UPLOAD_CAPACITY bytes.
+// A second session uploading at the same time gets 0# and its frame is
+// skipped by length so none of it is parsed as text. So is the rest of an
+// upload that fails once its header is in (oversize length, stall past
+// CMD_SERVER_UPLOAD_TIMEOUT_MS).
+//
+// Each command's time from its '#' being parsed to its handler returning
+// (micros, so queueing and execution both count) goes into a latency
+// histogram per priority class, urgent commands included; MetricsEndpoint
+// exports them.
+//
+// Commands handled here (others go to the OnStepX command processor):
+//   :NWCP<0|1|2>#   set this session's priority class         -> 1# or 0#
+//   :NWCP#          this session's class and the open count   -> <class>,<sessions>#
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmark.h"
+#include "Frame.h"
+
+namespace nightwatch {
+
+enum CommandPriority : uint8_t {
+  CMD_PRIORITY_SAFETY = 0,
+  CMD_PRIORITY_CONTROL = 1,
+  CMD_PRIORITY_QUERY = 2,
+  CMD_PRIORITY_COUNT = 3,
+};
+
+static_assert(CMD_SERVER_SESSIONS >= 1 && CMD_SERVER_SESSIONS <= 8, "CMD_SERVER_SESSIONS must be 1-8 (NativeEthernet socket limit)");
+static_assert(CMD_SERVER_QUEUE >= 1 && CMD_SERVER_QUEUE <= 16, "CMD_SERVER_QUEUE must be 1-16");
+static_assert(CMD_SERVER_LINE >= 16, "CMD_SERVER_LINE too short for LX200 commands");
+
+// Urgent: stops from anyone, park only from a safety session. command has
+// no ':' or '#'.
+inline bool isUrgentCommand(const char *command, uint8_t priority) {
+  if (command[0] == 'Q' && (command[1] == 0 || (command[2] == 0 && strchr("ewns", command[1]) != nullptr))) return true;
+  return priority == CMD_PRIORITY_SAFETY && strcmp(command, "hP") == 0;
+}
+
+// Commands that start or aim motion: moves and gotos (M*), goto targets
+// (Sr/Sd/Sa/Sz), home/park/unpark (h*), and the NIGHTWATCH commands that
+// slew (spline start, backlash sweep, StallGuard calibration, next queued
+// target). Purged from the queues by an urgent command.
+inline bool isMotionCommand(const char *command) {
+  if (command[0] == 'M' || command[0] == 'h') return true;
+  if (command[0] == 'S') return command[1] != 0 && strchr("rdaz", command[1]) != nullptr;
+  return strcmp(command, "NWKS") == 0 || strcmp(command, "NWQN") == 0 ||
+         strncmp(command, "NWLC", 4) == 0 || strncmp(command, "NWSC", 4) == 0;
+}
+
+constexpr uint8_t CMD_LATENCY_BUCKETS = 8;
+constexpr uint32_t CMD_LATENCY_BOUNDS_US[CMD_LATENCY_BUCKETS] = {100, 250, 500, 1000, 2500, 5000, 10000, 50000};
+
+// Command latency of one priority class. buckets[i] counts latencies up to
+// CMD_LATENCY_BOUNDS_US[i] (not cumulative); the last one everything above.
+struct CommandLatency {
+  uint32_t buckets[CMD_LATENCY_BUCKETS + 1];
+  uint32_t count;
+  uint64_t sumUs;
+
+  void add(uint32_t us) {
+    uint8_t i = 0;
+    while (i < CMD_LATENCY_BUCKETS && us > CMD_LATENCY_BOUNDS_US[i]) i++;
+    buckets[i]++;
+    count++;
+    sumUs += us;
+  }
+};
+
+// Server and Client are the Arduino Ethernet classes (NativeEthernet
+// EthernetServer / EthernetClient on Teensy 4.1).
+template <typename Server, typename Client>
+class CommandServer {
+  public:
+    // Runs one LX200 command (no ':' or '#') and writes its reply, text or
+    // binary frame, straight to the session's client
+    typedef void (*CommandHandler)(const char *command, Client &reply);
+    // Applies an uploaded frame by type; false replies 0#
+    typedef bool (*UploadHandler)(uint8_t type, const uint8_t *payload, uint16_t length);
+
+    void begin(Server *server, CommandHandler command, UploadHandler upload) {
+      server_ = server;
+      command_ = command;
+      upload_ = upload;
+      server_->begin();
+    }
+
+    // Call every main loop pass
+    void poll(uint32_t nowMs) {
+      if (server_ == nullptr) return;
+      accept();
+      for (uint8_t i = 0; i < CMD_SERVER_SESSIONS; i++) {
+        if (sessions_[i].active) {
+          if (!sessions_[i].client.connected()) close(i);
+          else read(i, nowMs);
+        }
+      }
+      checkUpload(nowMs);
+      for (uint8_t n = 0; n < CMD_SERVER_DISPATCH_BUDGET; n++) {
+        serviceSafety(nowMs);
+        if (!dispatchOne()) break;
+      }
+    }
+
+    uint8_t sessionCount() const {
+      uint8_t n = 0;
+      for (const Session &s : sessions_) if (s.active) n++;
+      return n;
+    }
+
+    uint8_t queued(uint8_t priority) const {
+      uint8_t n = 0;
+      for (const Session &s : sessions_) if (s.active && s.priority == priority) n += s.count;
+      return n;
+    }
+
+    const CommandLatency &latency(uint8_t priority) const { return latency_[priority]; }
+
+    // Motion commands dropped from the queues by urgent commands
+    uint32_t purged() const { return purged_; }
+
+  private:
+    typedef FrameReceiver<CMD_SERVER_UPLOAD_CAPACITY> Receiver;
+
+    struct Session {
+      Client client;
+      char line[CMD_SERVER_LINE];
+      char queue[CMD_SERVER_QUEUE][CMD_SERVER_LINE];
+      uint32_t queuedUs[CMD_SERVER_QUEUE];      // '#' parsed, NW_MICROS()
+      uint32_t queuedCycles[CMD_SERVER_QUEUE];   // '#' parsed, for the eth_turnaround probe
+      uint8_t lineLength;
+      uint8_t head;
+      uint8_t count;
+      uint8_t priority;
+      bool active;
+      bool inCommand;      // between ':' and '#'
+      bool overflow;       // line too long, discard to the next '#'
+      bool uploading;      // feeding the shared FrameReceiver
+      uint8_t skipHeader;  // header bytes of a refused frame still to skip
+      uint16_t skipLength;
+      uint32_t skipRemaining;
+    };
+
+    void accept() {
+      Client client = server_->accept();
+      if (!client) return;
+      for (Session &s : sessions_) {
+        if (s.active) continue;
+        s = Session();
+        s.client = client;
+        s.priority = CMD_PRIORITY_CONTROL;
+        s.active = true;
+        return;
+      }
+      client.stop();   // all sessions in use
+    }
+
+    void close(uint8_t index) {
+      Session &s = sessions_[index];
+      if (s.uploading) receiver_.reset();
+      s.client.stop();
+      s.active = false;
+    }
+
+    void serviceSafety(uint32_t nowMs) {
+      for (uint8_t i = 0; i < CMD_SERVER_SESSIONS; i++) {
+        if (sessions_[i].active && sessions_[i].priority == CMD_PRIORITY_SAFETY) read(i, nowMs);
+      }
+    }
+
+    void read(uint8_t index, uint32_t nowMs) {
+      Session &s = sessions_[index];
+      for (uint16_t budget = CMD_SERVER_READ_BUDGET; budget > 0 && s.count < CMD_SERVER_QUEUE; budget--) {
+        if (s.client.available() <= 0) return;
+        const int c = s.client.read();
+        if (c < 0) return;
+        feed(index, (uint8_t)c, nowMs);
+      }
+    }
+
+    void feed(uint8_t index, uint8_t c, uint32_t nowMs) {
+      Session &s = sessions_[index];
+      if (s.uploading) {
+        const auto state = receiver_.feed(c);
+        if (state == Receiver::FR_RECEIVING) return;
+        if (state == Receiver::FR_ERROR) skipRest(s);
+        const bool ok = state == Receiver::FR_COMPLETE &&
+                        upload_ != nullptr && upload_(receiver_.type(), receiver_.payload(), receiver_.length());
+        finishUpload(s, ok);
+        return;
+      }
+      if (s.skipHeader > 0 || s.skipRemaining > 0) { skip(s, c); return; }
+
+      // ':' only opens a command; inside one it is text (:Sr05:30:00#)
+      if (c == ':' && !s.inCommand) {
+        s.inCommand = true;
+        s.overflow = false;
+        s.lineLength = 0;
+        return;
+      }
+      if (!s.inCommand) return;
+      if (c != '#') {
+        if (s.lineLength < CMD_SERVER_LINE - 1) s.line[s.lineLength++] = (char)c;
+        else s.overflow = true;
+        return;
+      }
+      s.inCommand = false;
+      if (s.overflow) return;
+      s.line[s.lineLength] = 0;
+      accepted(index, nowMs);
+    }
+
+    // A complete command from session index
+    void accepted(uint8_t index, uint32_t nowMs) {
+      Session &s = sessions_[index];
+      if (strcmp(s.line, "NWU") == 0) {
+        if (receiver_.state() == Receiver::FR_RECEIVING) {
+          s.skipHeader = FRAME_HEADER_SIZE;
+          s.client.write((const uint8_t *)"0#", 2);
+          return;
+        }
+        receiver_.arm(nowMs);
+        s.uploading = true;
+        return;
+      }
+      if (isUrgentCommand(s.line, s.priority)) {
+        const uint32_t parsedUs = NW_MICROS();
+        purgeMotion();
+        execute(s, s.line, NW_BENCH_START());
+        latency_[s.priority].add(NW_MICROS() - parsedUs);
+        return;
+      }
+      const uint8_t slot = (s.head + s.count) % CMD_SERVER_QUEUE;
+      memcpy(s.queue[slot], s.line, s.lineLength + 1);
+      s.queuedUs[slot] = NW_MICROS();
+      s.queuedCycles[slot] = NW_BENCH_START();
+      s.count++;
+    }
+
+    // Drop queued motion commands from every session, keeping the order of
+    // the rest
+    void purgeMotion() {
+      for (Session &s : sessions_) {
+        if (!s.active) continue;
+        uint8_t kept = 0;
+        for (uint8_t n = 0; n < s.count; n++) {
+          const uint8_t from = (s.head + n) % CMD_SERVER_QUEUE;
+          if (isMotionCommand(s.queue[from])) { purged_++; continue; }
+          const uint8_t to = (s.head + kept) % CMD_SERVER_QUEUE;
+          if (to != from) {
+            memcpy(s.queue[to], s.queue[from], CMD_SERVER_LINE);
+            s.queuedUs[to] = s.queuedUs[from];
+            s.queuedCycles[to] = s.queuedCycles[from];
+          }
+          kept++;
+        }
+        s.count = kept;
+      }
+    }
+
+    void finishUpload(Session &s, bool ok) {
+      receiver_.reset();
+      s.uploading = false;
+      s.client.write((const uint8_t *)(ok ? "1#" : "0#"), 2);
+    }
+
+    void checkUpload(uint32_t nowMs) {
+      if (receiver_.checkTimeout(nowMs, CMD_SERVER_UPLOAD_TIMEOUT_MS) != Receiver::FR_ERROR) return;
+      for (Session &s : sessions_) {
+        if (!s.active || !s.uploading) continue;
+        skipRest(s);
+        finishUpload(s, false);
+      }
+      receiver_.reset();
+    }
+
+    // Step over a frame refused because the receiver was busy: read the
+    // header for its length, then drop payload and CRC
+    void skip(Session &s, uint8_t c) {
+      if (s.skipHeader == 0) { s.skipRemaining--; return; }
+      if (s.skipHeader == 2) s.skipLength = c;                     // length, low byte
+      if (s.skipHeader == 1) s.skipRemaining = (uint32_t)(s.skipLength | (uint16_t)c << 8) + FRAME_TRAILER_SIZE;
+      s.skipHeader--;
+    }
+
+    // Step over what is left of a failed upload by replaying the bytes the
+    // receiver already took through skip(). Nothing is skipped after a bad
+    // sync (not a frame) or a CRC failure (the whole frame is in).
+    void skipRest(Session &s) {
+      const uint8_t *frame = receiver_.received();
+      const uint16_t size = receiver_.receivedSize();
+      if (size < 2 || frame[0] != FRAME_SYNC_0 || frame[1] != FRAME_SYNC_1) return;
+      s.skipHeader = FRAME_HEADER_SIZE;
+      for (uint16_t i = 0; i < size; i++) skip(s, frame[i]);
+    }
+
+    bool dispatchOne() {
+      for (uint8_t priority = 0; priority < CMD_PRIORITY_COUNT; priority++) {
+        for (uint8_t n = 0; n < CMD_SERVER_SESSIONS; n++) {
+          const uint8_t i = (next_[priority] + n) % CMD_SERVER_SESSIONS;
+          Session &s = sessions_[i];
+          if (!s.active || s.priority != priority || s.count == 0) continue;
+          next_[priority] = (i + 1) % CMD_SERVER_SESSIONS;
+          const char *command = s.queue[s.head];
+          const uint32_t hashCycles = s.queuedCycles[s.head];
+          const uint32_t parsedUs = s.queuedUs[s.head];
+          s.head = (s.head + 1) % CMD_SERVER_QUEUE;
+          s.count--;
+          execute(s, command, hashCycles);
+          latency_[priority].add(NW_MICROS() - parsedUs);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // hashCycles: NW_BENCH_START() when the command's '#' was parsed
+    void execute(Session &s, const char *command, uint32_t hashCycles) {
+      {
+        NW_BENCH_SCOPE(BENCH_LX200_PARSE);
+        if (strncmp(command, "NWCP", 4) == 0) priorityCommand(s, command + 4);
+        else if (command_ != nullptr) command_(command, s.client);
+      }
+      NW_BENCH_SINCE(BENCH_ETH_TURNAROUND, hashCycles);
+      (void)hashCycles;
+    }
+
+    void priorityCommand(Session &s, const char *arg) {
+      char reply[12] = "0#";
+      if (arg[0] == 0) {
+        snprintf(reply, sizeof(reply), "%u,%u#", (unsigned)s.priority, (unsigned)sessionCount());
+      } else if (arg[1] == 0 && arg[0] >= '0' && arg[0] < '0' + CMD_PRIORITY_COUNT) {
+        s.priority = (uint8_t)(arg[0] - '0');
+        strcpy(reply, "1#");
+      }
+      s.client.write((const uint8_t *)reply, strlen(reply));
+    }
+
+    Server *server_ = nullptr;
+    CommandHandler command_ = nullptr;
+    UploadHandler upload_ = nullptr;
+    Session sessions_[CMD_SERVER_SESSIONS] = {};
+    uint8_t next_[CMD_PRIORITY_COUNT] = {};
+    CommandLatency latency_[CMD_PRIORITY_COUNT] = {};
+    uint32_t purged_ = 0;
+    Receiver receiver_;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,96 @@
+// NIGHTWATCH Firmware Extensions - Load-Adaptive Motor Current
+//
+// AXIS*_DRIVER_IHOLD / IRUN / IGOTO are fixed currents sized for the worst
+// case and run all night. With COOLSTEP ON they become bounds instead:
+//
+//   Gotos     TMC5160 CoolStep in hardware. IRUN is set to IGOTO and COOLCONF
+//             lets the driver scale the coil current down to IGOTO/2 from
+//             SG_RESULT while the load is light and back up within a few
+//             full steps when it grows. CoolStep needs SpreadCycle and runs
+//             above TCOOLTHRS, which is the StallGuardCal crossover.
+//   Tracking  StallGuard2 has no signal at sidereal speed, so the current is
+//             trimmed in firmware from the EncoderLoop following error: every
+//             COOLSTEP_TRACK_INTERVAL_MS it drops COOLSTEP_TRACK_STEP_MA toward
+//             IHOLD while the error stays under COOLSTEP_TRACK_LAG_ARCSEC and
+//             jumps back up four steps (capped at IRUN) as soon as it does not.
+//             Without an engaged encoder loop tracking stays at IRUN.
+//
+// Currents are in mA; the glue applies runCurrentMa() through the OnStepX
+// TMC driver's current setter and writes coolconf() to COOLCONF.
+
+#pragma once
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+constexpr uint8_t TMC_COOLCONF = 0x6D;
+constexpr uint8_t TMC_TCOOLTHRS = 0x14;
+
+static_assert(COOLSTEP_SEMIN >= 1 && COOLSTEP_SEMIN <= 15, "COOLSTEP_SEMIN must be 1-15 (0 disables CoolStep)");
+static_assert(COOLSTEP_SEMAX <= 15 && COOLSTEP_SEUP <= 3 && COOLSTEP_SEDN <= 3,
+              "COOLSTEP_SEMAX 0-15, COOLSTEP_SEUP / SEDN 0-3");
+static_assert(COOLSTEP_TRACK_LAG_ARCSEC < ENCODER_LOOP_SLIP_ARCSEC,
+              "COOLSTEP_TRACK_LAG_ARCSEC must react before the encoder loop declares a slip");
+
+// IHold, IRun, IGoto: AXIS*_DRIVER_IHOLD / IRUN / IGOTO in mA
+template <uint32_t IHold, uint32_t IRun, uint32_t IGoto>
+class CoolStepControl {
+  public:
+    static_assert(IHold <= IRun && IRun <= IGoto, "Driver currents must satisfy IHOLD <= IRUN <= IGOTO");
+    static_assert(IGoto / 2 >= IHold, "CoolStep would drop goto current below IHOLD; lower IHOLD or raise IGOTO");
+
+    // COOLCONF with the CoolStep fields set and the StallGuard bits (SGT,
+    // SFILT) of the current value kept. seimin = 0: floor is IRUN/2.
+    static constexpr uint32_t coolconf(uint32_t current) {
+      return (current & 0x01FF0000UL) |
+             (uint32_t)COOLSTEP_SEMIN | ((uint32_t)COOLSTEP_SEUP << 5) |
+             ((uint32_t)COOLSTEP_SEMAX << 8) | ((uint32_t)COOLSTEP_SEDN << 13);
+    }
+
+    // Lowest coil current the hardware may scale a goto down to
+    static constexpr uint32_t gotoFloorMa = IGoto / 2;
+
+    // ---- main loop side ----------------------------------------------------
+
+    void beginGoto() { goto_ = true; }
+    void endGoto(uint32_t nowMs) { goto_ = false; nextMs_ = nowMs + COOLSTEP_TRACK_INTERVAL_MS; }
+
+    // Call every main loop pass while tracking with the EncoderLoop error.
+    // Returns true when runCurrentMa() changed and must be applied.
+    bool track(uint32_t nowMs, bool loopEngaged, int32_t errorMas) {
+      if (goto_) return false;
+      const uint32_t previous = trackMa_;
+      if (!loopEngaged) {
+        trackMa_ = IRun;
+      } else {
+        const int32_t magnitude = errorMas < 0 ? -errorMas : errorMas;
+        if (magnitude > lagMas) {
+          trackMa_ += 4 * COOLSTEP_TRACK_STEP_MA;                  // react at once
+          nextMs_ = nowMs + COOLSTEP_TRACK_INTERVAL_MS;
+        } else if ((int32_t)(nowMs - nextMs_) >= 0) {
+          trackMa_ = trackMa_ > IHold + COOLSTEP_TRACK_STEP_MA ? trackMa_ - COOLSTEP_TRACK_STEP_MA : IHold;
+          nextMs_ = nowMs + COOLSTEP_TRACK_INTERVAL_MS;
+        }
+        if (trackMa_ > IRun) trackMa_ = IRun;
+      }
+      return trackMa_ != previous;
+    }
+
+    // IRUN to program now: IGOTO during gotos (CoolStep scales below it),
+    // otherwise the tracking setpoint
+    uint32_t runCurrentMa() const { return goto_ ? IGoto : trackMa_; }
+    uint32_t trackingCurrentMa() const { return trackMa_; }
+
+  private:
+    static constexpr int32_t lagMas = (int32_t)(COOLSTEP_TRACK_LAG_ARCSEC * 1000.0);
+
+    uint32_t trackMa_ = IRun;
+    uint32_t nextMs_ = 0;
+    bool goto_ = false;
+};
+
+using Axis1CoolStep = CoolStepControl<AXIS1_DRIVER_IHOLD, AXIS1_DRIVER_IRUN, AXIS1_DRIVER_IGOTO>;
+using Axis2CoolStep = CoolStepControl<AXIS2_DRIVER_IHOLD, AXIS2_DRIVER_IRUN, AXIS2_DRIVER_IGOTO>;
+
+} // namespace nightwatch
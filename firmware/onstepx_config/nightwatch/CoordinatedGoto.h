@@ -0,0 +1,113 @@
+// NIGHTWATCH Firmware Extensions - Coordinated Two-Axis Goto
+//
+// Plans both SCurvePlanner axes so they arrive together. Each axis is first
+// timed with its own limits; the faster one is then re-planned with its
+// rate, acceleration and jerk scaled by 1/k, 1/k² and 1/k³ (k = slow / fast
+// duration), which stretches its profile in time by exactly k while staying
+// inside every limit. The goto ends when the slower axis would have ended
+// anyway, but the faster axis moves gently and both settle at once.
+//
+// Meridian flips are normally two legs: a waypoint, then the target on the
+// new pier side. With GOTO_FLIP_OVERLAP ON the legs collapse into one
+// coordinated move when flipOverlapAllowed() says the swept region is safe.
+// Coordinated profiles are monotonic on both axes, so the region swept is
+// exactly the box spanned by start and end:
+//   - the axis1 span must stay within AXIS1_PAST_MERIDIAN_LIMIT_E/W of the
+//     counterweight-horizontal position on both sides, and
+//   - the lowest axis2 (Dec) in the box must clear GOTO_FLIP_OVERLAP_AXIS2_MIN,
+//     below which the tube can reach the pier with the counterweight high.
+//
+// Axis1 here is the instrument angle in degrees with 0 = counterweight down,
+// +90 / -90 = counterweight horizontal to the east / west.
+//
+// Commands (text, LX200 channel):
+//   :NWGM<0|1>#     independent / coordinated gotos             -> 1# or 0#
+//   :NWGM#          current mode                                -> 0# or 1#
+
+#pragma once
+
+#include "SCurvePlanner.h"
+
+namespace nightwatch {
+
+struct AxisLimits {
+  double rateDeg;
+  double accelerationDeg;
+  double jerkDeg;
+};
+
+// Per-axis limits: AXIS*_SLEW_RATE_DESIRED capped by GOTO_RATE
+constexpr double minRate(double a, double b) { return a < b ? a : b; }
+constexpr AxisLimits AXIS1_GOTO_LIMITS = {minRate(AXIS1_SLEW_RATE_DESIRED, GOTO_RATE), GOTO_ACCELERATION, AXIS1_JERK};
+constexpr AxisLimits AXIS2_GOTO_LIMITS = {minRate(AXIS2_SLEW_RATE_DESIRED, GOTO_RATE), GOTO_ACCELERATION, AXIS2_JERK};
+
+// Duration of a rest-to-rest goto of steps goto microsteps (seconds, 0 if no move)
+template <typename Geometry>
+inline double gotoDuration(int32_t steps, const AxisLimits &limits) {
+  const double k = Geometry::stepsPerDegreeGoto;
+  SCurveProfile profile;
+  if (!profile.plan(steps < 0 ? -(double)steps : (double)steps,
+                    limits.rateDeg * k, limits.accelerationDeg * k, limits.jerkDeg * k)) return 0;
+  return profile.duration();
+}
+
+// Limits stretched so a goto takes `scale` times longer
+inline AxisLimits scaledLimits(const AxisLimits &limits, double scale) {
+  return AxisLimits{limits.rateDeg / scale,
+                    limits.accelerationDeg / (scale * scale),
+                    limits.jerkDeg / (scale * scale * scale)};
+}
+
+class CoordinatedGoto {
+  public:
+    // Plan both axes; distances in goto microsteps (signed). Returns false if
+    // either planner is busy or refuses its profile (an axis with 0 steps has
+    // nothing to plan and counts as planned); neither axis is left running
+    // then. With GOTO_COORDINATED OFF each axis runs on its own limits.
+    bool plan(Axis1SCurvePlanner &axis1, Axis2SCurvePlanner &axis2, int32_t steps1, int32_t steps2) {
+      if (axis1.active() || axis2.active()) return false;
+      AxisLimits limits1 = AXIS1_GOTO_LIMITS;
+      AxisLimits limits2 = AXIS2_GOTO_LIMITS;
+      const double t1 = gotoDuration<Axis1Geometry>(steps1, limits1);
+      const double t2 = gotoDuration<Axis2Geometry>(steps2, limits2);
+    #if GOTO_COORDINATED == ON
+      if (t1 > 0 && t2 > 0) {
+        if (t1 > t2) limits2 = scaledLimits(limits2, t1 / t2);
+        else if (t2 > t1) limits1 = scaledLimits(limits1, t2 / t1);
+      }
+    #endif
+      duration_ = t1 > t2 ? t1 : t2;
+      const bool planned1 = steps1 == 0 || axis1.plan(steps1, limits1.rateDeg, limits1.accelerationDeg, limits1.jerkDeg);
+      const bool planned2 = steps2 == 0 || axis2.plan(steps2, limits2.rateDeg, limits2.accelerationDeg, limits2.jerkDeg);
+      if (planned1 && planned2) return true;
+      // Half a goto would land off target: drop the axis that did start
+      axis1.cancel();
+      axis2.cancel();
+      duration_ = 0;
+      return false;
+    }
+
+    // Expected goto time of the last plan(), seconds
+    double durationSeconds() const { return duration_; }
+
+    // True when a flip's waypoint leg can be merged with the Dec move
+    static bool flipOverlapAllowed(double axis1Start, double axis1End,
+                                   double axis2Start, double axis2End) {
+    #if GOTO_FLIP_OVERLAP == ON && GOTO_COORDINATED == ON
+      const double east = 90.0 + AXIS1_PAST_MERIDIAN_LIMIT_E;
+      const double west = -90.0 - AXIS1_PAST_MERIDIAN_LIMIT_W;
+      const double lo1 = axis1Start < axis1End ? axis1Start : axis1End;
+      const double hi1 = axis1Start < axis1End ? axis1End : axis1Start;
+      const double lo2 = axis2Start < axis2End ? axis2Start : axis2End;
+      return lo1 >= west && hi1 <= east && lo2 >= GOTO_FLIP_OVERLAP_AXIS2_MIN;
+    #else
+      (void)axis1Start; (void)axis1End; (void)axis2Start; (void)axis2End;
+      return false;
+    #endif
+    }
+
+  private:
+    double duration_ = 0;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,198 @@
+// NIGHTWATCH Firmware Extensions - Cached TMC5160 Driver Status
+//
+// With AXIS*_DRIVER_STATUS / AXIS*_DRIVER_STALLGUARD ON, every :GXU<axis>#
+// used to read DRV_STATUS over SPI inside the command handler, so each
+// get_driver_status() call from the host cost bus time in the motion loop.
+// DriverStatusCache polls both drivers in the background at
+// DRIVER_STATUS_POLL_HZ and keeps a double-buffered snapshot per axis; every
+// status query (:GXU, :NWS, :NWDS) is answered from the snapshot and never
+// touches the bus.
+//
+// DRV_STATUS carries everything the host asks for: the fault and standstill
+// flags, SG_RESULT (bits 0-9), CS_ACTUAL (bits 16-20) and the otpw / ot
+// temperature flags (the TMC5160 has no temperature readout beyond these).
+// The SPI status byte that comes back with each datagram is kept as well.
+//
+// Transfers are started with Bus::start() and complete under DMA; poll() only
+// checks Bus::busy(), decodes a finished datagram and queues the next one,
+// so it never waits on the bus. Reads are pipelined on the TMC5160: each
+// DRV_STATUS request returns the reply to whatever datagram went before it on
+// that chip select. That is only our previous request if nothing else used
+// the driver in between; StepEngine's XACTUAL reads and the CoolStep /
+// StallGuard writes often do. The Bus counts transfers per chip select, and a
+// reply is published only when the count shows our request was the last one.
+// Otherwise (and after begin()) the reply is dropped and DRV_STATUS is asked
+// for again at once, so the next reply answers it.
+//
+// Commands (LX200 channel):
+//   :GXU<axis>#     cached DRV_STATUS as 8 hex digits           -> XXXXXXXX#
+//   :NWDS#          FRAME_DRIVER_STATUS frame, both axes
+//
+// Payload (28 bytes, little-endian):
+//   u32 controller millis
+//   per axis (1 then 2):
+//     u32 DRV_STATUS
+//     u16 SG_RESULT
+//     u8  CS_ACTUAL
+//     u8  SPI status byte
+//     u32 snapshot age, ms (0xFFFFFFFF = no valid reply yet)
+
+#pragma once
+
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "Frame.h"
+
+namespace nightwatch {
+
+static_assert(DRIVER_STATUS_POLL_HZ > 0 && DRIVER_STATUS_POLL_HZ <= 1000,
+              "DRIVER_STATUS_POLL_HZ must be between 1 and 1000");
+
+constexpr uint8_t TMC_DRV_STATUS = 0x6F;
+constexpr uint16_t DRIVER_STATUS_PAYLOAD_SIZE = 28;
+constexpr uint16_t DRIVER_STATUS_FRAME_SIZE = DRIVER_STATUS_PAYLOAD_SIZE + FRAME_OVERHEAD;
+constexpr uint32_t DRIVER_STATUS_AGE_INVALID = 0xFFFFFFFFUL;
+
+struct DriverSnapshot {
+  uint32_t drvStatus;
+  uint16_t sgResult;
+  uint8_t csActual;
+  uint8_t spiStatus;
+  uint32_t updatedMs;
+  bool valid;
+};
+
+// Bus provides non-blocking DMA transfers of one datagram in place:
+//   void start(csPin, datagram, length)   begin an exchange (CS handled by the bus)
+//   bool busy()                           true until the exchange completed
+//   uint32_t transfers(csPin)             datagrams exchanged on csPin by any
+//                                         user, start() and transfer() alike
+// It must be the only user of the SPI port while a transfer is in flight;
+// the OnStepX TMC helper and StepEngine go through the same Bus and hold
+// their blocking transfer() calls until busy() clears.
+template <typename Bus>
+class DriverStatusCache {
+  public:
+    static constexpr uint32_t periodMs = 1000UL / DRIVER_STATUS_POLL_HZ;
+
+    // ---- main loop side ----------------------------------------------------
+
+    void begin(Bus *bus, uint8_t csAxis1, uint8_t csAxis2, uint32_t nowMs) {
+      bus_ = bus;
+      cs_[0] = csAxis1;
+      cs_[1] = csAxis2;
+      primed_[0] = primed_[1] = false;
+      ours_[0] = ours_[1] = false;
+      inFlight_ = false;
+      retried_ = false;
+      axis_ = 0;
+      nextMs_ = nowMs;
+    }
+
+    // Call every main loop pass. Starts at most one transfer and returns
+    // immediately; a round reads axis 1 then axis 2, once per periodMs.
+    void poll(uint32_t nowMs) {
+      NW_BENCH_SCOPE(BENCH_SPI_POLL);
+      if (bus_ == nullptr) return;
+      if (inFlight_) {
+        if (bus_->busy()) return;
+        inFlight_ = false;
+        // A reply to someone else's datagram: ask again right away, once per
+        // axis per round so steady foreign traffic cannot hold the bus here
+        if (!complete(axis_, nowMs) && !retried_) {
+          retried_ = true;
+          request(axis_);
+          return;
+        }
+        retried_ = false;
+      }
+      if (axis_ == 0) {
+        if ((int32_t)(nowMs - nextMs_) < 0) return;
+        nextMs_ += periodMs;
+        if ((int32_t)(nowMs - nextMs_) >= 0) nextMs_ = nowMs + periodMs;   // don't bunch missed rounds
+      } else if (axis_ == 2) {
+        axis_ = 0;   // round finished; wait for the next period
+        return;
+      }
+      axis_++;
+      request(axis_);
+    }
+
+    // Latest snapshot for axis 1 or 2
+    DriverSnapshot snapshot(uint8_t axis) const {
+      const uint8_t i = axis == 2 ? 1 : 0;
+      return slot_[active_[i]][i];
+    }
+
+    uint32_t drvStatus(uint8_t axis) const { return snapshot(axis).drvStatus; }
+
+    // Reply for :GXU<axis>#
+    int formatDrvStatus(uint8_t axis, char *out, size_t size) const {
+      return snprintf(out, size, "%08lX#", (unsigned long)drvStatus(axis));
+    }
+
+    // Serialize both axes as a complete frame. out must hold DRIVER_STATUS_FRAME_SIZE bytes.
+    uint16_t buildFrame(uint32_t nowMs, uint8_t *out) const {
+      uint8_t *p = out + FRAME_HEADER_SIZE;
+      p = putU32(p, nowMs);
+      for (uint8_t axis = 1; axis <= 2; axis++) {
+        const DriverSnapshot s = snapshot(axis);
+        p = putU32(p, s.drvStatus);
+        p = putU16(p, s.sgResult);
+        p = putU8(p, s.csActual);
+        p = putU8(p, s.spiStatus);
+        p = putU32(p, s.valid ? nowMs - s.updatedMs : DRIVER_STATUS_AGE_INVALID);
+      }
+      return encodeFrame(FRAME_DRIVER_STATUS, out + FRAME_HEADER_SIZE, DRIVER_STATUS_PAYLOAD_SIZE,
+                         out, DRIVER_STATUS_FRAME_SIZE);
+    }
+
+  private:
+    void request(uint8_t axis) {
+      const uint8_t i = axis - 1;
+      // The reply coming back is ours only if no other datagram reached this
+      // driver since our last request
+      ours_[i] = primed_[i] && bus_->transfers(cs_[i]) == seen_[i];
+      datagram_[0] = TMC_DRV_STATUS;
+      datagram_[1] = datagram_[2] = datagram_[3] = datagram_[4] = 0;
+      inFlight_ = true;
+      bus_->start(cs_[i], datagram_, 5);
+      seen_[i] = bus_->transfers(cs_[i]);
+      primed_[i] = true;
+    }
+
+    // Publish the reply; false when it answers a datagram we did not send
+    bool complete(uint8_t axis, uint32_t nowMs) {
+      const uint8_t i = axis - 1;
+      if (!ours_[i]) return false;
+      const uint32_t value = ((uint32_t)datagram_[1] << 24) | ((uint32_t)datagram_[2] << 16) |
+                             ((uint32_t)datagram_[3] << 8) | datagram_[4];
+      const uint8_t idle = active_[i] ^ 1;
+      DriverSnapshot &s = slot_[idle][i];
+      s.drvStatus = value;
+      s.sgResult = (uint16_t)(value & 0x3FF);
+      s.csActual = (uint8_t)((value >> 16) & 0x1F);
+      s.spiStatus = datagram_[0];
+      s.updatedMs = nowMs;
+      s.valid = value != 0xFFFFFFFFUL;   // MISO floating high: driver unpowered or absent
+      active_[i] = idle;
+      return true;
+    }
+
+    Bus *bus_ = nullptr;
+    uint8_t cs_[2] = {0, 0};
+    uint8_t datagram_[5] = {};
+    uint8_t axis_ = 0;   // axis of the transfer in flight or last done, 0 between rounds
+    bool inFlight_ = false;
+    bool primed_[2] = {false, false};    // a DRV_STATUS request of ours is pending on the driver
+    bool ours_[2] = {false, false};      // the transfer in flight returns that request's reply
+    bool retried_ = false;
+    uint32_t seen_[2] = {0, 0};          // Bus::transfers() right after our last request
+    uint32_t nextMs_ = 0;
+
+    DriverSnapshot slot_[2][2] = {};
+    volatile uint8_t active_[2] = {0, 0};
+};
+
+} // namespace nightwatch
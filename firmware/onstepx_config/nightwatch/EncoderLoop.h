@@ -0,0 +1,184 @@
+// NIGHTWATCH Firmware Extensions - Encoder Closed-Loop Tracking
+//
+// Closes the tracking loop on the controller from the motor-side AB encoders
+// (AXIS*_ENCODER / AXIS*_ENCODER_PPR). Until now step and encoder positions
+// were only compared in Python (EncoderBridge.get_position_error()), over the
+// network and once per poll; here the comparison runs at ENCODER_LOOP_HZ.
+//
+// Commanded position is the TrackingDds step count since engage (sidereal,
+// refraction, PPM offset and guide steps included). Measured position is the
+// encoder count converted to steps. A fixed-point PI loop turns the
+// difference into a correction step rate, which a second DDS accumulator
+// ticked from the tracking ISR emits as extra +/- steps. Correction steps are
+// counted here and never enter the commanded position, so the loop converges
+// instead of chasing its own output. This works on both axes regardless of
+// the tracking rate (the Dec axis mostly holds still).
+//
+// An error beyond ENCODER_LOOP_SLIP_ARCSEC is a slip: corrections stop, the
+// loop latches EL_SLIP and StatusFlag STATUS_ENCODER_SLIP is raised in the
+// status and telemetry frames until cleared with :NWER#.
+//
+// Commands (text, LX200 channel):
+//   :NWEL<0|1>#     disable / engage the loop on both axes   -> 1# or 0#
+//   :NWEQ<axis>#    state,error mas,correction steps,slips#
+//   :NWER#          clear a latched slip                     -> 1#
+
+#pragma once
+
+#include <stdio.h>
+
+#include "AxisGeometry.h"
+#include "Benchmark.h"
+#include "StatusFrame.h"
+
+namespace nightwatch {
+
+static_assert(ENCODER_LOOP_HZ > 0 && ENCODER_LOOP_HZ <= 5000,
+              "ENCODER_LOOP_HZ must be between 1 and 5000");
+static_assert(ENCODER_LOOP_KP >= 0 && ENCODER_LOOP_KI >= 0,
+              "ENCODER_LOOP gains must not be negative");
+
+constexpr int64_t Q16_ONE = 1LL << 16;
+constexpr int64_t toQ16(double value) { return (int64_t)(value * Q16_ONE + (value < 0 ? -0.5 : 0.5)); }
+
+enum EncoderLoopState : uint8_t {
+  EL_DISABLED = 0,
+  EL_ENGAGED  = 1,
+  EL_SLIP     = 2,
+};
+
+// Geometry is an AxisGeometry<> instantiation; EncoderPpr counts per motor rev
+template <typename Geometry, uint32_t EncoderPpr>
+class EncoderLoop {
+  public:
+    static constexpr uint32_t stepsPerMotorRev = (uint32_t)(Geometry::stepsPerRev / Geometry::reduction);
+    static constexpr uint32_t periodUs = 1000000UL / ENCODER_LOOP_HZ;
+
+    // Gains and limits folded to integers at compile time
+    static constexpr int64_t kpQ16 = toQ16(ENCODER_LOOP_KP);
+    static constexpr int64_t kiQ16 = toQ16(ENCODER_LOOP_KI);
+    static constexpr int64_t maxRateQ16 = toQ16(Geometry::stepsPerDegree * ENCODER_LOOP_MAX_ARCSEC_S / 3600.0);
+    static constexpr int64_t slipQ16 = toQ16(Geometry::stepsPerDegree * ENCODER_LOOP_SLIP_ARCSEC / 3600.0);
+    static constexpr int64_t masPerStepQ16 = toQ16(MAS_PER_DEGREE / Geometry::stepsPerDegree);
+
+    static_assert(EncoderPpr > 0, "Encoder loop needs AXIS*_ENCODER_PPR");
+    static_assert(Geometry::stepsPerDegree * ENCODER_LOOP_MAX_ARCSEC_S / 3600.0 * 2 < TRACK_DDS_CLOCK_HZ,
+                  "ENCODER_LOOP_MAX_ARCSEC_S correction rate too high for TRACK_DDS_CLOCK_HZ");
+    static_assert(ENCODER_LOOP_SLIP_ARCSEC * Geometry::stepsPerDegree / 3600.0 >= 2.0 * stepsPerMotorRev / EncoderPpr,
+                  "ENCODER_LOOP_SLIP_ARCSEC is below two encoder counts");
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Latch the current positions as the reference and start correcting
+    void engage(int32_t commandedSteps, int32_t encoderCounts, uint32_t nowUs) {
+      stepRef_ = commandedSteps;
+      encoderRef_ = encoderCounts;
+      corrections_ = 0;
+      integralQ16_ = 0;
+      errorQ16_ = 0;
+      nextUs_ = nowUs + periodUs;
+      publish(0);
+      state_ = EL_ENGAGED;
+    }
+
+    void disable() { publish(0); state_ = EL_DISABLED; }
+
+    // Clear a latched slip; the loop stays off until engaged again
+    void clearSlip() { if (state_ == EL_SLIP) state_ = EL_DISABLED; }
+
+    // Call every main loop pass; runs update() at the fixed ENCODER_LOOP_HZ
+    // cadence (skipping missed periods rather than bunching them)
+    void poll(uint32_t nowUs, int32_t commandedSteps, int32_t encoderCounts) {
+      if (state_ != EL_ENGAGED || (int32_t)(nowUs - nextUs_) < 0) return;
+      do { nextUs_ += periodUs; } while ((int32_t)(nowUs - nextUs_) >= 0);
+      update(commandedSteps, encoderCounts);
+    }
+
+    // One control period. Error is commanded minus measured, in Q16 steps;
+    // positive means the motor is behind.
+    void update(int32_t commandedSteps, int32_t encoderCounts) {
+      NW_BENCH_SCOPE(BENCH_ENCODER);
+      if (state_ != EL_ENGAGED) return;
+      const int64_t commandedQ16 = (int64_t)(commandedSteps - stepRef_) * Q16_ONE;
+      const int64_t measuredQ16 = (int64_t)(encoderCounts - encoderRef_) * stepsPerMotorRev * Q16_ONE / EncoderPpr;
+      errorQ16_ = commandedQ16 - measuredQ16;
+
+      if (errorQ16_ > slipQ16 || errorQ16_ < -slipQ16) {
+        publish(0);
+        slips_++;
+        state_ = EL_SLIP;
+        return;
+      }
+
+      // Integrator clamped so the I term alone cannot exceed the rate limit
+      integralQ16_ += errorQ16_ / ENCODER_LOOP_HZ;
+      if (kiQ16 > 0) {
+        const int64_t limit = maxRateQ16 * Q16_ONE / kiQ16;
+        if (integralQ16_ > limit) integralQ16_ = limit;
+        if (integralQ16_ < -limit) integralQ16_ = -limit;
+      }
+
+      int64_t rateQ16 = (kpQ16 * errorQ16_ + kiQ16 * integralQ16_) >> 16;
+      if (rateQ16 > maxRateQ16) rateQ16 = maxRateQ16;
+      if (rateQ16 < -maxRateQ16) rateQ16 = -maxRateQ16;
+      publish(rateQ16);
+    }
+
+    EncoderLoopState state() const { return state_; }
+    bool engaged() const { return state_ == EL_ENGAGED; }
+    bool slipped() const { return state_ == EL_SLIP; }
+    int32_t corrections() const { return corrections_; }
+    uint16_t slips() const { return slips_; }
+
+    // Last error (commanded minus measured) in milliarcseconds of axis angle
+    int32_t errorMas() const { return (int32_t)((errorQ16_ * masPerStepQ16) >> 32); }
+
+    // Reply for :NWEQ<axis>#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%ld,%ld,%u#", (unsigned)state_, (long)errorMas(),
+                      (long)corrections_, (unsigned)slips_);
+    }
+
+    // ---- ISR side ----------------------------------------------------------
+
+    // Called from the tracking ISR once per DDS clock, after TrackingDds::tick().
+    // Returns +1 / -1 when a correction step is due, 0 otherwise.
+    inline int8_t tick() {
+      const uint8_t slot = active_;
+      const uint64_t previous = phase_;
+      phase_ += increment_[slot];
+      if (phase_ >= previous) return 0;
+      const int8_t direction = direction_[slot];
+      corrections_ += direction;
+      return direction;
+    }
+
+  private:
+    // Correction rate (Q16 steps/s) to a DDS increment; |rate| < clock/2 by static_assert
+    void publish(int64_t rateQ16) {
+      const uint64_t magnitude = (uint64_t)(rateQ16 < 0 ? -rateQ16 : rateQ16);
+      const uint8_t idle = active_ ^ 1;
+      increment_[idle] = ((magnitude << 32) / TRACK_DDS_CLOCK_HZ) << 16;
+      direction_[idle] = rateQ16 < 0 ? -1 : 1;
+      active_ = idle;
+    }
+
+    int32_t stepRef_ = 0;
+    int32_t encoderRef_ = 0;
+    int64_t errorQ16_ = 0;
+    int64_t integralQ16_ = 0;
+    uint32_t nextUs_ = 0;
+    uint16_t slips_ = 0;
+    EncoderLoopState state_ = EL_DISABLED;
+
+    volatile uint64_t increment_[2] = {0, 0};
+    volatile int8_t direction_[2] = {1, 1};
+    volatile uint8_t active_ = 0;
+    volatile uint64_t phase_ = 0;
+    volatile int32_t corrections_ = 0;
+};
+
+using Axis1EncoderLoop = EncoderLoop<Axis1Geometry, AXIS1_ENCODER_PPR>;
+using Axis2EncoderLoop = EncoderLoop<Axis2Geometry, AXIS2_ENCODER_PPR>;
+
+} // namespace nightwatch
@@ -0,0 +1,438 @@
+// NIGHTWATCH Firmware Extensions - Log-Structured Calibration Store
+//
+// PEC models, the pointing model, StallGuard tables and park state used to
+// live in the emulated EEPROM: a few KB, slow, and every save blocked the
+// main loop. FlashStore keeps them as records in a log on the QSPI NOR flash
+// soldered to the Teensy 4.1 bottom pads instead.
+//
+// Layout: FLASH_STORE_BLOCKS erase blocks of FLASH_STORE_BLOCK_SIZE from
+// FLASH_STORE_BASE. Each block starts with a 16-byte header (magic, block
+// sequence, erase count, CRC); records follow back to back:
+//   u8 'R', u8 key (StoreKey), u16 payload length, u32 record sequence,
+//   u16 payload CRC, u16 header CRC, payload, padding to 4 bytes
+// A newer record of a key supersedes the older ones. Blocks fill in ring
+// order, so every block is erased once per lap of the ring (wear leveling by
+// construction). When opening a block would leave no spare, the oldest block
+// is reclaimed: its still-current records are copied to the head, then it is
+// erased. If a copy fails its read-back, the spare is erased again and the
+// copying starts over from the reclaimed block, which is still intact.
+//
+// Everything is asynchronous. Modules call markDirty(key); poll() later asks
+// the Source callback to serialize that key into the staging buffer and
+// programs it one page per pass, waiting on the chip's busy flag instead of
+// on the operation, then reads it back against the CRC before the index
+// points at it. A save during a session costs the main loop one memcpy-sized
+// serialize and a page program start per pass.
+//
+// Boot is one pass over the record headers (payloads are read once for the
+// CRC), then get() copies each module's record straight into its load().
+// A half-written record from a power cut fails its CRC and the previous copy
+// is used; a torn record header closes its block, and the next save opens a
+// fresh one.
+//
+// $QZW# (PEC save), the StallGuard save and the park hooks mark keys dirty
+// instead of writing EEPROM when FLASH_STORE is ON.
+//
+// Commands (LX200 channel):
+//   :NWFW#          save every key now (queued)                       -> 1#
+//   :NWFW<key>#     save one key                                      -> 1# or 0#
+//   :NWFQ#          state,blocks used,blocks,live bytes,pending mask,saves,max erase count,errors#
+//
+// Python side: OnStepXExtended.save_calibration(), get_store_status().
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Frame.h"
+
+namespace nightwatch {
+
+static_assert(FLASH_STORE_BLOCKS >= 3 && FLASH_STORE_BLOCKS <= 255, "FLASH_STORE_BLOCKS must be 3-255");
+static_assert(FLASH_STORE_BLOCK_SIZE % FLASH_STORE_PAGE_SIZE == 0 && FLASH_STORE_PAGE_SIZE % 4 == 0,
+              "FLASH_STORE_BLOCK_SIZE must be a multiple of FLASH_STORE_PAGE_SIZE");
+static_assert(FLASH_STORE_MAX_RECORD + 12 + 16 <= FLASH_STORE_BLOCK_SIZE,
+              "FLASH_STORE_MAX_RECORD does not fit one block");
+
+enum StoreKey : uint8_t {
+  STORE_PEC_AXIS1 = 1,           // PecEngine::serialize(1) payload
+  STORE_PEC_AXIS2 = 2,
+  STORE_POINTING_MODEL = 3,      // FRAME_POINTING_MODEL payload
+  STORE_STALLGUARD_AXIS1 = 4,    // StallGuardCalibration::serialize()
+  STORE_STALLGUARD_AXIS2 = 5,
+  STORE_PARK = 6,                // OnStepX park record, opaque
+  STORE_WARM_START = 7,          // WarmStart::serialize() position checkpoint
+  STORE_BACKLASH_AXIS1 = 8,      // BacklashComp::serialize()
+  STORE_BACKLASH_AXIS2 = 9,
+  STORE_KEY_COUNT = 10,
+};
+
+enum FlashStoreState : uint8_t {
+  FS_OFFLINE = 0,                // begin() not called or no flash
+  FS_IDLE = 1,
+  FS_ERASING = 2,
+  FS_PROGRAMMING = 3,
+  FS_VERIFYING = 4,
+};
+
+constexpr uint32_t FS_BLOCK_MAGIC = 0x5346574EUL;   // "NWFS"
+constexpr uint16_t FS_BLOCK_HEADER_SIZE = 16;
+constexpr uint16_t FS_RECORD_HEADER_SIZE = 12;
+constexpr uint8_t FS_RECORD_MAGIC = 'R';
+constexpr uint16_t FS_ALL_KEYS = ((1U << STORE_KEY_COUNT) - 1) & ~1U;
+
+constexpr uint32_t fsAlign4(uint32_t n) { return (n + 3) & ~3UL; }
+
+// Flash provides the QSPI NOR chip, addresses from 0:
+//   bool busy()                                     write-in-progress bit
+//   void read(uint32_t address, uint8_t *out, uint32_t length)
+//   void program(uint32_t address, const uint8_t *data, uint16_t length)   (within one page)
+//   void eraseBlock(uint32_t address)               FLASH_STORE_BLOCK_SIZE-aligned
+// program() and eraseBlock() only start the operation.
+template <typename Flash>
+class FlashStore {
+  public:
+    // Serialize key into out (capacity bytes); 0 when there is nothing to save
+    typedef uint16_t (*Source)(uint8_t key, uint8_t *out, uint16_t capacity);
+
+    // Scan the log and build the index. Call once at boot, before get().
+    void begin(Flash *flash, Source source) {
+      flash_ = flash;
+      source_ = source;
+      for (Entry &e : index_) e = Entry{};
+      head_ = 0xFF;
+      uint32_t bestSeq = 0;
+      for (uint8_t b = 0; b < FLASH_STORE_BLOCKS; b++) {
+        blocks_[b] = BlockInfo{};
+        uint8_t h[FS_BLOCK_HEADER_SIZE];
+        flash_->read(blockAddress(b), h, sizeof(h));
+        if (getU32(h) != FS_BLOCK_MAGIC || getU16(h + 14) != crc16(h, 14)) {
+          // Erased or torn: usable after an erase; the count is lost with the header
+          blocks_[b].eraseCount = 0;
+          continue;
+        }
+        blocks_[b].valid = true;
+        blocks_[b].sequence = getU32(h + 4);
+        blocks_[b].eraseCount = getU32(h + 8);
+        if (head_ == 0xFF || blocks_[b].sequence > bestSeq) { head_ = b; bestSeq = blocks_[b].sequence; }
+      }
+      // Replay blocks in sequence order so newer records overwrite the index
+      uint32_t after = 0;
+      for (uint8_t n = 0; n < FLASH_STORE_BLOCKS; n++) {
+        uint8_t next = 0xFF;
+        for (uint8_t b = 0; b < FLASH_STORE_BLOCKS; b++) {
+          if (blocks_[b].valid && (n == 0 || blocks_[b].sequence > after) &&
+              (next == 0xFF || blocks_[b].sequence < blocks_[next].sequence)) next = b;
+        }
+        if (next == 0xFF) break;
+        blocks_[next].used = scanBlock(next);
+        after = blocks_[next].sequence;
+      }
+      blockSeq_ = bestSeq;
+      state_ = FS_IDLE;
+    }
+
+    // Copy the current record of key into out; returns its length or 0
+    uint16_t get(uint8_t key, uint8_t *out, uint16_t capacity) const {
+      if (key >= STORE_KEY_COUNT || !index_[key].present || index_[key].length > capacity) return 0;
+      flash_->read(index_[key].address + FS_RECORD_HEADER_SIZE, out, index_[key].length);
+      return index_[key].length;
+    }
+
+    bool has(uint8_t key) const { return key < STORE_KEY_COUNT && index_[key].present; }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Queue a save; the Source is asked for the data when the store gets to it
+    bool markDirty(uint8_t key) {
+      if (key == 0 || key >= STORE_KEY_COUNT) return false;
+      dirty_ |= 1U << key;
+      return true;
+    }
+    void markAllDirty() { dirty_ |= FS_ALL_KEYS; }
+
+    // Call every main loop pass; issues at most one flash operation
+    void poll() {
+      if (state_ == FS_OFFLINE || flash_->busy()) return;
+      switch (state_) {
+        case FS_IDLE: startNext(); break;
+        case FS_ERASING: finishErase(); break;
+        case FS_PROGRAMMING: programNext(); break;
+        case FS_VERIFYING: verify(); break;
+        default: break;
+      }
+    }
+
+    FlashStoreState state() const { return state_; }
+    uint16_t pending() const { return dirty_ | relocate_; }
+    bool idle() const { return state_ == FS_IDLE && pending() == 0; }
+
+    uint8_t blocksUsed() const {
+      uint8_t n = 0;
+      for (const BlockInfo &b : blocks_) if (b.valid) n++;
+      return n;
+    }
+
+    uint32_t liveBytes() const {
+      uint32_t n = 0;
+      for (const Entry &e : index_) if (e.present) n += e.length;
+      return n;
+    }
+
+    uint32_t maxEraseCount() const {
+      uint32_t n = 0;
+      for (const BlockInfo &b : blocks_) if (b.eraseCount > n) n = b.eraseCount;
+      return n;
+    }
+
+    // Reply for :NWFQ#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%u,%u,%lu,%u,%lu,%lu,%lu#", (unsigned)state_, (unsigned)blocksUsed(),
+                      (unsigned)FLASH_STORE_BLOCKS, (unsigned long)liveBytes(), (unsigned)pending(),
+                      (unsigned long)saves_, (unsigned long)maxEraseCount(), (unsigned long)errors_);
+    }
+
+  private:
+    struct Entry {
+      uint32_t address = 0;      // record header
+      uint16_t length = 0;
+      uint8_t block = 0;
+      bool present = false;
+    };
+    struct BlockInfo {
+      uint32_t sequence = 0;
+      uint32_t eraseCount = 0;
+      uint32_t used = 0;         // bytes, header included
+      bool valid = false;
+    };
+
+    static uint32_t blockAddress(uint8_t b) { return FLASH_STORE_BASE + (uint32_t)b * FLASH_STORE_BLOCK_SIZE; }
+
+    static bool erased(const uint8_t *p, uint16_t n) {
+      for (uint16_t i = 0; i < n; i++) if (p[i] != 0xFF) return false;
+      return true;
+    }
+
+    // Index every good record of block b; returns the offset past the last
+    // one. Past a torn header nothing in the block can be trusted or safely
+    // programmed over, so the block is reported full and saves move on to a
+    // fresh one.
+    uint32_t scanBlock(uint8_t b) {
+      uint32_t offset = FS_BLOCK_HEADER_SIZE;
+      while (offset + FS_RECORD_HEADER_SIZE <= FLASH_STORE_BLOCK_SIZE) {
+        uint8_t h[FS_RECORD_HEADER_SIZE];
+        flash_->read(blockAddress(b) + offset, h, sizeof(h));
+        if (erased(h, sizeof(h))) break;                               // end of log
+        const uint16_t length = getU16(h + 2);
+        if (h[0] != FS_RECORD_MAGIC || getU16(h + 10) != crc16(h, 10) ||
+            offset + FS_RECORD_HEADER_SIZE + length > FLASH_STORE_BLOCK_SIZE) {
+          return FLASH_STORE_BLOCK_SIZE;                               // torn header
+        }
+        const uint32_t seq = getU32(h + 4);
+        if (seq > recordSeq_) recordSeq_ = seq;
+        if (h[1] > 0 && h[1] < STORE_KEY_COUNT &&
+            payloadCrc(blockAddress(b) + offset + FS_RECORD_HEADER_SIZE, length) == getU16(h + 8)) {
+          index_[h[1]] = Entry{blockAddress(b) + offset, length, b, true};
+        }
+        offset += fsAlign4(FS_RECORD_HEADER_SIZE + length);
+      }
+      return offset;
+    }
+
+    uint16_t payloadCrc(uint32_t address, uint32_t length) const {
+      uint16_t crc = 0xFFFF;
+      uint8_t chunk[64];
+      while (length > 0) {
+        const uint32_t n = length < sizeof(chunk) ? length : sizeof(chunk);
+        flash_->read(address, chunk, n);
+        crc = crc16(chunk, (uint16_t)n, crc);
+        address += n;
+        length -= n;
+      }
+      return crc;
+    }
+
+    uint8_t freeBlocks() const { return FLASH_STORE_BLOCKS - blocksUsed(); }
+
+    uint8_t oldestBlock() const {
+      uint8_t oldest = 0xFF;
+      for (uint8_t b = 0; b < FLASH_STORE_BLOCKS; b++) {
+        if (blocks_[b].valid && b != head_ && (oldest == 0xFF || blocks_[b].sequence < blocks_[oldest].sequence)) oldest = b;
+      }
+      return oldest;
+    }
+
+    // Decide the next job: finish a reclaim, relocate, or save a dirty key
+    void startNext() {
+      if (relocate_ == 0 && reclaim_ != 0xFF) { eraseReclaimed(); return; }
+      // Keys whose current record sits in the block being reclaimed go first
+      const uint16_t work = relocate_ ? relocate_ : dirty_;
+      if (work == 0) return;
+      uint8_t key = 1;
+      while (!(work & (1U << key))) key++;
+
+      uint16_t length;
+      if (relocate_) {
+        length = index_[key].length;
+        flash_->read(index_[key].address + FS_RECORD_HEADER_SIZE, stage_ + FS_RECORD_HEADER_SIZE, length);
+      } else {
+        length = source_ == nullptr ? 0 : source_(key, stage_ + FS_RECORD_HEADER_SIZE, FLASH_STORE_MAX_RECORD);
+      }
+      if (length == 0) { clearWork(key); return; }
+
+      const uint32_t size = fsAlign4(FS_RECORD_HEADER_SIZE + length);
+      if (head_ == 0xFF || blocks_[head_].used + size > FLASH_STORE_BLOCK_SIZE) {
+        openBlock();
+        return;                  // the job is picked up again once the block is ready
+      }
+      jobKey_ = key;
+      jobLength_ = length;
+      jobAddress_ = blockAddress(head_) + blocks_[head_].used;
+      jobSize_ = size;
+      uint8_t *h = stage_;
+      h[0] = FS_RECORD_MAGIC;
+      h[1] = key;
+      putU16(h + 2, length);
+      putU32(h + 4, ++recordSeq_);
+      putU16(h + 8, crc16(stage_ + FS_RECORD_HEADER_SIZE, length));
+      putU16(h + 10, crc16(h, 10));
+      memset(stage_ + FS_RECORD_HEADER_SIZE + length, 0xFF, size - FS_RECORD_HEADER_SIZE - length);
+      written_ = 0;
+      state_ = FS_PROGRAMMING;
+      programNext();
+    }
+
+    void clearWork(uint8_t key) {
+      if (relocate_) relocate_ &= ~(1U << key);
+      else dirty_ &= ~(1U << key);
+    }
+
+    // The head is full. Keep one block spare for reclaiming: when only one is
+    // left, the oldest block is reclaimed first (its current records are
+    // copied into the spare, which becomes the head, then it is erased).
+    void openBlock() {
+      if (freeBlocks() <= 1 && reclaim_ == 0xFF) {
+        reclaim_ = oldestBlock();
+        if (reclaim_ == 0xFF) { errors_++; return; }
+        for (uint8_t k = 1; k < STORE_KEY_COUNT; k++) {
+          if (index_[k].present && index_[k].block == reclaim_) {
+            relocate_ |= 1U << k;
+            reclaimed_[k] = index_[k];
+          }
+        }
+        if (relocate_ == 0) { eraseReclaimed(); return; }
+        reclaimKeys_ = relocate_;
+      }
+      uint8_t next = head_ == 0xFF ? 0 : (head_ + 1) % FLASH_STORE_BLOCKS;
+      for (uint8_t n = 0; n < FLASH_STORE_BLOCKS && blocks_[next].valid; n++) next = (next + 1) % FLASH_STORE_BLOCKS;
+      if (blocks_[next].valid) { errors_++; return; }          // live data exceeds the store
+      erasing_ = next;
+      eraseForHead_ = true;
+      flash_->eraseBlock(blockAddress(next));
+      state_ = FS_ERASING;
+    }
+
+    void eraseReclaimed() {
+      blocks_[reclaim_].valid = false;
+      erasing_ = reclaim_;
+      eraseForHead_ = false;
+      reclaim_ = 0xFF;
+      flash_->eraseBlock(blockAddress(erasing_));
+      state_ = FS_ERASING;
+    }
+
+    // A relocated copy failed its read-back. Nothing but relocated records is
+    // in the spare yet, and the originals are still in the reclaimed block:
+    // point the index back at them, erase the spare and copy them again.
+    void restartReclaim() {
+      for (uint8_t k = 1; k < STORE_KEY_COUNT; k++) {
+        if (reclaimKeys_ & (1U << k)) index_[k] = reclaimed_[k];
+      }
+      relocate_ = reclaimKeys_;
+      blocks_[head_].valid = false;
+      erasing_ = head_;
+      eraseForHead_ = true;
+      flash_->eraseBlock(blockAddress(erasing_));
+      state_ = FS_ERASING;
+    }
+
+    // Erase done: a reclaimed block is simply free; a new head gets its header
+    void finishErase() {
+      BlockInfo &b = blocks_[erasing_];
+      b.eraseCount++;
+      state_ = FS_IDLE;
+      if (!eraseForHead_) return;
+      uint8_t *h = header_;
+      putU32(h, FS_BLOCK_MAGIC);
+      putU32(h + 4, ++blockSeq_);
+      putU32(h + 8, b.eraseCount);
+      putU16(h + 12, 0);
+      putU16(h + 14, crc16(h, 14));
+      flash_->program(blockAddress(erasing_), h, FS_BLOCK_HEADER_SIZE);
+      b.sequence = blockSeq_;
+      b.used = FS_BLOCK_HEADER_SIZE;
+      b.valid = true;
+      head_ = erasing_;
+    }
+
+    // One program operation, never crossing a page
+    void programNext() {
+      if (written_ >= jobSize_) { state_ = FS_VERIFYING; return; }
+      const uint32_t address = jobAddress_ + written_;
+      const uint32_t room = FLASH_STORE_PAGE_SIZE - address % FLASH_STORE_PAGE_SIZE;
+      const uint32_t left = jobSize_ - written_;
+      const uint16_t n = (uint16_t)(left < room ? left : room);
+      flash_->program(address, stage_ + written_, n);
+      written_ += n;
+    }
+
+    void verify() {
+      state_ = FS_IDLE;
+      uint8_t h[FS_RECORD_HEADER_SIZE];
+      flash_->read(jobAddress_, h, sizeof(h));
+      const bool good = memcmp(h, stage_, FS_RECORD_HEADER_SIZE) == 0 &&
+                        payloadCrc(jobAddress_ + FS_RECORD_HEADER_SIZE, jobLength_) == getU16(stage_ + 8);
+      if (!good) {
+        errors_++;
+        // Giving up the spare would leave no block for the relocation
+        if (relocate_) { restartReclaim(); return; }
+        // The key stays pending. Its retry must not land behind a bad record
+        // that a boot scan stops at, so the rest of this block is given up.
+        blocks_[head_].used = FLASH_STORE_BLOCK_SIZE;
+        return;
+      }
+      blocks_[head_].used += jobSize_;
+      index_[jobKey_] = Entry{jobAddress_, jobLength_, head_, true};
+      clearWork(jobKey_);
+      saves_++;
+    }
+
+    Flash *flash_ = nullptr;
+    Source source_ = nullptr;
+    FlashStoreState state_ = FS_OFFLINE;
+    Entry index_[STORE_KEY_COUNT];
+    BlockInfo blocks_[FLASH_STORE_BLOCKS];
+    uint8_t head_ = 0xFF;
+    uint8_t erasing_ = 0;
+    uint8_t reclaim_ = 0xFF;
+    bool eraseForHead_ = false;
+    uint16_t dirty_ = 0;
+    uint16_t relocate_ = 0;
+    uint16_t reclaimKeys_ = 0;      // relocate_ when the reclaim started
+    Entry reclaimed_[STORE_KEY_COUNT];   // their records in the reclaimed block
+    uint32_t blockSeq_ = 0;
+    uint32_t recordSeq_ = 0;
+    uint32_t saves_ = 0;
+    uint32_t errors_ = 0;
+
+    uint8_t jobKey_ = 0;
+    uint16_t jobLength_ = 0;
+    uint32_t jobAddress_ = 0;
+    uint32_t jobSize_ = 0;
+    uint32_t written_ = 0;
+    uint8_t header_[FS_BLOCK_HEADER_SIZE] = {};
+    uint8_t stage_[fsAlign4(FS_RECORD_HEADER_SIZE + FLASH_STORE_MAX_RECORD)] = {};
+};
+
+} // namespace nightwatch
@@ -0,0 +1,174 @@
+// NIGHTWATCH Firmware Extensions - Binary Frame Format
+//
+// Shared framing for every NIGHTWATCH binary reply and upload. The Python side
+// lives in services/mount_control/nightwatch_protocol.py; keep the two in step.
+//
+//   offset  size  field
+//   0       2     sync 'N' 'W'
+//   2       1     frame type (FrameType)
+//   3       2     payload length, little-endian
+//   5       n     payload, little-endian fields
+//   5+n     2     CRC-16/CCITT-FALSE over type, length and payload
+//
+// Frames are length-prefixed, so payload bytes may contain '#'. A client
+// requesting a frame with an LX200 text command reads exactly 7+n bytes.
+// Uploads go the other way: the text command (e.g. :NWU#) is followed
+// immediately by one frame, which the channel collects with FrameReceiver
+// before replying with the usual LX200 "1#"/"0#".
+
+#pragma once
+
+#include <string.h>
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+constexpr uint8_t FRAME_SYNC_0 = 'N';
+constexpr uint8_t FRAME_SYNC_1 = 'W';
+constexpr uint16_t FRAME_HEADER_SIZE = 5;
+constexpr uint16_t FRAME_TRAILER_SIZE = 2;
+constexpr uint16_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE;
+
+// Angles travel as milliarcseconds in every payload
+constexpr double MAS_PER_DEGREE = 3600000.0;
+
+enum FrameType : uint8_t {
+  FRAME_STATUS = 0x01,
+  FRAME_TELEMETRY = 0x02,
+  FRAME_PEC_MODEL = 0x03,
+  FRAME_DRIVER_STATUS = 0x04,
+  FRAME_POINTING_MODEL = 0x05,
+  FRAME_GUIDE = 0x06,
+  FRAME_TRACE = 0x07,
+  FRAME_TARGET_QUEUE = 0x08,
+  FRAME_TARGET_EVENT = 0x09,
+  FRAME_SPLINE_TRACK = 0x0A,
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bitwise to keep flash small
+inline uint16_t crc16(const uint8_t *data, uint16_t length, uint16_t crc = 0xFFFF) {
+  while (length--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// =============================================================================
+// LITTLE-ENDIAN FIELD HELPERS
+// =============================================================================
+inline uint8_t *putU8(uint8_t *p, uint8_t v) { *p++ = v; return p; }
+inline uint8_t *putU16(uint8_t *p, uint16_t v) { *p++ = v & 0xFF; *p++ = v >> 8; return p; }
+inline uint8_t *putU32(uint8_t *p, uint32_t v) {
+  for (uint8_t i = 0; i < 4; i++) { *p++ = v & 0xFF; v >>= 8; }
+  return p;
+}
+inline uint8_t *putI32(uint8_t *p, int32_t v) { return putU32(p, (uint32_t)v); }
+inline uint8_t *putU64(uint8_t *p, uint64_t v) {
+  for (uint8_t i = 0; i < 8; i++) { *p++ = v & 0xFF; v >>= 8; }
+  return p;
+}
+
+inline uint16_t getU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+inline uint32_t getU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+inline int32_t getI32(const uint8_t *p) { return (int32_t)getU32(p); }
+inline uint64_t getU64(const uint8_t *p) {
+  return (uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+// =============================================================================
+// FRAME ENCODE / DECODE
+// =============================================================================
+
+// Wrap payload into out (capacity bytes). Returns frame size or 0 if it won't fit.
+inline uint16_t encodeFrame(uint8_t type, const uint8_t *payload, uint16_t length,
+                            uint8_t *out, uint16_t capacity) {
+  if ((uint32_t)length + FRAME_OVERHEAD > capacity) return 0;
+  uint8_t *p = out;
+  p = putU8(p, FRAME_SYNC_0);
+  p = putU8(p, FRAME_SYNC_1);
+  p = putU8(p, type);
+  p = putU16(p, length);
+  if (length > 0 && payload != p) memmove(p, payload, length);
+  p += length;
+  putU16(p, crc16(out + 2, length + 3));
+  return length + FRAME_OVERHEAD;
+}
+
+// Validate a received frame. On success sets type/payload/length and returns true.
+inline bool decodeFrame(const uint8_t *frame, uint16_t size, uint8_t *type,
+                        const uint8_t **payload, uint16_t *length) {
+  if (size < FRAME_OVERHEAD) return false;
+  if (frame[0] != FRAME_SYNC_0 || frame[1] != FRAME_SYNC_1) return false;
+  const uint16_t n = getU16(frame + 3);
+  if ((uint32_t)n + FRAME_OVERHEAD != size) return false;
+  if (crc16(frame + 2, n + 3) != getU16(frame + FRAME_HEADER_SIZE + n)) return false;
+  *type = frame[2];
+  *payload = frame + FRAME_HEADER_SIZE;
+  *length = n;
+  return true;
+}
+
+// =============================================================================
+// FRAME RECEIVER (uploads)
+// =============================================================================
+// Byte-at-a-time collector so a command channel can switch to binary for one
+// frame without blocking. Capacity bounds the largest accepted frame.
+template <uint16_t Capacity>
+class FrameReceiver {
+  public:
+    static_assert(Capacity >= FRAME_OVERHEAD, "FrameReceiver capacity too small");
+
+    enum State : uint8_t { FR_IDLE, FR_RECEIVING, FR_COMPLETE, FR_ERROR };
+
+    // Arm for one frame; bytes fed before arming are ignored
+    void arm(uint32_t nowMs) { size_ = 0; expected_ = FRAME_HEADER_SIZE; state_ = FR_RECEIVING; armedMs_ = nowMs; }
+    void reset() { state_ = FR_IDLE; size_ = 0; }
+
+    State feed(uint8_t byte) {
+      if (state_ != FR_RECEIVING) return state_;
+      buffer_[size_++] = byte;
+      if (size_ == 2 && (buffer_[0] != FRAME_SYNC_0 || buffer_[1] != FRAME_SYNC_1)) return state_ = FR_ERROR;
+      if (size_ == FRAME_HEADER_SIZE) {
+        const uint32_t total = (uint32_t)getU16(buffer_ + 3) + FRAME_OVERHEAD;
+        if (total > Capacity) return state_ = FR_ERROR;
+        expected_ = (uint16_t)total;
+      }
+      if (size_ == expected_) {
+        state_ = decodeFrame(buffer_, size_, &type_, &payload_, &length_) ? FR_COMPLETE : FR_ERROR;
+      }
+      return state_;
+    }
+
+    // Give up on a frame that stalls mid-transfer
+    State checkTimeout(uint32_t nowMs, uint32_t timeoutMs) {
+      if (state_ == FR_RECEIVING && nowMs - armedMs_ > timeoutMs) state_ = FR_ERROR;
+      return state_;
+    }
+
+    State state() const { return state_; }
+    uint8_t type() const { return type_; }
+    const uint8_t *payload() const { return payload_; }
+    uint16_t length() const { return length_; }
+
+    // Bytes of the current frame fed so far, header first
+    const uint8_t *received() const { return buffer_; }
+    uint16_t receivedSize() const { return size_; }
+
+  private:
+    uint8_t buffer_[Capacity];
+    uint16_t size_ = 0;
+    uint16_t expected_ = FRAME_HEADER_SIZE;
+    uint32_t armedMs_ = 0;
+    State state_ = FR_IDLE;
+    uint8_t type_ = 0;
+    const uint8_t *payload_ = nullptr;
+    uint16_t length_ = 0;
+};
+
+} // namespace nightwatch
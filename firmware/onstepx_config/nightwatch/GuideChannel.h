@@ -0,0 +1,368 @@
+// NIGHTWATCH Firmware Extensions - Streaming Guide Channel
+//
+// Guide corrections arrive as LX200 :Mg text commands on the shared command
+// socket, behind whatever else is queued. With GUIDE_CHANNEL set they get a
+// dedicated input instead, either a UDP port (GUIDE_CHANNEL_UDP) or the spare
+// SERIAL_B (GUIDE_CHANNEL_SERIAL), carrying one FRAME_GUIDE frame per command.
+//
+// Commands are handed to the DDS ISR through a two-slot buffer and take
+// effect on the next TRACK_DDS_CLOCK_HZ tick. Each axis has its own guide
+// accumulator ticked alongside TrackingDds, so a pulse lasts a whole number
+// of DDS ticks (20 µs at 50 kHz) whatever the main loop is doing.
+//
+// Payload, little-endian (25 bytes):
+//   u32 sequence       older or repeated sequences are dropped; 0, a jump
+//                      back of more than GUIDE_SEQUENCE_RESTART_GAP, or any
+//                      jump back after GUIDE_CHANNEL_HOLD_MS of silence
+//                      restarts the stream (host restart)
+//   u64 host time, µs  0 skips the lateness check
+//   u8  kind           1 pulse, 2 rate, 3 stop
+//   i32 axis1          pulse: signed duration µs at GUIDE_CHANNEL_RATE x sidereal;
+//                             0 leaves a pulse running on that axis alone, as :Mg does
+//   i32 axis2          rate:  signed offset, milliarcseconds/second
+//                      positive is west on axis 1 and north on axis 2 (:Mgw, :Mgn)
+//   u32 duration, µs   rate only; 0 holds until GUIDE_CHANNEL_HOLD_MS passes
+//                      without another packet
+//
+// Lateness: host and controller clocks are unrelated, so the channel tracks
+// the smallest (arrival - host time) in windows of GUIDE_CHANNEL_SYNC_WINDOW_MS
+// controller time as the zero-latency offset. The host clock is NTP-slewed
+// against the Teensy crystal, so the drift between two window minima is
+// measured and the floor is carried forward at that rate rather than held;
+// after a silence longer than two windows the estimate starts over. A
+// command arriving more than GUIDE_CHANNEL_MAX_LATENCY_US later than the
+// floor is counted late and dropped.
+//
+// Commands (LX200 channel):
+//   :NWGQ#   counters -> <applied>,<late>,<stale>,<bad>,<last latency µs>#
+//
+// Python side: services/guiding/guide_channel.py (GuideChannelClient).
+
+#pragma once
+
+#include <stdio.h>
+
+#include "Frame.h"
+#include "TrackingDds.h"
+
+namespace nightwatch {
+
+constexpr uint16_t GUIDE_PAYLOAD_SIZE = 25;
+constexpr uint16_t GUIDE_FRAME_SIZE = GUIDE_PAYLOAD_SIZE + FRAME_OVERHEAD;
+
+enum GuideKind : uint8_t {
+  GUIDE_PULSE = 1,
+  GUIDE_RATE = 2,
+  GUIDE_STOP = 3,
+};
+
+constexpr uint32_t GUIDE_HOLD = 0xFFFFFFFFUL;   // ticks: run until replaced
+constexpr int32_t GUIDE_SEQUENCE_RESTART_GAP = 64;  // far beyond any LAN reordering
+constexpr double GUIDE_DRIFT_MAX = 1e-3;            // host/controller clock rate, |fraction|
+
+static_assert(GUIDE_CHANNEL_RATE > 0.0 && GUIDE_CHANNEL_RATE <= 2.0, "GUIDE_CHANNEL_RATE must be 0-2 x sidereal");
+static_assert(GUIDE_CHANNEL_SYNC_WINDOW_MS >= 1000, "GUIDE_CHANNEL_SYNC_WINDOW_MS too short to find the minimum latency");
+
+struct GuideCommand {
+  uint32_t sequence;
+  uint64_t hostUs;
+  uint8_t kind;
+  int32_t axis[2];
+  uint32_t durationUs;
+};
+
+inline bool parseGuidePayload(const uint8_t *p, uint16_t length, GuideCommand *c) {
+  if (length != GUIDE_PAYLOAD_SIZE) return false;
+  c->sequence = getU32(p);
+  c->hostUs = getU64(p + 4);
+  c->kind = p[12];
+  c->axis[0] = getI32(p + 13);
+  c->axis[1] = getI32(p + 17);
+  c->durationUs = getU32(p + 21);
+  return c->kind >= GUIDE_PULSE && c->kind <= GUIDE_STOP;
+}
+
+// =============================================================================
+// PER-AXIS GUIDE ACCUMULATOR
+// =============================================================================
+// Geometry provides stepsPerDegree and trackingStepsPerSecond. Steps from
+// tick() add to the axis step train on top of TrackingDds.
+template <typename Geometry>
+class GuideAxis {
+  public:
+    static constexpr uint64_t pulseIncrement = ddsIncrement(Geometry::trackingStepsPerSecond * GUIDE_CHANNEL_RATE);
+
+    static_assert(pulseIncrement > 0, "Guide rate too low for the DDS clock");
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Signed pulse at GUIDE_CHANNEL_RATE, µs
+    void pulse(int32_t durationUs) {
+      const uint32_t magnitude = (uint32_t)(durationUs < 0 ? -(int64_t)durationUs : durationUs);
+      publish(magnitude == 0 ? 0 : pulseIncrement, durationUs < 0 ? -1 : 1, ticksFor(magnitude));
+    }
+
+    // Signed rate offset in mas/s for durationUs (GUIDE_HOLD in ticks when 0)
+    void rate(int32_t masPerSecond, uint32_t durationUs) {
+      const double stepsPerSecond = Geometry::stepsPerDegree * (masPerSecond < 0 ? -(double)masPerSecond : masPerSecond) / 3600000.0;
+      const uint32_t ticks = durationUs == 0 ? GUIDE_HOLD : ticksFor(durationUs);
+      publish(masPerSecond == 0 ? 0 : ddsIncrement(stepsPerSecond), masPerSecond < 0 ? -1 : 1, ticks);
+    }
+
+    void stop() { publish(0, 1, 0); }
+
+    // A pulse or rate is pending or running
+    bool busy() const {
+      const uint8_t generation = generation_;
+      const volatile Slot &slot = slots_[generation & 1];
+      return slot.increment != 0 && (generation != loaded_ ? slot.ticks > 0 : remaining_ > 0);
+    }
+    int32_t steps() const { return steps_; }
+
+    // ---- ISR side ----------------------------------------------------------
+
+    // Called once per DDS clock, same ISR as TrackingDds::tick(). Returns
+    // -1, 0 or +1 guide steps.
+    inline int8_t tick() {
+      NW_BENCH_SCOPE(BENCH_DDS_TICK);
+      const uint8_t generation = generation_;
+      const uint8_t slot = generation & 1;
+      if (generation != loaded_) {
+        loaded_ = generation;
+        remaining_ = slots_[slot].ticks;
+      }
+      if (remaining_ == 0) return 0;
+      if (remaining_ != GUIDE_HOLD) remaining_--;
+      const uint64_t previous = phase_;
+      phase_ += slots_[slot].increment;
+      if (phase_ >= previous) return 0;
+      steps_ += slots_[slot].direction;
+      return slots_[slot].direction;
+    }
+
+  private:
+    struct Slot {
+      uint64_t increment;
+      uint32_t ticks;
+      int8_t direction;
+    };
+
+    static uint32_t ticksFor(uint32_t us) {
+      const uint64_t ticks = ((uint64_t)us * TRACK_DDS_CLOCK_HZ + 500000ULL) / 1000000ULL;
+      return ticks >= GUIDE_HOLD ? GUIDE_HOLD - 1 : (uint32_t)ticks;
+    }
+
+    // Idle slot then flip, as TrackingDds::publish(). The flip bumps a
+    // generation rather than toggling an index so the ISR reloads its tick
+    // count even when two commands land between ticks.
+    void publish(uint64_t increment, int8_t direction, uint32_t ticks) {
+      const uint8_t next = generation_ + 1;
+      volatile Slot &slot = slots_[next & 1];
+      slot.increment = increment;
+      slot.direction = direction;
+      slot.ticks = ticks;
+      generation_ = next;
+    }
+
+    volatile Slot slots_[2] = {};
+    volatile uint8_t generation_ = 0;   // active slot is generation_ & 1
+    volatile uint8_t loaded_ = 0;
+    volatile uint32_t remaining_ = 0;
+    volatile uint64_t phase_ = 0;
+    volatile int32_t steps_ = 0;
+};
+
+using Axis1GuideAxis = GuideAxis<Axis1Geometry>;
+using Axis2GuideAxis = GuideAxis<Axis2Geometry>;
+
+// =============================================================================
+// CHANNEL
+// =============================================================================
+template <typename Axis1, typename Axis2>
+class GuideChannel {
+  public:
+    void begin(Axis1 *axis1, Axis2 *axis2) { axis1_ = axis1; axis2_ = axis2; }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // One received frame. nowUs is the 64-bit controller clock (Micros64).
+    bool handleFrame(const uint8_t *frame, uint16_t size, uint64_t nowUs, uint32_t nowMs) {
+      uint8_t type;
+      const uint8_t *payload;
+      uint16_t length;
+      GuideCommand c;
+      if (!decodeFrame(frame, size, &type, &payload, &length) || type != FRAME_GUIDE ||
+          !parseGuidePayload(payload, length, &c)) {
+        bad_++;
+        return false;
+      }
+      return handle(c, nowUs, nowMs);
+    }
+
+    bool handle(const GuideCommand &c, uint64_t nowUs, uint32_t nowMs) {
+      const int32_t step = (int32_t)(c.sequence - sequence_);
+      if (c.sequence == 0 ||
+          (haveSequence_ && step <= 0 && (step < -GUIDE_SEQUENCE_RESTART_GAP || nowMs - seenMs_ > GUIDE_CHANNEL_HOLD_MS))) {
+        resetSync();   // the host restarted, even if its sequence-0 packet was lost
+      } else if (haveSequence_ && step <= 0) {
+        stale_++;
+        return false;
+      }
+      haveSequence_ = true;
+      sequence_ = c.sequence;
+      seenMs_ = nowMs;
+      if (c.hostUs != 0 && late(c.hostUs, nowUs)) { late_++; return false; }
+
+      lastMs_ = nowMs;
+      holding_ = false;
+      switch (c.kind) {
+        case GUIDE_PULSE:
+          // A single-direction pulse must not cut short one on the other axis
+          if (c.axis[0] != 0) axis1_->pulse(c.axis[0]);
+          if (c.axis[1] != 0) axis2_->pulse(c.axis[1]);
+          break;
+        case GUIDE_RATE:
+          axis1_->rate(c.axis[0], c.durationUs);
+          axis2_->rate(c.axis[1], c.durationUs);
+          holding_ = c.durationUs == 0;
+          break;
+        default:
+          axis1_->stop();
+          axis2_->stop();
+          break;
+      }
+      applied_++;
+      return true;
+    }
+
+    // Call every main loop pass: ends held rates when the host goes quiet
+    void poll(uint32_t nowMs) {
+      if (holding_ && nowMs - lastMs_ > GUIDE_CHANNEL_HOLD_MS) {
+        holding_ = false;
+        axis1_->stop();
+        axis2_->stop();
+      }
+    }
+
+    // Udp: Arduino UDP class bound to GUIDE_CHANNEL_PORT
+    template <typename Udp>
+    void pollUdp(Udp &udp, uint64_t nowUs, uint32_t nowMs) {
+      int size;
+      while ((size = udp.parsePacket()) > 0) {
+        uint8_t frame[GUIDE_FRAME_SIZE];
+        if (size != GUIDE_FRAME_SIZE) { bad_++; continue; }   // parsePacket() discards the rest
+        udp.read(frame, GUIDE_FRAME_SIZE);
+        handleFrame(frame, GUIDE_FRAME_SIZE, nowUs, nowMs);
+      }
+      poll(nowMs);
+    }
+
+    // Stream: SERIAL_B. Bytes outside a frame are skipped up to the next sync.
+    template <typename Stream>
+    void pollStream(Stream &stream, uint64_t nowUs, uint32_t nowMs) {
+      while (stream.available() > 0) {
+        const int c = stream.read();
+        if (c < 0) break;
+        if (receiver_.state() != FrameReceiver<GUIDE_FRAME_SIZE>::FR_RECEIVING) {
+          if (c != FRAME_SYNC_0) continue;
+          receiver_.arm(nowMs);
+        }
+        const auto state = receiver_.feed((uint8_t)c);
+        if (state == FrameReceiver<GUIDE_FRAME_SIZE>::FR_COMPLETE) {
+          GuideCommand command;
+          if (receiver_.type() == FRAME_GUIDE && parseGuidePayload(receiver_.payload(), receiver_.length(), &command)) {
+            handle(command, nowUs, nowMs);
+          } else {
+            bad_++;
+          }
+          receiver_.reset();
+        } else if (state == FrameReceiver<GUIDE_FRAME_SIZE>::FR_ERROR) {
+          bad_++;
+          receiver_.reset();
+        }
+      }
+      receiver_.checkTimeout(nowMs, 100);
+      poll(nowMs);
+    }
+
+    // :NWGQ# reply
+    int formatCounters(char *out, size_t size) const {
+      return snprintf(out, size, "%lu,%lu,%lu,%lu,%ld#", (unsigned long)applied_, (unsigned long)late_,
+                      (unsigned long)stale_, (unsigned long)bad_, (long)latencyUs_);
+    }
+
+    int32_t lastLatencyUs() const { return latencyUs_; }
+
+  private:
+    static constexpr uint64_t windowUs = (uint64_t)GUIDE_CHANNEL_SYNC_WINDOW_MS * 1000ULL;
+
+    void resetSync() {
+      windowOpen_ = false;
+      havePrevious_ = false;
+      haveDrift_ = false;
+      drift_ = 0.0;
+    }
+
+    // Offset minimum taken at atUs, carried forward to nowUs at the drift
+    int64_t project(int64_t minimum, uint64_t atUs, uint64_t nowUs) const {
+      return minimum + (int64_t)(drift_ * (double)(nowUs - atUs));
+    }
+
+    bool late(uint64_t hostUs, uint64_t nowUs) {
+      const int64_t offset = (int64_t)(nowUs - hostUs);
+      if (windowOpen_ && nowUs - windowStartUs_ > 2 * windowUs) resetSync();   // too old to project
+      if (!windowOpen_) {
+        windowOpen_ = true;
+        windowStartUs_ = nowUs;
+        windowMin_ = INT64_MAX;
+      }
+      if (offset < windowMin_) { windowMin_ = offset; windowMinUs_ = nowUs; }
+      int64_t floor = project(windowMin_, windowMinUs_, nowUs);
+      // The previous window only counts once the drift to carry it forward is known
+      if (haveDrift_) {
+        const int64_t previous = project(previousMin_, previousMinUs_, nowUs);
+        if (previous < floor) floor = previous;
+      }
+      if (nowUs - windowStartUs_ >= windowUs) {
+        if (havePrevious_ && windowMinUs_ > previousMinUs_) {
+          double drift = (double)(windowMin_ - previousMin_) / (double)(windowMinUs_ - previousMinUs_);
+          if (drift > GUIDE_DRIFT_MAX) drift = GUIDE_DRIFT_MAX;
+          if (drift < -GUIDE_DRIFT_MAX) drift = -GUIDE_DRIFT_MAX;
+          drift_ = drift;
+          haveDrift_ = true;
+        }
+        previousMin_ = windowMin_;
+        previousMinUs_ = windowMinUs_;
+        havePrevious_ = true;
+        windowOpen_ = false;   // the next packet opens the following window
+      }
+      const int64_t latency = offset - floor;
+      latencyUs_ = latency > INT32_MAX ? INT32_MAX : (int32_t)latency;
+      return latency > GUIDE_CHANNEL_MAX_LATENCY_US;
+    }
+
+    Axis1 *axis1_ = nullptr;
+    Axis2 *axis2_ = nullptr;
+    FrameReceiver<GUIDE_FRAME_SIZE> receiver_;
+
+    uint32_t sequence_ = 0;
+    bool haveSequence_ = false;
+    bool holding_ = false;
+    uint32_t lastMs_ = 0;
+    uint32_t seenMs_ = 0;      // last packet that passed the sequence check
+
+    bool windowOpen_ = false;
+    bool havePrevious_ = false;
+    bool haveDrift_ = false;
+    uint64_t windowStartUs_ = 0;
+    int64_t windowMin_ = INT64_MAX;
+    uint64_t windowMinUs_ = 0;
+    int64_t previousMin_ = INT64_MAX;
+    uint64_t previousMinUs_ = 0;
+    double drift_ = 0.0;       // offset change per controller µs
+    int32_t latencyUs_ = 0;
+
+    uint32_t applied_ = 0, late_ = 0, stale_ = 0, bad_ = 0;
+};
+
+} // namespace nightwatch
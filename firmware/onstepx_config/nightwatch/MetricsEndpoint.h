@@ -0,0 +1,370 @@
+// NIGHTWATCH Firmware Extensions - Metrics Endpoint
+//
+// nightwatch/health.py could only judge the mount from the command port,
+// where every probe competes with real commands. MetricsEndpoint serves
+// Prometheus text on METRICS_HTTP_PORT (ETHERNET_HTTP_PORT unless set) for a
+// 1 Hz scrape instead, built so a scrape touches neither the command port
+// nor motion timing:
+//
+//   - Once per METRICS_REFRESH_MS the glue fills a MetricsSnapshot and the
+//     page is formatted from it into the idle one of two static buffers,
+//     METRICS_ROWS_PER_PASS metric families per main loop pass. A finished
+//     page swaps in whole, so a scrape never sees half a refresh.
+//   - A scrape is answered straight from the finished buffer: no heap, no
+//     copy, at most METRICS_WRITE_CHUNK bytes per connection per pass, so a
+//     slow client cannot hold the loop. A buffer still being sent is not
+//     reformatted until every send from it is done.
+//   - Requests are parsed byte by byte without blocking, up to
+//     METRICS_CLIENTS at once. Other paths go to the PageHandler (the web
+//     pages for humans on the same port), or get a 404 without one.
+//
+// Exported: uptime, main loop passes and pass interval (mean and max over the
+// refresh window), per-axis step rate, SG_RESULT, CS_ACTUAL and the TMC5160
+// otpw / ot flags (the driver has no temperature readout beyond these), MCU
+// die temperature, command sessions, queue depth and the CommandServer
+// parse-to-reply latency histogram per priority class.
+//
+// HTTP (METRICS_HTTP_PORT):
+//   GET /metrics    text/plain; version=0.0.4 (Prometheus exposition format)
+//
+// Python side: nightwatch/health.py check_mount_health() and parse_metrics().
+
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CommandServer.h"
+#include "DriverStatusCache.h"
+
+#if METRICS_ENDPOINT == ON && CMD_SERVER != ON
+  #error "METRICS_ENDPOINT exports the CMD_SERVER queues and latency histograms"
+#endif
+
+namespace nightwatch {
+
+static_assert(METRICS_CLIENTS >= 1 && METRICS_CLIENTS <= 4, "METRICS_CLIENTS must be 1-4 (sockets are shared with the command server)");
+static_assert(METRICS_BUFFER_SIZE >= 1024 && METRICS_BUFFER_SIZE <= 65535, "METRICS_BUFFER_SIZE must be 1-64 KB");
+static_assert(METRICS_ROWS_PER_PASS >= 1, "METRICS_ROWS_PER_PASS must be at least 1");
+static_assert(METRICS_WRITE_CHUNK >= 64, "METRICS_WRITE_CHUNK too small");
+
+constexpr uint32_t TMC_DRV_OT = 1UL << 25;
+constexpr uint32_t TMC_DRV_OTPW = 1UL << 26;
+constexpr uint8_t METRICS_REQUEST_LINE = 64;
+
+// Everything a page shows that the endpoint does not measure itself
+struct MetricsSnapshot {
+  float stepRateHz[2];             // signed step rate per axis, tracking, guiding and gotos
+  DriverSnapshot driver[2];        // DriverStatusCache::snapshot()
+  float mcuTempC;                  // NAN when unknown
+  uint8_t sessions;                // CommandServer::sessionCount()
+  uint8_t queued[CMD_PRIORITY_COUNT];
+  CommandLatency latency[CMD_PRIORITY_COUNT];
+};
+
+// Bounded append into a page buffer; overflow marks the row unusable
+struct MetricsWriter {
+  char *out;
+  size_t size;
+  size_t used;
+  bool overflow;
+
+  void printf(const char *format, ...) {
+    if (overflow) return;
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(out + used, size - used, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= size - used) overflow = true;
+    else used += (size_t)n;
+  }
+};
+
+// Server and Client are the Arduino Ethernet classes, as for CommandServer
+template <typename Server, typename Client>
+class MetricsEndpoint {
+  public:
+    // Fill the snapshot for the next page (main loop)
+    typedef void (*SnapshotHandler)(MetricsSnapshot &snapshot);
+    // Serve any other path; false gets a 404. The handler owns the reply.
+    typedef bool (*PageHandler)(const char *path, Client &client);
+
+    void begin(Server *server, SnapshotHandler snapshot, PageHandler pages) {
+      server_ = server;
+      snapshot_ = snapshot;
+      pages_ = pages;
+      server_->begin();
+    }
+
+    // Call every main loop pass
+    void poll(uint32_t nowMs, uint32_t nowUs) {
+      if (passes_++ > 0) {
+        const uint32_t interval = nowUs - lastUs_;
+        intervalSum_ += interval;
+        intervalCount_++;
+        if (interval > intervalMax_) intervalMax_ = interval;
+      }
+      lastUs_ = nowUs;
+      if (server_ == nullptr) return;
+
+      refresh(nowMs);
+      accept(nowMs);
+      for (Connection &c : connections_) if (c.active) service(c, nowMs);
+    }
+
+    uint32_t scrapes() const { return scrapes_; }
+    uint16_t pageLength() const { return length_[active_]; }
+    const char *page() const { return buffer_[active_]; }
+
+  private:
+    enum { ROW_UPTIME, ROW_LOOP, ROW_STEP_RATE, ROW_DRIVER, ROW_MCU, ROW_COMMANDS,
+           ROW_LATENCY, ROW_COUNT = ROW_LATENCY + CMD_PRIORITY_COUNT };
+
+    struct Connection {
+      Client client;
+      char line[METRICS_REQUEST_LINE];
+      uint8_t lineLength;
+      uint8_t blank;          // '\n' seen since the last other character
+      bool lineDone;
+      bool responding;
+      char header[112];
+      uint8_t headerLength;
+      uint8_t headerSent;
+      const char *body;
+      uint16_t bodyLength;
+      uint16_t bodySent;
+      int8_t pinned;          // page buffer being sent, -1 none
+      uint32_t openedMs;
+      bool active;
+    };
+
+    // ---- page formatting ----------------------------------------------------
+
+    void refresh(uint32_t nowMs) {
+      const uint8_t idle = active_ ^ 1;
+      if (!formatting_) {
+        if (length_[active_] != 0 && nowMs - refreshedMs_ < METRICS_REFRESH_MS) return;
+        if (pins_[idle] != 0) return;   // still being sent; try next pass
+        refreshedMs_ = nowMs;
+        snap_ = MetricsSnapshot();
+        snap_.mcuTempC = NAN;
+        if (snapshot_ != nullptr) snapshot_(snap_);
+        uptimeS_ = nowMs / 1000UL;
+        passesShown_ = passes_;
+        meanShown_ = intervalCount_ ? intervalSum_ / intervalCount_ : 0;
+        maxShown_ = intervalMax_;
+        intervalSum_ = intervalCount_ = intervalMax_ = 0;
+        row_ = 0;
+        used_ = 0;
+        formatting_ = true;
+      }
+      for (uint8_t n = 0; n < METRICS_ROWS_PER_PASS; n++) {
+        if (row_ == ROW_COUNT) {
+          length_[idle] = (uint16_t)used_;
+          active_ = idle;
+          formatting_ = false;
+          return;
+        }
+        MetricsWriter w{buffer_[idle] + used_, METRICS_BUFFER_SIZE - used_, 0, false};
+        formatRow(row_, w);
+        if (w.overflow) {
+          truncated_++;
+          row_ = ROW_COUNT;   // publish what fits
+          continue;
+        }
+        used_ += w.used;
+        row_++;
+      }
+    }
+
+    void formatRow(uint8_t row, MetricsWriter &w) const {
+      static const char *const classes[CMD_PRIORITY_COUNT] = {"safety", "control", "query"};
+      switch (row) {
+        case ROW_UPTIME:
+          w.printf("# TYPE nightwatch_uptime_seconds gauge\nnightwatch_uptime_seconds %lu\n"
+                   "# TYPE nightwatch_metrics_scrapes_total counter\nnightwatch_metrics_scrapes_total %lu\n"
+                   "# TYPE nightwatch_metrics_truncated_total counter\nnightwatch_metrics_truncated_total %lu\n",
+                   (unsigned long)uptimeS_, (unsigned long)scrapes_, (unsigned long)truncated_);
+          break;
+        case ROW_LOOP:
+          w.printf("# TYPE nightwatch_loop_passes_total counter\nnightwatch_loop_passes_total %lu\n"
+                   "# TYPE nightwatch_loop_interval_us gauge\n"
+                   "nightwatch_loop_interval_us{stat=\"mean\"} %lu\nnightwatch_loop_interval_us{stat=\"max\"} %lu\n",
+                   (unsigned long)passesShown_, (unsigned long)meanShown_, (unsigned long)maxShown_);
+          break;
+        case ROW_STEP_RATE:
+          w.printf("# TYPE nightwatch_axis_step_rate_hz gauge\n");
+          for (uint8_t a = 0; a < 2; a++)
+            w.printf("nightwatch_axis_step_rate_hz{axis=\"%u\"} %.1f\n", a + 1U, (double)snap_.stepRateHz[a]);
+          break;
+        case ROW_DRIVER:
+          w.printf("# TYPE nightwatch_driver_sg_result gauge\n# TYPE nightwatch_driver_cs_actual gauge\n"
+                   "# TYPE nightwatch_driver_overtemp_warning gauge\n# TYPE nightwatch_driver_overtemp gauge\n");
+          for (uint8_t a = 0; a < 2; a++) {
+            const DriverSnapshot &d = snap_.driver[a];
+            if (!d.valid) continue;
+            w.printf("nightwatch_driver_sg_result{axis=\"%u\"} %u\nnightwatch_driver_cs_actual{axis=\"%u\"} %u\n"
+                     "nightwatch_driver_overtemp_warning{axis=\"%u\"} %u\nnightwatch_driver_overtemp{axis=\"%u\"} %u\n",
+                     a + 1U, (unsigned)d.sgResult, a + 1U, (unsigned)d.csActual,
+                     a + 1U, (d.drvStatus & TMC_DRV_OTPW) ? 1U : 0U, a + 1U, (d.drvStatus & TMC_DRV_OT) ? 1U : 0U);
+          }
+          break;
+        case ROW_MCU:
+          if (!isnan(snap_.mcuTempC))
+            w.printf("# TYPE nightwatch_mcu_temperature_celsius gauge\nnightwatch_mcu_temperature_celsius %.1f\n",
+                     (double)snap_.mcuTempC);
+          break;
+        case ROW_COMMANDS:
+          w.printf("# TYPE nightwatch_cmd_sessions gauge\nnightwatch_cmd_sessions %u\n"
+                   "# TYPE nightwatch_cmd_queue_depth gauge\n", (unsigned)snap_.sessions);
+          for (uint8_t p = 0; p < CMD_PRIORITY_COUNT; p++)
+            w.printf("nightwatch_cmd_queue_depth{class=\"%s\"} %u\n", classes[p], (unsigned)snap_.queued[p]);
+          break;
+        default: {
+          const uint8_t p = row - ROW_LATENCY;
+          const CommandLatency &l = snap_.latency[p];
+          if (p == 0) w.printf("# TYPE nightwatch_cmd_latency_seconds histogram\n");
+          uint32_t cumulative = 0;
+          for (uint8_t i = 0; i < CMD_LATENCY_BUCKETS; i++) {
+            cumulative += l.buckets[i];
+            w.printf("nightwatch_cmd_latency_seconds_bucket{class=\"%s\",le=\"%g\"} %lu\n",
+                     classes[p], CMD_LATENCY_BOUNDS_US[i] / 1e6, (unsigned long)cumulative);
+          }
+          w.printf("nightwatch_cmd_latency_seconds_bucket{class=\"%s\",le=\"+Inf\"} %lu\n"
+                   "nightwatch_cmd_latency_seconds_sum{class=\"%s\"} %.6f\n"
+                   "nightwatch_cmd_latency_seconds_count{class=\"%s\"} %lu\n",
+                   classes[p], (unsigned long)l.count, classes[p], l.sumUs / 1e6, classes[p], (unsigned long)l.count);
+          break;
+        }
+      }
+    }
+
+    // ---- connections --------------------------------------------------------
+
+    void accept(uint32_t nowMs) {
+      Client client = server_->accept();
+      if (!client) return;
+      for (Connection &c : connections_) {
+        if (c.active) continue;
+        c = Connection();
+        c.client = client;
+        c.pinned = -1;
+        c.openedMs = nowMs;
+        c.active = true;
+        return;
+      }
+      client.stop();   // all connections in use
+    }
+
+    void close(Connection &c) {
+      if (c.pinned >= 0) pins_[c.pinned]--;
+      c.client.stop();
+      c.active = false;
+    }
+
+    void service(Connection &c, uint32_t nowMs) {
+      if (!c.client.connected() || nowMs - c.openedMs > METRICS_CLIENT_TIMEOUT_MS) { close(c); return; }
+      if (!c.responding) { readRequest(c); return; }
+
+      uint16_t budget = METRICS_WRITE_CHUNK;
+      if (c.headerSent < c.headerLength) {
+        const size_t n = c.client.write((const uint8_t *)c.header + c.headerSent, c.headerLength - c.headerSent);
+        c.headerSent += (uint8_t)n;
+        if (c.headerSent < c.headerLength) return;
+        budget -= n < budget ? (uint16_t)n : budget;
+      }
+      if (c.bodySent < c.bodyLength && budget > 0) {
+        const uint16_t left = c.bodyLength - c.bodySent;
+        c.bodySent += (uint16_t)c.client.write((const uint8_t *)c.body + c.bodySent, left < budget ? left : budget);
+      }
+      if (c.bodySent >= c.bodyLength) close(c);
+    }
+
+    // Request line, then headers up to the blank line, dropped unread
+    void readRequest(Connection &c) {
+      for (uint8_t budget = 128; budget > 0 && c.client.available() > 0; budget--) {
+        const int ch = c.client.read();
+        if (ch < 0) return;
+        if (ch == '\r') continue;
+        if (ch != '\n') {
+          c.blank = 0;
+          if (!c.lineDone && c.lineLength < METRICS_REQUEST_LINE - 1) c.line[c.lineLength++] = (char)ch;
+          continue;
+        }
+        c.lineDone = true;
+        if (++c.blank == 2 || c.lineLength == 0) { respond(c); return; }
+      }
+    }
+
+    void respond(Connection &c) {
+      c.line[c.lineLength] = 0;
+      // "GET /path HTTP/1.1"
+      char *path = strchr(c.line, ' ');
+      char *end = path ? strchr(path + 1, ' ') : nullptr;
+      if (end) *end = 0;
+      const bool get = strncmp(c.line, "GET ", 4) == 0 && path != nullptr;
+      const char *target = get ? path + 1 : "";
+      const char *query = strchr(target, '?');
+      const size_t pathLength = query ? (size_t)(query - target) : strlen(target);
+
+      if (get && pathLength == 8 && strncmp(target, "/metrics", 8) == 0) {
+        if (length_[active_] == 0) {
+          status(c, "503 Service Unavailable");
+          return;
+        }
+        scrapes_++;
+        c.pinned = (int8_t)active_;
+        pins_[active_]++;
+        c.body = buffer_[active_];
+        c.bodyLength = length_[active_];
+        c.headerLength = (uint8_t)snprintf(c.header, sizeof(c.header),
+          "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+          (unsigned)c.bodyLength);
+        c.responding = true;
+        return;
+      }
+      if (get && pages_ != nullptr && pages_(target, c.client)) { close(c); return; }
+      status(c, get ? "404 Not Found" : "405 Method Not Allowed");
+    }
+
+    void status(Connection &c, const char *status) {
+      c.headerLength = (uint8_t)snprintf(c.header, sizeof(c.header),
+                                         "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+      c.body = nullptr;
+      c.bodyLength = 0;
+      c.responding = true;
+    }
+
+    Server *server_ = nullptr;
+    SnapshotHandler snapshot_ = nullptr;
+    PageHandler pages_ = nullptr;
+    Connection connections_[METRICS_CLIENTS] = {};
+
+    // Pages
+    char buffer_[2][METRICS_BUFFER_SIZE];
+    uint16_t length_[2] = {0, 0};
+    uint8_t pins_[2] = {0, 0};          // connections sending from each buffer
+    uint8_t active_ = 0;
+    bool formatting_ = false;
+    uint8_t row_ = 0;
+    size_t used_ = 0;
+    uint32_t refreshedMs_ = 0;
+    MetricsSnapshot snap_ = {};
+    uint32_t uptimeS_ = 0;
+    uint32_t passesShown_ = 0;
+    uint32_t meanShown_ = 0;
+    uint32_t maxShown_ = 0;
+    uint32_t scrapes_ = 0;
+    uint32_t truncated_ = 0;
+
+    // Main loop timing over the current refresh window
+    uint32_t passes_ = 0;
+    uint32_t lastUs_ = 0;
+    uint32_t intervalSum_ = 0;
+    uint32_t intervalCount_ = 0;
+    uint32_t intervalMax_ = 0;
+};
+
+} // namespace nightwatch
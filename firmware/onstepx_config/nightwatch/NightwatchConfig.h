@@ -0,0 +1,671 @@
+// NIGHTWATCH Firmware Extensions - Configuration Defaults
+//
+// Pulls in the site Config.h and supplies fallback values for every
+// NIGHTWATCH-specific option so the extension headers compile even when
+// an option is left out of Config.h. Override any of these in Config.h.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "../Config.h"
+
+// =============================================================================
+// ONSTEPX CONSTANTS (matching values from OnStepX Constants.h)
+// =============================================================================
+#ifndef OFF
+  #define OFF                       -1
+#endif
+#ifndef ON
+  #define ON                        -2
+#endif
+
+// =============================================================================
+// SERIAL TRANSPORT
+// =============================================================================
+#ifndef SERIAL_A_BAUD_DEFAULT
+  #define SERIAL_A_BAUD_DEFAULT     9600
+#endif
+#ifndef SERIAL_BAUD_MAX
+  #define SERIAL_BAUD_MAX           115200     // Highest rate :NWBR# may select
+#endif
+#ifndef SERIAL_BAUD_CONFIRM_MS
+  #define SERIAL_BAUD_CONFIRM_MS    500        // Revert if :NWBK# does not arrive at the new rate
+#endif
+#ifndef SERIAL_BAUD_IDLE_MS
+  #define SERIAL_BAUD_IDLE_MS       5000       // Revert a confirmed rate after this much silence
+#endif
+
+// =============================================================================
+// STEP GENERATION LIMITS (Teensy 4.1 / i.MX RT1062 @ 600 MHz)
+// =============================================================================
+#ifndef NW_STEP_RATE_MAX_HZ
+  #define NW_STEP_RATE_MAX_HZ       200000     // 5 µs minimum step period for the software step ISR
+#endif
+#ifndef NW_STEP_TIMER_HZ
+  #define NW_STEP_TIMER_HZ          24000000   // PIT clocked from the 24 MHz oscillator
+#endif
+
+// =============================================================================
+// ISR CRITICAL SECTIONS
+// =============================================================================
+// Main-loop writes to ring indices the step ISR also advances. The host
+// build (sim/) has no ISR, so the lock compiles to nothing there.
+#if defined(ARDUINO)
+  #include <Arduino.h>
+  #define NW_ISR_LOCK()             noInterrupts()
+  #define NW_ISR_UNLOCK()           interrupts()
+#else
+  #define NW_ISR_LOCK()             do {} while (0)
+  #define NW_ISR_UNLOCK()           do {} while (0)
+#endif
+
+// Microsecond clock for timing in the main loop (command latency); the host
+// build reads the monotonic clock instead.
+#if defined(ARDUINO)
+  #define NW_MICROS()               ((uint32_t)micros())
+#else
+  #include <time.h>
+  inline uint32_t nwHostMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000);
+  }
+  #define NW_MICROS()               nwHostMicros()
+#endif
+
+// =============================================================================
+// STEP ENGINE
+// =============================================================================
+#define STEP_ENGINE_SOFTWARE        0          // OnStepX timer-interrupt step/dir
+#define STEP_ENGINE_TMC_RAMP        1          // TMC5160 internal ramp generator over SPI
+
+#ifndef STEP_ENGINE
+  #define STEP_ENGINE               STEP_ENGINE_SOFTWARE
+#endif
+#ifndef TMC5160_CLOCK_HZ
+  #define TMC5160_CLOCK_HZ          12000000   // Internal oscillator (CLK pin grounded)
+#endif
+
+// =============================================================================
+// DRIVER STATUS
+// =============================================================================
+#ifndef DRIVER_STATUS_POLL_HZ
+  #define DRIVER_STATUS_POLL_HZ     20         // Background DRV_STATUS reads per axis
+#endif
+
+// =============================================================================
+// STALLGUARD CALIBRATION
+// =============================================================================
+#ifndef STALLGUARD_CAL_POINTS
+  #define STALLGUARD_CAL_POINTS     8          // Velocities in the calibration sweep
+#endif
+#ifndef STALLGUARD_CAL_RATE_MIN
+  #define STALLGUARD_CAL_RATE_MIN   0.25       // degrees/second, slowest sweep point
+#endif
+#ifndef STALLGUARD_CAL_RATE_MAX
+  #define STALLGUARD_CAL_RATE_MAX   (GOTO_RATE * 1.5) // degrees/second, fastest sweep point
+#endif
+#ifndef STALLGUARD_CAL_SETTLE_MS
+  #define STALLGUARD_CAL_SETTLE_MS  500        // Wait after each rate change before sampling
+#endif
+#ifndef STALLGUARD_CAL_SAMPLE_MS
+  #define STALLGUARD_CAL_SAMPLE_MS  1000       // SG_RESULT sampling window per point
+#endif
+#ifndef STALLGUARD_CAL_MARGIN
+  #define STALLGUARD_CAL_MARGIN     0.5        // Stall threshold as a fraction of the unloaded minimum
+#endif
+#ifndef STALLGUARD_CAL_MIN_SG
+  #define STALLGUARD_CAL_MIN_SG     50         // Lowest usable threshold; sets the SpreadCycle crossover
+#endif
+#ifndef STALLGUARD_CAL_NV_ADDR
+  #define STALLGUARD_CAL_NV_ADDR    3584       // EEPROM address of the axis 1 table (axis 2 follows)
+#endif
+
+// =============================================================================
+// FLASH STORE
+// =============================================================================
+#ifndef FLASH_STORE
+  #define FLASH_STORE               OFF        // Calibration records in QSPI flash instead of EEPROM
+#endif
+#ifndef FLASH_STORE_BASE
+  #define FLASH_STORE_BASE          0          // Byte offset of the store in the flash chip
+#endif
+#ifndef FLASH_STORE_BLOCK_SIZE
+  #define FLASH_STORE_BLOCK_SIZE    65536      // NOR 64 KB block erase
+#endif
+#ifndef FLASH_STORE_BLOCKS
+  #define FLASH_STORE_BLOCKS        16         // Blocks in the log ring
+#endif
+#ifndef FLASH_STORE_PAGE_SIZE
+  #define FLASH_STORE_PAGE_SIZE     256        // NOR page program size
+#endif
+#ifndef FLASH_STORE_MAX_RECORD
+  #define FLASH_STORE_MAX_RECORD    (2 * PEC_LUT_POINTS + 16) // Largest record (a PEC LUT)
+#endif
+
+// =============================================================================
+// WARM START
+// =============================================================================
+#ifndef WARM_START
+  #define WARM_START                OFF        // Skip homing when the AS5600 shafts confirm the last checkpoint
+#endif
+#ifndef AS5600_I2C_ADDRESS
+  #define AS5600_I2C_ADDRESS        0x36       // Fixed by the chip; one bus per axis
+#endif
+#ifndef WARM_START_TOLERANCE_COUNTS
+  #define WARM_START_TOLERANCE_COUNTS 3        // AS5600 counts (0.088° each) a shaft may differ by
+#endif
+#ifndef WARM_START_SAMPLES
+  #define WARM_START_SAMPLES        16         // Readings averaged per axis at boot
+#endif
+#ifndef WARM_START_SPREAD_COUNTS
+  #define WARM_START_SPREAD_COUNTS  4          // Readings spread beyond this are treated as a bad chip
+#endif
+#ifndef WARM_START_CHECKPOINT_S
+  #define WARM_START_CHECKPOINT_S   60         // Checkpoint interval while tracking
+#endif
+#ifndef WARM_START_AXIS1_REVERSE
+  #define WARM_START_AXIS1_REVERSE  OFF        // Axis 1 AS5600 counts down for increasing steps
+#endif
+
+// =============================================================================
+// SAFETY PARK
+// =============================================================================
+#ifndef SAFETY_PARK
+  #define SAFETY_PARK               OFF        // Controller-side park on input, heartbeat loss or :NWHP#
+#endif
+#ifndef SAFETY_PARK_PIN
+  #define SAFETY_PARK_PIN           OFF        // Park input pin (rain relay, roof contact); OFF heartbeat only
+#endif
+#ifndef SAFETY_PARK_ACTIVE_LOW
+  #define SAFETY_PARK_ACTIVE_LOW    ON         // ON: contact to ground with pull-up asserts the input
+#endif
+#ifndef SAFETY_SAMPLE_HZ
+  #define SAFETY_SAMPLE_HZ          1000       // Input and heartbeat sampling timer
+#endif
+#ifndef SAFETY_PARK_DEBOUNCE_SAMPLES
+  #define SAFETY_PARK_DEBOUNCE_SAMPLES 5       // Consecutive asserted samples that trip
+#endif
+#ifndef SAFETY_STOP_LATENCY_MAX_US
+  #define SAFETY_STOP_LATENCY_MAX_US 20000     // Compile-time bound on trip to deceleration start
+#endif
+#ifndef SAFETY_HEARTBEAT_TIMEOUT_MS
+  #define SAFETY_HEARTBEAT_TIMEOUT_MS 30000    // Missing :NWHB# for this long trips
+#endif
+#ifndef SAFETY_PARK_START_MS
+  #define SAFETY_PARK_START_MS      2000       // Park goto not moving by then counts as failed
+#endif
+
+// =============================================================================
+// BACKLASH COMPENSATION
+// =============================================================================
+#ifndef BACKLASH_COMP
+  #define BACKLASH_COMP             OFF        // Measured per-axis takeup on tracking and guide reversals
+#endif
+#ifndef BACKLASH_CAL_RATE
+  #define BACKLASH_CAL_RATE         0.1        // degrees/second, :NWLC sweep rate
+#endif
+#ifndef BACKLASH_CAL_LEAD_CODES
+  #define BACKLASH_CAL_LEAD_CODES   2          // AS5600 codes of lead-in each way; must exceed the backlash
+#endif
+#ifndef BACKLASH_CAL_SPAN_CODES
+  #define BACKLASH_CAL_SPAN_CODES   16         // AS5600 codes sampled each way
+#endif
+#ifndef BACKLASH_CAL_SLOPE_TOLERANCE
+  #define BACKLASH_CAL_SLOPE_TOLERANCE 0.1     // AS5600/encoder slope error that fails a sweep
+#endif
+#ifndef BACKLASH_CAL_TIMEOUT_MS
+  #define BACKLASH_CAL_TIMEOUT_MS   120000     // Abandon a sweep that has not finished
+#endif
+#ifndef BACKLASH_MAX_ARCSEC
+  #define BACKLASH_MAX_ARCSEC       600.0      // Larger measured or :NWLS values are refused
+#endif
+#ifndef BACKLASH_TAKEUP_RATE_MAX
+  #define BACKLASH_TAKEUP_RATE_MAX  200        // x sidereal, cap on the unramped takeup
+#endif
+
+// =============================================================================
+// COOLSTEP CURRENT CONTROL
+// =============================================================================
+#ifndef COOLSTEP
+  #define COOLSTEP                  OFF
+#endif
+#ifndef COOLSTEP_SEMIN
+  #define COOLSTEP_SEMIN            5          // Raise current when SG_RESULT < SEMIN×32
+#endif
+#ifndef COOLSTEP_SEMAX
+  #define COOLSTEP_SEMAX            2          // Lower current when SG_RESULT >= (SEMIN+SEMAX+1)×32
+#endif
+#ifndef COOLSTEP_SEUP
+  #define COOLSTEP_SEUP             1          // Current increment 1, 2, 4 or 8 per SG reading
+#endif
+#ifndef COOLSTEP_SEDN
+  #define COOLSTEP_SEDN             0          // Decrement after 32, 8, 2 or 1 SG readings
+#endif
+#ifndef COOLSTEP_TRACK_STEP_MA
+  #define COOLSTEP_TRACK_STEP_MA    50         // Tracking current trim step
+#endif
+#ifndef COOLSTEP_TRACK_INTERVAL_MS
+  #define COOLSTEP_TRACK_INTERVAL_MS 10000     // Time between tracking current reductions
+#endif
+#ifndef COOLSTEP_TRACK_LAG_ARCSEC
+  #define COOLSTEP_TRACK_LAG_ARCSEC 2.0        // Encoder following error that raises the current
+#endif
+
+// =============================================================================
+// AXIS DRIVE TRAIN
+// =============================================================================
+#ifndef AXIS1_MOTOR_STEPS_PER_REV
+  #define AXIS1_MOTOR_STEPS_PER_REV 200
+#endif
+#ifndef AXIS1_GEARBOX_RATIO
+  #define AXIS1_GEARBOX_RATIO       1
+#endif
+#ifndef AXIS1_HARMONIC_RATIO
+  #define AXIS1_HARMONIC_RATIO      1
+#endif
+#ifndef AXIS1_DRIVER_MICROSTEPS_GOTO
+  #define AXIS1_DRIVER_MICROSTEPS_GOTO AXIS1_DRIVER_MICROSTEPS
+#endif
+
+#ifndef AXIS2_MOTOR_STEPS_PER_REV
+  #define AXIS2_MOTOR_STEPS_PER_REV 200
+#endif
+#ifndef AXIS2_GEARBOX_RATIO
+  #define AXIS2_GEARBOX_RATIO       1
+#endif
+#ifndef AXIS2_HARMONIC_RATIO
+  #define AXIS2_HARMONIC_RATIO      1
+#endif
+#ifndef AXIS2_DRIVER_MICROSTEPS_GOTO
+  #define AXIS2_DRIVER_MICROSTEPS_GOTO AXIS2_DRIVER_MICROSTEPS
+#endif
+
+#ifndef TRACK_BACKLASH_RATE
+  #define TRACK_BACKLASH_RATE       25
+#endif
+
+// =============================================================================
+// TRACKING
+// =============================================================================
+#ifndef TRACK_RATE_FIXED_POINT
+  #define TRACK_RATE_FIXED_POINT    OFF
+#endif
+#ifndef TRACK_DDS_CLOCK_HZ
+  #define TRACK_DDS_CLOCK_HZ        50000
+#endif
+#ifndef ENCODER_LOOP
+  #define ENCODER_LOOP              OFF
+#endif
+#ifndef ENCODER_LOOP_HZ
+  #define ENCODER_LOOP_HZ           500
+#endif
+#ifndef ENCODER_LOOP_KP
+  #define ENCODER_LOOP_KP           4.0
+#endif
+#ifndef ENCODER_LOOP_KI
+  #define ENCODER_LOOP_KI           1.0
+#endif
+#ifndef ENCODER_LOOP_MAX_ARCSEC_S
+  #define ENCODER_LOOP_MAX_ARCSEC_S 30.0
+#endif
+#ifndef ENCODER_LOOP_SLIP_ARCSEC
+  #define ENCODER_LOOP_SLIP_ARCSEC  20.0
+#endif
+
+// =============================================================================
+// COMMAND CHANNEL
+// =============================================================================
+#ifndef STATUS_FRAME_BINARY
+  #define STATUS_FRAME_BINARY       OFF
+#endif
+
+// =============================================================================
+// TELEMETRY STREAM
+// =============================================================================
+#ifndef TELEMETRY_STREAM
+  #define TELEMETRY_STREAM          OFF
+#endif
+#ifndef TELEMETRY_STREAM_PORT
+  #define TELEMETRY_STREAM_PORT     9998
+#endif
+#ifndef TELEMETRY_STREAM_HZ
+  #define TELEMETRY_STREAM_HZ       20
+#endif
+#ifndef TELEMETRY_STREAM_CLIENTS
+  #define TELEMETRY_STREAM_CLIENTS  2          // Concurrent subscribers
+#endif
+#ifndef TELEMETRY_SUBSCRIBE_TIMEOUT_MS
+  #define TELEMETRY_SUBSCRIBE_TIMEOUT_MS 10000 // Drop subscribers that stop re-subscribing
+#endif
+
+// =============================================================================
+// TIME DISCIPLINE
+// =============================================================================
+#ifndef TIME_DISCIPLINE
+  #define TIME_DISCIPLINE           OFF        // SNTP-disciplined controller clock
+#endif
+#ifndef TIME_NTP_SERVER
+  #define TIME_NTP_SERVER           {192, 168, 1, 1}
+#endif
+#ifndef TIME_NTP_LOCAL_PORT
+  #define TIME_NTP_LOCAL_PORT       8123
+#endif
+#ifndef TIME_NTP_POLL_S
+  #define TIME_NTP_POLL_S           8          // Poll interval while acquiring
+#endif
+#ifndef TIME_NTP_POLL_LOCKED_S
+  #define TIME_NTP_POLL_LOCKED_S    64         // Poll interval once locked
+#endif
+#ifndef TIME_NTP_FILTER
+  #define TIME_NTP_FILTER           8          // Round trips compared for the delay filter
+#endif
+#ifndef TIME_NTP_MAX_DELAY_US
+  #define TIME_NTP_MAX_DELAY_US     20000      // Drop slower exchanges outright
+#endif
+#ifndef TIME_NTP_STEP_US
+  #define TIME_NTP_STEP_US          128000     // Step instead of slew beyond this offset
+#endif
+#ifndef TIME_NTP_LOCK_US
+  #define TIME_NTP_LOCK_US          500        // Offset counted as locked
+#endif
+#ifndef TIME_NTP_LOCK_COUNT
+  #define TIME_NTP_LOCK_COUNT       4          // Samples in a row inside TIME_NTP_LOCK_US
+#endif
+#ifndef TIME_NTP_FREQ_GAIN
+  #define TIME_NTP_FREQ_GAIN        4          // Share (1/n) of each offset folded into frequency
+#endif
+
+// =============================================================================
+// PERIODIC ERROR CORRECTION MODEL
+// =============================================================================
+#define PEC_MODEL_FLAT              0          // Stock OnStepX PEC_BUFFER_SIZE buffer
+#define PEC_MODEL_LUT               1          // Linearly interpolated table per axis
+#define PEC_MODEL_FOURIER           2          // Sum of harmonic terms per axis
+
+#ifndef PEC_MODEL
+  #define PEC_MODEL                 PEC_MODEL_FLAT
+#endif
+#ifndef PEC_LUT_POINTS
+  #define PEC_LUT_POINTS            4096
+#endif
+#ifndef PEC_FOURIER_TERMS
+  #define PEC_FOURIER_TERMS         16
+#endif
+#ifndef PEC_AXIS2
+  #define PEC_AXIS2                 OFF
+#endif
+#ifndef AXIS1_ENCODER_PPR
+  #define AXIS1_ENCODER_PPR         8192
+#endif
+#ifndef AXIS2_ENCODER_PPR
+  #define AXIS2_ENCODER_PPR         8192
+#endif
+#ifndef AXIS1_ENCODER_ORIGIN
+  #define AXIS1_ENCODER_ORIGIN      0
+#endif
+#ifndef AXIS2_ENCODER_ORIGIN
+  #define AXIS2_ENCODER_ORIGIN      0
+#endif
+
+// =============================================================================
+// ENCODER DECODER
+// =============================================================================
+#define ENCODER_DECODER_GPIO        0          // OnStepX AB decoding on pin-change interrupts
+#define ENCODER_DECODER_QUAD_HW     1          // i.MX RT ENC quadrature decoder through XBAR1
+
+#ifndef AXIS1_ENCODER_DECODER
+  #define AXIS1_ENCODER_DECODER     ENCODER_DECODER_GPIO
+#endif
+#ifndef AXIS2_ENCODER_DECODER
+  #define AXIS2_ENCODER_DECODER     ENCODER_DECODER_GPIO
+#endif
+#ifndef AXIS1_ENCODER_A_PIN
+  #define AXIS1_ENCODER_A_PIN       7
+#endif
+#ifndef AXIS1_ENCODER_B_PIN
+  #define AXIS1_ENCODER_B_PIN       8
+#endif
+#ifndef AXIS2_ENCODER_A_PIN
+  #define AXIS2_ENCODER_A_PIN       30
+#endif
+#ifndef AXIS2_ENCODER_B_PIN
+  #define AXIS2_ENCODER_B_PIN       31
+#endif
+#ifndef QUAD_HW_IPG_HZ
+  #define QUAD_HW_IPG_HZ            150000000  // ENC modules run from the IPG clock
+#endif
+#ifndef QUAD_HW_FILTER_PERIOD
+  #define QUAD_HW_FILTER_PERIOD     5          // IPG clocks between filter samples
+#endif
+#ifndef QUAD_HW_FILTER_COUNT
+  #define QUAD_HW_FILTER_COUNT      3          // Consecutive samples required is this + 3
+#endif
+
+// =============================================================================
+// GUIDE CHANNEL
+// =============================================================================
+#define GUIDE_CHANNEL_UDP           1          // FRAME_GUIDE datagrams on GUIDE_CHANNEL_PORT
+#define GUIDE_CHANNEL_SERIAL        2          // FRAME_GUIDE frames on SERIAL_B
+
+#ifndef GUIDE_CHANNEL
+  #define GUIDE_CHANNEL             OFF
+#endif
+#ifndef GUIDE_CHANNEL_PORT
+  #define GUIDE_CHANNEL_PORT        9997
+#endif
+#ifndef GUIDE_CHANNEL_RATE
+  #define GUIDE_CHANNEL_RATE        0.5        // x sidereal for pulse commands
+#endif
+#ifndef GUIDE_CHANNEL_MAX_LATENCY_US
+  #define GUIDE_CHANNEL_MAX_LATENCY_US 5000    // Drop commands this much later than the fastest seen
+#endif
+#ifndef GUIDE_CHANNEL_SYNC_WINDOW_MS
+  #define GUIDE_CHANNEL_SYNC_WINDOW_MS 10000   // Clock-offset minimum window
+#endif
+#ifndef GUIDE_CHANNEL_HOLD_MS
+  #define GUIDE_CHANNEL_HOLD_MS     2000       // Held rate offsets end without a packet this long
+#endif
+
+// =============================================================================
+// COMMAND SERVER
+// =============================================================================
+#ifndef CMD_SERVER
+  #define CMD_SERVER                OFF
+#endif
+#ifndef CMD_SERVER_SESSIONS
+  #define CMD_SERVER_SESSIONS       4          // Concurrent TCP sessions on ETHERNET_CMD_PORT
+#endif
+#ifndef CMD_SERVER_QUEUE
+  #define CMD_SERVER_QUEUE          4          // Queued commands per session
+#endif
+#ifndef CMD_SERVER_LINE
+  #define CMD_SERVER_LINE           48         // Longest command between ':' and '#'
+#endif
+#ifndef CMD_SERVER_READ_BUDGET
+  #define CMD_SERVER_READ_BUDGET    64         // Bytes read per session per main loop pass
+#endif
+#ifndef CMD_SERVER_DISPATCH_BUDGET
+  #define CMD_SERVER_DISPATCH_BUDGET 4         // Queued commands run per main loop pass
+#endif
+#ifndef CMD_SERVER_UPLOAD_CAPACITY
+  #define CMD_SERVER_UPLOAD_CAPACITY (2 * PEC_LUT_POINTS + 16) // Largest :NWU# frame (a PEC LUT)
+#endif
+#ifndef CMD_SERVER_UPLOAD_TIMEOUT_MS
+  #define CMD_SERVER_UPLOAD_TIMEOUT_MS 2000    // Abandon an upload that stalls mid-frame
+#endif
+
+// =============================================================================
+// METRICS ENDPOINT
+// =============================================================================
+#ifndef METRICS_ENDPOINT
+  #define METRICS_ENDPOINT          OFF        // Prometheus text at GET /metrics
+#endif
+#ifndef METRICS_HTTP_PORT
+  #define METRICS_HTTP_PORT         ETHERNET_HTTP_PORT // Shared with the web pages
+#endif
+#ifndef METRICS_CLIENTS
+  #define METRICS_CLIENTS           2          // Concurrent HTTP connections
+#endif
+#ifndef METRICS_BUFFER_SIZE
+  #define METRICS_BUFFER_SIZE       4096       // Bytes per page buffer (two are kept)
+#endif
+#ifndef METRICS_REFRESH_MS
+  #define METRICS_REFRESH_MS        1000       // Page refresh interval; match the scrape interval
+#endif
+#ifndef METRICS_ROWS_PER_PASS
+  #define METRICS_ROWS_PER_PASS     1          // Metric families formatted per main loop pass
+#endif
+#ifndef METRICS_WRITE_CHUNK
+  #define METRICS_WRITE_CHUNK       512        // Bytes sent per connection per main loop pass
+#endif
+#ifndef METRICS_CLIENT_TIMEOUT_MS
+  #define METRICS_CLIENT_TIMEOUT_MS 2000       // Drop a connection that has not finished
+#endif
+
+// =============================================================================
+// REFRACTION TABLE
+// =============================================================================
+#ifndef REFRACTION_TABLE
+  #define REFRACTION_TABLE          OFF
+#endif
+#ifndef REFRACTION_TABLE_SIZE
+  #define REFRACTION_TABLE_SIZE     512        // Entries from REFRACTION_TABLE_MIN_ALT to the zenith
+#endif
+#ifndef REFRACTION_TABLE_MIN_ALT
+  #define REFRACTION_TABLE_MIN_ALT  -1.0       // degrees; refraction is held at this value below it
+#endif
+#ifndef REFRACTION_WEATHER_TIMEOUT_S
+  #define REFRACTION_WEATHER_TIMEOUT_S 900     // Fall back to standard atmosphere without weather pushes
+#endif
+#ifndef REFRACTION_REBUILD_TEMP_C
+  #define REFRACTION_REBUILD_TEMP_C 0.5        // Temperature change that rebuilds the table
+#endif
+#ifndef REFRACTION_REBUILD_PRESSURE_HPA
+  #define REFRACTION_REBUILD_PRESSURE_HPA 1.0  // Pressure change that rebuilds the table
+#endif
+#ifndef SITE_ELEVATION_DEFAULT
+  #define SITE_ELEVATION_DEFAULT    0          // meters
+#endif
+
+// =============================================================================
+// POINTING MODEL
+// =============================================================================
+#ifndef POINTING_MODEL
+  #define POINTING_MODEL            OFF
+#endif
+
+// =============================================================================
+// TARGET QUEUE
+// =============================================================================
+#ifndef TARGET_QUEUE
+  #define TARGET_QUEUE              OFF
+#endif
+#ifndef TARGET_QUEUE_SIZE
+  #define TARGET_QUEUE_SIZE         16         // Targets held per upload
+#endif
+#ifndef TARGET_SETTLE_ARCSEC
+  #define TARGET_SETTLE_ARCSEC      2.0        // Default encoder residual tolerance
+#endif
+#ifndef TARGET_SETTLE_MS
+  #define TARGET_SETTLE_MS          1000       // Residuals must stay inside tolerance this long
+#endif
+#ifndef TARGET_SETTLE_TIMEOUT_MS
+  #define TARGET_SETTLE_TIMEOUT_MS  30000      // Report a settle timeout and dwell anyway
+#endif
+
+// =============================================================================
+// SPLINE TRACK
+// =============================================================================
+#ifndef SPLINE_TRACK
+  #define SPLINE_TRACK              OFF
+#endif
+#ifndef SPLINE_TRACK_KNOTS
+  #define SPLINE_TRACK_KNOTS        256        // Hermite knots per upload (20 bytes each)
+#endif
+#ifndef SPLINE_TRACK_SLICE_US
+  #define SPLINE_TRACK_SLICE_US     1000       // Spline evaluation period
+#endif
+#ifndef SPLINE_TRACK_RING_SLICES
+  #define SPLINE_TRACK_RING_SLICES  64         // Buffered slices per axis (64 ms at 1 ms slices)
+#endif
+
+// =============================================================================
+// GOTO PROFILE
+// =============================================================================
+#ifndef GOTO_SCURVE
+  #define GOTO_SCURVE               OFF
+#endif
+#ifndef AXIS1_JERK
+  #define AXIS1_JERK                4.0        // degrees/second³
+#endif
+#ifndef AXIS2_JERK
+  #define AXIS2_JERK                4.0
+#endif
+#ifndef GOTO_COORDINATED
+  #define GOTO_COORDINATED          OFF
+#endif
+#ifndef GOTO_FLIP_OVERLAP
+  #define GOTO_FLIP_OVERLAP         OFF
+#endif
+#ifndef GOTO_FLIP_OVERLAP_AXIS2_MIN
+  #define GOTO_FLIP_OVERLAP_AXIS2_MIN 0        // degrees
+#endif
+#ifndef AXIS1_PAST_MERIDIAN_LIMIT_E
+  #define AXIS1_PAST_MERIDIAN_LIMIT_E 15
+#endif
+#ifndef AXIS1_PAST_MERIDIAN_LIMIT_W
+  #define AXIS1_PAST_MERIDIAN_LIMIT_W 15
+#endif
+#ifndef SCURVE_SLICE_US
+  #define SCURVE_SLICE_US           1000       // Profile evaluation period
+#endif
+#ifndef SCURVE_RING_SLICES
+  #define SCURVE_RING_SLICES        256        // Buffered slices (256 ms at 1 ms slices)
+#endif
+
+// =============================================================================
+// TRACE RECORDER
+// =============================================================================
+#ifndef TRACE_RECORDER
+  #define TRACE_RECORDER            OFF
+#endif
+#ifndef TRACE_RECORDER_RECORDS
+  #define TRACE_RECORDER_RECORDS    8192       // Ring size, power of two (24 bytes each)
+#endif
+#ifndef TRACE_RECORDER_PSRAM
+  #define TRACE_RECORDER_PSRAM      OFF        // Ring in EXTMEM instead of DMAMEM
+#endif
+#ifndef TRACE_DOWNLOAD_RECORDS
+  #define TRACE_DOWNLOAD_RECORDS    512        // Records per :NWTD# frame
+#endif
+
+// =============================================================================
+// BENCHMARK
+// =============================================================================
+#ifndef BENCHMARK
+  #define BENCHMARK                 OFF        // ON builds the timing-budget firmware
+#endif
+#ifndef BENCHMARK_LOAD_HZ
+  #define BENCHMARK_LOAD_HZ         200        // Synthetic LX200 queries per second
+#endif
+#ifndef BENCHMARK_ISR_SHARE
+  #define BENCHMARK_ISR_SHARE       20         // % of the encoder loop period the encoder probe may use
+#endif
+#ifndef BENCHMARK_MAIN_BUDGET_US
+  #define BENCHMARK_MAIN_BUDGET_US  200        // Main loop pass, SPI poll and single command
+#endif
+#ifndef BENCHMARK_TURNAROUND_US
+  #define BENCHMARK_TURNAROUND_US   1000       // Command '#' received to reply written
+#endif
+#ifndef BENCHMARK_JITTER_US
+  #define BENCHMARK_JITTER_US       2          // Control tick period deviation
+#endif
+
+// =============================================================================
+// BUILD-TIME CHECKS
+// =============================================================================
+// Config.h includes this file, so the drive-train static_asserts run in every
+// OnStepX translation unit, not only in those using a NIGHTWATCH module.
+#include "AxisGeometry.h"
@@ -0,0 +1,251 @@
+// NIGHTWATCH Firmware Extensions - Harmonic Drive PEC Model
+//
+// Replaces the single PEC_BUFFER_SIZE worm-period buffer with a per-axis model
+// indexed by output-shaft angle, taken from the AXIS*_ENCODER count. Harmonic
+// drive error is dominated by wave-generator harmonics (HARMONIC_RATIO and
+// 2×HARMONIC_RATIO cycles per output revolution) plus low-order output-shaft
+// terms, none of which line up with a worm period. Two representations, chosen
+// at compile time with PEC_MODEL:
+//
+//   PEC_MODEL_LUT      PEC_LUT_POINTS int16 corrections spanning 1/cycles of
+//                      an output revolution, linearly interpolated
+//   PEC_MODEL_FOURIER  PEC_FOURIER_TERMS (cycles/rev, cos, sin) terms
+//
+// Corrections are in centiarcseconds (0.01") and are the amount to add to the
+// commanded axis position. rateCorrectionPpmE4() gives the matching tracking
+// rate offset for TrackingDds, so PEC feeds forward without guide pulses.
+//
+// Whole models move as one FRAME_PEC_MODEL frame (:NWU# upload,
+// :NWPD<axis># download). Payload, little-endian:
+//   u8 axis (1 or 2), u8 kind (1 LUT, 2 Fourier), u16 count, u16 cycles/rev
+//   LUT:     i16 correction[count]
+//   Fourier: count × { u16 cycles/rev, i16 cos, i16 sin }
+
+#pragma once
+
+#include <math.h>
+
+#include "AxisGeometry.h"
+#include "Frame.h"
+
+namespace nightwatch {
+
+constexpr uint16_t PEC_HEADER_SIZE = 6;
+constexpr uint8_t PEC_KIND_LUT = 1;
+constexpr uint8_t PEC_KIND_FOURIER = 2;
+constexpr double CAS_PER_RADIAN = 20626480.6;   // centiarcseconds per radian
+constexpr double TWO_PI = 6.283185307179586;
+
+// Output-shaft phase (Q32 fraction of a revolution) from a motor-side encoder
+template <uint32_t EncoderPpr, int32_t EncoderOrigin, typename Geometry>
+struct OutputPhase {
+  static constexpr uint32_t countsPerRev = EncoderPpr * Geometry::reduction;
+  static_assert((uint64_t)EncoderPpr * Geometry::reduction < 0xFFFFFFFFULL,
+                "Encoder counts per output revolution must fit 32 bits");
+
+  static inline uint32_t fromCounts(int32_t counts) {
+    int64_t c = ((int64_t)counts - EncoderOrigin) % (int64_t)countsPerRev;
+    if (c < 0) c += countsPerRev;
+    return (uint32_t)(((uint64_t)c << 32) / countsPerRev);
+  }
+};
+
+using Axis1OutputPhase = OutputPhase<AXIS1_ENCODER_PPR, AXIS1_ENCODER_ORIGIN, Axis1Geometry>;
+using Axis2OutputPhase = OutputPhase<AXIS2_ENCODER_PPR, AXIS2_ENCODER_ORIGIN, Axis2Geometry>;
+
+// =============================================================================
+// INTERPOLATED LOOKUP TABLE
+// =============================================================================
+template <uint16_t Points>
+class PecLut {
+  public:
+    static_assert(Points >= 16, "PEC LUT needs at least 16 points");
+    static constexpr uint16_t slopeSpan = Points >= 2048 ? Points / 256 : 1;
+    static constexpr uint32_t payloadSize = PEC_HEADER_SIZE + 2UL * Points;
+
+    bool ready() const { return ready_; }
+    void clear() { ready_ = false; }
+
+    bool load(const uint8_t *payload, uint16_t length) {
+      if (length < PEC_HEADER_SIZE || payload[1] != PEC_KIND_LUT) return false;
+      const uint16_t count = getU16(payload + 2);
+      const uint16_t cycles = getU16(payload + 4);
+      if (count != Points || cycles == 0 || length != payloadSize) return false;
+      for (uint16_t i = 0; i < Points; i++) table_[i] = (int16_t)getU16(payload + PEC_HEADER_SIZE + 2 * i);
+      cyclesPerRev_ = cycles;
+      ready_ = true;
+      return true;
+    }
+
+    uint16_t serialize(uint8_t axis, uint8_t *out, uint16_t capacity) const {
+      if (capacity < payloadSize) return 0;
+      uint8_t *p = out;
+      p = putU8(p, axis);
+      p = putU8(p, PEC_KIND_LUT);
+      p = putU16(p, Points);
+      p = putU16(p, cyclesPerRev_);
+      for (uint16_t i = 0; i < Points; i++) p = putU16(p, (uint16_t)table_[i]);
+      return (uint16_t)payloadSize;
+    }
+
+    // Correction at an output-shaft phase, centiarcseconds
+    int32_t correctionCas(uint32_t phaseQ32) const {
+      if (!ready_) return 0;
+      uint16_t index; int32_t fraction;
+      locate(phaseQ32, &index, &fraction);
+      const int32_t a = table_[index];
+      const int32_t b = table_[(index + 1) % Points];
+      return a + (int32_t)(((int64_t)(b - a) * fraction) >> 16);
+    }
+
+    // d(correction)/d(angle) as a tracking offset in 1e-4 ppm. The slope is a
+    // central difference over ±slopeSpan points so that centiarcsecond
+    // quantization of a finely sampled table does not dominate it.
+    int32_t rateCorrectionPpmE4(uint32_t phaseQ32) const {
+      if (!ready_) return 0;
+      uint16_t index; int32_t fraction;
+      locate(phaseQ32, &index, &fraction);
+      const int64_t delta = (int64_t)table_[(index + slopeSpan) % Points] -
+                            table_[(index + Points - slopeSpan) % Points];
+      // delta cas over 2·slopeSpan·1296000"/(cycles·Points)
+      //   → ppmE4 = delta·cycles·Points·6250 / (81·2·slopeSpan)
+      return (int32_t)(delta * cyclesPerRev_ * Points * 6250 / (81 * 2 * slopeSpan));
+    }
+
+  private:
+    inline void locate(uint32_t phaseQ32, uint16_t *index, int32_t *fraction) const {
+      const uint32_t local = phaseQ32 * cyclesPerRev_;   // wraps to the phase within one cycle
+      const uint64_t position = (uint64_t)local * Points;
+      *index = (uint16_t)(position >> 32);
+      *fraction = (int32_t)((position & 0xFFFFFFFFULL) >> 16);
+    }
+
+    int16_t table_[Points] = {};
+    uint16_t cyclesPerRev_ = 1;
+    bool ready_ = false;
+};
+
+// =============================================================================
+// FOURIER MODEL
+// =============================================================================
+// Evaluated in the main loop (the M7 FPU handles it); never called from an ISR.
+template <uint8_t MaxTerms>
+class PecFourier {
+  public:
+    struct Term {
+      uint16_t cycles;   // cycles per output revolution
+      int16_t cosCas;
+      int16_t sinCas;
+    };
+
+    static constexpr uint32_t maxPayloadSize = PEC_HEADER_SIZE + 6UL * MaxTerms;
+
+    bool ready() const { return count_ > 0; }
+    void clear() { count_ = 0; }
+
+    bool load(const uint8_t *payload, uint16_t length) {
+      if (length < PEC_HEADER_SIZE || payload[1] != PEC_KIND_FOURIER) return false;
+      const uint16_t count = getU16(payload + 2);
+      if (count == 0 || count > MaxTerms || length != PEC_HEADER_SIZE + 6 * count) return false;
+      const uint8_t *p = payload + PEC_HEADER_SIZE;
+      for (uint16_t i = 0; i < count; i++, p += 6) {
+        terms_[i] = Term{getU16(p), (int16_t)getU16(p + 2), (int16_t)getU16(p + 4)};
+      }
+      count_ = (uint8_t)count;
+      return true;
+    }
+
+    uint16_t serialize(uint8_t axis, uint8_t *out, uint16_t capacity) const {
+      const uint16_t size = PEC_HEADER_SIZE + 6 * count_;
+      if (capacity < size) return 0;
+      uint8_t *p = out;
+      p = putU8(p, axis);
+      p = putU8(p, PEC_KIND_FOURIER);
+      p = putU16(p, count_);
+      p = putU16(p, 1);
+      for (uint8_t i = 0; i < count_; i++) {
+        p = putU16(p, terms_[i].cycles);
+        p = putU16(p, (uint16_t)terms_[i].cosCas);
+        p = putU16(p, (uint16_t)terms_[i].sinCas);
+      }
+      return size;
+    }
+
+    int32_t correctionCas(uint32_t phaseQ32) const {
+      const float theta = (float)(phaseQ32 * (TWO_PI / 4294967296.0));
+      float sum = 0.0F;
+      for (uint8_t i = 0; i < count_; i++) {
+        const float a = theta * terms_[i].cycles;
+        sum += terms_[i].cosCas * cosf(a) + terms_[i].sinCas * sinf(a);
+      }
+      return (int32_t)lroundf(sum);
+    }
+
+    int32_t rateCorrectionPpmE4(uint32_t phaseQ32) const {
+      const float theta = (float)(phaseQ32 * (TWO_PI / 4294967296.0));
+      float slope = 0.0F;   // cas per radian
+      for (uint8_t i = 0; i < count_; i++) {
+        const float a = theta * terms_[i].cycles;
+        slope += terms_[i].cycles * (terms_[i].sinCas * cosf(a) - terms_[i].cosCas * sinf(a));
+      }
+      return (int32_t)lroundf((float)(slope / CAS_PER_RADIAN * 1.0e10));
+    }
+
+  private:
+    Term terms_[MaxTerms] = {};
+    uint8_t count_ = 0;
+};
+
+// =============================================================================
+// SELECTED MODEL
+// =============================================================================
+#if PEC_MODEL == PEC_MODEL_LUT
+  using PecAxisModel = PecLut<PEC_LUT_POINTS>;
+  constexpr uint32_t PEC_MAX_PAYLOAD = PecAxisModel::payloadSize;
+#elif PEC_MODEL == PEC_MODEL_FOURIER
+  using PecAxisModel = PecFourier<PEC_FOURIER_TERMS>;
+  constexpr uint32_t PEC_MAX_PAYLOAD = PecAxisModel::maxPayloadSize;
+#endif
+
+#if PEC_MODEL != PEC_MODEL_FLAT
+static_assert(PEC_MAX_PAYLOAD + FRAME_OVERHEAD <= 0xFFFF, "PEC model too large for one frame");
+
+class PecEngine {
+  public:
+    static constexpr uint8_t axes = (PEC_AXIS2 == ON) ? 2 : 1;
+
+    // Accept an uploaded FRAME_PEC_MODEL payload
+    bool load(const uint8_t *payload, uint16_t length) {
+      if (length < 1 || payload[0] < 1 || payload[0] > axes) return false;
+      return model_[payload[0] - 1].load(payload, length);
+    }
+
+    uint16_t serialize(uint8_t axis, uint8_t *out, uint16_t capacity) const {
+      if (axis < 1 || axis > axes) return 0;
+      return model_[axis - 1].serialize(axis, out, capacity);
+    }
+
+    bool ready(uint8_t axis) const { return axis >= 1 && axis <= axes && model_[axis - 1].ready(); }
+    void clear() { for (auto &m : model_) m.clear(); }
+
+    // Tracking offset for axis at its current encoder count (main loop, per control tick)
+    int32_t rateCorrectionPpmE4(uint8_t axis, int32_t encoderCounts) const {
+      if (!ready(axis)) return 0;
+      const uint32_t phase = axis == 1 ? Axis1OutputPhase::fromCounts(encoderCounts)
+                                       : Axis2OutputPhase::fromCounts(encoderCounts);
+      return model_[axis - 1].rateCorrectionPpmE4(phase);
+    }
+
+    int32_t correctionCas(uint8_t axis, int32_t encoderCounts) const {
+      if (!ready(axis)) return 0;
+      const uint32_t phase = axis == 1 ? Axis1OutputPhase::fromCounts(encoderCounts)
+                                       : Axis2OutputPhase::fromCounts(encoderCounts);
+      return model_[axis - 1].correctionCas(phase);
+    }
+
+  private:
+    PecAxisModel model_[axes];
+};
+#endif
+
+} // namespace nightwatch
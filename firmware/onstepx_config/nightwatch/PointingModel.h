@@ -0,0 +1,169 @@
+// NIGHTWATCH Firmware Extensions - Pointing Model
+//
+// TPOINT-style equatorial pointing model applied in the coordinate transform.
+// GOTO_OFFSET_ALIGN only removes a constant offset; this corrects the
+// systematic terms that make first-goto pointing miss by arcminutes across
+// the sky. The model is linear in its coefficients, so it is fitted on the
+// host (services/astrometry/pointing_model.py) from batches of plate solves
+// and uploaded as one FRAME_POINTING_MODEL frame with :NWU#.
+//
+// Mount position = sky position + correction, with h the hour angle, d the
+// declination and phi the site latitude:
+//
+//   IH    index error in h           dh = IH
+//   ID    index error in d           dd = ID
+//   CH    cone (collimation)         dh = CH / cos d
+//   NP    h/d non-perpendicularity   dh = NP tan d
+//   MA    polar axis azimuth         dh = -MA cos h tan d      dd = MA sin h
+//   ME    polar axis elevation       dh = ME sin h tan d       dd = ME cos h
+//   TF    tube flexure               dh = TF cos phi sin h / cos d
+//                                    dd = TF (cos phi cos h sin d - sin phi cos d)
+//   HHSH  harmonic drive, RA         dh = HHSH sin h
+//   HHCH                             dh = HHCH cos h
+//   HDSD  harmonic drive, Dec        dd = HDSD sin d
+//   HDCD                             dd = HDCD cos d
+//
+// On a German mount ID, CH and NP change sign with the pier side (the Dec
+// axis and the tube are reversed after a flip). Terms involving tan d and
+// 1/cos d are evaluated with |d| clamped to POINTING_DEC_LIMIT so the model
+// cannot run away at the pole.
+//
+// Payload (little-endian): u8 term count, then count × { u8 term, i32 mas }.
+//
+// Commands (LX200 channel):
+//   :NWU#           upload a FRAME_POINTING_MODEL frame             -> 1# or 0#
+//   :NWPM<0|1>#     disable / enable the loaded model               -> 1# or 0#
+//   :NWPM#          model state (0 none, 1 loaded and off, 2 active)
+
+#pragma once
+
+#include <math.h>
+
+#include "Frame.h"
+
+namespace nightwatch {
+
+enum PointingTerm : uint8_t {
+  PT_IH = 1,
+  PT_ID = 2,
+  PT_CH = 3,
+  PT_NP = 4,
+  PT_MA = 5,
+  PT_ME = 6,
+  PT_TF = 7,
+  PT_HHSH = 8,
+  PT_HHCH = 9,
+  PT_HDSD = 10,
+  PT_HDCD = 11,
+  PT_TERM_COUNT = 12,   // one past the last id
+};
+
+constexpr double POINTING_DEC_LIMIT = 89.5;               // degrees
+constexpr double RAD_PER_DEGREE = 0.017453292519943295;
+constexpr double DEGREES_PER_MAS = 1.0 / 3600000.0;
+constexpr uint16_t POINTING_MAX_PAYLOAD = 1 + 5 * (PT_TERM_COUNT - 1);
+
+class PointingModel {
+  public:
+    // ---- main loop side ----------------------------------------------------
+
+    // Accept an uploaded FRAME_POINTING_MODEL payload; unknown terms reject it
+    bool load(const uint8_t *payload, uint16_t length) {
+      if (length < 1 || length != 1 + 5 * payload[0]) return false;
+      double terms[PT_TERM_COUNT] = {};
+      const uint8_t *p = payload + 1;
+      for (uint8_t i = 0; i < payload[0]; i++, p += 5) {
+        if (p[0] == 0 || p[0] >= PT_TERM_COUNT) return false;
+        terms[p[0]] = getI32(p + 1) * DEGREES_PER_MAS;
+      }
+      for (uint8_t i = 0; i < PT_TERM_COUNT; i++) terms_[i] = terms[i];
+      loaded_ = true;
+      return true;
+    }
+
+    // FRAME_POINTING_MODEL payload of the loaded terms (FlashStore record);
+    // returns 0 with no model loaded
+    uint16_t serialize(uint8_t *out, uint16_t capacity) const {
+      if (!loaded_ || capacity < POINTING_MAX_PAYLOAD) return 0;
+      uint8_t *p = out + 1;
+      uint8_t count = 0;
+      for (uint8_t i = 1; i < PT_TERM_COUNT; i++) {
+        if (terms_[i] == 0.0) continue;
+        p = putU8(p, i);
+        p = putI32(p, (int32_t)lround(terms_[i] / DEGREES_PER_MAS));
+        count++;
+      }
+      out[0] = count;
+      return (uint16_t)(p - out);
+    }
+
+    bool enable(bool on) {
+      if (on && !loaded_) return false;
+      enabled_ = on;
+      return true;
+    }
+    bool active() const { return loaded_ && enabled_; }
+    uint8_t state() const { return loaded_ ? (enabled_ ? 2 : 1) : 0; }
+
+    // Coefficient in degrees (0 for a term not in the model)
+    double term(PointingTerm t) const { return terms_[t]; }
+
+    // Correction at a sky position, degrees. pierWest: tube on the east side
+    // of the pier looking west (after a flip).
+    void correction(double haDeg, double decDeg, double latitudeDeg, bool pierWest,
+                    double *dHa, double *dDec) const {
+      const double side = pierWest ? -1.0 : 1.0;
+      const double clamped = fmax(-POINTING_DEC_LIMIT, fmin(POINTING_DEC_LIMIT, decDeg));
+      const double h = haDeg * RAD_PER_DEGREE;
+      const double d = clamped * RAD_PER_DEGREE;
+      const double phi = latitudeDeg * RAD_PER_DEGREE;
+      const double sh = sin(h), ch = cos(h), sd = sin(d), cd = cos(d), td = sd / cd;
+
+      *dHa = terms_[PT_IH]
+           + side * (terms_[PT_CH] / cd + terms_[PT_NP] * td)
+           - terms_[PT_MA] * ch * td
+           + terms_[PT_ME] * sh * td
+           + terms_[PT_TF] * cos(phi) * sh / cd
+           + terms_[PT_HHSH] * sh + terms_[PT_HHCH] * ch;
+      *dDec = side * terms_[PT_ID]
+            + terms_[PT_MA] * sh
+            + terms_[PT_ME] * ch
+            + terms_[PT_TF] * (cos(phi) * ch * sd - sin(phi) * cd)
+            + terms_[PT_HDSD] * sd + terms_[PT_HDCD] * cd;
+    }
+
+    // Sky target to mount coordinates, applied before every goto
+    void skyToMount(double haDeg, double decDeg, double latitudeDeg, bool pierWest,
+                    double *mountHa, double *mountDec) const {
+      *mountHa = haDeg;
+      *mountDec = decDeg;
+      if (!active()) return;
+      double dh, dd;
+      correction(haDeg, decDeg, latitudeDeg, pierWest, &dh, &dd);
+      *mountHa = haDeg + dh;
+      *mountDec = decDeg + dd;
+    }
+
+    // Mount coordinates back to sky (position reports). Corrections are a
+    // few arcminutes, so three fixed-point passes converge to well under a
+    // milliarcsecond.
+    void mountToSky(double mountHa, double mountDec, double latitudeDeg, bool pierWest,
+                    double *haDeg, double *decDeg) const {
+      *haDeg = mountHa;
+      *decDeg = mountDec;
+      if (!active()) return;
+      for (uint8_t i = 0; i < 3; i++) {
+        double dh, dd;
+        correction(*haDeg, *decDeg, latitudeDeg, pierWest, &dh, &dd);
+        *haDeg = mountHa - dh;
+        *decDeg = mountDec - dd;
+      }
+    }
+
+  private:
+    double terms_[PT_TERM_COUNT] = {};
+    bool loaded_ = false;
+    bool enabled_ = false;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,180 @@
+// NIGHTWATCH Firmware Extensions - Hardware Quadrature Decoding
+//
+// AXIS*_ENCODER_DECODER ENCODER_DECODER_QUAD_HW routes the motor-side AB encoder lines through
+// XBAR1 into the i.MX RT1062 ENC quadrature decoders (ENC1 for axis 1, ENC2
+// for axis 2) instead of OnStepX's per-edge GPIO interrupts. At 8192 PPR
+// behind a 2700:1 reduction a 4°/s goto is ~250k counts/s per axis, which
+// GPIO decoding cannot keep up with; the ENC counts every edge in hardware
+// with a glitch filter and costs nothing per edge.
+//
+// read() is called once per control tick. Reading UPOS latches LPOS, POSD
+// and REV into their hold registers, so the 32-bit position, the change since
+// the previous read and the index revolution count all come from the same
+// instant. Positions are reported in the same units OnStepX's AB decoder
+// uses, so EncoderLoop, PecModel and the telemetry stream are unaffected.
+//
+// Encoder pins must be XBAR-capable; the table below lists the Teensy 4.1
+// pins that are (defaults: 7/8 for axis 1, 30/31 for axis 2). AXIS*_ENCODER
+// stays AB so OnStepX still treats the axis as encoder-equipped; the glue
+// reads QuadEncoder instead of attaching OnStepX's AB interrupts to the pins.
+
+#pragma once
+
+#include "AxisGeometry.h"
+#include "Benchmark.h"
+
+#if defined(__IMXRT1062__)
+  #include <Arduino.h>
+#endif
+
+namespace nightwatch {
+
+// One latched reading
+struct QuadSnapshot {
+  int32_t position;      // counts
+  int16_t delta;         // counts since the previous read
+  uint16_t revolutions;  // index pulses (REV), unused without an index line
+};
+
+// Quadrature counts per second at GOTO_RATE, and the glitch filter's delay.
+// The filter must settle well inside the shortest edge spacing or it starts
+// rejecting real edges at full goto speed.
+template <typename Geometry, uint32_t EncoderPpr>
+constexpr double quadCountRate() { return GOTO_RATE / 360.0 * Geometry::reduction * EncoderPpr; }
+
+constexpr double QUAD_HW_FILTER_SECONDS =
+  (QUAD_HW_FILTER_COUNT + 3.0) * QUAD_HW_FILTER_PERIOD / (double)QUAD_HW_IPG_HZ;
+
+#if AXIS1_ENCODER_DECODER == ENCODER_DECODER_QUAD_HW
+static_assert(QUAD_HW_FILTER_SECONDS * 4.0 < 1.0 / quadCountRate<Axis1Geometry, AXIS1_ENCODER_PPR>(),
+              "QUAD_HW_FILTER_* too slow for the axis 1 encoder count rate at GOTO_RATE");
+#endif
+#if AXIS2_ENCODER_DECODER == ENCODER_DECODER_QUAD_HW
+static_assert(QUAD_HW_FILTER_SECONDS * 4.0 < 1.0 / quadCountRate<Axis2Geometry, AXIS2_ENCODER_PPR>(),
+              "QUAD_HW_FILTER_* too slow for the axis 2 encoder count rate at GOTO_RATE");
+#endif
+
+#if defined(__IMXRT1062__)
+
+// =============================================================================
+// XBAR-CAPABLE PINS (Teensy 4.1)
+// =============================================================================
+struct XbarPin {
+  uint8_t pin;
+  uint8_t muxAlt;
+  uint8_t xbarInput;
+  uint8_t selectValue;
+  volatile uint32_t *selectInput;   // daisy-chain register, or nullptr
+};
+
+static const XbarPin XBAR_PINS[] = {
+  {0,  1, 17, 1, &IOMUXC_XBAR1_IN17_SELECT_INPUT},
+  {1,  1, 16, 0, nullptr},
+  {2,  3,  6, 0, nullptr},
+  {3,  3,  7, 0, nullptr},
+  {4,  3,  8, 0, nullptr},
+  {5,  3, 17, 0, &IOMUXC_XBAR1_IN17_SELECT_INPUT},
+  {7,  1, 15, 1, &IOMUXC_XBAR1_IN15_SELECT_INPUT},
+  {8,  1, 14, 1, &IOMUXC_XBAR1_IN14_SELECT_INPUT},
+  {30, 1, 23, 0, &IOMUXC_XBAR1_IN23_SELECT_INPUT},
+  {31, 1, 22, 0, &IOMUXC_XBAR1_IN22_SELECT_INPUT},
+  {33, 3,  9, 0, nullptr},
+  {36, 6, 16, 1, nullptr},
+  {37, 6, 17, 3, &IOMUXC_XBAR1_IN17_SELECT_INPUT},
+};
+
+// XBAR1 outputs feeding ENCn phase A (phase B is +1)
+constexpr uint8_t XBAR_OUT_ENC_PHASE_A[4] = {66, 71, 76, 81};
+
+inline const XbarPin *findXbarPin(uint8_t pin) {
+  for (const XbarPin &p : XBAR_PINS) if (p.pin == pin) return &p;
+  return nullptr;
+}
+
+inline void xbarConnect(uint8_t input, uint8_t output) {
+  volatile uint16_t *sel = &XBARA1_SEL0 + (output / 2);
+  const uint16_t value = *sel;
+  *sel = (output & 1) ? (uint16_t)((value & 0x00FF) | (input << 8)) : (uint16_t)((value & 0xFF00) | input);
+}
+
+// =============================================================================
+// ENC DECODER
+// =============================================================================
+constexpr uint16_t ENC_CTRL_REV  = 1U << 10;   // reverse counting direction
+constexpr uint16_t ENC_CTRL_SWIP = 1U << 11;   // load UINIT/LINIT into the position
+
+class QuadEncoder {
+  public:
+    // module 1-4 (ENC1-ENC4); returns false if a pin is not XBAR-capable
+    bool begin(uint8_t module, uint8_t pinA, uint8_t pinB, bool reverse) {
+      const XbarPin *a = findXbarPin(pinA);
+      const XbarPin *b = findXbarPin(pinB);
+      if (module < 1 || module > 4 || a == nullptr || b == nullptr) return false;
+
+      CCM_CCGR2 |= CCM_CCGR2_XBAR1(CCM_CCGR_ON);
+      switch (module) {
+        case 1: CCM_CCGR4 |= CCM_CCGR4_ENC1(CCM_CCGR_ON); enc_ = &IMXRT_ENC1; break;
+        case 2: CCM_CCGR4 |= CCM_CCGR4_ENC2(CCM_CCGR_ON); enc_ = &IMXRT_ENC2; break;
+        case 3: CCM_CCGR4 |= CCM_CCGR4_ENC3(CCM_CCGR_ON); enc_ = &IMXRT_ENC3; break;
+        default: CCM_CCGR4 |= CCM_CCGR4_ENC4(CCM_CCGR_ON); enc_ = &IMXRT_ENC4; break;
+      }
+
+      routePin(*a, XBAR_OUT_ENC_PHASE_A[module - 1]);
+      routePin(*b, XBAR_OUT_ENC_PHASE_A[module - 1] + 1);
+
+      // Glitch filter: inputs must hold for FILT_CNT+3 samples, FILT_PER IPG clocks apart
+      enc_->FILT = (uint16_t)((QUAD_HW_FILTER_COUNT & 0x7) << 8) | (QUAD_HW_FILTER_PERIOD & 0xFF);
+      enc_->UINIT = 0;
+      enc_->LINIT = 0;
+      enc_->UMOD = 0;                 // free-running 32-bit position
+      enc_->LMOD = 0;
+      enc_->CTRL2 = 0;
+      enc_->CTRL = (reverse ? ENC_CTRL_REV : 0) | ENC_CTRL_SWIP;
+      read();
+      return true;
+    }
+
+    // Latch and read; call once per control tick
+    QuadSnapshot read() {
+      NW_BENCH_SCOPE(BENCH_ENCODER);
+      QuadSnapshot s;
+      const uint16_t upper = enc_->UPOS;    // latches LPOSH, POSDH, REVH
+      s.position = (int32_t)(((uint32_t)upper << 16) | enc_->LPOSH);
+      s.delta = (int16_t)enc_->POSDH;
+      s.revolutions = enc_->REVH;
+      last_ = s;
+      return s;
+    }
+
+    // Re-zero (after homing or a sync)
+    void setPosition(int32_t counts) {
+      enc_->UINIT = (uint16_t)((uint32_t)counts >> 16);
+      enc_->LINIT = (uint16_t)counts;
+      enc_->CTRL |= ENC_CTRL_SWIP;
+    }
+
+    const QuadSnapshot &last() const { return last_; }
+
+  private:
+    static void routePin(const XbarPin &p, uint8_t xbarOutput) {
+      *(portConfigRegister(p.pin)) = p.muxAlt;
+      *(portControlRegister(p.pin)) = IOMUXC_PAD_HYS | IOMUXC_PAD_PKE | IOMUXC_PAD_PUE | IOMUXC_PAD_PUS(2);
+      if (p.selectInput != nullptr) *p.selectInput = p.selectValue;
+      xbarConnect(p.xbarInput, xbarOutput);
+    }
+
+    IMXRT_ENC_t *enc_ = nullptr;
+    QuadSnapshot last_ = {0, 0, 0};
+};
+
+// Axis 1 on ENC1, axis 2 on ENC2
+inline bool beginAxis1Encoder(QuadEncoder &encoder) {
+  return encoder.begin(1, AXIS1_ENCODER_A_PIN, AXIS1_ENCODER_B_PIN, AXIS1_REVERSE == ON);
+}
+inline bool beginAxis2Encoder(QuadEncoder &encoder) {
+  return encoder.begin(2, AXIS2_ENCODER_A_PIN, AXIS2_ENCODER_B_PIN, AXIS2_REVERSE == ON);
+}
+
+#endif // __IMXRT1062__
+
+} // namespace nightwatch
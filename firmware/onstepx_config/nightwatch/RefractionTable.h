@@ -0,0 +1,228 @@
+// NIGHTWATCH Firmware Extensions - Refraction Tables
+//
+// TRACK_REFRACTION_TYPE REFRAC_CALC_FULL evaluates the refraction formula and
+// the Alt/Az transform on every rate update. With REFRACTION_TABLE ON the
+// weather-dependent part is built once into a table and the per-tick work is
+// one sincos of the hour angle plus a table lookup, cheap enough to run at
+// the control rate.
+//
+// Refraction moves a star by R(a) toward the zenith. Split into hour angle
+// and declination with the parallactic angle, both components share the
+// factor K = R(a) / cos a:
+//
+//   dh = -K cos phi sin h / cos d
+//   dd =  K (sin phi cos d - cos phi sin d cos h)
+//
+// K is tabulated against s = sin a (so no asin is needed per tick) together
+// with dK/ds. The derivative gives cubic Hermite interpolation of K and the
+// tracking-rate corrections analytically, with ds/dh = -cos phi cos d sin h:
+//
+//   d(dh)/dh = -(cos phi / cos d) (K' ds/dh sin h + K cos h)
+//   d(dd)/dh = K' ds/dh (sin phi cos d - cos phi sin d cos h) + K cos phi sin d sin h
+//
+// The split is first order in R: against the exact Alt/Az round trip it is
+// within 0.6 arcsec above 5 degrees altitude and 0.1 arcsec above 20.
+//
+// R(a) is Saemundsson's formula for true altitude, scaled for station
+// temperature and pressure. The table is rebuilt in the main loop into the
+// inactive slot whenever pushed weather moves by more than
+// REFRACTION_REBUILD_TEMP_C / REFRACTION_REBUILD_PRESSURE_HPA, then switched
+// in with one store. Without a weather push for REFRACTION_WEATHER_TIMEOUT_S
+// it falls back to 10 °C and the standard-atmosphere pressure at
+// SITE_ELEVATION_DEFAULT.
+//
+// Commands (LX200 channel):
+//   :NWRW<tempC>,<hPa>#   push station temperature and pressure      -> 1# or 0#
+//   :NWRW#                weather in use                             -> <tempC>,<hPa>,<0|1 live>#
+
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+static_assert(REFRACTION_TABLE_SIZE >= 64, "REFRACTION_TABLE_SIZE too small for sub-arcsecond interpolation near the horizon");
+static_assert(REFRACTION_TABLE_MIN_ALT >= -2.0 && REFRACTION_TABLE_MIN_ALT <= 0.0,
+              "REFRACTION_TABLE_MIN_ALT must be between -2 and 0 degrees");
+
+constexpr float REFRACTION_STANDARD_TEMP_C = 10.0f;
+constexpr float REFRACTION_DEC_LIMIT = 89.5f;             // degrees, keeps 1/cos d finite
+constexpr float REFRACTION_RAD_PER_DEGREE = 0.017453292519943295f;
+
+// Standard-atmosphere station pressure at an elevation, hPa
+inline float standardPressureHpa(float elevationM) {
+  return 1013.25f * expf(-elevationM / 8434.0f);
+}
+
+// Refraction at a true altitude, arcminutes
+inline double refractionArcmin(double altitudeDeg, double tempC, double pressureHpa) {
+  const double a = altitudeDeg + 10.3 / (altitudeDeg + 5.11);
+  const double r = 1.02 / tan(a * 0.017453292519943295) + 0.0019279;   // zero at the zenith
+  return r * (pressureHpa / 1010.0) * (283.0 / (273.0 + tempC));
+}
+
+class RefractionTable {
+  public:
+    // ---- main loop side ----------------------------------------------------
+
+    // Site latitude and elevation; builds the standard-atmosphere table the
+    // first time. Latitude only enters the per-tick trig, so changing it
+    // does not rebuild.
+    void begin(float latitudeDeg, float elevationM, uint32_t nowMs) {
+      setSite(latitudeDeg, elevationM);
+      tempC_ = REFRACTION_STANDARD_TEMP_C;
+      pressureHpa_ = standardPressureHpa(elevationM);
+      live_ = false;
+      weatherMs_ = nowMs;
+      build(0);
+      active_ = 0;
+    }
+
+    void setSite(float latitudeDeg, float elevationM) {
+      const float phi = latitudeDeg * REFRACTION_RAD_PER_DEGREE;
+      sinLat_ = sinf(phi);
+      cosLat_ = cosf(phi);
+      elevationM_ = elevationM;
+      if (!live_) {
+        pendingTempC_ = REFRACTION_STANDARD_TEMP_C;
+        pendingPressureHpa_ = standardPressureHpa(elevationM);
+      }
+    }
+
+    // :NWRW<tempC>,<hPa># from the host weather service
+    bool setWeather(float tempC, float pressureHpa, uint32_t nowMs) {
+      if (!(tempC >= -40.0f && tempC <= 50.0f) || !(pressureHpa >= 500.0f && pressureHpa <= 1100.0f)) return false;
+      pendingTempC_ = tempC;
+      pendingPressureHpa_ = pressureHpa;
+      live_ = true;
+      weatherMs_ = nowMs;
+      return true;
+    }
+
+    // Call every main loop pass. Returns true when a rebuilt table went live.
+    bool poll(uint32_t nowMs) {
+      if (live_ && nowMs - weatherMs_ > (uint32_t)REFRACTION_WEATHER_TIMEOUT_S * 1000UL) {
+        live_ = false;
+        pendingTempC_ = REFRACTION_STANDARD_TEMP_C;
+        pendingPressureHpa_ = standardPressureHpa(elevationM_);
+      }
+      if (fabsf(pendingTempC_ - tempC_) < REFRACTION_REBUILD_TEMP_C &&
+          fabsf(pendingPressureHpa_ - pressureHpa_) < REFRACTION_REBUILD_PRESSURE_HPA) return false;
+
+      tempC_ = pendingTempC_;
+      pressureHpa_ = pendingPressureHpa_;
+      const uint8_t slot = active_ ^ 1;
+      build(slot);
+      active_ = slot;
+      return true;
+    }
+
+    // :NWRW# reply
+    int formatWeather(char *out, size_t size) const {
+      return snprintf(out, size, "%.1f,%.1f,%d#", (double)tempC_, (double)pressureHpa_, live_ ? 1 : 0);
+    }
+
+    float temperatureC() const { return tempC_; }
+    float pressureHpa() const { return pressureHpa_; }
+    bool live() const { return live_; }
+
+    // ---- control tick side -------------------------------------------------
+
+    // Topocentric (true) place to observed place, degrees. rateHa and
+    // rateDec are d(dh)/dh and d(dd)/dh: while tracking at sidereal rate the
+    // axis 1 rate is sidereal x (1 + rateHa) and axis 2 is sidereal x rateDec.
+    void correction(float haDeg, float decDeg, float *dHa, float *dDec,
+                    float *rateHa = nullptr, float *rateDec = nullptr) const {
+      const float h = haDeg * REFRACTION_RAD_PER_DEGREE;
+      const float d = fmaxf(-REFRACTION_DEC_LIMIT, fminf(REFRACTION_DEC_LIMIT, decDeg)) * REFRACTION_RAD_PER_DEGREE;
+      const float sh = sinf(h), ch = cosf(h), sd = sinf(d), cd = cosf(d);
+      const float s = sinLat_ * sd + cosLat_ * cd * ch;
+      float k, ks;
+      lookup(s, &k, &ks);
+
+      const float vertical = sinLat_ * cd - cosLat_ * sd * ch;
+      *dHa = -k * cosLat_ * sh / cd / REFRACTION_RAD_PER_DEGREE;
+      *dDec = k * vertical / REFRACTION_RAD_PER_DEGREE;
+      if (rateHa == nullptr || rateDec == nullptr) return;
+      const float dsdh = -cosLat_ * cd * sh;
+      *rateHa = -(cosLat_ / cd) * (ks * dsdh * sh + k * ch);
+      *rateDec = ks * dsdh * vertical + k * cosLat_ * sd * sh;
+    }
+
+    void topocentricToObserved(float haDeg, float decDeg, float *obsHa, float *obsDec) const {
+      float dh, dd;
+      correction(haDeg, decDeg, &dh, &dd);
+      *obsHa = haDeg + dh;
+      *obsDec = decDeg + dd;
+    }
+
+    // Inverse for position reports; refraction changes slowly with position,
+    // so two fixed-point passes return to within 0.2 arcsec above 5 degrees
+    void observedToTopocentric(float obsHa, float obsDec, float *haDeg, float *decDeg) const {
+      *haDeg = obsHa;
+      *decDeg = obsDec;
+      for (uint8_t i = 0; i < 2; i++) {
+        float dh, dd;
+        correction(*haDeg, *decDeg, &dh, &dd);
+        *haDeg = obsHa - dh;
+        *decDeg = obsDec - dd;
+      }
+    }
+
+  private:
+    static constexpr uint16_t size = REFRACTION_TABLE_SIZE;
+
+    static float sMin() { return sinf((float)REFRACTION_TABLE_MIN_ALT * REFRACTION_RAD_PER_DEGREE); }
+
+    // K = R / cos a in radians at s = sin a; R and cos a both vanish at the zenith
+    double kAt(double s) const {
+      const double a = asin(fmin(s, 1.0 - 1e-9));
+      const double r = refractionArcmin(a / 0.017453292519943295, tempC_, pressureHpa_) / 3437.7467707849396;
+      return r / cos(a);
+    }
+
+    void build(uint8_t slot) {
+      const double lo = sMin();
+      const double step = (1.0 - lo) / (size - 1);
+      const double eps = step * 0.25;
+      for (uint16_t i = 0; i < size; i++) {
+        const double s = i == size - 1 ? 1.0 : lo + i * step;
+        const double below = fmax(lo, s - eps), above = fmin(1.0, s + eps);
+        k_[slot][i] = (float)kAt(s);
+        ks_[slot][i] = (float)((kAt(above) - kAt(below)) / (above - below));
+      }
+      step_ = (float)step;
+      invStep_ = (float)(1.0 / step);
+      lo_ = (float)lo;
+    }
+
+    // Cubic Hermite for K, linear for K'
+    void lookup(float s, float *k, float *ks) const {
+      const uint8_t slot = active_;
+      const float x = (fmaxf(s, lo_) - lo_) * invStep_;
+      uint16_t i = (uint16_t)x;
+      if (i > size - 2) i = size - 2;
+      const float t = fminf(x - i, 1.0f);
+      const float t2 = t * t, t3 = t2 * t;
+      const float k0 = k_[slot][i], k1 = k_[slot][i + 1];
+      const float d0 = ks_[slot][i] * step_, d1 = ks_[slot][i + 1] * step_;
+      *k = (2 * t3 - 3 * t2 + 1) * k0 + (t3 - 2 * t2 + t) * d0 + (3 * t2 - 2 * t3) * k1 + (t3 - t2) * d1;
+      *ks = ks_[slot][i] + t * (ks_[slot][i + 1] - ks_[slot][i]);
+    }
+
+    float k_[2][size] = {};
+    float ks_[2][size] = {};
+    volatile uint8_t active_ = 0;
+    float lo_ = 0.0f, step_ = 1.0f, invStep_ = 1.0f;
+
+    float sinLat_ = 0.0f, cosLat_ = 1.0f, elevationM_ = 0.0f;
+    float tempC_ = REFRACTION_STANDARD_TEMP_C, pressureHpa_ = 1013.25f;
+    float pendingTempC_ = REFRACTION_STANDARD_TEMP_C, pendingPressureHpa_ = 1013.25f;
+    uint32_t weatherMs_ = 0;
+    bool live_ = false;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,227 @@
+// NIGHTWATCH Firmware Extensions - Jerk-Limited S-Curve Goto Planner
+//
+// Replaces the trapezoidal GOTO_RATE / GOTO_ACCELERATION ramp with a 7-segment
+// jerk-limited profile per axis (AXIS*_JERK). Harmonic drives are sensitive
+// to the acceleration step at the start and end of a trapezoidal ramp; with
+// the jerk bounded, the goto rate can be raised without tripping
+// AXIS*_DRIVER_STALLGUARD.
+//
+// The main loop evaluates the profile (doubles, M7 FPU) once per
+// SCURVE_SLICE_US and pushes a slice {step count, step interval} into a ring
+// buffer of SCURVE_RING_SLICES entries; the step ISR only pops intervals.
+// Step counts come from differences of the rounded profile position, so a
+// slew always lands on exactly the planned step count.
+//
+// Distances and rates are in goto microsteps (AxisGeometry::stepsPerDegreeGoto).
+
+#pragma once
+
+#include <math.h>
+
+#include "AxisGeometry.h"
+#include "Benchmark.h"
+
+namespace nightwatch {
+
+static_assert((SCURVE_RING_SLICES & (SCURVE_RING_SLICES - 1)) == 0 && SCURVE_RING_SLICES >= 16,
+              "SCURVE_RING_SLICES must be a power of two of at least 16");
+static_assert(SCURVE_SLICE_US >= 100 && SCURVE_SLICE_US <= 10000,
+              "SCURVE_SLICE_US must be between 100 and 10000");
+
+constexpr uint32_t SCURVE_SLICE_TICKS = (uint32_t)((uint64_t)NW_STEP_TIMER_HZ * SCURVE_SLICE_US / 1000000UL);
+
+// =============================================================================
+// PROFILE
+// =============================================================================
+// Rest-to-rest move over distance with |v| <= vmax, |a| <= amax, |j| <= jerk.
+// Segments: +j, 0, -j, 0 (cruise), -j, 0, +j. When the distance is too short
+// to reach vmax the peak velocity is lowered by bisection.
+class SCurveProfile {
+  public:
+    bool plan(double distance, double vmax, double amax, double jerk) {
+      if (distance <= 0 || vmax <= 0 || amax <= 0 || jerk <= 0) { duration_ = 0; return false; }
+      double v = vmax;
+      if (2.0 * accelDistance(v, amax, jerk) > distance) {
+        double lo = 0.0, hi = vmax;
+        for (int i = 0; i < 48; i++) {
+          v = 0.5 * (lo + hi);
+          if (2.0 * accelDistance(v, amax, jerk) > distance) hi = v; else lo = v;
+        }
+        v = lo;
+      }
+
+      const double a = fmin(amax, sqrt(v * jerk));   // peak acceleration actually reached
+      const double tj = a / jerk;
+      const double ta = v / a - tj;                  // constant-acceleration time
+      const double tv = (distance - 2.0 * accelDistance(v, amax, jerk)) / v;
+
+      const double durations[7] = {tj, ta, tj, tv > 0 ? tv : 0, tj, ta, tj};
+      const double jerks[7] = {jerk, 0, -jerk, 0, -jerk, 0, jerk};
+      double p = 0, vel = 0, acc = 0, t = 0;
+      for (int i = 0; i < 7; i++) {
+        seg_[i] = Segment{t, durations[i], jerks[i], p, vel, acc};
+        const double d = durations[i];
+        p += vel * d + acc * d * d / 2.0 + jerks[i] * d * d * d / 6.0;
+        vel += acc * d + jerks[i] * d * d / 2.0;
+        acc += jerks[i] * d;
+        t += d;
+      }
+      duration_ = t;
+      distance_ = distance;
+      peakVelocity_ = v;
+      return true;
+    }
+
+    double duration() const { return duration_; }
+    double peakVelocity() const { return peakVelocity_; }
+
+    // Position at time t (clamped to the move)
+    double position(double t) const {
+      if (t <= 0) return 0;
+      if (t >= duration_) return distance_;
+      int i = 6;
+      while (i > 0 && t < seg_[i].start) i--;
+      const Segment &s = seg_[i];
+      const double d = t - s.start;
+      return s.p + s.v * d + s.a * d * d / 2.0 + s.j * d * d * d / 6.0;
+    }
+
+    // Distance covered accelerating from rest to v
+    static double accelDistance(double v, double amax, double jerk) {
+      const double a = fmin(amax, sqrt(v * jerk));
+      const double tj = a / jerk;
+      const double ta = v / a - tj;
+      return v * (2.0 * tj + ta) / 2.0;
+    }
+
+  private:
+    struct Segment { double start, duration, j, p, v, a; };
+    Segment seg_[7] = {};
+    double duration_ = 0;
+    double distance_ = 0;
+    double peakVelocity_ = 0;
+};
+
+// =============================================================================
+// STEP SCHEDULE RING
+// =============================================================================
+// One slice: steps spread evenly over SCURVE_SLICE_TICKS. The last interval
+// absorbs the rounding remainder so slices never drift against the clock.
+// A slice with zero steps is a single step-less wait of one slice.
+struct StepSlice {
+  uint32_t intervalTicks;
+  uint32_t lastIntervalTicks;
+  uint16_t steps;
+};
+
+template <typename Geometry>
+class SCurvePlanner {
+  public:
+    static_assert(Geometry::gotoStepsPerSecond(GOTO_RATE) * SCURVE_SLICE_US / 1000000.0 < 65535.0,
+                  "Goto steps per slice must fit 16 bits");
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Plan a rest-to-rest goto of distanceSteps goto microsteps (signed).
+    // Rates in degrees: GOTO_RATE, GOTO_ACCELERATION and AXIS*_JERK.
+    bool plan(int32_t distanceSteps, double rateDeg, double accelerationDeg, double jerkDeg) {
+      if (active_) return false;
+      forward_ = distanceSteps >= 0;
+      totalSteps_ = forward_ ? distanceSteps : -distanceSteps;
+      const double k = Geometry::stepsPerDegreeGoto;
+      if (totalSteps_ == 0 || !profile_.plan(totalSteps_, rateDeg * k, accelerationDeg * k, jerkDeg * k)) return false;
+      slice_ = 0;
+      planned_ = 0;
+      NW_ISR_LOCK();
+      head_ = tail_ = 0;
+      remaining_ = 0;
+      NW_ISR_UNLOCK();
+      active_ = true;
+      fill();
+      return true;
+    }
+
+    // Top up the ring; call every main loop pass while a goto is active.
+    // active() drops once the last slice has been consumed.
+    void fill() {
+      if (!active_) return;
+      if (planned_ >= totalSteps_) {
+        if (head_ == tail_ && remaining_ == 0) active_ = false;
+        return;
+      }
+      while (planned_ < totalSteps_ && ((head_ + 1) & MASK) != tail_) {
+        const double t = (double)(slice_ + 1) * (SCURVE_SLICE_US / 1000000.0);
+        int32_t target = (int32_t)lround(profile_.position(t));
+        if (target > totalSteps_) target = totalSteps_;
+        const uint16_t steps = (uint16_t)(target - planned_);
+        StepSlice &s = ring_[head_];
+        s.steps = steps;
+        if (steps == 0) {
+          s.intervalTicks = s.lastIntervalTicks = SCURVE_SLICE_TICKS;
+        } else {
+          s.intervalTicks = SCURVE_SLICE_TICKS / steps;
+          s.lastIntervalTicks = SCURVE_SLICE_TICKS - s.intervalTicks * (steps - 1);
+        }
+        planned_ = target;
+        slice_++;
+        head_ = (head_ + 1) & MASK;
+      }
+    }
+
+    // Abort: the ISR stops at the next pop. Use the rapid-stop ramp for motion
+    // already in progress; this only drops the rest of the schedule. The ISR
+    // owns tail_ and remaining_, so they are cleared with it masked.
+    void cancel() {
+      NW_ISR_LOCK();
+      active_ = false;
+      tail_ = head_;
+      remaining_ = 0;
+      NW_ISR_UNLOCK();
+    }
+
+    bool active() const { return active_; }
+    bool forward() const { return forward_; }
+    int32_t totalSteps() const { return totalSteps_; }
+    double durationSeconds() const { return profile_.duration(); }
+    double peakStepsPerSecond() const { return profile_.peakVelocity(); }
+    uint16_t buffered() const { return (head_ - tail_) & MASK; }
+
+    // ---- ISR side ----------------------------------------------------------
+
+    // Next timer interval and whether it ends with a step pulse. Returns false
+    // when the ring is empty (goto complete, or fill() fell behind).
+    inline bool pop(uint32_t *intervalTicks, bool *step) {
+      NW_BENCH_SCOPE(BENCH_STEP_ISR);
+      if (remaining_ == 0) {
+        if (tail_ == head_) return false;
+        current_ = ring_[tail_];
+        tail_ = (tail_ + 1) & MASK;
+        remaining_ = current_.steps ? current_.steps : 1;
+      }
+      remaining_--;
+      *intervalTicks = remaining_ == 0 ? current_.lastIntervalTicks : current_.intervalTicks;
+      *step = current_.steps != 0;
+      return true;
+    }
+
+  private:
+    static constexpr uint16_t MASK = SCURVE_RING_SLICES - 1;
+
+    SCurveProfile profile_;
+    StepSlice ring_[SCURVE_RING_SLICES] = {};
+    StepSlice current_ = {};
+    uint32_t slice_ = 0;
+    int32_t planned_ = 0;
+    int32_t totalSteps_ = 0;
+    bool forward_ = true;
+
+    volatile uint16_t head_ = 0;
+    volatile uint16_t tail_ = 0;
+    volatile uint16_t remaining_ = 0;
+    volatile bool active_ = false;
+};
+
+using Axis1SCurvePlanner = SCurvePlanner<Axis1Geometry>;
+using Axis2SCurvePlanner = SCurvePlanner<Axis2Geometry>;
+
+} // namespace nightwatch
@@ -0,0 +1,218 @@
+// NIGHTWATCH Firmware Extensions - Safety Park Fast Path
+//
+// A rain alert used to travel cloudwatcher.py -> SafetyMonitor ->
+// LX200Client.park() over the network, so how soon the mount started to
+// park depended on the host, the network and orchestrator load. SafetyPark
+// trips on the controller itself:
+//
+//   input      SAFETY_PARK_PIN asserted (rain sensor relay, roof controller
+//              contact) for SAFETY_PARK_DEBOUNCE_SAMPLES consecutive samples
+//   heartbeat  no :NWHB# from the safety monitor for SAFETY_HEARTBEAT_TIMEOUT_MS
+//              once it has sent one (host, network or monitor dead)
+//   host       :NWHP#, the safety monitor's own park request on the same path
+//
+// tick() runs from its own timer at SAFETY_SAMPLE_HZ. On a trip it calls the
+// RapidStopHandler right there, in interrupt context: the glue starts the
+// AXIS*_RAPID_STOP_TIME deceleration of both axes (OnStepX's abort path only
+// sets the axis rate targets; the axis ISRs ramp them down) and stops
+// SplineTrack / TargetQueue. The main loop then starts the park as soon as
+// both axes are stopped. Bounds, from Config.h alone:
+//
+//   trip -> deceleration starts   SAFETY_PARK_DEBOUNCE_SAMPLES / SAFETY_SAMPLE_HZ
+//   trip -> park goto starts      that + AXIS*_RAPID_STOP_TIME + one main loop pass
+//
+// The worst latencies actually seen are kept and reported by :NWHQ#. A trip
+// latches: gotos and unpark are refused (allowMotion()) and StatusFlag
+// STATUS_FAULT is raised until the host clears it with :NWHC#, which is
+// refused while the input is still asserted.
+//
+// A park that is refused, aborted (:Q#) or stops short of the park position
+// ends in SP_FAULT and counts a park failure, so :NWHC# can recover it. A
+// park goto counts as stopped short once the axes stop after it moved, or
+// when it has not moved within SAFETY_PARK_START_MS.
+//
+// Commands (LX200 channel):
+//   :NWHB#          heartbeat, arms the timeout                          -> 1#
+//   :NWHB0#         disarm the heartbeat (orderly host shutdown)         -> 1#
+//   :NWHP#          park through the fast path                           -> 1#
+//   :NWHC#          clear a latched trip                                 -> 1# or 0#
+//   :NWHQ#          state,cause mask,input,heartbeat age ms,worst stop latency us,
+//                   worst park latency ms,trips,park failures#
+//
+// Python side: OnStepXExtended.safety_heartbeat(), SafetyMonitor heartbeat task.
+
+#pragma once
+
+#include <stdio.h>
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+static_assert(SAFETY_SAMPLE_HZ >= 100 && SAFETY_SAMPLE_HZ <= 10000, "SAFETY_SAMPLE_HZ must be 100-10000");
+static_assert(SAFETY_PARK_DEBOUNCE_SAMPLES >= 1 && SAFETY_PARK_DEBOUNCE_SAMPLES <= 255,
+              "SAFETY_PARK_DEBOUNCE_SAMPLES must be 1-255");
+
+constexpr uint32_t SAFETY_SAMPLE_US = 1000000UL / SAFETY_SAMPLE_HZ;
+// Guaranteed trip -> deceleration start
+constexpr uint32_t SAFETY_STOP_LATENCY_US = SAFETY_PARK_DEBOUNCE_SAMPLES * SAFETY_SAMPLE_US;
+// Trip -> park goto start, less the main loop pass that starts it
+constexpr uint32_t SAFETY_PARK_LATENCY_MS = SAFETY_STOP_LATENCY_US / 1000UL +
+  (AXIS1_RAPID_STOP_TIME > AXIS2_RAPID_STOP_TIME ? AXIS1_RAPID_STOP_TIME : AXIS2_RAPID_STOP_TIME) * 1000UL;
+
+static_assert(SAFETY_STOP_LATENCY_US <= SAFETY_STOP_LATENCY_MAX_US,
+              "SAFETY_PARK_DEBOUNCE_SAMPLES at SAFETY_SAMPLE_HZ exceeds SAFETY_STOP_LATENCY_MAX_US");
+static_assert(SAFETY_HEARTBEAT_TIMEOUT_MS >= 1000 && SAFETY_HEARTBEAT_TIMEOUT_MS <= 600000,
+              "SAFETY_HEARTBEAT_TIMEOUT_MS must be 1-600 s");
+
+enum SafetyParkState : uint8_t {
+  SP_CLEAR = 0,
+  SP_STOPPING = 1,               // tripped, axes decelerating
+  SP_PARKING = 2,                // park goto running
+  SP_PARKED = 3,                 // parked, trip still latched
+  SP_FAULT = 4,                  // park refused or stopped short; axes stopped
+};
+
+enum SafetyParkCause : uint8_t {
+  SP_CAUSE_INPUT = 0x01,
+  SP_CAUSE_HEARTBEAT = 0x02,
+  SP_CAUSE_HOST = 0x04,
+};
+
+class SafetyPark {
+  public:
+    // Interrupt context: start the rapid stop of both axes, nothing slower
+    typedef void (*RapidStopHandler)();
+    // Main loop: start the park goto; returns 0 or the OnStepX CommandError
+    typedef uint8_t (*ParkHandler)();
+
+    void begin(RapidStopHandler rapidStopHandler, ParkHandler parkHandler) {
+      rapidStop_ = rapidStopHandler;
+      park_ = parkHandler;
+    }
+
+    // ---- ISR side (SAFETY_SAMPLE_HZ timer) ---------------------------------
+
+    // inputActive: SAFETY_PARK_PIN level already corrected for
+    // SAFETY_PARK_ACTIVE_LOW, false without a pin
+    void tick(uint32_t nowUs, bool inputActive) {
+      input_ = inputActive;
+      if (!inputActive) {
+        activeSamples_ = 0;
+      } else if (activeSamples_ < SAFETY_PARK_DEBOUNCE_SAMPLES) {
+        if (activeSamples_++ == 0) firstActiveUs_ = nowUs;
+        if (activeSamples_ == SAFETY_PARK_DEBOUNCE_SAMPLES) trip(SP_CAUSE_INPUT, firstActiveUs_, nowUs);
+      }
+      if (hostPark_) {
+        hostPark_ = false;
+        trip(SP_CAUSE_HOST, hostParkUs_, nowUs);
+      }
+      if (heartbeatArmed_ && nowUs - heartbeatUs_ >= SAFETY_HEARTBEAT_TIMEOUT_MS * 1000UL) {
+        heartbeatArmed_ = false;
+        trip(SP_CAUSE_HEARTBEAT, nowUs, nowUs);
+      }
+    }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // :NWHB# / :NWHB0#
+    void heartbeat(uint32_t nowUs, bool arm) {
+      heartbeatUs_ = nowUs;
+      heartbeatArmed_ = arm;
+    }
+
+    // :NWHP#; taken by the next tick()
+    void requestPark(uint32_t nowUs) {
+      hostParkUs_ = nowUs;
+      hostPark_ = true;
+    }
+
+    // :NWHC#
+    bool clear() {
+      if (input_ || state_ == SP_STOPPING || state_ == SP_PARKING) return false;
+      state_ = SP_CLEAR;
+      causes_ = 0;
+      return true;
+    }
+
+    // Call every main loop pass. stopped: neither axis is moving;
+    // parked: OnStepX reports the park complete
+    void poll(uint32_t nowUs, bool stopped, bool parked) {
+      switch (state_) {
+        case SP_CLEAR: break;
+        case SP_STOPPING: {
+          if (!stopped) break;
+          const uint8_t error = park_ == nullptr ? 1 : park_();
+          const uint32_t latencyMs = (nowUs - tripUs_) / 1000UL;
+          if (latencyMs > worstParkMs_) worstParkMs_ = latencyMs;
+          if (error != 0) {
+            parkFailures_++;
+            state_ = SP_FAULT;
+            break;
+          }
+          parkStartUs_ = nowUs;
+          parkMoved_ = false;
+          state_ = SP_PARKING;
+          break;
+        }
+        case SP_PARKING: {
+          if (parked) { state_ = SP_PARKED; break; }
+          if (!stopped) { parkMoved_ = true; break; }
+          // Aborted, refused by OnStepX after starting, or stopped short
+          if (parkMoved_ || nowUs - parkStartUs_ >= SAFETY_PARK_START_MS * 1000UL) {
+            parkFailures_++;
+            state_ = SP_FAULT;
+          }
+          break;
+        }
+        case SP_PARKED:
+        case SP_FAULT: break;
+      }
+    }
+
+    SafetyParkState state() const { return state_; }
+    bool tripped() const { return state_ != SP_CLEAR; }
+    bool allowMotion() const { return state_ == SP_CLEAR; }
+    uint8_t causes() const { return causes_; }
+
+    // Reply for :NWHQ#
+    int formatStatus(char *out, size_t size, uint32_t nowUs) const {
+      const unsigned long ageMs = heartbeatArmed_ ? (nowUs - heartbeatUs_) / 1000UL : 0;
+      return snprintf(out, size, "%u,%u,%u,%lu,%lu,%lu,%lu,%lu#", (unsigned)state_, (unsigned)causes_,
+                      input_ ? 1U : 0U, ageMs, (unsigned long)worstStopUs_, (unsigned long)worstParkMs_,
+                      (unsigned long)trips_, (unsigned long)parkFailures_);
+    }
+
+  private:
+    // Interrupt context. sinceUs: when the condition was first seen
+    void trip(uint8_t cause, uint32_t sinceUs, uint32_t nowUs) {
+      causes_ |= cause;
+      if (state_ != SP_CLEAR) return;
+      if (rapidStop_ != nullptr) rapidStop_();
+      tripUs_ = sinceUs;
+      if (nowUs - sinceUs > worstStopUs_) worstStopUs_ = nowUs - sinceUs;
+      trips_++;
+      state_ = SP_STOPPING;
+    }
+
+    RapidStopHandler rapidStop_ = nullptr;
+    ParkHandler park_ = nullptr;
+    volatile SafetyParkState state_ = SP_CLEAR;
+    volatile uint8_t causes_ = 0;
+    volatile bool input_ = false;
+    volatile bool hostPark_ = false;
+    volatile bool heartbeatArmed_ = false;
+    volatile uint32_t heartbeatUs_ = 0;
+    volatile uint32_t hostParkUs_ = 0;
+    uint8_t activeSamples_ = 0;
+    uint32_t firstActiveUs_ = 0;
+    volatile uint32_t tripUs_ = 0;
+    volatile uint32_t worstStopUs_ = 0;
+    uint32_t worstParkMs_ = 0;
+    volatile uint32_t trips_ = 0;
+    uint32_t parkStartUs_ = 0;
+    bool parkMoved_ = false;
+    uint32_t parkFailures_ = 0;
+};
+
+} // namespace nightwatch
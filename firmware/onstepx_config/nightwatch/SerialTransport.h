@@ -0,0 +1,113 @@
+// NIGHTWATCH Firmware Extensions - SERIAL_A Baud Negotiation
+//
+// SERIAL_A is the fallback LX200 link when Ethernet is down. At
+// SERIAL_A_BAUD_DEFAULT (9600) a :NWS# status frame alone takes ~50 ms and the
+// individual LX200 queries several times that, far too slow for safety
+// polling. The host therefore opens the link at the default rate and asks for
+// a faster one:
+//
+//   host  :NWBR<baud>#           at the current rate
+//   mount 1#                     at the current rate, then switches (0# if
+//                                the rate is not allowed)
+//   host  :NWBK#                 at the new rate within SERIAL_BAUD_CONFIRM_MS
+//   mount 1#                     at the new rate; the rate is now kept
+//
+// An unconfirmed switch reverts to SERIAL_A_BAUD_DEFAULT, and so does a
+// confirmed one after SERIAL_BAUD_IDLE_MS without a received byte, so a host
+// that restarts at the default rate always gets back in. :NWBK# is answered
+// at any time, letting a host probe a link it left at the high rate.
+//
+// Binary frame replies (:NWS#, :NWDS#, ...) work unchanged on the faster
+// link; at 921600 baud a status frame takes under 0.5 ms.
+//
+// Rates: 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 2000000,
+// limited to SERIAL_BAUD_MAX.
+
+#pragma once
+
+#include <stdlib.h>
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+constexpr uint32_t SERIAL_BAUD_RATES[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 2000000};
+
+inline bool serialBaudAllowed(uint32_t baud) {
+  if (baud > SERIAL_BAUD_MAX) return false;
+  for (uint32_t rate : SERIAL_BAUD_RATES) if (rate == baud) return true;
+  return false;
+}
+
+// Port is the SERIAL_A HardwareSerial (begin / flush)
+template <typename Port>
+class SerialBaud {
+  public:
+    void begin(Port *port, uint32_t nowMs) {
+      port_ = port;
+      baud_ = SERIAL_A_BAUD_DEFAULT;
+      state_ = SB_DEFAULT;
+      lastRxMs_ = nowMs;
+      port_->begin(baud_);
+    }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Call whenever SERIAL_A received bytes
+    void activity(uint32_t nowMs) { lastRxMs_ = nowMs; }
+
+    // :NWBR<baud># argument; returns the reply. The switch itself happens in
+    // poll() once the reply has been sent.
+    const char *request(const char *arg) {
+      char *end;
+      const unsigned long baud = strtoul(arg, &end, 10);
+      if (end == arg || *end != 0 || !serialBaudAllowed((uint32_t)baud)) return "0#";
+      pending_ = (uint32_t)baud;
+      return "1#";
+    }
+
+    // :NWBK#
+    const char *confirm() {
+      if (state_ == SB_UNCONFIRMED) state_ = SB_CONFIRMED;
+      return "1#";
+    }
+
+    // Call every main loop pass, after replies have been written
+    void poll(uint32_t nowMs) {
+      if (pending_ != 0) {
+        const uint32_t baud = pending_;
+        pending_ = 0;
+        switchTo(baud, nowMs, baud == SERIAL_A_BAUD_DEFAULT ? SB_DEFAULT : SB_UNCONFIRMED);
+        return;
+      }
+      if (state_ == SB_UNCONFIRMED && nowMs - switchMs_ > SERIAL_BAUD_CONFIRM_MS) {
+        switchTo(SERIAL_A_BAUD_DEFAULT, nowMs, SB_DEFAULT);
+      } else if (state_ == SB_CONFIRMED && nowMs - lastRxMs_ > SERIAL_BAUD_IDLE_MS) {
+        switchTo(SERIAL_A_BAUD_DEFAULT, nowMs, SB_DEFAULT);
+      }
+    }
+
+    uint32_t baud() const { return baud_; }
+    bool upgraded() const { return state_ == SB_CONFIRMED; }
+
+  private:
+    enum State : uint8_t { SB_DEFAULT, SB_UNCONFIRMED, SB_CONFIRMED };
+
+    void switchTo(uint32_t baud, uint32_t nowMs, State state) {
+      port_->flush();          // finish the reply at the old rate
+      port_->begin(baud);
+      baud_ = baud;
+      state_ = state;
+      switchMs_ = nowMs;
+      lastRxMs_ = nowMs;
+    }
+
+    Port *port_ = nullptr;
+    uint32_t baud_ = SERIAL_A_BAUD_DEFAULT;
+    uint32_t pending_ = 0;
+    uint32_t switchMs_ = 0;
+    uint32_t lastRxMs_ = 0;
+    State state_ = SB_DEFAULT;
+};
+
+} // namespace nightwatch
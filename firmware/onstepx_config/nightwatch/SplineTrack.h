@@ -0,0 +1,406 @@
+// NIGHTWATCH Firmware Extensions - Spline Track Mode
+//
+// Custom-rate tracking for fast movers (LEO satellites, bolide follow-ups).
+// A stream of gotos from services/meteor_tracking cannot keep up: every goto
+// is a host round trip plus a rest-to-rest ramp. Instead the host uploads the
+// whole path once as a cubic Hermite spline (position and rate at each knot,
+// RA/Dec or Alt/Az) and the controller follows it on its own.
+//
+// The main loop evaluates the spline once per SPLINE_TRACK_SLICE_US, has the
+// OnStepX glue convert the point to axis angles at that instant (so RA/Dec
+// paths pick up the sidereal term and the pointing model), and turns the
+// change in goto microsteps into a slice for the step ISR, exactly like
+// SCurvePlanner. The commanded rate is the spline's own rate plus a catch-up
+// term, limited to AXIS*_SLEW_RATE_DESIRED and GOTO_ACCELERATION, and uses a
+// braking curve so a catch-up never overshoots. Slices the limits clipped
+// after the lead-in are counted; the host sees them as lag in :NWKQ#.
+//
+// Before the first knot's time the axes chase the first knot (lead-in), so
+// :NWKS# can be sent from anywhere nearby. After the last knot they brake to
+// the end point and the track is DONE; the glue then resumes normal
+// tracking. Knot times are relative to the start time in the upload, in
+// controller microseconds (the TelemetryStream timestamp clock), or to the
+// :NWKS# command when it is 0.
+//
+// Upload payload (little-endian):
+//   u8  frame (SplineFrame), u8 reserved = 0, u16 knot count (2..SPLINE_TRACK_KNOTS)
+//   u64 start time, controller microseconds (0 = on :NWKS#)
+//   count × { u32 t ms, i32 c1 mas, i32 c2 mas, i32 c1 rate mas/s, i32 c2 rate mas/s }
+// c1/c2 are RA/Dec or Az/Alt. Knot times must increase; RA and Az are
+// unwrapped by the host, so a path across 0h keeps going past 360°.
+//
+// Commands (LX200 channel):
+//   :NWU#           upload a FRAME_SPLINE_TRACK frame (refused while running) -> 1# or 0#
+//   :NWKS#          start following the uploaded track                      -> 1# or 0#
+//   :NWKX#          stop; the glue brings running slices to a rapid stop   -> 1#
+//   :NWKQ#          state,ms into track,axis1 lag mas,axis2 lag mas,clipped slices,underruns#
+//
+// Python side: OnStepXExtended.upload_spline_track(), nightwatch_protocol.spline_knots_from_samples().
+
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+
+#include "AxisGeometry.h"
+#include "Benchmark.h"
+#include "Frame.h"
+
+namespace nightwatch {
+
+static_assert(SPLINE_TRACK_KNOTS >= 2 && SPLINE_TRACK_KNOTS <= 4096, "SPLINE_TRACK_KNOTS must be 2-4096");
+static_assert(12 + 20 * SPLINE_TRACK_KNOTS + FRAME_OVERHEAD <= CMD_SERVER_UPLOAD_CAPACITY,
+              "SPLINE_TRACK_KNOTS upload does not fit CMD_SERVER_UPLOAD_CAPACITY");
+static_assert((SPLINE_TRACK_RING_SLICES & (SPLINE_TRACK_RING_SLICES - 1)) == 0 && SPLINE_TRACK_RING_SLICES >= 8,
+              "SPLINE_TRACK_RING_SLICES must be a power of two of at least 8");
+static_assert(SPLINE_TRACK_SLICE_US >= 100 && SPLINE_TRACK_SLICE_US <= 10000,
+              "SPLINE_TRACK_SLICE_US must be between 100 and 10000");
+
+constexpr uint16_t SPLINE_HEADER_SIZE = 12;
+constexpr uint16_t SPLINE_KNOT_SIZE = 20;
+constexpr double SPLINE_SLICE_S = SPLINE_TRACK_SLICE_US / 1000000.0;
+constexpr uint32_t SPLINE_SLICE_TICKS = (uint32_t)((uint64_t)NW_STEP_TIMER_HZ * SPLINE_TRACK_SLICE_US / 1000000UL);
+
+enum SplineFrame : uint8_t {
+  SPLINE_RADEC = 0,
+  SPLINE_ALTAZ = 1,        // c1 = azimuth, c2 = altitude
+};
+
+enum SplineTrackState : uint8_t {
+  SPLINE_IDLE = 0,         // nothing uploaded, or stopped
+  SPLINE_LOADED = 1,       // uploaded, waiting for :NWKS#
+  SPLINE_LEAD_IN = 2,      // chasing the first knot before its time
+  SPLINE_FOLLOWING = 3,
+  SPLINE_DONE = 4,         // braked to the last knot
+  SPLINE_FAULT = 5,        // the glue refused a point (limits, horizon)
+};
+
+struct SplineKnot {
+  uint32_t tMs;
+  int32_t c[2];            // mas
+  int32_t rate[2];         // mas/s
+};
+
+// =============================================================================
+// AXIS FOLLOWER
+// =============================================================================
+// Rate- and acceleration-limited chase of one axis toward the spline target,
+// in goto microsteps, feeding a slice ring to the step ISR. Unlike
+// SCurvePlanner slices carry their own direction: fast paths reverse (an Az
+// axis through the zenith, Dec at culmination).
+struct SplineSlice {
+  uint32_t intervalTicks;
+  uint32_t lastIntervalTicks;
+  uint16_t steps;
+  bool forward;
+};
+
+template <typename Geometry>
+class SplineAxis {
+  public:
+    static_assert(Geometry::gotoStepsPerSecond(GOTO_RATE) * SPLINE_SLICE_S < 65535.0,
+                  "Spline track steps per slice must fit 16 bits");
+
+    // ---- main loop side ----------------------------------------------------
+
+    // positionSteps: the axis position now, goto microsteps
+    void reset(int32_t positionSteps, double rateDeg, double accelerationDeg) {
+      planned_ = positionSteps;
+      position_ = positionSteps;
+      lastMove_ = 0;
+      maxMove_ = rateDeg * Geometry::stepsPerDegreeGoto * SPLINE_SLICE_S;
+      maxDelta_ = accelerationDeg * Geometry::stepsPerDegreeGoto * SPLINE_SLICE_S * SPLINE_SLICE_S;
+      NW_ISR_LOCK();
+      head_ = tail_ = 0;
+      remaining_ = 0;
+      NW_ISR_UNLOCK();
+    }
+
+    bool full() const { return ((head_ + 1) & MASK) == tail_; }
+    bool empty() const { return head_ == tail_ && remaining_ == 0; }
+
+    // Queue the next slice toward targetSteps (where the axis should be at
+    // the end of the slice) given the target's own motion this slice.
+    // Returns true when a limit clipped the move.
+    bool push(double targetSteps, double feedSteps) {
+      const double gap = targetSteps - position_;
+      double move = gap;
+      // Braking curve: relative to the moving target, never close faster than
+      // half the acceleration limit could stop in the remaining error. The
+      // other half absorbs the discrete slices and the target's own changes.
+      const double closing = sqrt(maxDelta_ * fabs(gap - feedSteps));
+      if (move > feedSteps + closing) move = feedSteps + closing;
+      if (move < feedSteps - closing) move = feedSteps - closing;
+      if (move > lastMove_ + maxDelta_) move = lastMove_ + maxDelta_;
+      if (move < lastMove_ - maxDelta_) move = lastMove_ - maxDelta_;
+      if (move > maxMove_) move = maxMove_;
+      if (move < -maxMove_) move = -maxMove_;
+
+      // Steps are differences of the rounded planned position, so fractional
+      // moves accumulate instead of being lost slice by slice
+      position_ += move;
+      const int32_t next = (int32_t)lround(position_);
+      const int32_t steps = next - planned_;
+      SplineSlice &s = ring_[head_];
+      s.forward = steps >= 0;
+      s.steps = (uint16_t)(steps < 0 ? -steps : steps);
+      if (s.steps == 0) {
+        s.intervalTicks = s.lastIntervalTicks = SPLINE_SLICE_TICKS;
+      } else {
+        s.intervalTicks = SPLINE_SLICE_TICKS / s.steps;
+        s.lastIntervalTicks = SPLINE_SLICE_TICKS - s.intervalTicks * (s.steps - 1);
+      }
+      planned_ = next;
+      lagSteps_ = targetSteps - position_;
+      const bool clipped = fabs(move - gap) > 1.0;
+      lastMove_ = move;
+      head_ = (head_ + 1) & MASK;
+      return clipped;
+    }
+
+    // Drop the rest of the ring (stop / fault). The ISR owns tail_ and
+    // remaining_, so they are cleared with it masked, as in SCurvePlanner.
+    void cancel() {
+      NW_ISR_LOCK();
+      tail_ = head_;
+      remaining_ = 0;
+      NW_ISR_UNLOCK();
+    }
+
+    int32_t plannedSteps() const { return planned_; }
+    double lagSteps() const { return lagSteps_; }
+    double lastMoveSteps() const { return lastMove_; }
+
+    // ---- ISR side ----------------------------------------------------------
+
+    // Next timer interval, whether it ends with a step pulse and its
+    // direction. Returns false when the ring is empty.
+    inline bool pop(uint32_t *intervalTicks, bool *step, bool *forward) {
+      NW_BENCH_SCOPE(BENCH_STEP_ISR);
+      if (remaining_ == 0) {
+        if (tail_ == head_) return false;
+        current_ = ring_[tail_];
+        tail_ = (tail_ + 1) & MASK;
+        remaining_ = current_.steps ? current_.steps : 1;
+      }
+      remaining_--;
+      *intervalTicks = remaining_ == 0 ? current_.lastIntervalTicks : current_.intervalTicks;
+      *step = current_.steps != 0;
+      *forward = current_.forward;
+      return true;
+    }
+
+  private:
+    static constexpr uint16_t MASK = SPLINE_TRACK_RING_SLICES - 1;
+
+    SplineSlice ring_[SPLINE_TRACK_RING_SLICES] = {};
+    SplineSlice current_ = {};
+    int32_t planned_ = 0;
+    double position_ = 0;
+    double lastMove_ = 0;
+    double lagSteps_ = 0;
+    double maxMove_ = 0;
+    double maxDelta_ = 0;
+
+    volatile uint16_t head_ = 0;
+    volatile uint16_t tail_ = 0;
+    volatile uint16_t remaining_ = 0;
+};
+
+// =============================================================================
+// TRACK
+// =============================================================================
+template <typename Geometry1, typename Geometry2>
+class SplineTrack {
+  public:
+    // Convert a spline point (degrees) at controller time atUs to axis angles
+    // in degrees, the same angles the step counts are measured from. Return
+    // false for a point the mount must not go to.
+    typedef bool (*AxisConverter)(uint8_t frame, double c1Deg, double c2Deg, uint64_t atUs,
+                                  double *axis1Deg, double *axis2Deg);
+
+    void begin(AxisConverter converter) { converter_ = converter; }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Accept a FRAME_SPLINE_TRACK payload; false leaves the loaded track unchanged
+    bool load(const uint8_t *payload, uint16_t length) {
+      if (running() || length < SPLINE_HEADER_SIZE) return false;
+      const uint8_t frame = payload[0];
+      const uint16_t count = getU16(payload + 2);
+      if (frame > SPLINE_ALTAZ || payload[1] != 0 || count < 2 || count > SPLINE_TRACK_KNOTS) return false;
+      if (length != SPLINE_HEADER_SIZE + (uint32_t)count * SPLINE_KNOT_SIZE) return false;
+      const uint8_t *p = payload + SPLINE_HEADER_SIZE;
+      for (uint16_t i = 1; i < count; i++) {
+        if (getU32(p + i * SPLINE_KNOT_SIZE) <= getU32(p + (i - 1) * SPLINE_KNOT_SIZE)) return false;
+      }
+      for (uint16_t i = 0; i < count; i++, p += SPLINE_KNOT_SIZE) {
+        SplineKnot &k = knots_[i];
+        k.tMs = getU32(p);
+        k.c[0] = (int32_t)getU32(p + 4);
+        k.c[1] = (int32_t)getU32(p + 8);
+        k.rate[0] = (int32_t)getU32(p + 12);
+        k.rate[1] = (int32_t)getU32(p + 16);
+      }
+      frame_ = frame;
+      count_ = count;
+      startUs_ = (uint64_t)getU32(payload + 4) | (uint64_t)getU32(payload + 8) << 32;
+      state_ = SPLINE_LOADED;
+      return true;
+    }
+
+    // :NWKS#. axis*Deg: the axis angles now (same convention as AxisConverter)
+    bool start(uint64_t nowUs, double axis1Deg, double axis2Deg) {
+      if (state_ != SPLINE_LOADED && state_ != SPLINE_DONE) return false;
+      if (converter_ == nullptr) return false;
+      originUs_ = nowUs;
+      trackStartUs_ = startUs_ != 0 ? startUs_ : nowUs;
+      slice_ = 0;
+      segment_ = 0;
+      clipped_ = 0;
+      underruns_ = 0;
+      axis1_.reset((int32_t)lround(axis1Deg * Geometry1::stepsPerDegreeGoto),
+                   minRate(AXIS1_SLEW_RATE_DESIRED, GOTO_RATE), GOTO_ACCELERATION);
+      axis2_.reset((int32_t)lround(axis2Deg * Geometry2::stepsPerDegreeGoto),
+                   minRate(AXIS2_SLEW_RATE_DESIRED, GOTO_RATE), GOTO_ACCELERATION);
+      haveLast_ = false;
+      state_ = SPLINE_LEAD_IN;
+      fill(nowUs);
+      return state_ != SPLINE_FAULT;
+    }
+
+    // :NWKX# and the :Q / park / limit paths. The uploaded track stays loaded.
+    void stop() {
+      axis1_.cancel();
+      axis2_.cancel();
+      state_ = count_ >= 2 ? SPLINE_LOADED : SPLINE_IDLE;
+    }
+
+    // Top up both rings; call every main loop pass while running()
+    void fill(uint64_t nowUs) {
+      if (!running()) return;
+      // The ISR ran dry: the slice timeline fell behind the clock. Skip ahead
+      // instead of replaying the past at full rate.
+      if (axis1_.empty() && axis2_.empty() && slice_ > 0) {
+        const uint32_t due = (uint32_t)((nowUs - originUs_) / SPLINE_TRACK_SLICE_US);
+        if (due > slice_) { slice_ = due; underruns_++; }
+      }
+      while (!axis1_.full() && !axis2_.full()) {
+        const uint64_t atUs = originUs_ + (uint64_t)(slice_ + 1) * SPLINE_TRACK_SLICE_US;
+        double target[2];
+        if (!evaluate(atUs, target)) { fault(); return; }
+        double feed[2] = {0, 0};
+        if (haveLast_) { feed[0] = target[0] - last_[0]; feed[1] = target[1] - last_[1]; }
+        last_[0] = target[0];
+        last_[1] = target[1];
+        haveLast_ = true;
+        const bool clipped = axis1_.push(target[0], feed[0]) | axis2_.push(target[1], feed[1]);
+        if (clipped && state_ == SPLINE_FOLLOWING) clipped_++;
+        slice_++;
+        if (state_ == SPLINE_DONE) return;
+      }
+    }
+
+    bool running() const { return state_ == SPLINE_LEAD_IN || state_ == SPLINE_FOLLOWING; }
+    SplineTrackState state() const { return state_; }
+    uint16_t knots() const { return count_; }
+    uint32_t clippedSlices() const { return clipped_; }
+    uint32_t underruns() const { return underruns_; }
+
+    // The step ISR pops each axis ring directly
+    SplineAxis<Geometry1> &axis1() { return axis1_; }
+    SplineAxis<Geometry2> &axis2() { return axis2_; }
+
+    int32_t lagMas(uint8_t axis) const {
+      return axis == 0 ? (int32_t)lround(axis1_.lagSteps() / Geometry1::stepsPerDegreeGoto * MAS_PER_DEGREE)
+                       : (int32_t)lround(axis2_.lagSteps() / Geometry2::stepsPerDegreeGoto * MAS_PER_DEGREE);
+    }
+
+    // Milliseconds into the track at the last planned slice (negative in the lead-in)
+    int32_t elapsedMs() const {
+      const int64_t at = (int64_t)(originUs_ + (uint64_t)slice_ * SPLINE_TRACK_SLICE_US);
+      return (int32_t)((at - (int64_t)trackStartUs_) / 1000);
+    }
+
+    // Reply for :NWKQ#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%ld,%ld,%ld,%lu,%lu#", (unsigned)state_, (long)elapsedMs(),
+                      (long)lagMas(0), (long)lagMas(1), (unsigned long)clipped_, (unsigned long)underruns_);
+    }
+
+    // Spline point at t seconds into the track, degrees; clamps to the ends
+    void pointAt(double t, double *c1Deg, double *c2Deg) {
+      const double tMs = t * 1000.0;
+      if (tMs <= knots_[0].tMs) { endPoint(0, c1Deg, c2Deg); return; }
+      if (tMs >= knots_[count_ - 1].tMs) { endPoint(count_ - 1, c1Deg, c2Deg); return; }
+      // Slices move forward in time, so the segment search resumes where it stopped
+      if (tMs < knots_[segment_].tMs) segment_ = 0;
+      while (segment_ + 2 < count_ && tMs >= knots_[segment_ + 1].tMs) segment_++;
+      const SplineKnot &a = knots_[segment_];
+      const SplineKnot &b = knots_[segment_ + 1];
+      const double h = (b.tMs - a.tMs) / 1000.0;
+      const double s = (tMs - a.tMs) / (b.tMs - a.tMs);
+      const double s2 = s * s, s3 = s2 * s;
+      const double h00 = 2 * s3 - 3 * s2 + 1, h10 = s3 - 2 * s2 + s;
+      const double h01 = -2 * s3 + 3 * s2, h11 = s3 - s2;
+      double c[2];
+      for (int i = 0; i < 2; i++) {
+        c[i] = h00 * a.c[i] + h10 * h * a.rate[i] + h01 * b.c[i] + h11 * h * b.rate[i];
+      }
+      *c1Deg = c[0] / MAS_PER_DEGREE;
+      *c2Deg = c[1] / MAS_PER_DEGREE;
+    }
+
+  private:
+    static constexpr double minRate(double a, double b) { return a < b ? a : b; }
+
+    void endPoint(uint16_t i, double *c1Deg, double *c2Deg) const {
+      *c1Deg = knots_[i].c[0] / MAS_PER_DEGREE;
+      *c2Deg = knots_[i].c[1] / MAS_PER_DEGREE;
+    }
+
+    // Target of the slice ending at atUs, in goto microsteps; advances the state
+    bool evaluate(uint64_t atUs, double *target) {
+      const double t = ((double)atUs - (double)trackStartUs_) / 1000000.0;
+      const double lastS = knots_[count_ - 1].tMs / 1000.0;
+      if (state_ == SPLINE_LEAD_IN && t >= knots_[0].tMs / 1000.0) state_ = SPLINE_FOLLOWING;
+      double c1, c2, axis1, axis2;
+      pointAt(t, &c1, &c2);
+      if (!converter_(frame_, c1, c2, atUs, &axis1, &axis2)) return false;
+      target[0] = axis1 * Geometry1::stepsPerDegreeGoto;
+      target[1] = axis2 * Geometry2::stepsPerDegreeGoto;
+      // Past the end: done once both axes have braked onto the end point
+      if (t > lastS && fabs(target[0] - axis1_.plannedSteps()) < 1.0 && fabs(target[1] - axis2_.plannedSteps()) < 1.0 &&
+          fabs(axis1_.lastMoveSteps()) < 1.0 && fabs(axis2_.lastMoveSteps()) < 1.0) {
+        state_ = SPLINE_DONE;
+      }
+      return true;
+    }
+
+    void fault() {
+      axis1_.cancel();
+      axis2_.cancel();
+      state_ = SPLINE_FAULT;
+    }
+
+    AxisConverter converter_ = nullptr;
+    SplineKnot knots_[SPLINE_TRACK_KNOTS] = {};
+    SplineAxis<Geometry1> axis1_;
+    SplineAxis<Geometry2> axis2_;
+    uint16_t count_ = 0;
+    uint16_t segment_ = 0;
+    uint8_t frame_ = SPLINE_RADEC;
+    SplineTrackState state_ = SPLINE_IDLE;
+    uint64_t startUs_ = 0;
+    uint64_t trackStartUs_ = 0;
+    uint64_t originUs_ = 0;
+    uint32_t slice_ = 0;
+    uint32_t clipped_ = 0;
+    uint32_t underruns_ = 0;
+    double last_[2] = {0, 0};
+    bool haveLast_ = false;
+};
+
+using NightwatchSplineTrack = SplineTrack<Axis1Geometry, Axis2Geometry>;
+
+} // namespace nightwatch
@@ -0,0 +1,284 @@
+// NIGHTWATCH Firmware Extensions - StallGuard Calibration
+//
+// AXIS*_DRIVER_STALLGUARD_THRESHOLD and AXIS*_DRIVER_STEALTHCHOP_THRESHOLD
+// are single hand-picked values. SG_RESULT depends strongly on velocity, so a
+// threshold safe at low speed false-trips at high speed, which is what caps
+// GOTO_RATE today. This module measures the real curve instead.
+//
+// Calibration (:NWSC<axis>#, mount idle) sweeps STALLGUARD_CAL_POINTS rates
+// geometrically from STALLGUARD_CAL_RATE_MIN to STALLGUARD_CAL_RATE_MAX in
+// SpreadCycle. Each rate runs for the same time forward, then in reverse, so
+// every pair of legs cancels and the axis ends where it started. On each leg
+// it waits STALLGUARD_CAL_SETTLE_MS, then samples SG_RESULT from
+// DriverStatusCache for STALLGUARD_CAL_SAMPLE_MS; the point keeps mean and
+// minimum over both legs. The stall threshold at that rate is
+// STALLGUARD_CAL_MARGIN × the unloaded minimum.
+//
+// StallGuard2 only works in SpreadCycle and is noisy at low speed. The
+// StealthChop→SpreadCycle crossover is the lowest rate whose threshold clears
+// STALLGUARD_CAL_MIN_SG; below it the axis stays in StealthChop with stall
+// detection off, above it TPWMTHRS / TCOOLTHRS switch to SpreadCycle and
+// stalled() compares SG_RESULT against the interpolated threshold.
+//
+// The finished table is written to EEPROM at STALLGUARD_CAL_NV_ADDR (axis 2
+// follows axis 1) with a CRC and reloaded at boot; with FLASH_STORE ON the
+// same serialized table is the STORE_STALLGUARD_AXIS* record instead. Without
+// a valid table the fixed Config.h thresholds stay in charge.
+//
+// Commands (text, LX200 channel):
+//   :NWSC<axis>#         start calibration (mount idle)            -> 1# or 0#
+//   :NWSQ<axis>#         state,point,points,crossover mdeg/s#
+//   :NWSP<axis><n>#      rate mdeg/s,SG mean,SG min,threshold#  (point n)
+
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+
+#include "AxisGeometry.h"
+#include "Frame.h"
+
+namespace nightwatch {
+
+static_assert(STALLGUARD_CAL_POINTS >= 2 && STALLGUARD_CAL_POINTS <= 32,
+              "STALLGUARD_CAL_POINTS must be between 2 and 32");
+static_assert(STALLGUARD_CAL_RATE_MIN > 0 && STALLGUARD_CAL_RATE_MAX > STALLGUARD_CAL_RATE_MIN,
+              "STALLGUARD_CAL_RATE_MIN/MAX must be positive and increasing");
+static_assert(STALLGUARD_CAL_MARGIN > 0 && STALLGUARD_CAL_MARGIN < 1,
+              "STALLGUARD_CAL_MARGIN must be between 0 and 1");
+
+enum StallGuardCalState : uint8_t {
+  SG_CAL_NONE     = 0,   // no table; fixed Config.h thresholds
+  SG_CAL_RUNNING  = 1,
+  SG_CAL_DONE     = 2,   // valid table in use
+  SG_CAL_FAILED   = 3,   // no SG_RESULT samples or no usable point
+};
+
+struct StallGuardPoint {
+  uint16_t rateMdeg;     // axis rate, millidegrees/second
+  uint16_t sgMean;
+  uint16_t sgMin;
+  uint16_t threshold;    // 0 = stall detection off at this rate
+};
+
+constexpr uint16_t STALLGUARD_NV_MAGIC = 0x5347;   // "SG"
+constexpr uint16_t STALLGUARD_NV_SIZE = 6 + 8 * STALLGUARD_CAL_POINTS + 2;
+
+// Geometry is an AxisGeometry<> instantiation, Microsteps AXIS*_DRIVER_MICROSTEPS,
+// FallbackCrossover AXIS*_DRIVER_STEALTHCHOP_THRESHOLD (steps/s)
+template <typename Geometry, uint32_t Microsteps, uint32_t FallbackCrossover>
+class StallGuardCal {
+  public:
+    // TSTEP counts 1/fCLK between 1/256 microsteps
+    static constexpr double microsteps256PerDegree = Geometry::stepsPerDegree * 256.0 / Microsteps;
+
+    static uint32_t tstepAt(double rateDeg) {
+      if (rateDeg <= 0) return 0xFFFFF;
+      const double t = TMC5160_CLOCK_HZ / (rateDeg * microsteps256PerDegree);
+      return t > 0xFFFFF ? 0xFFFFF : (uint32_t)t;
+    }
+
+    // ---- calibration (main loop) ------------------------------------------
+
+    bool start(uint32_t nowMs) {
+      if (state_ == SG_CAL_RUNNING) return false;
+      for (uint8_t i = 0; i < STALLGUARD_CAL_POINTS; i++) {
+        const double r = STALLGUARD_CAL_RATE_MIN *
+          pow((double)STALLGUARD_CAL_RATE_MAX / STALLGUARD_CAL_RATE_MIN, (double)i / (STALLGUARD_CAL_POINTS - 1));
+        running_[i] = StallGuardPoint{(uint16_t)(r * 1000.0 + 0.5), 0, 0, 0};
+      }
+      leg_ = 0;
+      beginPoint(nowMs);
+      state_ = SG_CAL_RUNNING;
+      return true;
+    }
+
+    void abort() { if (state_ == SG_CAL_RUNNING) state_ = validTable_ ? SG_CAL_DONE : SG_CAL_NONE; }
+
+    // Call every main loop pass during calibration with the DriverStatusCache
+    // snapshot; each new snapshot (updatedMs changed) is one sample. Returns
+    // true when calibration just finished and the table should be saved.
+    bool poll(uint32_t nowMs, uint16_t sgResult, uint32_t updatedMs, bool valid) {
+      if (state_ != SG_CAL_RUNNING) return false;
+      if ((int32_t)(nowMs - legStartMs_) < STALLGUARD_CAL_SETTLE_MS) return false;
+      if (valid && updatedMs != lastSampleMs_ && (int32_t)(updatedMs - legStartMs_) >= STALLGUARD_CAL_SETTLE_MS) {
+        lastSampleMs_ = updatedMs;
+        sum_ += sgResult;
+        count_++;
+        if (sgResult < min_) min_ = sgResult;
+      }
+      if ((int32_t)(nowMs - legStartMs_) < STALLGUARD_CAL_SETTLE_MS + STALLGUARD_CAL_SAMPLE_MS) return false;
+
+      if (count_ == legStartCount_) { state_ = SG_CAL_FAILED; return false; }
+      if ((leg_++ & 1) == 0) { beginLeg(nowMs); return false; }   // now the reverse leg
+      StallGuardPoint &p = running_[point()];
+      p.sgMean = (uint16_t)(sum_ / count_);
+      p.sgMin = min_;
+      p.threshold = (uint16_t)(min_ * STALLGUARD_CAL_MARGIN);
+      if (point() < STALLGUARD_CAL_POINTS) { beginPoint(nowMs); return false; }
+      return finish();
+    }
+
+    // Signed rate the glue should run the axis at (deg/s, 0 when idle), in
+    // SpreadCycle while calibrating() is true: forward on the first leg of a
+    // point, reverse on the second
+    double commandRate() const {
+      if (state_ != SG_CAL_RUNNING) return 0;
+      const double r = running_[point()].rateMdeg / 1000.0;
+      return (leg_ & 1) ? -r : r;
+    }
+    bool calibrating() const { return state_ == SG_CAL_RUNNING; }
+
+    // ---- runtime (main loop) ----------------------------------------------
+
+    bool calibrated() const { return validTable_; }
+    double crossoverDeg() const { return crossoverMdeg_ / 1000.0; }
+    // Fastest swept rate, which the axis ran unloaded without a stall (0 until calibrated)
+    double maxRateDeg() const { return validTable_ ? table_[STALLGUARD_CAL_POINTS - 1].rateMdeg / 1000.0 : 0; }
+
+    // Use SpreadCycle (and StallGuard) at this rate
+    bool spreadCycleAt(double rateDeg) const {
+      if (!validTable_) return fabs(rateDeg) * Geometry::stepsPerDegree >= FallbackCrossover;
+      return fabs(rateDeg) * 1000.0 >= crossoverMdeg_;
+    }
+
+    // TPWMTHRS / TCOOLTHRS register value for the calibrated crossover
+    uint32_t crossoverTstep() const { return tstepAt(crossoverDeg()); }
+
+    // Interpolated SG_RESULT stall threshold at a rate, 0 = detection off
+    uint16_t thresholdAt(double rateDeg) const {
+      if (!validTable_) return 0;
+      const double m = fabs(rateDeg) * 1000.0;
+      if (m < crossoverMdeg_) return 0;
+      if (m <= table_[0].rateMdeg) return table_[0].threshold;
+      for (uint8_t i = 1; i < STALLGUARD_CAL_POINTS; i++) {
+        if (m <= table_[i].rateMdeg) {
+          const StallGuardPoint &a = table_[i - 1], &b = table_[i];
+          if (a.threshold == 0) return b.threshold;
+          const double f = (m - a.rateMdeg) / (double)(b.rateMdeg - a.rateMdeg);
+          return (uint16_t)(a.threshold + f * ((double)b.threshold - a.threshold) + 0.5);
+        }
+      }
+      return table_[STALLGUARD_CAL_POINTS - 1].threshold;   // above the sweep: hold the last value
+    }
+
+    bool stalled(uint16_t sgResult, double rateDeg) const {
+      const uint16_t threshold = thresholdAt(rateDeg);
+      return threshold != 0 && sgResult < threshold;
+    }
+
+    StallGuardCalState state() const { return state_; }
+
+    // Reply for :NWSQ<axis>#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%u,%u,%u#", (unsigned)state_,
+                      (unsigned)(state_ == SG_CAL_RUNNING ? point() : 0),
+                      (unsigned)STALLGUARD_CAL_POINTS, (unsigned)crossoverMdeg_);
+    }
+
+    // Reply for :NWSP<axis><n>#
+    int formatPoint(uint8_t n, char *out, size_t size) const {
+      if (n >= STALLGUARD_CAL_POINTS || !validTable_) return snprintf(out, size, "0#");
+      const StallGuardPoint &p = table_[n];
+      return snprintf(out, size, "%u,%u,%u,%u#", (unsigned)p.rateMdeg, (unsigned)p.sgMean,
+                      (unsigned)p.sgMin, (unsigned)p.threshold);
+    }
+
+    // ---- persistence ------------------------------------------------------
+    // Eeprom provides read(address) and update(address, value), as the
+    // Teensy EEPROM class does.
+
+    template <typename Eeprom>
+    void save(Eeprom &eeprom, uint16_t address) const {
+      uint8_t buffer[STALLGUARD_NV_SIZE];
+      serialize(buffer);
+      for (uint16_t i = 0; i < STALLGUARD_NV_SIZE; i++) eeprom.update(address + i, buffer[i]);
+    }
+
+    template <typename Eeprom>
+    bool load(Eeprom &eeprom, uint16_t address) {
+      uint8_t buffer[STALLGUARD_NV_SIZE];
+      for (uint16_t i = 0; i < STALLGUARD_NV_SIZE; i++) buffer[i] = eeprom.read(address + i);
+      return deserialize(buffer);
+    }
+
+    void serialize(uint8_t *out) const {
+      uint8_t *p = out;
+      p = putU16(p, STALLGUARD_NV_MAGIC);
+      p = putU16(p, STALLGUARD_CAL_POINTS);
+      p = putU16(p, crossoverMdeg_);
+      for (const StallGuardPoint &s : table_) {
+        p = putU16(p, s.rateMdeg);
+        p = putU16(p, s.sgMean);
+        p = putU16(p, s.sgMin);
+        p = putU16(p, s.threshold);
+      }
+      putU16(p, crc16(out, STALLGUARD_NV_SIZE - 2));
+    }
+
+    bool deserialize(const uint8_t *in) {
+      if (getU16(in) != STALLGUARD_NV_MAGIC || getU16(in + 2) != STALLGUARD_CAL_POINTS) return false;
+      if (getU16(in + STALLGUARD_NV_SIZE - 2) != crc16(in, STALLGUARD_NV_SIZE - 2)) return false;
+      crossoverMdeg_ = getU16(in + 4);
+      const uint8_t *p = in + 6;
+      for (StallGuardPoint &s : table_) {
+        s = StallGuardPoint{getU16(p), getU16(p + 2), getU16(p + 4), getU16(p + 6)};
+        p += 8;
+      }
+      validTable_ = true;
+      state_ = SG_CAL_DONE;
+      return true;
+    }
+
+  private:
+    uint8_t point() const { return leg_ >> 1; }
+
+    void beginPoint(uint32_t nowMs) {
+      sum_ = 0;
+      count_ = 0;
+      min_ = 0xFFFF;
+      beginLeg(nowMs);
+    }
+
+    void beginLeg(uint32_t nowMs) {
+      legStartMs_ = nowMs;
+      lastSampleMs_ = nowMs;
+      legStartCount_ = count_;
+    }
+
+    bool finish() {
+      uint8_t first = STALLGUARD_CAL_POINTS;
+      for (uint8_t i = 0; i < STALLGUARD_CAL_POINTS; i++) {
+        if (running_[i].threshold >= STALLGUARD_CAL_MIN_SG) { first = i; break; }
+      }
+      if (first == STALLGUARD_CAL_POINTS) { state_ = SG_CAL_FAILED; return false; }
+      for (uint8_t i = 0; i < first; i++) running_[i].threshold = 0;
+      for (uint8_t i = 0; i < STALLGUARD_CAL_POINTS; i++) table_[i] = running_[i];
+      crossoverMdeg_ = table_[first].rateMdeg;
+      validTable_ = true;
+      state_ = SG_CAL_DONE;
+      return true;
+    }
+
+    StallGuardPoint running_[STALLGUARD_CAL_POINTS] = {};
+    StallGuardPoint table_[STALLGUARD_CAL_POINTS] = {};
+    uint16_t crossoverMdeg_ = 0;
+    bool validTable_ = false;
+    StallGuardCalState state_ = SG_CAL_NONE;
+
+    uint8_t leg_ = 0;                 // two per point: forward, then reverse
+    uint32_t legStartMs_ = 0;
+    uint32_t lastSampleMs_ = 0;
+    uint32_t sum_ = 0;
+    uint16_t count_ = 0;
+    uint16_t legStartCount_ = 0;
+    uint16_t min_ = 0xFFFF;
+};
+
+using Axis1StallGuardCal = StallGuardCal<Axis1Geometry, AXIS1_DRIVER_MICROSTEPS, AXIS1_DRIVER_STEALTHCHOP_THRESHOLD>;
+using Axis2StallGuardCal = StallGuardCal<Axis2Geometry, AXIS2_DRIVER_MICROSTEPS, AXIS2_DRIVER_STEALTHCHOP_THRESHOLD>;
+
+constexpr uint16_t STALLGUARD_NV_ADDR_AXIS1 = STALLGUARD_CAL_NV_ADDR;
+constexpr uint16_t STALLGUARD_NV_ADDR_AXIS2 = STALLGUARD_CAL_NV_ADDR + STALLGUARD_NV_SIZE;
+
+} // namespace nightwatch
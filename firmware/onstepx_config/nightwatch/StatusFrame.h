@@ -0,0 +1,83 @@
+// NIGHTWATCH Firmware Extensions - Batched Status Frame
+//
+// One :NWS# command on ETHERNET_CMD_PORT (or SERIAL_A) returns everything
+// LX200Client.get_status() used to assemble from :GR# :GD# :GA# :GZ# :Gm#
+// :GW# :GU# and the per-axis driver queries, as a single FRAME_STATUS frame.
+// That is one round trip instead of eight at the 10 Hz polling rate, and the
+// socket stays free for park/stop commands.
+//
+// Payload (30 bytes, little-endian):
+//   u32 controller millis
+//   u32 RA   milliarcseconds (0 .. 1,296,000,000)
+//   i32 Dec  milliarcseconds
+//   i32 Alt  milliarcseconds
+//   u32 Az   milliarcseconds (0 .. 1,296,000,000)
+//   u8  pier side (0 unknown, 1 east, 2 west)
+//   u8  flags (StatusFlag)
+//   u32 axis1 TMC5160 DRV_STATUS
+//   u32 axis2 TMC5160 DRV_STATUS
+
+#pragma once
+
+#include "Frame.h"
+
+namespace nightwatch {
+
+constexpr uint16_t STATUS_PAYLOAD_SIZE = 30;
+constexpr uint16_t STATUS_FRAME_SIZE = STATUS_PAYLOAD_SIZE + FRAME_OVERHEAD;
+
+enum PierSideCode : uint8_t {
+  PIER_CODE_UNKNOWN = 0,
+  PIER_CODE_EAST = 1,
+  PIER_CODE_WEST = 2,
+};
+
+enum StatusFlag : uint8_t {
+  STATUS_TRACKING = 0x01,
+  STATUS_SLEWING  = 0x02,
+  STATUS_PARKED   = 0x04,
+  STATUS_PARKING  = 0x08,
+  STATUS_AT_HOME  = 0x10,
+  STATUS_GUIDING  = 0x20,
+  STATUS_FAULT    = 0x40,
+  STATUS_ENCODER_SLIP = 0x80,   // EncoderLoop latched a slip on either axis
+};
+
+// Filled in by the OnStepX glue from Mount/Axis state; angles already in mas
+struct StatusSnapshot {
+  uint32_t millis;
+  uint32_t raMas;
+  int32_t decMas;
+  int32_t altMas;
+  uint32_t azMas;
+  uint8_t pierSide;
+  uint8_t flags;
+  uint32_t driverStatus[2];
+};
+
+// Degrees to milliarcseconds (main loop only; the snapshot is built outside ISRs)
+inline int32_t degreesToMas(double degrees) {
+  return (int32_t)(degrees * MAS_PER_DEGREE + (degrees < 0 ? -0.5 : 0.5));
+}
+inline uint32_t degreesToMasUnsigned(double degrees) {
+  while (degrees < 0.0) degrees += 360.0;
+  while (degrees >= 360.0) degrees -= 360.0;
+  return (uint32_t)(degrees * MAS_PER_DEGREE + 0.5);
+}
+
+// Serialize a snapshot as a complete frame. out must hold STATUS_FRAME_SIZE bytes.
+inline uint16_t buildStatusFrame(const StatusSnapshot &s, uint8_t *out) {
+  uint8_t *p = out + FRAME_HEADER_SIZE;
+  p = putU32(p, s.millis);
+  p = putU32(p, s.raMas);
+  p = putI32(p, s.decMas);
+  p = putI32(p, s.altMas);
+  p = putU32(p, s.azMas);
+  p = putU8(p, s.pierSide);
+  p = putU8(p, s.flags);
+  p = putU32(p, s.driverStatus[0]);
+  p = putU32(p, s.driverStatus[1]);
+  return encodeFrame(FRAME_STATUS, out + FRAME_HEADER_SIZE, STATUS_PAYLOAD_SIZE, out, STATUS_FRAME_SIZE);
+}
+
+} // namespace nightwatch
@@ -0,0 +1,203 @@
+// NIGHTWATCH Firmware Extensions - Step Engine Selection
+//
+// STEP_ENGINE picks who produces step pulses:
+//
+//   STEP_ENGINE_SOFTWARE  OnStepX step/dir from timer interrupts (stock). Goto
+//                         rates are bounded by NW_STEP_RATE_MAX_HZ, hence the
+//                         AXIS*_DRIVER_MICROSTEPS_GOTO switch.
+//   STEP_ENGINE_TMC_RAMP  TMC5160 internal ramp generator over SPI (motion
+//                         controller mode). The driver interpolates every
+//                         pulse itself at 256 microsteps, so the MCU emits no
+//                         step pulses at all and gotos never drop to coarse
+//                         microstepping.
+//
+// TMC_RAMP needs the driver's SD_MODE pin strapped low (motion controller)
+// and SPI_MODE high; STEP/DIR inputs are ignored in that mode. Only the SPI
+// lines already used for AXIS*_DRIVER_STATUS are required, so it does not
+// depend on which Teensy pins the step lines happen to be routed to.
+//
+// Gotos write XTARGET and let the ramp generator run AMAX/DMAX. Tracking uses
+// velocity mode: VMAX resolves ~450 ppm at sidereal, far too coarse to set
+// directly, so track() servoes XACTUAL onto the TrackingDds position each
+// control tick, nudging VMAX around the nominal rate. Averaged over a
+// second the rate is exact and the position error stays within a few 1/256
+// microsteps.
+
+#pragma once
+
+#include <math.h>
+
+#include "AxisGeometry.h"
+
+namespace nightwatch {
+
+// =============================================================================
+// TMC5160 MOTION CONTROLLER REGISTERS
+// =============================================================================
+enum Tmc5160Register : uint8_t {
+  TMC_GSTAT      = 0x01,
+  TMC_RAMPMODE   = 0x20,
+  TMC_XACTUAL    = 0x21,
+  TMC_VACTUAL    = 0x22,
+  TMC_VSTART     = 0x23,
+  TMC_A1         = 0x24,
+  TMC_V1         = 0x25,
+  TMC_AMAX       = 0x26,
+  TMC_VMAX       = 0x27,
+  TMC_DMAX       = 0x28,
+  TMC_D1         = 0x2A,
+  TMC_VSTOP      = 0x2B,
+  TMC_TZEROWAIT  = 0x2C,
+  TMC_XTARGET    = 0x2D,
+  TMC_RAMP_STAT  = 0x35,
+};
+
+enum Tmc5160RampMode : uint8_t {
+  TMC_MODE_POSITION = 0,
+  TMC_MODE_VELOCITY_POS = 1,
+  TMC_MODE_VELOCITY_NEG = 2,
+  TMC_MODE_HOLD = 3,
+};
+
+constexpr uint32_t TMC_RAMP_STAT_POSITION_REACHED = 1UL << 9;
+constexpr uint32_t TMC_RAMP_MICROSTEPS = 256;        // Ramp generator resolution per full step
+constexpr uint32_t TMC_VMAX_LIMIT = (1UL << 23) - 512;
+constexpr uint32_t TMC_AMAX_LIMIT = (1UL << 16) - 1;
+
+// Register units at TMC5160_CLOCK_HZ (datasheet: v = VMAX·f/2^24, a = AMAX·f²/2^41)
+constexpr double tmcVelocity(double microstepsPerSecond) {
+  return microstepsPerSecond * 16777216.0 / TMC5160_CLOCK_HZ;
+}
+constexpr double tmcAcceleration(double microstepsPerSecond2) {
+  return microstepsPerSecond2 * 2199023255552.0 / ((double)TMC5160_CLOCK_HZ * TMC5160_CLOCK_HZ);
+}
+
+// =============================================================================
+// TMC5160 RAMP ENGINE
+// =============================================================================
+// Bus provides transfer(csPin, datagram, 5): full-duplex SPI mode 3 exchange
+// of one 40-bit datagram in place (OnStepX's TMC SPI helper fits this), and
+// busy(): a DriverStatusCache DMA datagram is in flight on the port. It is the
+// DriverStatusCache Bus. The engine never starts a transfer while busy():
+// track() skips the tick (the next one closes the gap), everything else waits
+// the one datagram out.
+// Positions are OnStepX axis steps at AXIS*_DRIVER_MICROSTEPS; the engine
+// converts to ramp units.
+template <typename Geometry, uint32_t Microsteps, typename Bus>
+class Tmc5160RampEngine {
+  public:
+    static_assert(TMC_RAMP_MICROSTEPS % Microsteps == 0,
+                  "AXIS*_DRIVER_MICROSTEPS must divide 256 for the TMC5160 ramp engine");
+    static constexpr int32_t rampPerStep = TMC_RAMP_MICROSTEPS / Microsteps;
+    static constexpr double rampPerDegree = Geometry::stepsPerDegree * rampPerStep;
+
+    static constexpr uint32_t gotoVmax = (uint32_t)tmcVelocity(rampPerDegree * GOTO_RATE);
+    static constexpr uint32_t gotoAmax = (uint32_t)tmcAcceleration(rampPerDegree * GOTO_ACCELERATION);
+    static constexpr double siderealVmax = tmcVelocity(Geometry::trackingStepsPerSecond * rampPerStep);
+
+    static_assert(tmcVelocity(rampPerDegree * GOTO_RATE) < TMC_VMAX_LIMIT,
+                  "GOTO_RATE exceeds the TMC5160 VMAX range");
+    static_assert(gotoAmax >= 1 && tmcAcceleration(rampPerDegree * GOTO_ACCELERATION) <= TMC_AMAX_LIMIT,
+                  "GOTO_ACCELERATION outside the TMC5160 AMAX range");
+    static_assert(siderealVmax >= 100.0,
+                  "Sidereal rate below 100 VMAX LSB; the tracking servo would be too coarse");
+
+    bool begin(Bus *bus, uint8_t csPin) {
+      bus_ = bus;
+      cs_ = csPin;
+      read(TMC_GSTAT);                      // clear reset / driver error flags
+      write(TMC_VSTART, 0);
+      write(TMC_A1, gotoAmax);
+      write(TMC_V1, 0);                     // single AMAX/DMAX phase
+      write(TMC_AMAX, gotoAmax);
+      write(TMC_DMAX, gotoAmax);
+      write(TMC_D1, gotoAmax);              // must be non-zero
+      write(TMC_VSTOP, 10);
+      write(TMC_TZEROWAIT, 0);
+      write(TMC_RAMPMODE, TMC_MODE_HOLD);
+      return read(TMC_RAMPMODE) == TMC_MODE_HOLD;   // ramp registers are write-only; RAMPMODE reads back
+    }
+
+    // ---- goto -------------------------------------------------------------
+
+    void gotoSteps(int32_t targetSteps) {
+      tracking_ = false;
+      write(TMC_AMAX, gotoAmax);
+      write(TMC_VMAX, gotoVmax);
+      write(TMC_RAMPMODE, TMC_MODE_POSITION);
+      write(TMC_XTARGET, (uint32_t)(targetSteps * rampPerStep));
+    }
+
+    bool gotoDone() { return (read(TMC_RAMP_STAT) & TMC_RAMP_STAT_POSITION_REACHED) != 0; }
+
+    // ---- tracking ---------------------------------------------------------
+
+    // Call every control tick (~100 Hz) with the TrackingDds position in axis
+    // steps and its sub-step phase (phaseFraction()); rateScale is the current
+    // tracking multiple of sidereal (1.0 normally).
+    void track(int32_t targetSteps, uint16_t phaseFraction, double rateScale) {
+      if (bus_->busy()) return;
+      const int64_t target = (int64_t)targetSteps * rampPerStep + (((int64_t)phaseFraction * rampPerStep) >> 16);
+      const int32_t error = (int32_t)(target - position());
+      // Nominal VMAX plus a proportional pull that closes the gap in ~1 s
+      double v = siderealVmax * rateScale + tmcVelocity((double)error);
+      const uint8_t mode = v >= 0 ? TMC_MODE_VELOCITY_POS : TMC_MODE_VELOCITY_NEG;
+      uint32_t vmax = (uint32_t)lround(fabs(v));
+      if (vmax > gotoVmax) vmax = gotoVmax;
+      if (!tracking_ || mode != mode_) {
+        write(TMC_AMAX, gotoAmax);
+        write(TMC_RAMPMODE, mode);
+        mode_ = mode;
+        tracking_ = true;
+      }
+      write(TMC_VMAX, vmax);
+    }
+
+    void stop() { tracking_ = false; write(TMC_VMAX, 0); write(TMC_RAMPMODE, TMC_MODE_VELOCITY_POS); }
+
+    // Current position in ramp units (1/256 step) and in axis steps
+    int32_t position() { return (int32_t)read(TMC_XACTUAL); }
+    int32_t positionSteps() { return position() / rampPerStep; }
+
+    // Re-zero after homing or a sync
+    void setPositionSteps(int32_t steps) {
+      write(TMC_RAMPMODE, TMC_MODE_HOLD);
+      write(TMC_XACTUAL, (uint32_t)(steps * rampPerStep));
+      write(TMC_XTARGET, (uint32_t)(steps * rampPerStep));
+      tracking_ = false;
+    }
+
+  private:
+    void write(uint8_t address, uint32_t value) {
+      uint8_t d[5] = {(uint8_t)(address | 0x80), (uint8_t)(value >> 24), (uint8_t)(value >> 16),
+                      (uint8_t)(value >> 8), (uint8_t)value};
+      transfer(d);
+    }
+
+    // TMC reads are pipelined: the reply arrives with the next datagram
+    uint32_t read(uint8_t address) {
+      uint8_t d[5] = {address, 0, 0, 0, 0};
+      transfer(d);
+      d[0] = address; d[1] = d[2] = d[3] = d[4] = 0;
+      transfer(d);
+      return ((uint32_t)d[1] << 24) | ((uint32_t)d[2] << 16) | ((uint32_t)d[3] << 8) | d[4];
+    }
+
+    // A blocking exchange must not cut into a DriverStatusCache DMA transfer
+    void transfer(uint8_t *datagram) {
+      while (bus_->busy()) {}
+      bus_->transfer(cs_, datagram, 5);
+    }
+
+    Bus *bus_ = nullptr;
+    uint8_t cs_ = 0;
+    uint8_t mode_ = TMC_MODE_HOLD;
+    bool tracking_ = false;
+};
+
+template <typename Bus>
+using Axis1RampEngine = Tmc5160RampEngine<Axis1Geometry, AXIS1_DRIVER_MICROSTEPS, Bus>;
+template <typename Bus>
+using Axis2RampEngine = Tmc5160RampEngine<Axis2Geometry, AXIS2_DRIVER_MICROSTEPS, Bus>;
+
+} // namespace nightwatch
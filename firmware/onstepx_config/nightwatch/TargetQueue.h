@@ -0,0 +1,263 @@
+// NIGHTWATCH Firmware Extensions - Onboard Target Queue
+//
+// Every scheduled target used to cost a full host round trip: :Sr/:Sd/:MS,
+// then is_slewing() polling until the slew ends, then a settle guess before
+// imaging. TargetQueue takes the next TARGET_QUEUE_SIZE targets in one
+// FRAME_TARGET_QUEUE upload and runs them back to back on the controller:
+//
+//   goto -> slew ends -> settle -> dwell -> next goto (same main loop pass)
+//
+// Settle is judged from the EncoderLoop residuals (commanded minus encoder
+// position, both axes): the target is settled once both stay inside its
+// tolerance for TARGET_SETTLE_MS. A target that does not settle within
+// TARGET_SETTLE_TIMEOUT_MS is reported and dwelt on anyway; the host
+// decides whether to use the frames. Dwell is the imaging time; 0 holds the
+// target until the host sends :NWQN# when its exposures are done.
+//
+// Every transition is pushed as a FRAME_TARGET_EVENT frame to the telemetry
+// stream subscribers (TelemetryStream::push), so the host waits on events
+// instead of polling. Event sequence numbers expose lost datagrams, and
+// :NWQQ# gives the current state.
+//
+// Upload payload (little-endian):
+//   u8 count, u8 mode (0 replace, 1 append)
+//   count × { u32 id, u32 RA mas, i32 Dec mas, u16 dwell s, u16 tolerance 0.01" (0 = default) }
+//
+// Event payload (32 bytes, little-endian):
+//   u32 sequence
+//   u64 controller timestamp, microseconds
+//   u32 target id
+//   u8  event (TargetEvent)
+//   u8  targets still queued after this one
+//   u16 detail (goto error code for TQ_EV_FAILED)
+//   i32 axis1 residual mas  i32 axis2 residual mas
+//   u32 ms since this target's goto started
+//
+// Commands (LX200 channel):
+//   :NWU#           upload a FRAME_TARGET_QUEUE frame                 -> 1# or 0#
+//   :NWQN#          end the current dwell and go to the next target   -> 1# or 0#
+//                   (sent before settling, the dwell is skipped)
+//   :NWQC#          clear the queue; a running goto is not stopped   -> 1#
+//   :NWQQ#          state,target id,queued,last event sequence#
+//
+// Python side: OnStepXExtended.upload_targets(), TelemetrySubscriber target events.
+
+#pragma once
+
+#include <stdio.h>
+
+#include "TelemetryStream.h"
+
+namespace nightwatch {
+
+static_assert(TARGET_QUEUE_SIZE >= 1 && TARGET_QUEUE_SIZE <= 255, "TARGET_QUEUE_SIZE must be 1-255");
+static_assert(2 + 16 * TARGET_QUEUE_SIZE + FRAME_OVERHEAD <= CMD_SERVER_UPLOAD_CAPACITY,
+              "TARGET_QUEUE_SIZE upload does not fit CMD_SERVER_UPLOAD_CAPACITY");
+
+constexpr uint16_t TARGET_ENTRY_SIZE = 16;
+constexpr uint16_t TARGET_EVENT_PAYLOAD_SIZE = 32;
+constexpr uint16_t TARGET_EVENT_FRAME_SIZE = TARGET_EVENT_PAYLOAD_SIZE + FRAME_OVERHEAD;
+constexpr int32_t TARGET_SETTLE_DEFAULT_MAS = (int32_t)(TARGET_SETTLE_ARCSEC * 1000.0 + 0.5);
+
+enum TargetEvent : uint8_t {
+  TQ_EV_STARTED = 1,           // goto accepted
+  TQ_EV_SLEW_DONE = 2,         // slew ended, settling
+  TQ_EV_SETTLED = 3,           // residuals inside tolerance for TARGET_SETTLE_MS
+  TQ_EV_SETTLE_TIMEOUT = 4,    // dwelling without settling
+  TQ_EV_DONE = 5,              // dwell over or :NWQN#
+  TQ_EV_FAILED = 6,            // goto refused, detail = error code
+  TQ_EV_ABORTED = 7,           // clear() / abort() during this target
+  TQ_EV_EMPTY = 8,             // queue ran out
+};
+
+enum TargetQueueState : uint8_t {
+  TQ_IDLE = 0,
+  TQ_SLEWING = 1,
+  TQ_SETTLING = 2,
+  TQ_DWELL = 3,
+};
+
+struct QueuedTarget {
+  uint32_t id;
+  uint32_t raMas;
+  int32_t decMas;
+  uint16_t dwellS;
+  int32_t toleranceMas;
+};
+
+class TargetQueue {
+  public:
+    // Starts a goto; returns 0 or the OnStepX CommandError
+    typedef uint8_t (*GotoHandler)(uint32_t raMas, int32_t decMas);
+    // Delivers one FRAME_TARGET_EVENT frame (TelemetryStream::push)
+    typedef void (*EventHandler)(const uint8_t *frame, uint16_t size);
+
+    void begin(GotoHandler gotoHandler, EventHandler eventHandler) {
+      goto_ = gotoHandler;
+      event_ = eventHandler;
+    }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Accept a FRAME_TARGET_QUEUE payload; false leaves the queue unchanged
+    bool load(const uint8_t *payload, uint16_t length) {
+      if (length < 2) return false;
+      const uint8_t count = payload[0];
+      const uint8_t mode = payload[1];
+      if (mode > 1 || length != 2 + (uint32_t)count * TARGET_ENTRY_SIZE) return false;
+      const uint8_t kept = mode == 0 ? 0 : count_;
+      // The running target stays at the head when replacing
+      const uint8_t base = mode == 0 && state_ != TQ_IDLE ? 1 : kept;
+      if (base + count > TARGET_QUEUE_SIZE) return false;
+      const uint8_t *p = payload + 2;
+      for (uint8_t i = 0; i < count; i++, p += TARGET_ENTRY_SIZE) {
+        QueuedTarget &t = queue_[(head_ + base + i) % TARGET_QUEUE_SIZE];
+        t.id = getU32(p);
+        t.raMas = getU32(p + 4);
+        t.decMas = (int32_t)getU32(p + 8);
+        t.dwellS = getU16(p + 12);
+        const uint16_t tolerance = getU16(p + 14);
+        t.toleranceMas = tolerance == 0 ? TARGET_SETTLE_DEFAULT_MAS : (int32_t)tolerance * 10;
+      }
+      count_ = base + count;
+      return true;
+    }
+
+    // :NWQN#
+    bool next() {
+      if (state_ == TQ_IDLE) return false;
+      nextRequested_ = true;
+      return true;
+    }
+
+    // :NWQC#: drop everything; the glue stops a running goto itself if needed
+    void clear(uint64_t nowUs, uint32_t nowMs) {
+      if (state_ != TQ_IDLE) emit(TQ_EV_ABORTED, true, 0, nowUs, nowMs);
+      count_ = 0;
+      state_ = TQ_IDLE;
+      nextRequested_ = false;
+    }
+
+    // Call from the :Q / park / limit paths
+    void abort(uint64_t nowUs, uint32_t nowMs) { clear(nowUs, nowMs); }
+
+    // Call every main loop pass. slewing: a goto is in progress; residual*:
+    // EncoderLoop::errorMas() of each axis
+    void poll(uint64_t nowUs, uint32_t nowMs, bool slewing, int32_t residual1, int32_t residual2) {
+      residual_[0] = residual1;
+      residual_[1] = residual2;
+      switch (state_) {
+        case TQ_IDLE: start(nowUs, nowMs); break;
+        case TQ_SLEWING:
+          if (slewing) break;
+          state_ = TQ_SETTLING;
+          stateMs_ = nowMs;
+          inBand_ = false;
+          emit(TQ_EV_SLEW_DONE, true, 0, nowUs, nowMs);
+          break;
+        case TQ_SETTLING: {
+          const int32_t tolerance = queue_[head_].toleranceMas;
+          const bool within = abs32(residual1) <= tolerance && abs32(residual2) <= tolerance;
+          if (within && !inBand_) { inBand_ = true; inBandMs_ = nowMs; }
+          if (!within) inBand_ = false;
+          if (inBand_ && nowMs - inBandMs_ >= TARGET_SETTLE_MS) {
+            dwell(TQ_EV_SETTLED, nowUs, nowMs);
+          } else if (nowMs - stateMs_ >= TARGET_SETTLE_TIMEOUT_MS) {
+            dwell(TQ_EV_SETTLE_TIMEOUT, nowUs, nowMs);
+          }
+          break;
+        }
+        case TQ_DWELL: {
+          const uint16_t dwellS = queue_[head_].dwellS;
+          if (nextRequested_ || (dwellS != 0 && nowMs - stateMs_ >= (uint32_t)dwellS * 1000UL)) {
+            emit(TQ_EV_DONE, true, 0, nowUs, nowMs);
+            pop();
+            start(nowUs, nowMs);               // pipelined: next goto in the same pass
+          }
+          break;
+        }
+      }
+    }
+
+    TargetQueueState state() const { return state_; }
+    uint8_t queued() const { return count_; }
+    uint32_t currentId() const { return state_ == TQ_IDLE ? 0 : queue_[head_].id; }
+    uint32_t eventSequence() const { return sequence_; }
+
+    // Reply for :NWQQ#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%lu,%u,%lu#", (unsigned)state_, (unsigned long)currentId(),
+                      (unsigned)count_, (unsigned long)sequence_);
+    }
+
+  private:
+    static int32_t abs32(int32_t v) { return v < 0 ? -v : v; }
+
+    void start(uint64_t nowUs, uint32_t nowMs) {
+      while (count_ > 0) {
+        const QueuedTarget &t = queue_[head_];
+        gotoMs_ = nowMs;
+        const uint8_t error = goto_ == nullptr ? 1 : goto_(t.raMas, t.decMas);
+        if (error == 0) {
+          state_ = TQ_SLEWING;
+          nextRequested_ = false;
+          emit(TQ_EV_STARTED, true, 0, nowUs, nowMs);
+          return;
+        }
+        emit(TQ_EV_FAILED, true, error, nowUs, nowMs);
+        pop();
+      }
+      if (!emptyReported_) {
+        emptyReported_ = true;
+        emit(TQ_EV_EMPTY, false, 0, nowUs, nowMs);
+      }
+    }
+
+    void dwell(TargetEvent event, uint64_t nowUs, uint32_t nowMs) {
+      state_ = TQ_DWELL;
+      stateMs_ = nowMs;
+      emit(event, true, 0, nowUs, nowMs);
+    }
+
+    void pop() {
+      head_ = (head_ + 1) % TARGET_QUEUE_SIZE;
+      count_--;
+      state_ = TQ_IDLE;
+    }
+
+    // current: the event is about the target at the head of the queue
+    void emit(TargetEvent event, bool current, uint16_t detail, uint64_t nowUs, uint32_t nowMs) {
+      if (event != TQ_EV_EMPTY) emptyReported_ = false;
+      uint8_t frame[TARGET_EVENT_FRAME_SIZE];
+      uint8_t *p = frame + FRAME_HEADER_SIZE;
+      p = putU32(p, ++sequence_);
+      p = putU64(p, nowUs);
+      p = putU32(p, current ? queue_[head_].id : 0);
+      p = putU8(p, event);
+      p = putU8(p, current ? count_ - 1 : count_);
+      p = putU16(p, detail);
+      p = putI32(p, residual_[0]);
+      p = putI32(p, residual_[1]);
+      p = putU32(p, current ? nowMs - gotoMs_ : 0);
+      const uint16_t size = encodeFrame(FRAME_TARGET_EVENT, frame + FRAME_HEADER_SIZE, TARGET_EVENT_PAYLOAD_SIZE,
+                                        frame, TARGET_EVENT_FRAME_SIZE);
+      if (event_ != nullptr) event_(frame, size);
+    }
+
+    GotoHandler goto_ = nullptr;
+    EventHandler event_ = nullptr;
+    QueuedTarget queue_[TARGET_QUEUE_SIZE] = {};
+    uint8_t head_ = 0;
+    uint8_t count_ = 0;
+    TargetQueueState state_ = TQ_IDLE;
+    bool nextRequested_ = false;
+    bool inBand_ = false;
+    bool emptyReported_ = true;        // no "empty" event before anything ran
+    uint32_t stateMs_ = 0;
+    uint32_t inBandMs_ = 0;
+    uint32_t gotoMs_ = 0;
+    uint32_t sequence_ = 0;
+    int32_t residual_[2] = {0, 0};
+};
+
+} // namespace nightwatch
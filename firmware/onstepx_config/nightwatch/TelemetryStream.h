@@ -0,0 +1,195 @@
+// NIGHTWATCH Firmware Extensions - Telemetry Push Stream
+//
+// Pushes timestamped position samples over UDP at TELEMETRY_STREAM_HZ so the
+// DGX side no longer polls the LX200 socket for position. A client subscribes
+// by sending "NWSUB" to TELEMETRY_STREAM_PORT and must repeat it at least once
+// every TELEMETRY_SUBSCRIBE_TIMEOUT_MS; "NWUNSUB" leaves immediately. Samples
+// go to every live subscriber (up to TELEMETRY_STREAM_CLIENTS).
+//
+// Each datagram is one FRAME_TELEMETRY frame (Frame.h), payload 46 bytes LE:
+//   u32 sequence
+//   u64 controller timestamp, microseconds
+//   i32 axis1 steps        i32 axis2 steps
+//   i32 axis1 encoder      i32 axis2 encoder   (AXIS*_ENCODER counts)
+//   u32 RA milliarcseconds i32 Dec milliarcseconds
+//   u8  status flags (StatusFlag)
+//   u8  pier side (PierSideCode)
+//   u64 UTC of the sample, Unix microseconds (TimeDiscipline; 0 unsynced)
+//
+// The first 38 bytes are the original payload; readers accept both sizes.
+//
+// Other modules push their own frames (e.g. TargetQueue FRAME_TARGET_EVENT)
+// to the same subscribers with push().
+//
+// Python side: services/mount_control/telemetry.py (TelemetrySubscriber).
+
+#pragma once
+
+#include "StatusFrame.h"
+
+namespace nightwatch {
+
+constexpr uint16_t TELEMETRY_PAYLOAD_SIZE = 46;
+constexpr uint16_t TELEMETRY_FRAME_SIZE = TELEMETRY_PAYLOAD_SIZE + FRAME_OVERHEAD;
+constexpr uint32_t TELEMETRY_PERIOD_MS = 1000UL / TELEMETRY_STREAM_HZ;
+
+static_assert(TELEMETRY_STREAM_HZ > 0 && TELEMETRY_STREAM_HZ <= 200,
+              "TELEMETRY_STREAM_HZ must be between 1 and 200");
+
+// Captured once per control tick by the OnStepX glue, outside the step ISR
+struct TelemetrySample {
+  uint64_t timestampUs;
+  int32_t steps[2];
+  int32_t encoder[2];
+  uint32_t raMas;
+  int32_t decMas;
+  uint8_t flags;
+  uint8_t pierSide;
+  uint64_t utcUs;          // TimeDiscipline::utcUs(timestampUs)
+};
+
+inline uint16_t buildTelemetryFrame(const TelemetrySample &s, uint32_t sequence, uint8_t *out) {
+  uint8_t *p = out + FRAME_HEADER_SIZE;
+  p = putU32(p, sequence);
+  p = putU64(p, s.timestampUs);
+  p = putI32(p, s.steps[0]);
+  p = putI32(p, s.steps[1]);
+  p = putI32(p, s.encoder[0]);
+  p = putI32(p, s.encoder[1]);
+  p = putU32(p, s.raMas);
+  p = putI32(p, s.decMas);
+  p = putU8(p, s.flags);
+  p = putU8(p, s.pierSide);
+  p = putU64(p, s.utcUs);
+  return encodeFrame(FRAME_TELEMETRY, out + FRAME_HEADER_SIZE, TELEMETRY_PAYLOAD_SIZE,
+                     out, TELEMETRY_FRAME_SIZE);
+}
+
+// Extends the 32-bit micros() counter to 64 bits; call at least once per 71 minutes
+class Micros64 {
+  public:
+    uint64_t update(uint32_t nowUs) {
+      if (nowUs < last_) high_ += 1ULL << 32;
+      last_ = nowUs;
+      return high_ | nowUs;
+    }
+  private:
+    uint64_t high_ = 0;
+    uint32_t last_ = 0;
+};
+
+// =============================================================================
+// SUBSCRIBER TABLE
+// =============================================================================
+template <typename Address>
+class TelemetrySubscribers {
+  public:
+    struct Entry {
+      Address address;
+      uint16_t port;
+      uint32_t lastSeenMs;
+      bool active;
+    };
+
+    // Add or refresh a subscriber; returns false when the table is full
+    bool subscribe(const Address &address, uint16_t port, uint32_t nowMs) {
+      Entry *free = nullptr;
+      for (Entry &e : entries_) {
+        if (e.active && e.address == address && e.port == port) { e.lastSeenMs = nowMs; return true; }
+        if (!e.active && free == nullptr) free = &e;
+      }
+      if (free == nullptr) return false;
+      *free = Entry{address, port, nowMs, true};
+      return true;
+    }
+
+    void unsubscribe(const Address &address, uint16_t port) {
+      for (Entry &e : entries_) {
+        if (e.active && e.address == address && e.port == port) e.active = false;
+      }
+    }
+
+    void expire(uint32_t nowMs) {
+      for (Entry &e : entries_) {
+        if (e.active && nowMs - e.lastSeenMs > TELEMETRY_SUBSCRIBE_TIMEOUT_MS) e.active = false;
+      }
+    }
+
+    uint8_t count() const {
+      uint8_t n = 0;
+      for (const Entry &e : entries_) if (e.active) n++;
+      return n;
+    }
+
+    Entry *begin() { return entries_; }
+    Entry *end() { return entries_ + TELEMETRY_STREAM_CLIENTS; }
+
+  private:
+    Entry entries_[TELEMETRY_STREAM_CLIENTS] = {};
+};
+
+// =============================================================================
+// STREAM
+// =============================================================================
+// Udp is an Arduino UDP class (NativeEthernet EthernetUDP on Teensy 4.1) and
+// Address its IPAddress type. Sampler fills a TelemetrySample from live state.
+template <typename Udp, typename Address>
+class TelemetryStream {
+  public:
+    typedef void (*Sampler)(TelemetrySample *sample);
+
+    bool begin(Udp *udp, Sampler sampler) {
+      udp_ = udp;
+      sampler_ = sampler;
+      return udp_->begin(TELEMETRY_STREAM_PORT);
+    }
+
+    // Call from the main loop; never blocks
+    void poll(uint32_t nowMs) {
+      if (udp_ == nullptr) return;
+      handleRequests(nowMs);
+      subscribers_.expire(nowMs);
+      if (nowMs - lastSendMs_ < TELEMETRY_PERIOD_MS || subscribers_.count() == 0) return;
+      lastSendMs_ = nowMs;
+
+      TelemetrySample sample;
+      sampler_(&sample);
+      uint8_t frame[TELEMETRY_FRAME_SIZE];
+      push(frame, buildTelemetryFrame(sample, sequence_++, frame));
+    }
+
+    // Send one complete frame to every live subscriber
+    void push(const uint8_t *frame, uint16_t size) {
+      if (udp_ == nullptr) return;
+      for (auto &e : subscribers_) {
+        if (!e.active) continue;
+        udp_->beginPacket(e.address, e.port);
+        udp_->write(frame, size);
+        udp_->endPacket();
+      }
+    }
+
+    uint8_t subscriberCount() const { return subscribers_.count(); }
+
+  private:
+    void handleRequests(uint32_t nowMs) {
+      while (udp_->parsePacket() > 0) {
+        char request[8] = {0};
+        const int n = udp_->read((uint8_t *)request, sizeof(request) - 1);
+        if (n <= 0) continue;
+        if (strncmp(request, "NWSUB", 5) == 0) {
+          subscribers_.subscribe(udp_->remoteIP(), udp_->remotePort(), nowMs);
+        } else if (strncmp(request, "NWUNSUB", 7) == 0) {
+          subscribers_.unsubscribe(udp_->remoteIP(), udp_->remotePort());
+        }
+      }
+    }
+
+    Udp *udp_ = nullptr;
+    Sampler sampler_ = nullptr;
+    TelemetrySubscribers<Address> subscribers_;
+    uint32_t lastSendMs_ = 0;
+    uint32_t sequence_ = 0;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,288 @@
+// NIGHTWATCH Firmware Extensions - Disciplined Controller Clock (SNTP)
+//
+// OnStepX keeps local time from TIME_ZONE_DEFAULT and a free-running crystal;
+// the host reads :GL#/:GS# and re-syncs by text command. TimeDiscipline
+// instead locks the 64-bit controller microsecond clock (Micros64) to UTC
+// from an NTP server on the observatory LAN (TIME_NTP_SERVER, normally the
+// DGX), so every controller timestamp - telemetry, encoder, driver, trace and
+// target event samples - converts to UTC without a round trip.
+//
+// The clock itself is never stepped or slewed: controller timestamps stay
+// monotonic for the step, guide and spline modules. What is disciplined is
+// the mapping
+//   utc = baseUtc + (controller - baseController) × (1 + ppb × 1e-9)
+// which is rebased on every accepted NTP sample:
+//   - each poll is a four-timestamp SNTP exchange. Queueing makes a slow
+//     exchange asymmetric, so one taking more than twice the best round trip
+//     of the last TIME_NTP_FILTER (plus 50 µs) is only used to age the
+//     window, and anything slower than TIME_NTP_MAX_DELAY_US is dropped
+//   - an offset beyond TIME_NTP_STEP_US steps the mapping (first sync, server
+//     change); smaller offsets are slewed out over the poll interval that
+//     follows the sample (TIME_NTP_POLL_LOCKED_S if it completed the lock),
+//     and the slew stops there, so a silent server (HOLDOVER) runs on the
+//     learned frequency alone. A frequency integrator learns the crystal error
+//   - LOCKED once TIME_NTP_LOCK_COUNT samples in a row are inside
+//     TIME_NTP_LOCK_US; the poll interval then grows to TIME_NTP_POLL_LOCKED_S
+//
+// The learned crystal error also runs the DDS step clock, so the glue adds
+// trackingPpmE4() to the TrackingDds rate offset, and it sets the OnStepX
+// date/time from utcUs() while LOCKED so sidereal time stops drifting.
+//
+// The NIGHTWATCH network has an SNTP server but no PTP grandmaster, and
+// NativeEthernet exposes no ENET 1588 receive timestamps, so this uses SNTP
+// with timestamps taken in the main loop: on a quiet LAN a few tens of µs.
+//
+// Commands (LX200 channel):
+//   :NWYQ#          state,controller us,utc us,ppb,last offset us,last delay us,s since sample#
+//                   (controller us and utc us are one point of the current mapping)
+//
+// Python side: OnStepXExtended.get_clock_mapping(), TelemetrySample.utc_time_us.
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#include "NightwatchConfig.h"
+
+namespace nightwatch {
+
+static_assert(TIME_NTP_FILTER >= 1 && TIME_NTP_FILTER <= 16, "TIME_NTP_FILTER must be 1-16");
+static_assert(TIME_NTP_POLL_S >= 1 && TIME_NTP_POLL_LOCKED_S >= TIME_NTP_POLL_S,
+              "TIME_NTP_POLL_LOCKED_S must be at least TIME_NTP_POLL_S");
+
+constexpr uint16_t NTP_PORT = 123;
+constexpr uint16_t NTP_PACKET_SIZE = 48;
+constexpr uint64_t NTP_UNIX_OFFSET_S = 2208988800ULL;      // 1900 -> 1970
+constexpr int64_t TIME_FREQ_LIMIT_PPB = 500000;             // ±500 ppm crystal
+constexpr uint32_t TIME_NTP_TIMEOUT_MS = 1000;
+
+enum TimeState : uint8_t {
+  TIME_UNSYNCED = 0,
+  TIME_ACQUIRING = 1,      // stepped, frequency still settling
+  TIME_LOCKED = 2,
+  TIME_HOLDOVER = 3,       // was locked, server silent for 4 locked polls
+};
+
+// NTP 32.32 timestamp <-> Unix microseconds
+inline uint64_t ntpToUnixUs(uint32_t seconds, uint32_t fraction) {
+  return ((uint64_t)seconds - NTP_UNIX_OFFSET_S) * 1000000ULL + (((uint64_t)fraction * 1000000ULL) >> 32);
+}
+
+inline void unixUsToNtp(uint64_t us, uint32_t *seconds, uint32_t *fraction) {
+  *seconds = (uint32_t)(us / 1000000ULL + NTP_UNIX_OFFSET_S);
+  *fraction = (uint32_t)(((us % 1000000ULL) << 32) / 1000000ULL);
+}
+
+inline uint32_t getU32BE(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+inline void putU32BE(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+// =============================================================================
+// CLOCK MAPPING
+// =============================================================================
+class ClockMapping {
+  public:
+    bool valid() const { return valid_; }
+    int32_t ppb() const { return (int32_t)freqPpb_; }
+
+    // UTC (Unix µs) for a controller timestamp; 0 before the first sync.
+    // The slew only runs from baseController_ to slewEnd_.
+    uint64_t utcUs(uint64_t controllerUs) const {
+      if (!valid_) return 0;
+      const int64_t dc = (int64_t)(controllerUs - baseController_);
+      const uint64_t slewTo = controllerUs < slewEnd_ ? controllerUs : slewEnd_;
+      const int64_t slewed = slewTo > baseController_ ? (int64_t)(slewTo - baseController_) : 0;
+      return baseUtc_ + dc + dc / 1000 * freqPpb_ / 1000000 + slewed / 1000 * slewPpb_ / 1000000;
+    }
+
+    // First sync / large error: jump to utc now
+    void step(uint64_t controllerUs, uint64_t utcUs) {
+      baseController_ = controllerUs;
+      baseUtc_ = utcUs;
+      slewPpb_ = 0;
+      slewEnd_ = controllerUs;
+      valid_ = true;
+    }
+
+    // Remove offsetUs over the next intervalS and fold a share of it into the
+    // frequency
+    void slew(uint64_t controllerUs, int64_t offsetUs, uint32_t intervalS) {
+      baseUtc_ = utcUs(controllerUs);
+      baseController_ = controllerUs;
+      // offset µs per interval s is ppm; ×1000 for ppb
+      const int64_t error = offsetUs * 1000 / (int64_t)intervalS;
+      freqPpb_ = clampPpb(freqPpb_ + error / TIME_NTP_FREQ_GAIN);
+      slewPpb_ = clampPpb(error);
+      slewEnd_ = controllerUs + (uint64_t)intervalS * 1000000ULL;
+    }
+
+  private:
+    static int64_t clampPpb(int64_t v) {
+      return v > TIME_FREQ_LIMIT_PPB ? TIME_FREQ_LIMIT_PPB : v < -TIME_FREQ_LIMIT_PPB ? -TIME_FREQ_LIMIT_PPB : v;
+    }
+
+    uint64_t baseController_ = 0;
+    uint64_t baseUtc_ = 0;
+    int64_t freqPpb_ = 0;          // learned crystal error (utc per controller µs)
+    int64_t slewPpb_ = 0;          // temporary, removes the last offset
+    uint64_t slewEnd_ = 0;         // controller µs where the slew has removed the offset
+    bool valid_ = false;
+};
+
+// =============================================================================
+// SNTP CLIENT
+// =============================================================================
+// Udp is an Arduino UDP class (NativeEthernet EthernetUDP on Teensy 4.1) and
+// Address its IPAddress type, as for TelemetryStream.
+template <typename Udp, typename Address>
+class TimeDiscipline {
+  public:
+    bool begin(Udp *udp) {
+      udp_ = udp;
+      const uint8_t server[4] = TIME_NTP_SERVER;
+      server_ = Address(server[0], server[1], server[2], server[3]);
+      return udp_->begin(TIME_NTP_LOCAL_PORT);
+    }
+
+    // Call every main loop pass with the Micros64 clock; never blocks
+    void poll(uint64_t nowUs, uint32_t nowMs) {
+      if (udp_ == nullptr) return;
+      receive(nowUs, nowMs);
+      if (pending_ && nowMs - sentMs_ > TIME_NTP_TIMEOUT_MS) pending_ = false;
+      if (state_ == TIME_LOCKED && nowMs - lastSampleMs_ > 4000UL * TIME_NTP_POLL_LOCKED_S) state_ = TIME_HOLDOVER;
+      const uint32_t intervalMs = 1000UL * pollIntervalS();
+      if (!pending_ && (!polled_ || nowMs - sentMs_ >= intervalMs)) send(nowUs, nowMs);
+    }
+
+    // Feed one reply; split out of poll() for testing
+    bool handleReply(const uint8_t *packet, int length, uint64_t nowUs, uint32_t nowMs) {
+      if (!pending_ || length < NTP_PACKET_SIZE) return false;
+      const uint8_t mode = packet[0] & 0x07;
+      const uint8_t stratum = packet[1];
+      if (mode != 4 || stratum == 0 || stratum > 15) return false;
+      // Originate must echo our transmit stamp: rejects stale and stray replies
+      if (memcmp(packet + 24, sentStamp_, 8) != 0) return false;
+      pending_ = false;
+
+      const uint64_t t2 = ntpToUnixUs(getU32BE(packet + 32), getU32BE(packet + 36));
+      const uint64_t t3 = ntpToUnixUs(getU32BE(packet + 40), getU32BE(packet + 44));
+      if (!mapping_.valid()) {
+        // Unsynced: take the server time at the midpoint and start over
+        mapping_.step(nowUs, t3 + (nowUs - sentUs_) / 2);
+        accept(0, (int64_t)(nowUs - sentUs_), nowUs, nowMs);
+        return true;
+      }
+      const int64_t T1 = (int64_t)mapping_.utcUs(sentUs_);
+      const int64_t T4 = (int64_t)mapping_.utcUs(nowUs);
+      const int64_t offset = (((int64_t)t2 - T1) + ((int64_t)t3 - T4)) / 2;
+      const int64_t delay = (T4 - T1) - ((int64_t)t3 - (int64_t)t2);
+      if (delay < 0 || delay > TIME_NTP_MAX_DELAY_US) { rejected_++; return false; }
+      accept(offset, delay, nowUs, nowMs);
+      return true;
+    }
+
+    uint64_t utcUs(uint64_t controllerUs) const { return mapping_.utcUs(controllerUs); }
+    TimeState state() const { return state_; }
+    bool locked() const { return state_ == TIME_LOCKED; }
+    int32_t lastOffsetUs() const { return (int32_t)lastOffset_; }
+    int32_t lastDelayUs() const { return (int32_t)lastDelay_; }
+    uint32_t rejected() const { return rejected_; }
+
+    // Rate offset for TrackingDds::setRate(): the crystal also clocks the DDS
+    // (1 ppb = 10 × 1e-4 ppm)
+    int32_t trackingPpmE4() const { return state_ == TIME_UNSYNCED ? 0 : mapping_.ppb() * 10; }
+
+    // Reply for :NWYQ#
+    int formatStatus(char *out, size_t size, uint64_t nowUs, uint32_t nowMs) const {
+      const uint32_t age = state_ == TIME_UNSYNCED ? 0 : (nowMs - lastSampleMs_) / 1000;
+      return snprintf(out, size, "%u,%llu,%llu,%ld,%ld,%ld,%lu#", (unsigned)state_, (unsigned long long)nowUs,
+                      (unsigned long long)mapping_.utcUs(nowUs), (long)mapping_.ppb(), (long)lastOffset_,
+                      (long)lastDelay_, (unsigned long)age);
+    }
+
+  private:
+    uint32_t pollIntervalS() const { return state_ == TIME_LOCKED ? TIME_NTP_POLL_LOCKED_S : TIME_NTP_POLL_S; }
+
+    void send(uint64_t nowUs, uint32_t nowMs) {
+      uint8_t packet[NTP_PACKET_SIZE] = {0};
+      packet[0] = 0x23;                       // LI 0, version 4, mode 3 (client)
+      // Transmit stamp: our UTC estimate, or the raw clock before the first sync
+      uint32_t seconds, fraction;
+      unixUsToNtp(mapping_.valid() ? mapping_.utcUs(nowUs) : nowUs, &seconds, &fraction);
+      putU32BE(packet + 40, seconds);
+      putU32BE(packet + 44, fraction);
+      memcpy(sentStamp_, packet + 40, 8);
+      sentUs_ = nowUs;
+      sentMs_ = nowMs;
+      polled_ = true;
+      pending_ = true;
+      udp_->beginPacket(server_, NTP_PORT);
+      udp_->write(packet, NTP_PACKET_SIZE);
+      udp_->endPacket();
+    }
+
+    void receive(uint64_t nowUs, uint32_t nowMs) {
+      while (udp_->parsePacket() > 0) {
+        uint8_t packet[NTP_PACKET_SIZE];
+        const int n = udp_->read(packet, NTP_PACKET_SIZE);
+        if (udp_->remoteIP() == server_) handleReply(packet, n, nowUs, nowMs);
+      }
+    }
+
+    void accept(int64_t offset, int64_t delay, uint64_t nowUs, uint32_t nowMs) {
+      lastOffset_ = offset;
+      lastDelay_ = delay;
+      lastSampleMs_ = nowMs;
+      if (state_ == TIME_UNSYNCED) {
+        state_ = TIME_ACQUIRING;
+        filled_ = 0;
+        return;
+      }
+
+      delays_[next_] = delay;
+      next_ = (next_ + 1) % TIME_NTP_FILTER;
+      if (filled_ < TIME_NTP_FILTER) filled_++;
+      int64_t best = delay;
+      for (uint8_t i = 0; i < filled_; i++) if (delays_[i] < best) best = delays_[i];
+      if (delay > 2 * best + 50) { rejected_++; return; }
+
+      if (offset > TIME_NTP_STEP_US || offset < -TIME_NTP_STEP_US) {
+        mapping_.step(nowUs, mapping_.utcUs(nowUs) + offset);
+        state_ = TIME_ACQUIRING;
+        inLock_ = 0;
+        filled_ = 0;
+        return;
+      }
+      const bool inside = offset <= TIME_NTP_LOCK_US && offset >= -TIME_NTP_LOCK_US;
+      inLock_ = inside ? inLock_ + 1 : 0;
+      if (inLock_ >= TIME_NTP_LOCK_COUNT) state_ = TIME_LOCKED;
+      else if (!inside) state_ = TIME_ACQUIRING;
+      // Sized for the interval this sample's state polls at
+      mapping_.slew(nowUs, offset, pollIntervalS());
+    }
+
+    Udp *udp_ = nullptr;
+    Address server_;
+    ClockMapping mapping_;
+    TimeState state_ = TIME_UNSYNCED;
+    int64_t delays_[TIME_NTP_FILTER] = {};
+    uint8_t filled_ = 0;
+    uint8_t next_ = 0;
+    uint8_t inLock_ = 0;
+    uint8_t sentStamp_[8] = {0};
+    bool pending_ = false;
+    bool polled_ = false;
+    uint64_t sentUs_ = 0;
+    uint32_t sentMs_ = 0;
+    uint32_t lastSampleMs_ = 0;
+    uint32_t rejected_ = 0;
+    int64_t lastOffset_ = 0;
+    int64_t lastDelay_ = 0;
+};
+
+} // namespace nightwatch
@@ -0,0 +1,356 @@
+// NIGHTWATCH Firmware Extensions - Motion Trace Recorder
+//
+// DEBUG_STEPPER / DEBUG_SERVO / DEBUG_ECHO_COMMANDS print as they go, and the
+// serial writes shift the very timing being debugged. TraceRecorder instead
+// appends fixed 24-byte binary records to a RAM ring of TRACE_RECORDER_RECORDS
+// entries and leaves the host to download them afterwards.
+//
+// Producers are the control tick (per-axis samples, usually in an ISR) and
+// the main loop (commands and events). A slot is claimed with one atomic
+// fetch-add on the head counter (LDREX/STREX on the Cortex-M7), so neither
+// side ever masks interrupts or waits for the other. The ring overwrites its
+// oldest records; a trigger (host, slip, limit) ends recording a set number
+// of records later, so the window around a glitch survives.
+//
+// Placement: at 24 bytes a record, 65536 records take 1.5 MB. With
+// TRACE_RECORDER_PSRAM ON declare the recorder NIGHTWATCH_TRACE_STORAGE
+// (EXTMEM, the Teensy 4.1 PSRAM pads), otherwise it goes in DMAMEM. Neither
+// section is zeroed at startup; begin() initialises the recorder.
+//
+// Record (little-endian):
+//   u32 controller micros
+//   u8  kind (TraceKind)
+//   kind TRACE_TICK:
+//     u8  axis (1, 2)
+//     u8  CS_ACTUAL driver current scale, 0-31
+//     u8  flags (TraceTickFlag)
+//     i32 step position
+//     i32 encoder count (AXIS*_ENCODER)
+//     i32 step rate, millisteps/s
+//     u16 PEC phase, 1/65536 cycle
+//     u16 SG_RESULT
+//   kind TRACE_COMMAND:
+//     u8  length of the full command
+//     u8  reserved
+//     u8  reserved
+//     char[16] first 16 command characters, NUL-padded
+//   kind TRACE_EVENT:
+//     u8  event (TraceEvent)
+//     u8  axis (0 = both / none)
+//     u8  reserved
+//     i32 a, i32 b, i32 c (per event), u16 reserved, u16 reserved
+//
+// Commands (LX200 channel):
+//   :NWTA<mask>[,<decimate>[,<post>]]#  arm; mask of TraceChannel, keep
+//                                        every decimate-th tick, post-trigger
+//                                        records (0 = until :NWTS#)  -> 1# or 0#
+//   :NWTS#          stop                                          -> 1#
+//   :NWTM<n>#       TRACE_EV_MARK event with a = n (host markers)  -> 1#
+//   :NWTT#          trigger from the host                          -> 1#
+//   :NWTQ#          state,records,capacity,overwritten,mask#       -> text
+//   :NWTD<first>#   FRAME_TRACE frame of up to TRACE_DOWNLOAD_RECORDS records
+//                   from the oldest + first; empty while recording
+//
+// Download payload:
+//   u32 first, u32 records held, u16 count, u16 record size
+//   count records
+//
+// Python side: OnStepXExtended.arm_trace() / download_trace();
+// decode_trace_payload() in nightwatch_protocol.py.
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Frame.h"
+
+#if TRACE_RECORDER_PSRAM == ON && defined(EXTMEM)
+  #define NIGHTWATCH_TRACE_STORAGE EXTMEM
+#elif defined(DMAMEM)
+  #define NIGHTWATCH_TRACE_STORAGE DMAMEM
+#else
+  #define NIGHTWATCH_TRACE_STORAGE
+#endif
+
+namespace nightwatch {
+
+static_assert((TRACE_RECORDER_RECORDS & (TRACE_RECORDER_RECORDS - 1)) == 0 && TRACE_RECORDER_RECORDS >= 256,
+              "TRACE_RECORDER_RECORDS must be a power of two, at least 256");
+
+constexpr uint16_t TRACE_RECORD_SIZE = 24;
+constexpr uint16_t TRACE_DOWNLOAD_HEADER_SIZE = 12;
+constexpr uint8_t TRACE_COMMAND_CHARS = 16;
+
+static_assert(TRACE_DOWNLOAD_RECORDS >= 1 &&
+              (uint32_t)TRACE_DOWNLOAD_RECORDS * TRACE_RECORD_SIZE + TRACE_DOWNLOAD_HEADER_SIZE <= 0xFFFF,
+              "TRACE_DOWNLOAD_RECORDS must fit one frame");
+
+enum TraceKind : uint8_t {
+  TRACE_TICK = 1,
+  TRACE_COMMAND = 2,
+  TRACE_EVENT = 3,
+};
+
+// :NWTA# mask bits
+enum TraceChannel : uint8_t {
+  TRACE_CH_AXIS1 = 0x01,
+  TRACE_CH_AXIS2 = 0x02,
+  TRACE_CH_COMMANDS = 0x04,
+  TRACE_CH_EVENTS = 0x08,
+  TRACE_CH_ALL = 0x0F,
+};
+
+enum TraceTickFlag : uint8_t {
+  TRACE_TICK_SLEWING = 0x01,
+  TRACE_TICK_TRACKING = 0x02,
+  TRACE_TICK_GUIDING = 0x04,
+  TRACE_TICK_PEC = 0x08,
+  TRACE_TICK_SLIP = 0x10,
+  TRACE_TICK_STALL = 0x20,
+};
+
+// Event codes; a / b / c as noted
+enum TraceEvent : uint8_t {
+  TRACE_EV_MARK = 1,           // a = host marker
+  TRACE_EV_TRIGGER = 2,        // a = source event code (0 = host)
+  TRACE_EV_GOTO_START = 3,     // a, b = target steps axis1, axis2
+  TRACE_EV_GOTO_END = 4,       // a, b = final steps axis1, axis2
+  TRACE_EV_SLIP = 5,           // a = encoder error, steps
+  TRACE_EV_GUIDE = 6,          // a = axis1, b = axis2 guide offset, millisteps/s
+  TRACE_EV_LIMIT = 7,          // a = limit code
+};
+
+enum TraceState : uint8_t {
+  TRACE_IDLE = 0,              // nothing recorded since begin()
+  TRACE_ARMED = 1,
+  TRACE_STOPPED = 2,
+};
+
+// One per-axis sample, filled by the control tick
+struct TraceSample {
+  int32_t steps;
+  int32_t encoder;
+  int32_t rateMilliHz;
+  uint16_t pecPhase;
+  uint16_t sgResult;
+  uint8_t csActual;
+  uint8_t flags;
+};
+
+struct TraceRecord {
+  uint32_t timeUs;
+  uint8_t kind;
+  uint8_t b0, b1, b2;
+  union {
+    struct { int32_t a, b, c; uint16_t d, e; } v;
+    char text[TRACE_COMMAND_CHARS];
+  };
+};
+
+static_assert(sizeof(TraceRecord) == TRACE_RECORD_SIZE, "TraceRecord layout");
+
+inline uint8_t *putTraceRecord(uint8_t *p, const TraceRecord &r) {
+  p = putU32(p, r.timeUs);
+  p = putU8(p, r.kind);
+  p = putU8(p, r.b0);
+  p = putU8(p, r.b1);
+  p = putU8(p, r.b2);
+  if (r.kind == TRACE_COMMAND) {
+    memcpy(p, r.text, TRACE_COMMAND_CHARS);
+    return p + TRACE_COMMAND_CHARS;
+  }
+  p = putI32(p, r.v.a);
+  p = putI32(p, r.v.b);
+  p = putI32(p, r.v.c);
+  p = putU16(p, r.v.d);
+  return putU16(p, r.v.e);
+}
+
+class TraceRecorder {
+  public:
+    void begin() {
+      head_ = 0;
+      stopAt_ = 0;
+      mask_ = 0;
+      decimate_ = 1;
+      post_ = 0;
+      tickCount_[0] = tickCount_[1] = 0;
+      state_ = TRACE_IDLE;
+    }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Start a fresh recording
+    void arm(uint8_t mask, uint16_t decimate, uint32_t post) {
+      state_ = TRACE_STOPPED;          // producers off while the ring resets
+      head_ = 0;
+      stopAt_ = 0;
+      decimate_ = decimate == 0 ? 1 : decimate;
+      post_ = post > TRACE_RECORDER_RECORDS ? TRACE_RECORDER_RECORDS : post;
+      tickCount_[0] = tickCount_[1] = 0;
+      mask_ = mask & TRACE_CH_ALL;
+      state_ = TRACE_ARMED;
+    }
+
+    void stop() { if (state_ == TRACE_ARMED) state_ = TRACE_STOPPED; }
+
+    // Command text without ':' / '#', from any channel
+    void command(const char *text, uint32_t nowUs) {
+      if (!accepting(TRACE_CH_COMMANDS)) return;
+      TraceRecord *r = claim();
+      if (r == nullptr) return;
+      const size_t length = strlen(text);
+      r->timeUs = nowUs;
+      r->b0 = (uint8_t)(length > 255 ? 255 : length);
+      r->b1 = r->b2 = 0;
+      memset(r->text, 0, TRACE_COMMAND_CHARS);
+      memcpy(r->text, text, length < TRACE_COMMAND_CHARS ? length : TRACE_COMMAND_CHARS);
+      r->kind = TRACE_COMMAND;
+    }
+
+    // Events may also come from ISRs (slip, limit)
+    void event(TraceEvent code, uint8_t axis, int32_t a, int32_t b, int32_t c, uint32_t nowUs) {
+      if (!accepting(TRACE_CH_EVENTS) && code != TRACE_EV_TRIGGER) return;
+      if (state_ != TRACE_ARMED) return;
+      TraceRecord *r = claim();
+      if (r == nullptr) return;
+      r->timeUs = nowUs;
+      r->b0 = code;
+      r->b1 = axis;
+      r->b2 = 0;
+      r->v.a = a; r->v.b = b; r->v.c = c; r->v.d = 0; r->v.e = 0;
+      r->kind = TRACE_EVENT;
+    }
+
+    // Start the post-trigger countdown; the first trigger wins
+    void trigger(uint8_t source, uint32_t nowUs) {
+      if (state_ != TRACE_ARMED || post_ == 0 || stopAt_ != 0) return;
+      event(TRACE_EV_TRIGGER, 0, source, 0, 0, nowUs);
+      stopAt_ = head_ + post_;
+    }
+
+    // ---- ISR side ----------------------------------------------------------
+
+    // axis 1 or 2; call every control tick
+    void tick(uint8_t axis, const TraceSample &s, uint32_t nowUs) {
+      if (!accepting(axis == 1 ? TRACE_CH_AXIS1 : TRACE_CH_AXIS2)) return;
+      if (++tickCount_[axis - 1] < decimate_) return;
+      tickCount_[axis - 1] = 0;
+      TraceRecord *r = claim();
+      if (r == nullptr) return;
+      r->timeUs = nowUs;
+      r->b0 = axis;
+      r->b1 = s.csActual;
+      r->b2 = s.flags;
+      r->v.a = s.steps;
+      r->v.b = s.encoder;
+      r->v.c = s.rateMilliHz;
+      r->v.d = s.pecPhase;
+      r->v.e = s.sgResult;
+      r->kind = TRACE_TICK;
+    }
+
+    // ---- readout (main loop, after stop) -----------------------------------
+
+    TraceState state() const { return state_; }
+    uint8_t mask() const { return mask_; }
+    uint32_t written() const { return head_; }
+    uint32_t records() const { return head_ < TRACE_RECORDER_RECORDS ? head_ : TRACE_RECORDER_RECORDS; }
+    uint32_t overwritten() const { return head_ - records(); }
+
+    // n-th record from the oldest
+    const TraceRecord &at(uint32_t n) const {
+      return ring_[(head_ - records() + n) & (TRACE_RECORDER_RECORDS - 1)];
+    }
+
+    // Writes the :NWTD# frame to out (Arduino Print-style write(buf, n)) in
+    // small pieces so no frame-sized buffer is needed
+    template <typename Out>
+    void download(uint32_t first, Out &out) const {
+      const uint32_t held = state_ == TRACE_ARMED ? 0 : records();
+      const uint32_t start = first < held ? first : held;
+      const uint16_t count = (uint16_t)(held - start < TRACE_DOWNLOAD_RECORDS ? held - start : TRACE_DOWNLOAD_RECORDS);
+      const uint16_t length = TRACE_DOWNLOAD_HEADER_SIZE + count * TRACE_RECORD_SIZE;
+
+      uint8_t chunk[FRAME_HEADER_SIZE + TRACE_DOWNLOAD_HEADER_SIZE + 8 * TRACE_RECORD_SIZE];
+      uint8_t *p = chunk;
+      p = putU8(p, FRAME_SYNC_0);
+      p = putU8(p, FRAME_SYNC_1);
+      p = putU8(p, FRAME_TRACE);
+      p = putU16(p, length);
+      p = putU32(p, start);
+      p = putU32(p, held);
+      p = putU16(p, count);
+      p = putU16(p, TRACE_RECORD_SIZE);
+      uint16_t crc = crc16(chunk + 2, (uint16_t)(p - chunk - 2));
+      out.write(chunk, p - chunk);
+
+      for (uint16_t i = 0; i < count;) {
+        p = chunk;
+        for (uint8_t n = 0; n < 8 && i < count; n++, i++) p = putTraceRecord(p, at(start + i));
+        crc = crc16(chunk, (uint16_t)(p - chunk), crc);
+        out.write(chunk, p - chunk);
+      }
+      putU16(chunk, crc);
+      out.write(chunk, FRAME_TRAILER_SIZE);
+    }
+
+    // ---- LX200 commands ----------------------------------------------------
+
+    // :NWTA / :NWTS / :NWTM / :NWTT / :NWTQ with the "NWT" stripped; returns
+    // false for :NWTD or anything else
+    bool handle(const char *arg, uint32_t nowUs, char *reply, size_t replySize) {
+      char *end;
+      switch (arg[0]) {
+        case 'A': {
+          const unsigned long mask = strtoul(arg + 1, &end, 10);
+          unsigned long decimate = 1, post = 0;
+          if (end == arg + 1 || mask == 0 || mask > TRACE_CH_ALL) { snprintf(reply, replySize, "0#"); return true; }
+          if (*end == ',') decimate = strtoul(end + 1, &end, 10);
+          if (*end == ',') post = strtoul(end + 1, &end, 10);
+          if (*end != 0 || decimate == 0 || decimate > 65535) { snprintf(reply, replySize, "0#"); return true; }
+          arm((uint8_t)mask, (uint16_t)decimate, (uint32_t)post);
+          snprintf(reply, replySize, "1#");
+          return true;
+        }
+        case 'S': stop(); snprintf(reply, replySize, "1#"); return true;
+        case 'M': event(TRACE_EV_MARK, 0, (int32_t)strtol(arg + 1, nullptr, 10), 0, 0, nowUs); snprintf(reply, replySize, "1#"); return true;
+        case 'T': trigger(0, nowUs); snprintf(reply, replySize, "1#"); return true;
+        case 'Q':
+          snprintf(reply, replySize, "%u,%lu,%lu,%lu,%u#", (unsigned)state_, (unsigned long)records(),
+                   (unsigned long)TRACE_RECORDER_RECORDS, (unsigned long)overwritten(), (unsigned)mask_);
+          return true;
+        default: return false;
+      }
+    }
+
+  private:
+    bool accepting(uint8_t channel) const { return state_ == TRACE_ARMED && (mask_ & channel) != 0; }
+
+    // Lock-free slot claim; the claim past the post-trigger count stops the
+    // recording and is given back
+    TraceRecord *claim() {
+      const uint32_t slot = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED);
+      if (stopAt_ != 0 && (int32_t)(slot - stopAt_) >= 0) {
+        __atomic_fetch_sub(&head_, 1, __ATOMIC_RELAXED);
+        state_ = TRACE_STOPPED;
+        return nullptr;
+      }
+      TraceRecord *r = &ring_[slot & (TRACE_RECORDER_RECORDS - 1)];
+      r->kind = 0;                     // incomplete until the producer sets kind
+      return r;
+    }
+
+    TraceRecord ring_[TRACE_RECORDER_RECORDS];
+    volatile uint32_t head_ = 0;
+    volatile uint32_t stopAt_ = 0;
+    volatile TraceState state_ = TRACE_IDLE;
+    uint8_t mask_ = 0;
+    uint16_t decimate_ = 1;
+    uint32_t post_ = 0;
+    uint16_t tickCount_[2] = {0, 0};
+};
+
+} // namespace nightwatch
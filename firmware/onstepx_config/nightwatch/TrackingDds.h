@@ -0,0 +1,173 @@
+// NIGHTWATCH Firmware Extensions - Fixed-Point Tracking (DDS)
+//
+// Direct digital synthesis of the tracking step train. A hardware timer fires
+// at TRACK_DDS_CLOCK_HZ and adds a 64-bit phase increment to a 64-bit phase
+// accumulator; every accumulator overflow is one step. The step ISR therefore
+// does one 64-bit add and compare, never touches floats, and the rate is
+// resolved to 2^-64 steps per tick, so there is no accumulated drift over a
+// night of sidereal tracking.
+//
+// Rate changes (refraction from TRACK_REFRACTION_TYPE, the PPM offset pushed by
+// OnStepXExtended.set_tracking_offset(), backlash/guide multiples) are computed
+// in integer math in the main loop and handed to the ISR through a two-slot
+// buffer, so they can be applied as often as needed without adding jitter.
+
+#pragma once
+
+#include "AxisGeometry.h"
+#include "Benchmark.h"
+
+#if TRACK_RATE_FIXED_POINT == ON && defined(__IMXRT1062__)
+  #include <IntervalTimer.h>
+#endif
+
+namespace nightwatch {
+
+static_assert(TRACK_DDS_CLOCK_HZ > 0 && 1000000UL % TRACK_DDS_CLOCK_HZ == 0,
+              "TRACK_DDS_CLOCK_HZ must divide 1 MHz so the timer period is a whole microsecond");
+
+constexpr double TWO_POW_64 = 18446744073709551616.0;
+
+// Largest supported |offset| in 1e-4 ppm units (±50000 ppm)
+constexpr int32_t DDS_PPM_E4_LIMIT = 500000000L;
+
+// Phase increment for a step rate (steps/s) at the DDS clock
+constexpr uint64_t ddsIncrement(double stepsPerSecond) {
+  return (uint64_t)(stepsPerSecond / TRACK_DDS_CLOCK_HZ * TWO_POW_64);
+}
+
+// Scale an increment by (1 + ppmE4 * 1e-10) without overflowing 64 bits
+inline uint64_t ddsApplyPpm(uint64_t increment, int32_t ppmE4) {
+  if (ppmE4 > DDS_PPM_E4_LIMIT) ppmE4 = DDS_PPM_E4_LIMIT;
+  if (ppmE4 < -DDS_PPM_E4_LIMIT) ppmE4 = -DDS_PPM_E4_LIMIT;
+  const uint64_t scale = 10000000000ULL;
+  const uint64_t magnitude = (uint64_t)(ppmE4 < 0 ? -(int64_t)ppmE4 : ppmE4);
+  const uint64_t delta = (increment / scale) * magnitude + (increment % scale) * magnitude / scale;
+  return ppmE4 < 0 ? increment - delta : increment + delta;
+}
+
+// Scale an increment by numerator/denominator without overflowing 64 bits
+inline uint64_t ddsApplyRatio(uint64_t increment, uint32_t numerator, uint32_t denominator) {
+  if (denominator == 0) return 0;
+  return (increment / denominator) * numerator + (increment % denominator) * numerator / denominator;
+}
+
+// Parse the ST command argument ("+15.5000" style ppm) into 1e-4 ppm units
+// without using floating point. Returns false on malformed input.
+inline bool parsePpmE4(const char *text, int32_t *ppmE4) {
+  if (text == nullptr || ppmE4 == nullptr) return false;
+  bool negative = false;
+  if (*text == '+' || *text == '-') { negative = *text == '-'; text++; }
+  int64_t whole = 0;
+  int64_t fraction = 0;
+  int fractionDigits = 0;
+  bool digits = false;
+  while (*text >= '0' && *text <= '9') {
+    whole = whole * 10 + (*text++ - '0');
+    digits = true;
+    if (whole > DDS_PPM_E4_LIMIT / 10000) return false;
+  }
+  if (*text == '.') {
+    text++;
+    while (*text >= '0' && *text <= '9') {
+      if (fractionDigits < 4) { fraction = fraction * 10 + (*text - '0'); fractionDigits++; }
+      text++;
+      digits = true;
+    }
+  }
+  if (!digits || *text != 0) return false;
+  while (fractionDigits < 4) { fraction *= 10; fractionDigits++; }
+  const int64_t value = whole * 10000 + fraction;
+  *ppmE4 = (int32_t)(negative ? -value : value);
+  return true;
+}
+
+// =============================================================================
+// DDS ACCUMULATOR
+// =============================================================================
+// Geometry is an AxisGeometry<> instantiation providing trackingStepsPerSecond.
+template <typename Geometry>
+class TrackingDds {
+  public:
+    // Sidereal increment for this axis, the base for every rate change
+    static constexpr uint64_t siderealIncrement = ddsIncrement(Geometry::trackingStepsPerSecond);
+
+    static_assert(siderealIncrement > 0, "Tracking rate too low for the DDS clock");
+    static_assert(Geometry::trackingStepsPerSecond * TRACK_BACKLASH_RATE * 2 < TRACK_DDS_CLOCK_HZ,
+                  "TRACK_DDS_CLOCK_HZ must be at least twice the backlash takeup step rate");
+    // Truncating the increment loses < 1 LSB per tick; over 8 h of ticks that
+    // must stay far below one step (here < 1/1024 step)
+    static_assert((double)(8ULL * 3600ULL * TRACK_DDS_CLOCK_HZ) < TWO_POW_64 / 1024.0,
+                  "DDS accumulator resolution insufficient for an 8 hour session");
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Tracking at ratioNumerator/ratioDenominator × sidereal plus ppmE4 offset
+    void setRate(uint32_t ratioNumerator, uint32_t ratioDenominator, int32_t ppmE4) {
+      uint64_t increment = ddsApplyRatio(siderealIncrement, ratioNumerator, ratioDenominator);
+      increment = ddsApplyPpm(increment, ppmE4);
+      publish(increment);
+    }
+
+    void setSidereal(int32_t ppmE4 = 0) { setRate(1, 1, ppmE4); }
+    void stop() { publish(0); }
+    void setDirection(bool forward) { direction_ = forward ? 1 : -1; }
+
+    uint64_t increment() const { return increment_[active_]; }
+    int32_t steps() const { return steps_; }
+
+    // ---- ISR side ----------------------------------------------------------
+
+    // Called once per DDS clock; returns true when a step is due
+    inline bool tick() {
+      NW_BENCH_PERIOD(BENCH_TICK_JITTER, benchLast_, nightwatch::bench.ddsPeriodCycles());
+      NW_BENCH_SCOPE(BENCH_DDS_TICK);
+      const uint64_t previous = phase_;
+      phase_ += increment_[active_];
+      if (phase_ < previous) {
+        steps_ += direction_;
+        return true;
+      }
+      return false;
+    }
+
+    // Sub-step phase in 1/65536 step, for PEC interpolation
+    inline uint16_t phaseFraction() const { return (uint16_t)(phase_ >> 48); }
+
+  #if TRACK_RATE_FIXED_POINT == ON && defined(__IMXRT1062__)
+    // Start the PIT driving tick() through the caller's ISR trampoline
+    bool begin(void (*isr)()) {
+      if (!timer_.begin(isr, (unsigned int)(1000000UL / TRACK_DDS_CLOCK_HZ))) return false;
+      timer_.priority(0);
+      return true;
+    }
+    void end() { timer_.end(); }
+  #endif
+
+  private:
+    // Write the idle slot, then flip; the ISR only ever reads the active slot.
+    // The main loop never preempts the ISR, so a flip is never observed half-done.
+    void publish(uint64_t increment) {
+      const uint8_t idle = active_ ^ 1;
+      increment_[idle] = increment;
+      active_ = idle;
+    }
+
+    volatile uint64_t increment_[2] = {0, 0};
+    volatile uint8_t active_ = 0;
+    volatile uint64_t phase_ = 0;
+    volatile int32_t steps_ = 0;
+    volatile int8_t direction_ = 1;
+  #if BENCHMARK == ON
+    uint32_t benchLast_ = 0;
+  #endif
+
+  #if TRACK_RATE_FIXED_POINT == ON && defined(__IMXRT1062__)
+    IntervalTimer timer_;
+  #endif
+};
+
+using Axis1TrackingDds = TrackingDds<Axis1Geometry>;
+using Axis2TrackingDds = TrackingDds<Axis2Geometry>;
+
+} // namespace nightwatch
@@ -0,0 +1,288 @@
+// NIGHTWATCH Firmware Extensions - Warm Start From Absolute Encoders
+//
+// HOME_AUTOMATIC with PARK_STRICT homes after every reset that was not
+// preceded by a park: a watchdog restart or a power blip costs a full homing
+// pass (minutes of observing time and another run on the harmonic drives)
+// even though the mount has not moved. WarmStart lets the controller come up
+// ready instead when the AS5600 absolute encoders on the output shafts agree
+// with the last position checkpoint.
+//
+// Checkpoints are taken from the main loop: on every change of motion
+// (started moving, stopped, started tracking, parked) and every
+// WARM_START_CHECKPOINT_S while tracking. Each one stores both step
+// positions, both AS5600 raw angles and the motion kind as the
+// STORE_WARM_START record in the FlashStore, so a checkpoint is one page
+// program, not an EEPROM write.
+//
+// At boot both encoders are read WARM_START_SAMPLES times and compared with
+// the record:
+//
+//   record kind     encoders within tolerance      result
+//   stopped/parked  both axes                      WS_WARM: saved steps restored exactly
+//   tracking        axis 2, axis 1 within drift    WS_WARM_COARSE: axis 1 moved on by
+//                                                  the encoder delta, sync before imaging
+//   moving          -                              cold (reset during a slew)
+//   any             no                             cold (mount was moved while off)
+//
+// Cold results leave HOME_AUTOMATIC in charge. One AS5600 count is 0.088° of
+// output shaft, so the shafts only confirm the step positions; the steps
+// themselves come from the record. Both chips answer at the fixed address
+// AS5600_I2C_ADDRESS, so each axis has its own bus (Wire and Wire1).
+//
+// Record payload (18 bytes, little-endian):
+//   u8 version, u8 kind (WarmRecordKind)
+//   i32 axis1 steps, i32 axis2 steps (tracking microsteps)
+//   u16 axis1 raw angle, u16 axis2 raw angle
+//   u32 checkpoint sequence
+//
+// Commands (LX200 channel):
+//   :NWWQ#          result,record kind,axis1 delta counts,axis2 delta counts,checkpoints#
+//   :NWWX#          invalidate the checkpoint, next boot homes        -> 1#
+//                   (after moving the mount by hand with the clutches)
+//
+// Python side: OnStepXExtended.get_warm_start_status(), invalidate_warm_start().
+
+#pragma once
+
+#include <stdio.h>
+
+#include "AxisGeometry.h"
+#include "FlashStore.h"
+
+#if WARM_START == ON && FLASH_STORE != ON
+  #error "WARM_START keeps its checkpoint in the FLASH_STORE"
+#endif
+
+namespace nightwatch {
+
+static_assert(WARM_START_SAMPLES >= 1 && WARM_START_SAMPLES <= 64, "WARM_START_SAMPLES must be 1-64");
+static_assert(WARM_START_TOLERANCE_COUNTS >= 1 && WARM_START_TOLERANCE_COUNTS < 2048,
+              "WARM_START_TOLERANCE_COUNTS must be 1-2047");
+
+constexpr uint16_t AS5600_COUNTS = 4096;
+constexpr uint16_t WARM_RECORD_SIZE = 18;
+constexpr uint8_t WARM_RECORD_VERSION = 1;
+
+// Sidereal drift of axis 1 between tracking checkpoints, in AS5600 counts
+constexpr int32_t WARM_START_DRIFT_COUNTS =
+  (int32_t)(WARM_START_CHECKPOINT_S * AS5600_COUNTS / SIDEREAL_DAY_SECONDS) + 1;
+
+enum WarmRecordKind : uint8_t {
+  WS_REC_INVALID = 0,            // :NWWX# or never checkpointed
+  WS_REC_MOVING = 1,             // slewing or guiding at more than tracking rate
+  WS_REC_STOPPED = 2,
+  WS_REC_TRACKING = 3,
+  WS_REC_PARKED = 4,
+};
+
+enum WarmStartResult : uint8_t {
+  WS_COLD_NO_RECORD = 0,         // no valid checkpoint
+  WS_COLD_ENCODER = 1,           // bus error, no magnet or noisy readings
+  WS_COLD_MOVED = 2,             // shafts disagree with the checkpoint
+  WS_COLD_MOVING = 3,            // reset during a slew
+  WS_WARM = 4,
+  WS_WARM_COARSE = 5,
+};
+
+// =============================================================================
+// AS5600
+// =============================================================================
+// Wire: Arduino TwoWire (beginTransmission/write/endTransmission/requestFrom/read)
+template <typename Wire>
+class As5600 {
+  public:
+    static constexpr uint8_t REG_STATUS = 0x0B;
+    static constexpr uint8_t REG_RAW_ANGLE = 0x0C;
+    static constexpr uint8_t STATUS_MD = 0x20;     // magnet detected
+    static constexpr uint8_t STATUS_ML = 0x10;     // magnet too weak
+    static constexpr uint8_t STATUS_MH = 0x08;     // magnet too strong
+
+    void begin(Wire *wire) { wire_ = wire; }
+
+    // False on a bus error or when the magnet is missing or out of range
+    bool magnetOk() {
+      uint8_t status;
+      if (!readRegisters(REG_STATUS, &status, 1)) return false;
+      return (status & (STATUS_MD | STATUS_ML | STATUS_MH)) == STATUS_MD;
+    }
+
+    // 12-bit raw angle, ignoring the ZPOS/MPOS scaling
+    bool readRaw(uint16_t &raw) {
+      uint8_t data[2];
+      if (!readRegisters(REG_RAW_ANGLE, data, 2)) return false;
+      raw = (uint16_t)(((data[0] & 0x0F) << 8) | data[1]);
+      return true;
+    }
+
+  private:
+    bool readRegisters(uint8_t reg, uint8_t *out, uint8_t count) {
+      if (wire_ == nullptr) return false;
+      wire_->beginTransmission(AS5600_I2C_ADDRESS);
+      wire_->write(reg);
+      if (wire_->endTransmission(false) != 0) return false;
+      if (wire_->requestFrom((uint8_t)AS5600_I2C_ADDRESS, count) != count) return false;
+      for (uint8_t i = 0; i < count; i++) out[i] = (uint8_t)wire_->read();
+      return true;
+    }
+
+    Wire *wire_ = nullptr;
+};
+
+// =============================================================================
+// WARM START
+// =============================================================================
+template <typename Wire>
+class WarmStart {
+  public:
+    // Marks STORE_WARM_START dirty (FlashStore::markDirty)
+    typedef void (*DirtyHandler)(uint8_t key);
+
+    void begin(Wire *axis1Bus, Wire *axis2Bus, DirtyHandler dirtyHandler) {
+      encoder_[0].begin(axis1Bus);
+      encoder_[1].begin(axis2Bus);
+      dirty_ = dirtyHandler;
+    }
+
+    // ---- boot ------------------------------------------------------------
+
+    // record: FlashStore::get(STORE_WARM_START) contents, length 0 if absent.
+    // On WS_WARM / WS_WARM_COARSE the glue sets both axis positions from
+    // restoredSteps() and marks the mount homed instead of homing.
+    WarmStartResult boot(const uint8_t *record, uint16_t length) {
+      result_ = decide(record, length);
+      return result_;
+    }
+
+    WarmStartResult result() const { return result_; }
+    bool warm() const { return result_ == WS_WARM || result_ == WS_WARM_COARSE; }
+    bool parked() const { return warm() && saved_.kind == WS_REC_PARKED; }
+    int32_t restoredSteps(uint8_t axis) const { return restored_[axis - 1]; }
+
+    // ---- main loop side ----------------------------------------------------
+
+    // Call every main loop pass with the current motion kind and step
+    // positions; WS_REC_INVALID until the mount is homed, warm started or
+    // synced. A checkpoint reads both encoders (two short I2C transfers).
+    void poll(uint32_t nowMs, WarmRecordKind kind, int32_t steps1, int32_t steps2) {
+      const bool changed = kind != current_.kind;
+      const bool due = kind == WS_REC_TRACKING && nowMs - checkpointMs_ >= WARM_START_CHECKPOINT_S * 1000UL;
+      if (!changed && !due) return;
+      checkpointMs_ = nowMs;
+      if (kind == WS_REC_INVALID) { invalidate(); return; }
+      current_.kind = kind;
+      current_.steps[0] = steps1;
+      current_.steps[1] = steps2;
+      // A failed read leaves the angles unset; boot then fails the cross-check
+      for (uint8_t i = 0; i < 2; i++) {
+        if (!encoder_[i].readRaw(current_.raw[i])) current_.raw[i] = 0xFFFF;
+      }
+      current_.sequence = ++checkpoints_;
+      if (dirty_ != nullptr) dirty_(STORE_WARM_START);
+    }
+
+    // :NWWX#
+    void invalidate() {
+      current_.kind = WS_REC_INVALID;
+      current_.sequence = ++checkpoints_;
+      if (dirty_ != nullptr) dirty_(STORE_WARM_START);
+    }
+
+    // FlashStore Source for STORE_WARM_START
+    uint16_t serialize(uint8_t *out, uint16_t capacity) const {
+      if (capacity < WARM_RECORD_SIZE) return 0;
+      uint8_t *p = out;
+      p = putU8(p, WARM_RECORD_VERSION);
+      p = putU8(p, current_.kind);
+      p = putI32(p, current_.steps[0]);
+      p = putI32(p, current_.steps[1]);
+      p = putU16(p, current_.raw[0]);
+      p = putU16(p, current_.raw[1]);
+      p = putU32(p, current_.sequence);
+      return (uint16_t)(p - out);
+    }
+
+    // Reply for :NWWQ#
+    int formatStatus(char *out, size_t size) const {
+      return snprintf(out, size, "%u,%u,%d,%d,%lu#", (unsigned)result_, (unsigned)saved_.kind,
+                      (int)delta_[0], (int)delta_[1], (unsigned long)checkpoints_);
+    }
+
+  private:
+    struct Record {
+      WarmRecordKind kind = WS_REC_INVALID;
+      int32_t steps[2] = {0, 0};
+      uint16_t raw[2] = {0xFFFF, 0xFFFF};
+      uint32_t sequence = 0;
+    };
+
+    // Shortest signed distance between two raw angles
+    static int32_t wrap(int32_t counts) {
+      counts %= AS5600_COUNTS;
+      if (counts > AS5600_COUNTS / 2) counts -= AS5600_COUNTS;
+      if (counts < -AS5600_COUNTS / 2) counts += AS5600_COUNTS;
+      return counts;
+    }
+    static int32_t abs32(int32_t v) { return v < 0 ? -v : v; }
+
+    // Mean of WARM_START_SAMPLES readings, relative to reference; false when
+    // the chip is unusable or the readings spread too far
+    bool sample(uint8_t axis, uint16_t reference, int32_t &delta) {
+      if (!encoder_[axis].magnetOk()) return false;
+      int32_t sum = 0, lo = 0, hi = 0;
+      for (uint8_t i = 0; i < WARM_START_SAMPLES; i++) {
+        uint16_t raw;
+        if (!encoder_[axis].readRaw(raw)) return false;
+        const int32_t d = wrap((int32_t)raw - reference);
+        if (i == 0 || d < lo) lo = d;
+        if (i == 0 || d > hi) hi = d;
+        sum += d;
+      }
+      if (hi - lo > WARM_START_SPREAD_COUNTS) return false;
+      delta = (sum + (sum >= 0 ? WARM_START_SAMPLES / 2 : -(WARM_START_SAMPLES / 2))) / WARM_START_SAMPLES;
+      return true;
+    }
+
+    WarmStartResult decide(const uint8_t *record, uint16_t length) {
+      if (length != WARM_RECORD_SIZE || record[0] != WARM_RECORD_VERSION) return WS_COLD_NO_RECORD;
+      saved_.kind = (WarmRecordKind)record[1];
+      saved_.steps[0] = getI32(record + 2);
+      saved_.steps[1] = getI32(record + 6);
+      saved_.raw[0] = getU16(record + 10);
+      saved_.raw[1] = getU16(record + 12);
+      saved_.sequence = getU32(record + 14);
+      // Later checkpoints continue the sequence
+      checkpoints_ = saved_.sequence;
+      current_ = saved_;
+      if (saved_.kind == WS_REC_INVALID || saved_.kind > WS_REC_PARKED) return WS_COLD_NO_RECORD;
+      if (saved_.kind == WS_REC_MOVING) return WS_COLD_MOVING;
+      if (saved_.raw[0] >= AS5600_COUNTS || saved_.raw[1] >= AS5600_COUNTS) return WS_COLD_ENCODER;
+      for (uint8_t i = 0; i < 2; i++) {
+        if (!sample(i, saved_.raw[i], delta_[i])) return WS_COLD_ENCODER;
+      }
+      restored_[0] = saved_.steps[0];
+      restored_[1] = saved_.steps[1];
+      if (abs32(delta_[1]) > WARM_START_TOLERANCE_COUNTS) return WS_COLD_MOVED;
+      if (abs32(delta_[0]) <= WARM_START_TOLERANCE_COUNTS && saved_.kind != WS_REC_TRACKING) return WS_WARM;
+      if (saved_.kind != WS_REC_TRACKING ||
+          abs32(delta_[0]) > WARM_START_TOLERANCE_COUNTS + WARM_START_DRIFT_COUNTS) {
+        return WS_COLD_MOVED;
+      }
+      // Tracking ran on after the checkpoint: carry axis 1 on by what its shaft turned
+      const int32_t turned = WARM_START_AXIS1_REVERSE == ON ? -delta_[0] : delta_[0];
+      restored_[0] += (int32_t)(turned * ((double)Axis1Geometry::stepsPerRev / AS5600_COUNTS) +
+                                (turned >= 0 ? 0.5 : -0.5));
+      return WS_WARM_COARSE;
+    }
+
+    As5600<Wire> encoder_[2];
+    DirtyHandler dirty_ = nullptr;
+    WarmStartResult result_ = WS_COLD_NO_RECORD;
+    Record saved_;
+    Record current_;
+    int32_t delta_[2] = {0, 0};
+    int32_t restored_[2] = {0, 0};
+    uint32_t checkpointMs_ = 0;
+    uint32_t checkpoints_ = 0;
+};
+
+} // namespace nightwatch
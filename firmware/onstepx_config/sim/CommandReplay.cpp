@@ -0,0 +1,155 @@
+// NIGHTWATCH Firmware Extensions - Host CommandServer Replay
+//
+// Runs CommandServer on the host over scripted sessions instead of
+// NativeEthernet sockets, so queueing, priority and urgent-command behaviour
+// can be checked without a controller. The OnStepX command processor is
+// replaced by a handler that logs each command it is given and replies 1#.
+//
+// Build on the host, never for the Teensy (ARDUINO undefined):
+//   c++ -std=gnu++17 -O2 -I firmware/onstepx_config
+//       firmware/onstepx_config/sim/CommandReplay.cpp -o command_replay
+//
+// Input (stdin), one event per line:
+//   <session> <text>     bytes arriving on a session (0 to
+//                        CMD_SERVER_SESSIONS-1); a session connects the
+//                        first time it is named
+//   poll [<n>]           n main loop passes (default 1)
+//
+// At the end of the input the server is polled until every queue is empty.
+//
+// Output (stdout):
+//   exec <session> <command>     command reached the handler
+//   reply <session> <text>       everything the session was sent
+//   summary purged=<n> safety=<n> control=<n> query=<n>   (latency counts)
+//
+// Python side: tests/unit/test_command_server.py.
+
+#ifdef ARDUINO
+  #error "CommandReplay is a host program; it is not part of the firmware build"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <string>
+
+#include "Config.h"
+#include "nightwatch/CommandServer.h"
+
+using namespace nightwatch;
+
+namespace {
+
+struct Connection {
+  std::deque<uint8_t> input;
+  std::string output;
+  bool connected = false;
+  bool accepted = false;
+};
+
+Connection connections[CMD_SERVER_SESSIONS];
+
+class ReplayClient {
+  public:
+    ReplayClient() = default;
+    explicit ReplayClient(int8_t id) : id_(id) {}
+
+    explicit operator bool() const { return id_ >= 0; }
+    int8_t id() const { return id_; }
+    bool connected() const { return id_ >= 0 && connections[id_].connected; }
+    int available() const { return id_ >= 0 ? (int)connections[id_].input.size() : 0; }
+
+    int read() {
+      if (available() <= 0) return -1;
+      const int c = connections[id_].input.front();
+      connections[id_].input.pop_front();
+      return c;
+    }
+
+    size_t write(const uint8_t *data, size_t length) {
+      if (id_ >= 0) connections[id_].output.append((const char *)data, length);
+      return length;
+    }
+
+    void stop() { if (id_ >= 0) connections[id_].connected = false; }
+
+  private:
+    int8_t id_ = -1;
+};
+
+class ReplayServer {
+  public:
+    void begin() {}
+
+    // Hands out connected sessions in order, one per call like EthernetServer
+    ReplayClient accept() {
+      for (int8_t i = 0; i < CMD_SERVER_SESSIONS; i++) {
+        if (connections[i].connected && !connections[i].accepted) {
+          connections[i].accepted = true;
+          return ReplayClient(i);
+        }
+      }
+      return ReplayClient();
+    }
+};
+
+void handle(const char *command, ReplayClient &reply) {
+  printf("exec %d %s\n", reply.id(), command);
+  reply.write((const uint8_t *)"1#", 2);
+}
+
+CommandServer<ReplayServer, ReplayClient> server;
+ReplayServer listener;
+uint32_t nowMs = 0;
+
+bool pending() {
+  for (const Connection &c : connections) if (!c.input.empty()) return true;
+  for (uint8_t p = 0; p < CMD_PRIORITY_COUNT; p++) if (server.queued(p) > 0) return true;
+  return false;
+}
+
+void poll(long passes) {
+  for (long i = 0; i < passes; i++) server.poll(nowMs++);
+}
+
+} // namespace
+
+int main() {
+  server.begin(&listener, handle, nullptr);
+
+  char line[512];
+  unsigned lineNumber = 0;
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    lineNumber++;
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[0] == 0) continue;
+    if (strncmp(line, "poll", 4) == 0) {
+      poll(line[4] == ' ' ? strtol(line + 5, nullptr, 10) : 1);
+      continue;
+    }
+    char *text = nullptr;
+    const long id = strtol(line, &text, 10);
+    if (text == line || *text != ' ' || id < 0 || id >= CMD_SERVER_SESSIONS) {
+      printf("error %u bad event\n", lineNumber);
+      continue;
+    }
+    Connection &c = connections[id];
+    c.connected = true;
+    for (const char *p = text + 1; *p != 0; p++) c.input.push_back((uint8_t)*p);
+  }
+
+  for (long budget = 100000; budget > 0 && pending(); budget--) poll(1);
+  poll(1);
+
+  for (uint8_t i = 0; i < CMD_SERVER_SESSIONS; i++) {
+    if (connections[i].accepted) printf("reply %u %s\n", (unsigned)i, connections[i].output.c_str());
+  }
+  printf("summary purged=%u safety=%u control=%u query=%u\n", (unsigned)server.purged(),
+         (unsigned)server.latency(CMD_PRIORITY_SAFETY).count,
+         (unsigned)server.latency(CMD_PRIORITY_CONTROL).count,
+         (unsigned)server.latency(CMD_PRIORITY_QUERY).count);
+  return 0;
+}
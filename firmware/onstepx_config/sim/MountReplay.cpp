@@ -0,0 +1,667 @@
+// NIGHTWATCH Firmware Extensions - Host Replay Simulator
+//
+// services/simulators/mount_simulator.py models a generic mount and knows
+// nothing of Config.h. MountReplay is the other end: a host program built
+// from the same Config.h and the same motion headers as the firmware
+// (AxisGeometry, SCurvePlanner, CoordinatedGoto, PecModel), replaying a
+// recorded command trace in virtual time as fast as the host runs it.
+//
+//   gotos     planned by CoordinatedGoto, every step popped from the
+//             SCurvePlanner rings at its NW_STEP_TIMER_HZ interval, so slew
+//             times and landing positions are the firmware's own. The target
+//             is led by the planned duration, as the goto tracks meanwhile.
+//   pier      PIER_SIDE_PREFERRED BEST: stay on the current side while the
+//             target is within AXIS1_PAST_MERIDIAN_LIMIT_E/W, else flip. A
+//             flip is one leg when CoordinatedGoto::flipOverlapAllowed(),
+//             otherwise a leg to the pole first. Home and park are at the
+//             pole on neither side (N): the first goto from there takes the
+//             counterweight-down side of the target and is not a flip.
+//   limits    AXIS2_LIMIT_MIN/MAX refuse gotos; tracking stops where axis1
+//             passes AXIS1_PAST_MERIDIAN_LIMIT_E.
+//   settle    TARGET_SETTLE_MS after each goto (the shortest settle the
+//             TargetQueue can report), then queued targets dwell.
+//   stop      AXIS*_RAPID_STOP_TIME deceleration from the rate at the stop.
+//   PEC       axis1 periodic error terms are injected, and with PEC_MODEL
+//             LUT or FOURIER an uploaded FRAME_PEC_MODEL payload corrects
+//             them; the residual is sampled once per second of tracking.
+//
+// Axis1 is the instrument angle of CoordinatedGoto (0 = counterweight down,
+// +90 = counterweight horizontal east): HA + 90 on the west pier side,
+// HA - 90 on the east side. Axis2 is Dec on the west side, 180 - Dec east.
+//
+// Build on the host, never for the Teensy (ARDUINO undefined):
+//   c++ -std=gnu++17 -O2 -I firmware/onstepx_config
+//       firmware/onstepx_config/sim/MountReplay.cpp -o mount_replay
+//
+// Input (stdin), one event per line, times in seconds, non-decreasing:
+//   <t> lst <deg>                    local sidereal time at t
+//   <t> goto <ra deg> <dec deg>      goto now (refused while slewing/parked)
+//   <t> queue <ra> <dec> <dwell s>   append to the target queue
+//   <t> track <0|1>
+//   <t> stop                         abort a goto, clear the queue
+//   <t> park | unpark
+//   <t> pe <cycles> <cos"> <sin">    add an axis1 periodic error term
+//   <t> pec <hex payload>            FRAME_PEC_MODEL payload (:NWU#)
+//   <t> probe                        report the simulated state at t
+//   <t> end                          run to t
+//
+// At the end of the input the replay runs on until gotos, settles and the
+// target queue are done, so a queue-only trace needs no end event.
+//
+// Output (stdout):
+//   goto <n> <t start> <t end> <E|W> <legs>
+//   refused <n> <t> <reason>
+//   stopped <t> <t stationary>
+//   limit <t>
+//   probe <t> <state> <ra> <dec> <E|W|N> <axis1 deg> <axis2 deg>
+//   pec <samples> <raw rms"> <corrected rms">
+//   error <line> <reason>
+//   summary key=value ...
+//
+// Python side: services/simulators/firmware_replay.py.
+
+#ifdef ARDUINO
+  #error "MountReplay is a host program; it is not part of the firmware build"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Config.h"
+#include "nightwatch/CoordinatedGoto.h"
+#include "nightwatch/PecModel.h"
+
+using namespace nightwatch;
+
+namespace {
+
+constexpr double LST_DEG_PER_S = 360.0 / SIDEREAL_DAY_SECONDS;
+constexpr double AXIS1_LIMIT_EAST = 90.0 + AXIS1_PAST_MERIDIAN_LIMIT_E;
+constexpr double AXIS1_LIMIT_WEST = -90.0 - AXIS1_PAST_MERIDIAN_LIMIT_W;
+constexpr double PEC_SAMPLE_S = 1.0;
+constexpr uint8_t PE_TERMS_MAX = 16;
+constexpr uint16_t QUEUE_MAX = 256;
+#if PEC_MODEL != PEC_MODEL_FLAT
+constexpr size_t LINE_SIZE = 2 * PEC_MAX_PAYLOAD + 64;   // a hex PEC payload on one line
+#else
+constexpr size_t LINE_SIZE = 256;
+#endif
+
+enum SimState : uint8_t { SIM_IDLE, SIM_SLEWING, SIM_STOPPING, SIM_SETTLING, SIM_PARKED };
+const char *const STATE_NAMES[] = {"idle", "slewing", "stopping", "settling", "parked"};
+
+enum PierSide : uint8_t { PIER_EAST, PIER_WEST, PIER_NONE };   // none: home / park at the pole
+const char PIER_NAMES[] = {'E', 'W', 'N'};
+
+double wrap180(double deg) {
+  deg = fmod(deg + 180.0, 360.0);
+  if (deg < 0) deg += 360.0;
+  return deg - 180.0;
+}
+
+double wrap360(double deg) {
+  deg = fmod(deg, 360.0);
+  return deg < 0 ? deg + 360.0 : deg;
+}
+
+// One axis of a goto leg: pops its planner's intervals against a tick cursor
+template <typename Geometry>
+struct AxisRunner {
+  SCurvePlanner<Geometry> planner;
+  int64_t *steps = nullptr;     // tracking microsteps
+  uint64_t cursorTicks = 0;     // since the leg started
+  uint32_t lastIntervalTicks = 0;
+  int8_t direction = 1;
+  bool running = false;
+
+  void start(int64_t *position) {
+    steps = position;
+    cursorTicks = 0;
+    lastIntervalTicks = 0;
+    direction = planner.forward() ? 1 : -1;
+    running = planner.active();
+  }
+
+  // Step until the cursor reaches deadlineTicks or the schedule ends
+  void advance(uint64_t deadlineTicks) {
+    while (running && cursorTicks < deadlineTicks) {
+      uint32_t interval;
+      bool step;
+      if (!planner.pop(&interval, &step)) {
+        planner.fill();
+        if (!planner.active()) running = false;
+        continue;
+      }
+      cursorTicks += interval;
+      if (step) {
+        *steps += direction * (int64_t)Geometry::gotoStepMultiplier;
+        lastIntervalTicks = interval;
+      }
+    }
+  }
+
+  // Current rate, degrees/second
+  double rateDeg() const {
+    if (!running || lastIntervalTicks == 0) return 0;
+    return NW_STEP_TIMER_HZ / (double)lastIntervalTicks / Geometry::stepsPerDegreeGoto;
+  }
+
+  void stop() {
+    planner.cancel();
+    running = false;
+  }
+};
+
+struct PeTerm {
+  uint16_t cycles;
+  double cosArcsec;
+  double sinArcsec;
+};
+
+struct PecStats {
+  uint32_t samples;
+  double rawSq;
+  double correctedSq;
+};
+
+struct Target {
+  double raDeg;
+  double decDeg;
+  double dwellS;
+};
+
+class MountReplay {
+  public:
+    MountReplay() {
+      steps_[0] = 0;
+      steps_[1] = llround(90.0 * Axis2Geometry::stepsPerDegree);   // home: counterweight down, pole
+    }
+
+    bool event(double t, char *verb, char *args, uint32_t line) {
+      if (t < now_) { error(line, "time went backwards"); return false; }
+      advanceTo(t);
+
+      if (strcmp(verb, "lst") == 0) {
+        lstDeg_ = atof(args);
+        lstAtS_ = t;
+      } else if (strcmp(verb, "goto") == 0) {
+        double ra, dec;
+        if (sscanf(args, "%lf %lf", &ra, &dec) != 2) { error(line, "goto needs ra dec"); return false; }
+        queueHead_ = queueTail_ = 0;
+        requestGoto(Target{ra, dec, 0}, t);
+      } else if (strcmp(verb, "queue") == 0) {
+        Target target = {0, 0, 0};
+        if (sscanf(args, "%lf %lf %lf", &target.raDeg, &target.decDeg, &target.dwellS) < 2) {
+          error(line, "queue needs ra dec [dwell]");
+          return false;
+        }
+        if (queueTail_ - queueHead_ >= QUEUE_MAX) { error(line, "queue full"); return false; }
+        queue_[queueTail_++ % QUEUE_MAX] = target;
+        serviceQueue();
+      } else if (strcmp(verb, "track") == 0) {
+        tracking_ = atoi(args) != 0 && state_ != SIM_PARKED;
+      } else if (strcmp(verb, "stop") == 0) {
+        queueHead_ = queueTail_ = 0;
+        stop();
+      } else if (strcmp(verb, "park") == 0) {
+        queueHead_ = queueTail_ = 0;
+        park(t);
+      } else if (strcmp(verb, "unpark") == 0) {
+        if (state_ == SIM_PARKED) state_ = SIM_IDLE;
+      } else if (strcmp(verb, "pe") == 0) {
+        unsigned cycles;
+        PeTerm term;
+        if (sscanf(args, "%u %lf %lf", &cycles, &term.cosArcsec, &term.sinArcsec) != 3 ||
+            cycles == 0 || peCount_ >= PE_TERMS_MAX) {
+          error(line, "pe needs cycles cos sin");
+          return false;
+        }
+        term.cycles = (uint16_t)cycles;
+        pe_[peCount_++] = term;
+      } else if (strcmp(verb, "pec") == 0) {
+        if (!loadPec(args)) { error(line, "pec payload rejected"); return false; }
+      } else if (strcmp(verb, "probe") == 0) {
+        probe(t);
+      } else if (strcmp(verb, "end") != 0) {
+        error(line, "unknown event");
+        return false;
+      }
+      return true;
+    }
+
+    // Run on until nothing is moving, settling or queued
+    void drain() {
+      for (;;) {
+        if (state_ == SIM_SLEWING) {
+          runLeg(now_ + 60.0);
+        } else if (state_ == SIM_STOPPING || state_ == SIM_SETTLING) {
+          advanceTo(stateEndS_);
+        } else if (state_ == SIM_IDLE && queueHead_ != queueTail_) {
+          if (dwellEndS_ > now_) advanceTo(dwellEndS_);
+          serviceQueue();
+        } else {
+          break;
+        }
+      }
+    }
+
+    void finish(double wallS) {
+      if (pec_.samples > 0) {
+        printf("pec %lu %.4f %.4f\n", (unsigned long)pec_.samples,
+               sqrt(pec_.rawSq / pec_.samples), sqrt(pec_.correctedSq / pec_.samples));
+      }
+      const double span = now_ - firstS_;
+      printf("summary sim_s=%.3f gotos=%lu refused=%lu stopped=%lu flips=%lu limits=%lu slew_s=%.3f "
+             "settle_s=%.3f track_s=%.3f slews_per_hour=%.3f wall_s=%.3f speedup=%.1f\n",
+             span, (unsigned long)gotos_, (unsigned long)refused_, (unsigned long)stopped_,
+             (unsigned long)flips_, (unsigned long)limits_, slewS_, settleS_, trackS_,
+             span > 0 ? gotos_ * 3600.0 / span : 0.0, wallS, wallS > 0 ? span / wallS : 0.0);
+    }
+
+    void setStart(double t) { if (firstS_ < 0) { firstS_ = t; now_ = t; } }
+
+  private:
+    // ---- time ---------------------------------------------------------------
+
+    double lst(double t) const { return wrap360(lstDeg_ + (t - lstAtS_) * LST_DEG_PER_S); }
+
+    void advanceTo(double t) {
+      while (now_ < t) {
+        switch (state_) {
+          case SIM_SLEWING: runLeg(t); break;
+          case SIM_STOPPING:
+          case SIM_SETTLING: {
+            const double until = t < stateEndS_ ? t : stateEndS_;
+            track(until);
+            if (state_ == SIM_SETTLING) settleS_ += until - now_;
+            now_ = until;
+            if (now_ >= stateEndS_) {
+              state_ = SIM_IDLE;
+              dwellEndS_ = now_ + dwellS_;
+            }
+            break;
+          }
+          case SIM_IDLE: {
+            double until = t;
+            if (queueHead_ != queueTail_ && dwellEndS_ > now_ && dwellEndS_ < until) until = dwellEndS_;
+            track(until);
+            now_ = until;
+            serviceQueue();
+            break;
+          }
+          case SIM_PARKED: now_ = t; break;
+        }
+      }
+    }
+
+    // Sidereal tracking from now_ to until; stops at the meridian limit
+    void track(double until) {
+      if (!tracking_ || until <= now_) return;
+      double from = now_;
+      const double limitS = from + (AXIS1_LIMIT_EAST - axisDeg(0)) / LST_DEG_PER_S;
+      const bool limited = limitS < until;
+      if (limited) until = limitS > from ? limitS : from;
+      trackS_ += until - from;
+
+      // PEC residual on every PEC_SAMPLE_S of tracking time
+      while (from < until) {
+        double next = from + (nextPecS_ - trackedS_);
+        if (next > until) next = until;
+        trackFraction_ += (next - from) * Axis1Geometry::trackingStepsPerSecond;
+        const int64_t whole = (int64_t)floor(trackFraction_);
+        steps_[0] += whole;
+        trackFraction_ -= whole;
+        trackedS_ += next - from;
+        from = next;
+        if (trackedS_ >= nextPecS_ - 1e-9) {
+          samplePec();
+          nextPecS_ += PEC_SAMPLE_S;
+        }
+      }
+      if (limited) {
+        tracking_ = false;
+        limits_++;
+        printf("limit %.3f\n", until);
+      }
+    }
+
+    // ---- gotos --------------------------------------------------------------
+
+    double axisDeg(uint8_t axis) const {
+      return axis == 0 ? steps_[0] / Axis1Geometry::stepsPerDegree : steps_[1] / Axis2Geometry::stepsPerDegree;
+    }
+
+    // Side the tube is on: axis2 mirrors at the pole, which is either side
+    // (PIER_NONE when starting from home)
+    PierSide side() const {
+      if (state_ != SIM_SLEWING && state_ != SIM_STOPPING) return pier_;
+      const double a2 = axisDeg(1);
+      return a2 < 90.0 ? PIER_WEST : a2 > 90.0 ? PIER_EAST : pier_;
+    }
+
+    void pointing(double *raDeg, double *decDeg) const {
+      const double a1 = axisDeg(0), a2 = axisDeg(1);
+      const PierSide s = side();   // at the pole any side gives Dec 90
+      const double ha = s == PIER_WEST ? a1 - 90.0 : a1 + 90.0;
+      *decDeg = s == PIER_WEST ? a2 : 180.0 - a2;
+      *raDeg = wrap360(lst(now_) - ha);
+    }
+
+    static bool reachable(PierSide side, double haDeg) {
+      const double a1 = side == PIER_WEST ? haDeg + 90.0 : haDeg - 90.0;
+      return a1 >= AXIS1_LIMIT_WEST && a1 <= AXIS1_LIMIT_EAST && a1 >= AXIS1_LIMIT_MIN && a1 <= AXIS1_LIMIT_MAX;
+    }
+
+    static void instrument(PierSide side, double haDeg, double decDeg, double *a1, double *a2) {
+      *a1 = side == PIER_WEST ? haDeg + 90.0 : haDeg - 90.0;
+      *a2 = side == PIER_WEST ? decDeg : 180.0 - decDeg;
+    }
+
+    void requestGoto(const Target &target, double t) {
+      const uint32_t id = ++requests_;
+      const char *reason = nullptr;
+      if (state_ == SIM_PARKED) reason = "parked";
+      else if (state_ == SIM_SLEWING || state_ == SIM_STOPPING) reason = "busy";
+      else if (target.decDeg < AXIS2_LIMIT_MIN || target.decDeg > AXIS2_LIMIT_MAX) reason = "dec_limit";
+      if (reason == nullptr) {
+        if (state_ == SIM_SETTLING) state_ = SIM_IDLE;   // a new goto cuts the settle short
+        target_ = target;
+        id_ = id;
+        reason = planGoto();
+      }
+      if (reason != nullptr) {
+        refused_++;
+        printf("refused %lu %.3f %s\n", (unsigned long)id, t, reason);
+      }
+    }
+
+    // Side and axis angles for the target at HA after leadS
+    const char *chooseSide(double leadS, PierSide *side, double *a1, double *a2) const {
+      const double ha = wrap180(lst(now_ + leadS) - target_.raDeg);
+      // From the pole: the side with the counterweight down, axis1 within ±90
+      PierSide s = pier_ != PIER_NONE ? pier_ : ha >= 0 ? PIER_EAST : PIER_WEST;
+      if (!reachable(s, ha)) s = s == PIER_WEST ? PIER_EAST : PIER_WEST;
+      if (!reachable(s, ha)) return "meridian_limit";
+      *side = s;
+      instrument(s, ha, target_.decDeg, a1, a2);
+      return nullptr;
+    }
+
+    // Target led by the expected duration of the move there, once
+    const char *aim(PierSide *side, double *a1, double *a2) const {
+      const char *reason = chooseSide(0, side, a1, a2);
+      if (reason != nullptr) return reason;
+      return chooseSide(gotoSeconds(*a1, *a2), side, a1, a2);
+    }
+
+    const char *planGoto() {
+      PierSide side;
+      double a1, a2;
+      const char *reason = aim(&side, &a1, &a2);
+      if (reason != nullptr) return reason;
+
+      legs_ = 1;
+      if (pier_ != PIER_NONE && side != pier_) {   // leaving the pole picks a side, no flip
+        flips_++;
+        double fromRa, fromDec;
+        pointing(&fromRa, &fromDec);
+        if (!CoordinatedGoto::flipOverlapAllowed(axisDeg(0), a1, fromDec, target_.decDeg)) legs_ = 2;
+      }
+      legsPlanned_ = legs_;
+      newSide_ = side;
+      startS_ = now_;
+      // Two-leg flip: the pole first, axis1 where it is
+      const bool ok = legs_ == 2 ? startLeg(axisDeg(0), 90.0) : startLeg(a1, a2);
+      return ok ? nullptr : "planner";
+    }
+
+    double gotoSeconds(double a1, double a2) const {
+      const double t1 = gotoDuration<Axis1Geometry>(gotoSteps<Axis1Geometry>(steps_[0], a1), AXIS1_GOTO_LIMITS);
+      const double t2 = gotoDuration<Axis2Geometry>(gotoSteps<Axis2Geometry>(steps_[1], a2), AXIS2_GOTO_LIMITS);
+      return t1 > t2 ? t1 : t2;
+    }
+
+    template <typename Geometry>
+    static int32_t gotoSteps(int64_t from, double toDeg) {
+      const double delta = toDeg * Geometry::stepsPerDegree - (double)from;
+      return (int32_t)llround(delta / Geometry::gotoStepMultiplier);
+    }
+
+    bool startLeg(double a1, double a2) {
+      CoordinatedGoto coordinated;
+      if (!coordinated.plan(axis1_.planner, axis2_.planner,
+                            gotoSteps<Axis1Geometry>(steps_[0], a1), gotoSteps<Axis2Geometry>(steps_[1], a2))) {
+        return false;
+      }
+      axis1_.start(&steps_[0]);
+      axis2_.start(&steps_[1]);
+      legStartS_ = now_;
+      state_ = SIM_SLEWING;
+      return true;
+    }
+
+    void runLeg(double t) {
+      const uint64_t deadline = (uint64_t)ceil((t - legStartS_) * NW_STEP_TIMER_HZ);
+      axis1_.advance(deadline);
+      axis2_.advance(deadline);
+      if (axis1_.running || axis2_.running) {
+        slewS_ += t - now_;
+        now_ = t;
+        return;
+      }
+      const uint64_t ticks = axis1_.cursorTicks > axis2_.cursorTicks ? axis1_.cursorTicks : axis2_.cursorTicks;
+      const double end = legStartS_ + ticks / (double)NW_STEP_TIMER_HZ;
+      slewS_ += end - now_;
+      now_ = end;
+
+      if (--legs_ > 0) {
+        // Pole waypoint reached: the second leg leads the target from here
+        pier_ = newSide_;
+        PierSide side;
+        double a1, a2;
+        if (aim(&side, &a1, &a2) != nullptr || side != pier_ || !startLeg(a1, a2)) {
+          legs_ = 0;
+          state_ = SIM_IDLE;
+          refused_++;
+          printf("refused %lu %.3f meridian_limit\n", (unsigned long)id_, now_);
+        }
+        return;
+      }
+      pier_ = newSide_;
+      if (parking_) {
+        parking_ = false;
+        tracking_ = false;
+        state_ = SIM_PARKED;
+        return;
+      }
+      gotos_++;
+      printf("goto %lu %.3f %.3f %c %u\n", (unsigned long)id_, startS_, now_,
+             PIER_NAMES[pier_], (unsigned)legsPlanned_);
+      tracking_ = true;   // gotos end tracking the target
+      state_ = SIM_SETTLING;
+      stateEndS_ = now_ + TARGET_SETTLE_MS / 1000.0;
+      dwellS_ = target_.dwellS;
+    }
+
+    // Next queued target once idle and the last dwell is over; refused
+    // targets are skipped, as TargetQueue does
+    void serviceQueue() {
+      while (state_ == SIM_IDLE && queueHead_ != queueTail_ && now_ >= dwellEndS_) {
+        const Target target = queue_[queueHead_++ % QUEUE_MAX];
+        requestGoto(target, now_);
+      }
+    }
+
+    void stop() {
+      if (state_ != SIM_SLEWING) return;
+      // Decelerate each axis from its rate at the stop over AXIS*_RAPID_STOP_TIME
+      const double v1 = axis1_.rateDeg(), v2 = axis2_.rateDeg();
+      const double t1 = v1 > 0 ? AXIS1_RAPID_STOP_TIME : 0, t2 = v2 > 0 ? AXIS2_RAPID_STOP_TIME : 0;
+      steps_[0] += axis1_.direction * llround(v1 * t1 / 2.0 * Axis1Geometry::stepsPerDegree);
+      steps_[1] += axis2_.direction * llround(v2 * t2 / 2.0 * Axis2Geometry::stepsPerDegree);
+      axis1_.stop();
+      axis2_.stop();
+      pier_ = side();
+      legs_ = 0;
+      parking_ = false;
+      stopped_++;
+      state_ = SIM_STOPPING;
+      stateEndS_ = now_ + (t1 > t2 ? t1 : t2);
+      dwellS_ = 0;
+      printf("stopped %.3f %.3f\n", now_, stateEndS_);
+    }
+
+    void park(double t) {
+      if (state_ == SIM_PARKED) return;
+      if (state_ == SIM_SLEWING || state_ == SIM_STOPPING) {
+        refused_++;
+        printf("refused %lu %.3f busy\n", (unsigned long)++requests_, t);
+        return;
+      }
+      state_ = SIM_IDLE;
+      tracking_ = false;
+      parking_ = true;
+      legs_ = legsPlanned_ = 1;
+      newSide_ = PIER_NONE;   // parked at the pole
+      startS_ = now_;
+      if (!startLeg(0.0, 90.0)) parking_ = false;
+    }
+
+    // ---- PEC ----------------------------------------------------------------
+
+    bool loadPec(const char *hex) {
+    #if PEC_MODEL != PEC_MODEL_FLAT
+      static uint8_t payload[PEC_MAX_PAYLOAD];
+      const size_t digits = strlen(hex);
+      if (digits % 2 != 0 || digits / 2 > sizeof(payload)) return false;
+      for (size_t i = 0; i < digits / 2; i++) {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], 0};
+        char *end;
+        payload[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != 0) return false;
+      }
+      return pecEngine_.load(payload, (uint16_t)(digits / 2));
+    #else
+      (void)hex;
+      return false;   // PEC_MODEL_FLAT has no uploadable model
+    #endif
+    }
+
+    void samplePec() {
+      if (peCount_ == 0) return;
+      // Motor-side encoder count at this step position
+      const int64_t counts = steps_[0] * AXIS1_ENCODER_PPR / (AXIS1_MOTOR_STEPS_PER_REV * AXIS1_DRIVER_MICROSTEPS);
+      const int32_t wrapped = (int32_t)(counts % Axis1OutputPhase::countsPerRev);
+      const double theta = Axis1OutputPhase::fromCounts(wrapped) * (TWO_PI / 4294967296.0);
+      double raw = 0;
+      for (uint8_t i = 0; i < peCount_; i++) {
+        raw += pe_[i].cosArcsec * cos(pe_[i].cycles * theta) + pe_[i].sinArcsec * sin(pe_[i].cycles * theta);
+      }
+    #if PEC_MODEL != PEC_MODEL_FLAT
+      const double corrected = raw + pecEngine_.correctionCas(1, wrapped) / 100.0;
+    #else
+      const double corrected = raw;
+    #endif
+      pec_.samples++;
+      pec_.rawSq += raw * raw;
+      pec_.correctedSq += corrected * corrected;
+    }
+
+    // ---- reports ------------------------------------------------------------
+
+    void probe(double t) {
+      double ra, dec;
+      pointing(&ra, &dec);
+      printf("probe %.3f %s %.5f %.5f %c %.5f %.5f\n", t, STATE_NAMES[state_], ra, dec,
+             PIER_NAMES[side()], axisDeg(0), axisDeg(1));
+    }
+
+    void error(uint32_t line, const char *reason) { printf("error %lu %s\n", (unsigned long)line, reason); }
+
+    // Position
+    int64_t steps_[2];
+    double trackFraction_ = 0;
+    PierSide pier_ = PIER_NONE;   // home
+    bool tracking_ = false;
+
+    // Clock
+    double now_ = 0;
+    double firstS_ = -1;
+    double lstDeg_ = 0;
+    double lstAtS_ = 0;
+    double trackedS_ = 0;
+    double nextPecS_ = PEC_SAMPLE_S;
+
+    // Goto in progress
+    SimState state_ = SIM_IDLE;
+    AxisRunner<Axis1Geometry> axis1_;
+    AxisRunner<Axis2Geometry> axis2_;
+    Target target_ = {0, 0, 0};
+    PierSide newSide_ = PIER_NONE;
+    uint8_t legs_ = 0;          // left to run
+    uint8_t legsPlanned_ = 0;
+    bool parking_ = false;
+    double startS_ = 0;
+    double legStartS_ = 0;
+    double stateEndS_ = 0;
+    double dwellS_ = 0;
+    double dwellEndS_ = 0;
+    uint32_t id_ = 0;
+
+    // Target queue
+    Target queue_[QUEUE_MAX];
+    uint32_t queueHead_ = 0;
+    uint32_t queueTail_ = 0;
+
+    // PEC
+    PeTerm pe_[PE_TERMS_MAX] = {};
+    uint8_t peCount_ = 0;
+    PecStats pec_ = {};
+  #if PEC_MODEL != PEC_MODEL_FLAT
+    PecEngine pecEngine_;
+  #endif
+
+    // Totals
+    uint32_t requests_ = 0;
+    uint32_t gotos_ = 0;
+    uint32_t refused_ = 0;
+    uint32_t stopped_ = 0;
+    uint32_t flips_ = 0;
+    uint32_t limits_ = 0;
+    double slewS_ = 0;
+    double settleS_ = 0;
+    double trackS_ = 0;
+};
+
+MountReplay replay;   // large: PEC tables and planner rings
+
+} // namespace
+
+int main() {
+  static char line[LINE_SIZE];
+  const clock_t started = clock();
+  uint32_t number = 0;
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    number++;
+    char *hash = strchr(line, '#');
+    if (hash != nullptr) *hash = 0;
+    char *cursor = line;
+    const double t = strtod(cursor, &cursor);
+    if (cursor == line) continue;   // blank or comment
+    while (*cursor == ' ' || *cursor == '\t') cursor++;
+    char *verb = cursor;
+    while (*cursor != 0 && *cursor != ' ' && *cursor != '\t' && *cursor != '\n' && *cursor != '\r') cursor++;
+    if (*cursor != 0) *cursor++ = 0;
+    char *end = cursor + strlen(cursor);
+    while (end > cursor && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ')) *--end = 0;
+    replay.setStart(t);
+    replay.event(t, verb, cursor, number);
+  }
+  replay.drain();
+  replay.finish((double)(clock() - started) / CLOCKS_PER_SEC);
+  return 0;
+}
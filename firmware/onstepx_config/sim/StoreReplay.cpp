@@ -0,0 +1,137 @@
+// NIGHTWATCH Firmware Extensions - Host FlashStore Replay
+//
+// Runs FlashStore on the host over a RAM image of the QSPI NOR chip, so
+// saving, reclaiming and the boot scan can be checked without a controller,
+// including program failures the real chip only shows once in a while.
+// Programming only clears bits and erasing sets a block to 0xFF, as on NOR.
+//
+// Build on the host, never for the Teensy (ARDUINO undefined). A small ring
+// reaches the reclaim path in a few saves:
+//   c++ -std=gnu++17 -O2 -I firmware/onstepx_config
+//       -DFLASH_STORE_BLOCKS=3 -DFLASH_STORE_BLOCK_SIZE=1024 -DFLASH_STORE_MAX_RECORD=256
+//       firmware/onstepx_config/sim/StoreReplay.cpp -o store_replay
+//
+// Input (stdin), one event per line:
+//   save <key> <length> <byte>   the Source now returns length bytes of
+//                                byte for key; the key is marked dirty
+//   fail <key>                   the next record programmed for key reads
+//                                back wrong (its first program call drops a
+//                                bit)
+//   run                          poll until the store is idle
+//   reboot                       a fresh FlashStore scans the same flash
+//   get <key>                    report the current record
+//   status                       report the :NWFQ# reply
+//
+// Output (stdout):
+//   get <key> <length> <first byte> <all bytes equal 0|1>
+//   status <:NWFQ# reply>
+//   stuck                        run gave up: the store never went idle
+//   error <line> <reason>
+//
+// Python side: tests/unit/test_flash_store.py.
+
+#ifdef ARDUINO
+  #error "StoreReplay is a host program; it is not part of the firmware build"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Config.h"
+#include "nightwatch/FlashStore.h"
+
+using namespace nightwatch;
+
+namespace {
+
+class RamFlash {
+  public:
+    RamFlash() { memset(memory_, 0xFF, sizeof(memory_)); }
+
+    void failNext(uint8_t key) { failKey_ = key; }
+
+    bool busy() const { return false; }
+
+    void read(uint32_t address, uint8_t *out, uint32_t length) const { memcpy(out, memory_ + address, length); }
+
+    void program(uint32_t address, const uint8_t *data, uint16_t length) {
+      for (uint16_t i = 0; i < length; i++) memory_[address + i] &= data[i];
+      // A record's first program call starts with its header
+      if (failKey_ != 0 && length >= 2 && data[0] == FS_RECORD_MAGIC && data[1] == failKey_) {
+        // Drop the lowest set bit of the last byte that has one ('R' does)
+        uint16_t i = length;
+        while (memory_[address + i - 1] == 0) i--;
+        memory_[address + i - 1] &= memory_[address + i - 1] - 1;
+        failKey_ = 0;
+      }
+    }
+
+    void eraseBlock(uint32_t address) { memset(memory_ + address, 0xFF, FLASH_STORE_BLOCK_SIZE); }
+
+  private:
+    uint8_t memory_[FLASH_STORE_BASE + (uint32_t)FLASH_STORE_BLOCKS * FLASH_STORE_BLOCK_SIZE];
+    uint8_t failKey_ = 0;
+};
+
+struct SourceData {
+  uint16_t length;
+  uint8_t value;
+};
+
+SourceData sources[STORE_KEY_COUNT] = {};
+
+uint16_t source(uint8_t key, uint8_t *out, uint16_t capacity) {
+  const SourceData &d = sources[key];
+  if (d.length == 0 || d.length > capacity) return 0;
+  memset(out, d.value, d.length);
+  return d.length;
+}
+
+RamFlash flash;
+FlashStore<RamFlash> store;
+
+} // namespace
+
+int main() {
+  store.begin(&flash, source);
+
+  char line[128];
+  unsigned lineNumber = 0;
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    lineNumber++;
+    char event[16] = "";
+    unsigned key = 0, length = 0, value = 0;
+    const int fields = sscanf(line, "%15s %u %u %u", event, &key, &length, &value);
+    if (fields <= 0) continue;
+    const bool keyed = fields >= 2 && key > 0 && key < STORE_KEY_COUNT;
+
+    if (strcmp(event, "save") == 0 && keyed && fields == 4 && length <= FLASH_STORE_MAX_RECORD) {
+      sources[key] = SourceData{(uint16_t)length, (uint8_t)value};
+      store.markDirty((uint8_t)key);
+    } else if (strcmp(event, "fail") == 0 && keyed) {
+      flash.failNext((uint8_t)key);
+    } else if (strcmp(event, "run") == 0) {
+      long budget = 100000;
+      while (budget-- > 0 && !store.idle()) store.poll();
+      if (!store.idle()) printf("stuck\n");
+    } else if (strcmp(event, "reboot") == 0) {
+      store = FlashStore<RamFlash>();
+      store.begin(&flash, source);
+    } else if (strcmp(event, "get") == 0 && keyed) {
+      static uint8_t out[FLASH_STORE_MAX_RECORD];
+      const uint16_t n = store.get((uint8_t)key, out, sizeof(out));
+      bool same = true;
+      for (uint16_t i = 1; i < n; i++) if (out[i] != out[0]) same = false;
+      printf("get %u %u %u %d\n", key, (unsigned)n, n > 0 ? (unsigned)out[0] : 0U, same ? 1 : 0);
+    } else if (strcmp(event, "status") == 0) {
+      char reply[96];
+      store.formatStatus(reply, sizeof(reply));
+      printf("status %s\n", reply);
+    } else {
+      printf("error %u bad event\n", lineNumber);
+    }
+  }
+  return 0;
+}
@@ -131,6 +131,12 @@ class MountConfig(BaseModel):
         le=65535,
         description="Mount controller TCP port (default: 9999 for OnStepX)",
     )
+    metrics_port: int = Field(
+        default=80,
+        ge=0,
+        le=65535,
+        description="Controller HTTP port serving /metrics (firmware METRICS_ENDPOINT); 0 disables",
+    )
 
     # Serial connection (alternative to TCP)
     serial_port: Optional[str] = Field(
@@ -39,6 +39,8 @@ __all__ = [
     "HealthChecker",
     "check_tcp_connection",
     "check_http_endpoint",
+    "fetch_metrics",
+    "parse_metrics",
 ]
 
 logger = get_logger(__name__)
@@ -186,6 +188,68 @@ async def check_http_endpoint(
         return False, 0.0, f"HTTP error: {e}"
 
 
+async def fetch_metrics(url: str, timeout: float = 5.0) -> tuple[dict | None, float, str]:
+    """Scrape a Prometheus text endpoint.
+
+    Args:
+        url: Full URL of the metrics page
+        timeout: Request timeout in seconds
+
+    Returns:
+        Tuple of (metrics or None, latency_ms, message); metrics as from
+        parse_metrics()
+    """
+    try:
+        import aiohttp
+
+        start = time.monotonic()
+        async with aiohttp.ClientSession() as session:
+            async with session.get(url, timeout=aiohttp.ClientTimeout(total=timeout)) as resp:
+                body = await resp.text()
+                latency = (time.monotonic() - start) * 1000
+                if resp.status != 200:
+                    return None, latency, f"HTTP {resp.status} from {url}"
+                return parse_metrics(body), latency, f"Scraped {url}"
+    except ImportError:
+        return None, 0.0, "aiohttp not installed"
+    except asyncio.TimeoutError:
+        return None, timeout * 1000, f"HTTP timeout to {url}"
+    except Exception as e:
+        return None, 0.0, f"HTTP error: {e}"
+
+
+def parse_metrics(text: str) -> dict[str, dict[tuple, float]]:
+    """Parse Prometheus text exposition format.
+
+    Args:
+        text: Page body
+
+    Returns:
+        Dict of metric name to {sorted label (key, value) tuple: value};
+        unlabelled samples are keyed by ().
+    """
+    metrics: dict[str, dict[tuple, float]] = {}
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        try:
+            if "{" in line:
+                name, rest = line.split("{", 1)
+                label_text, value = rest.rsplit("}", 1)
+                labels = tuple(sorted(
+                    (key.strip(), val.strip().strip('"'))
+                    for key, val in (pair.split("=", 1) for pair in label_text.split(",") if pair)
+                ))
+            else:
+                name, value = line.split(None, 1)
+                labels = ()
+            metrics.setdefault(name.strip(), {})[labels] = float(value.split()[0])
+        except ValueError:
+            logger.debug(f"Skipping malformed metrics line: {line}")
+    return metrics
+
+
 def check_socket_sync(host: str, port: int, timeout: float = 5.0) -> tuple[bool, str]:
     """Synchronous TCP connection check (for use in sync contexts).
 
@@ -233,6 +297,15 @@ async def check_mount_health(config: "NightwatchConfig") -> ServiceHealth:
             details={"type": "simulator"},
         )
 
+    # Controller metrics when the firmware serves them; the command port
+    # stays free for real commands
+    if mount_config.metrics_port:
+        url = f"http://{mount_config.host}:{mount_config.metrics_port}/metrics"
+        metrics, latency, message = await fetch_metrics(url, mount_config.timeout)
+        if metrics is not None:
+            return _mount_health_from_metrics(metrics, latency, mount_config)
+        logger.debug(f"Mount metrics unavailable ({message}), checking command port")
+
     # Check TCP connection to mount controller
     success, latency, message = await check_tcp_connection(
         mount_config.host,
@@ -265,6 +338,56 @@ async def check_mount_health(config: "NightwatchConfig") -> ServiceHealth:
         )
 
 
+# Main loop pass interval above which motion timing is suspect
+MOUNT_LOOP_MAX_INTERVAL_US = 5000
+
+
+def _mount_health_from_metrics(metrics: dict, latency: float, mount_config) -> ServiceHealth:
+    """Judge the mount from a /metrics scrape (firmware MetricsEndpoint.h)."""
+
+    def by_axis(name: str) -> dict[str, float]:
+        return {dict(labels).get("axis", ""): value for labels, value in metrics.get(name, {}).items()}
+
+    def by_label(name: str, label: str) -> dict[str, float]:
+        return {dict(labels).get(label, ""): value for labels, value in metrics.get(name, {}).items()}
+
+    overtemp = [axis for axis, value in by_axis("nightwatch_driver_overtemp").items() if value]
+    warning = [axis for axis, value in by_axis("nightwatch_driver_overtemp_warning").items() if value]
+    loop = by_label("nightwatch_loop_interval_us", "stat")
+    loop_max = loop.get("max", 0.0)
+
+    details = {
+        "host": mount_config.host,
+        "port": mount_config.metrics_port,
+        "type": mount_config.type,
+        "uptime_s": metrics.get("nightwatch_uptime_seconds", {}).get((), 0.0),
+        "loop_interval_mean_us": loop.get("mean", 0.0),
+        "loop_interval_max_us": loop_max,
+        "step_rate_hz": by_axis("nightwatch_axis_step_rate_hz"),
+        "sg_result": by_axis("nightwatch_driver_sg_result"),
+        "mcu_temperature_c": metrics.get("nightwatch_mcu_temperature_celsius", {}).get(()),
+        "cmd_sessions": metrics.get("nightwatch_cmd_sessions", {}).get((), 0.0),
+        "cmd_queue_depth": by_label("nightwatch_cmd_queue_depth", "class"),
+    }
+
+    if overtemp:
+        status, message = HealthStatus.UNHEALTHY, f"Driver overtemperature on axis {','.join(sorted(overtemp))}"
+    elif warning:
+        status, message = HealthStatus.DEGRADED, f"Driver overtemperature warning on axis {','.join(sorted(warning))}"
+    elif loop_max > MOUNT_LOOP_MAX_INTERVAL_US:
+        status, message = HealthStatus.DEGRADED, f"Controller loop stalled {loop_max / 1000:.1f}ms"
+    else:
+        status, message = HealthStatus.HEALTHY, "Controller metrics nominal"
+
+    return ServiceHealth(
+        name="mount",
+        status=status,
+        message=message,
+        latency_ms=latency,
+        details=details,
+    )
+
+
 async def check_weather_health(config: "NightwatchConfig") -> ServiceHealth:
     """Check weather station connectivity (Step 48).
 
@@ -0,0 +1,242 @@
+"""
+NIGHTWATCH Pointing Model Fitter
+TPOINT-style equatorial pointing model
+
+Fits the multi-term pointing model applied by the firmware
+(firmware/onstepx_config/nightwatch/PointingModel.h) from a batch of plate
+solves. Each observation pairs where the mount thought it was pointing (model
+disabled) with where the plate solver says it was. The model is linear in its
+coefficients, so a least-squares solve of the normal equations is enough.
+
+Terms (mount = sky + correction; h hour angle, d declination, phi latitude):
+    IH    dh = IH
+    ID    dd = ID
+    CH    dh = CH / cos d
+    NP    dh = NP tan d
+    MA    dh = -MA cos h tan d      dd = MA sin h
+    ME    dh = ME sin h tan d       dd = ME cos h
+    TF    dh = TF cos phi sin h / cos d
+          dd = TF (cos phi cos h sin d - sin phi cos d)
+    HHSH  dh = HHSH sin h           HHCH  dh = HHCH cos h
+    HDSD  dd = HDSD sin d           HDCD  dd = HDCD cos d
+
+ID, CH and NP change sign on the west pier side (after a meridian flip).
+"""
+
+import logging
+import math
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Sequence, Tuple
+
+from .plate_solver import SolveResult, SolveStatus
+
+logger = logging.getLogger("NIGHTWATCH.Astrometry")
+
+# Term order used by the firmware (PointingTerm in PointingModel.h)
+POINTING_TERMS = ("IH", "ID", "CH", "NP", "MA", "ME", "TF", "HHSH", "HHCH", "HDSD", "HDCD")
+DEFAULT_TERMS = ("IH", "ID", "CH", "NP", "MA", "ME", "TF")
+
+DEC_LIMIT_DEG = 89.5  # Must match POINTING_DEC_LIMIT
+
+
+@dataclass
+class PointingObservation:
+    """One plate-solved pointing: true sky position and mount-reported position."""
+    ha_deg: float  # Solved hour angle
+    dec_deg: float  # Solved declination
+    mount_ha_deg: float  # Mount hour angle, model disabled
+    mount_dec_deg: float  # Mount declination, model disabled
+    pier_west: bool = False  # Tube east of the pier looking west (after a flip)
+
+
+@dataclass
+class PointingModelFit:
+    """Fitted pointing model."""
+    terms: Dict[str, float]  # Coefficients in arcseconds
+    latitude_deg: float
+    rms_arcsec: float  # On-sky RMS of the residuals
+    residuals_arcsec: List[float] = field(default_factory=list)  # Per observation, on sky
+
+    @property
+    def observation_count(self) -> int:
+        return len(self.residuals_arcsec)
+
+
+def _wrap_degrees(angle: float) -> float:
+    """Wrap to [-180, 180)."""
+    return (angle + 180.0) % 360.0 - 180.0
+
+
+def observation_from_solve(
+    result: SolveResult,
+    mount_ra_deg: float,
+    mount_dec_deg: float,
+    lst_deg: float,
+    pier_west: bool = False,
+) -> Optional[PointingObservation]:
+    """
+    Build an observation from a plate solve and the mount position at exposure.
+
+    Args:
+        result: Successful plate solve (J2000 of date is assumed to match
+            the mount's coordinate frame; MOUNT_COORDS OBSERVED_PLACE)
+        mount_ra_deg: Mount-reported RA with the pointing model disabled
+        mount_dec_deg: Mount-reported Dec with the pointing model disabled
+        lst_deg: Local sidereal time at mid-exposure, degrees
+        pier_west: Pier side at exposure
+
+    Returns:
+        PointingObservation, or None if the solve failed
+    """
+    if result.status != SolveStatus.SUCCESS or result.ra_deg is None or result.dec_deg is None:
+        return None
+    return PointingObservation(
+        ha_deg=_wrap_degrees(lst_deg - result.ra_deg),
+        dec_deg=result.dec_deg,
+        mount_ha_deg=_wrap_degrees(lst_deg - mount_ra_deg),
+        mount_dec_deg=mount_dec_deg,
+        pier_west=pier_west,
+    )
+
+
+def term_partials(
+    term: str, ha_deg: float, dec_deg: float, latitude_deg: float, pier_west: bool
+) -> Tuple[float, float]:
+    """Contribution of a unit coefficient of term to (dh, dd)."""
+    side = -1.0 if pier_west else 1.0
+    h = math.radians(ha_deg)
+    d = math.radians(max(-DEC_LIMIT_DEG, min(DEC_LIMIT_DEG, dec_deg)))
+    phi = math.radians(latitude_deg)
+    sh, ch, sd, cd = math.sin(h), math.cos(h), math.sin(d), math.cos(d)
+    td = sd / cd
+    if term == "IH":
+        return 1.0, 0.0
+    if term == "ID":
+        return 0.0, side
+    if term == "CH":
+        return side / cd, 0.0
+    if term == "NP":
+        return side * td, 0.0
+    if term == "MA":
+        return -ch * td, sh
+    if term == "ME":
+        return sh * td, ch
+    if term == "TF":
+        return math.cos(phi) * sh / cd, math.cos(phi) * ch * sd - math.sin(phi) * cd
+    if term == "HHSH":
+        return sh, 0.0
+    if term == "HHCH":
+        return ch, 0.0
+    if term == "HDSD":
+        return 0.0, sd
+    if term == "HDCD":
+        return 0.0, cd
+    raise ValueError(f"Unknown pointing term: {term}")
+
+
+def correction(
+    terms: Dict[str, float], ha_deg: float, dec_deg: float, latitude_deg: float,
+    pier_west: bool = False,
+) -> Tuple[float, float]:
+    """
+    Model correction (mount minus sky) at a sky position.
+
+    Args:
+        terms: Coefficients in arcseconds
+
+    Returns:
+        (dh, dd) in arcseconds
+    """
+    dh = dd = 0.0
+    for name, value in terms.items():
+        ph, pd = term_partials(name, ha_deg, dec_deg, latitude_deg, pier_west)
+        dh += value * ph
+        dd += value * pd
+    return dh, dd
+
+
+def _solve(matrix: List[List[float]], vector: List[float]) -> List[float]:
+    """Solve a small dense system by Gaussian elimination with partial pivoting."""
+    n = len(vector)
+    a = [row[:] + [vector[i]] for i, row in enumerate(matrix)]
+    scale = max(abs(a[i][i]) for i in range(n)) or 1.0
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(a[r][col]))
+        if abs(a[pivot][col]) < 1e-10 * scale:
+            raise ValueError("Pointing model is degenerate for these observations; "
+                             "spread them over the sky or drop terms")
+        a[col], a[pivot] = a[pivot], a[col]
+        for r in range(col + 1, n):
+            f = a[r][col] / a[col][col]
+            for c in range(col, n + 1):
+                a[r][c] -= f * a[col][c]
+    x = [0.0] * n
+    for r in range(n - 1, -1, -1):
+        x[r] = (a[r][n] - sum(a[r][c] * x[c] for c in range(r + 1, n))) / a[r][r]
+    return x
+
+
+def fit_pointing_model(
+    observations: Sequence[PointingObservation],
+    latitude_deg: float,
+    terms: Sequence[str] = DEFAULT_TERMS,
+) -> PointingModelFit:
+    """
+    Least-squares fit of the pointing model.
+
+    Hour-angle residuals are weighted by cos d so every equation is an
+    on-sky arcsecond.
+
+    Args:
+        observations: Plate-solved pointings spread over the sky
+        latitude_deg: Site latitude
+        terms: Terms to fit (subset of POINTING_TERMS)
+
+    Returns:
+        PointingModelFit with coefficients in arcseconds
+
+    Raises:
+        ValueError: Unknown term, too few observations, or a degenerate set
+    """
+    for name in terms:
+        if name not in POINTING_TERMS:
+            raise ValueError(f"Unknown pointing term: {name}")
+    if 2 * len(observations) <= len(terms):
+        raise ValueError(
+            f"{len(terms)} terms need more than {len(terms) // 2} observations, got {len(observations)}"
+        )
+
+    n = len(terms)
+    normal = [[0.0] * n for _ in range(n)]
+    rhs = [0.0] * n
+    rows = []
+    for obs in observations:
+        cos_dec = math.cos(math.radians(obs.dec_deg))
+        dh = _wrap_degrees(obs.mount_ha_deg - obs.ha_deg) * 3600.0
+        dd = (obs.mount_dec_deg - obs.dec_deg) * 3600.0
+        partials = [term_partials(t, obs.ha_deg, obs.dec_deg, latitude_deg, obs.pier_west) for t in terms]
+        rows.append(([p[0] * cos_dec for p in partials], dh * cos_dec))
+        rows.append(([p[1] for p in partials], dd))
+    for coeffs, value in rows:
+        for i in range(n):
+            rhs[i] += coeffs[i] * value
+            for j in range(n):
+                normal[i][j] += coeffs[i] * coeffs[j]
+
+    solution = _solve(normal, rhs)
+    fitted = dict(zip(terms, solution))
+
+    residuals = []
+    for k in range(0, len(rows), 2):
+        (ch, vh), (cd, vd) = rows[k], rows[k + 1]
+        rh = vh - sum(c * x for c, x in zip(ch, solution))
+        rd = vd - sum(c * x for c, x in zip(cd, solution))
+        residuals.append(math.hypot(rh, rd))
+    rms = math.sqrt(sum(r * r for r in residuals) / len(residuals))
+
+    logger.info(
+        f"Pointing model fitted from {len(observations)} solves: RMS {rms:.1f}\" ("
+        + ", ".join(f"{k}={v:+.1f}\"" for k, v in fitted.items()) + ")"
+    )
+    return PointingModelFit(terms=fitted, latitude_deg=latitude_deg, rms_arcsec=rms,
+                            residuals_arcsec=residuals)
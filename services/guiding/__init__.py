@@ -6,5 +6,6 @@ POS Panel v2.0: Craig Stark recommendations
 """
 
 from .phd2_client import PHD2Client, GuideStats, CalibrationData
+from .guide_channel import GuideChannelClient, GuideKind
 
-__all__ = ["PHD2Client", "GuideStats", "CalibrationData"]
+__all__ = ["PHD2Client", "GuideStats", "CalibrationData", "GuideChannelClient", "GuideKind"]
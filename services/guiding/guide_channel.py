@@ -0,0 +1,218 @@
+"""
+NIGHTWATCH Guide Channel Client
+Low-latency guide pulses to the mount controller
+
+Sends guide corrections to the firmware's dedicated guide input
+(firmware/onstepx_config/nightwatch/GuideChannel.h) as binary FRAME_GUIDE
+datagrams instead of LX200 :Mg commands on the shared command socket. Each
+packet carries a sequence number and the host send time, so the controller
+drops reordered and late packets; anything accepted takes effect on its next
+DDS tick (20 µs).
+
+Example:
+    >>> channel = GuideChannelClient(host="192.168.1.100")
+    >>> channel.open()
+    >>> channel.guide("W", 120.0)        # 120 ms west at GUIDE_CHANNEL_RATE
+    >>> channel.pulse(ra_ms=-35.5, dec_ms=12.0)
+"""
+
+import logging
+import socket
+import struct
+import time
+from enum import IntEnum
+from typing import Optional
+
+import serial
+
+from services.mount_control.nightwatch_protocol import FrameType, encode_frame
+
+logger = logging.getLogger("NIGHTWATCH.Guiding")
+
+GUIDE_PAYLOAD = struct.Struct("<IQBiiI")
+
+_INT32_MAX = 0x7FFFFFFF
+
+
+class GuideKind(IntEnum):
+    """Guide packet kinds (GuideKind in GuideChannel.h)."""
+    PULSE = 1
+    RATE = 2
+    STOP = 3
+
+
+def build_guide_payload(
+    sequence: int,
+    host_time_us: int,
+    kind: GuideKind,
+    axis1: int,
+    axis2: int,
+    duration_us: int = 0,
+) -> bytes:
+    """
+    Pack a FRAME_GUIDE payload.
+
+    Args:
+        sequence: Wrapping u32; 0 tells the controller the stream restarted
+        host_time_us: Host send time (any monotonic base), 0 to skip the lateness check
+        kind: PULSE (axis values in µs) or RATE (axis values in mas/s)
+        axis1: Signed RA value, positive west
+        axis2: Signed Dec value, positive north
+        duration_us: RATE only; 0 holds until the controller's hold timeout
+    """
+    for value in (axis1, axis2):
+        if abs(value) > _INT32_MAX:
+            raise ValueError(f"Guide value out of range: {value}")
+    return GUIDE_PAYLOAD.pack(
+        sequence & 0xFFFFFFFF, host_time_us, int(kind), axis1, axis2, duration_us
+    )
+
+
+def parse_guide_payload(payload: bytes) -> tuple:
+    """Unpack a FRAME_GUIDE payload (sequence, host_time_us, kind, axis1, axis2, duration_us)."""
+    seq, host, kind, a1, a2, duration = GUIDE_PAYLOAD.unpack(payload)
+    return seq, host, GuideKind(kind), a1, a2, duration
+
+
+class GuideChannelClient:
+    """
+    Sender for the controller's guide channel (GUIDE_CHANNEL in Config.h).
+
+    Uses UDP to GUIDE_CHANNEL_PORT by default, or SERIAL_B when serial_port
+    is given (GUIDE_CHANNEL_SERIAL). Sends are fire-and-forget; the
+    controller's counters are available through
+    OnStepXExtended.get_guide_channel_stats().
+    """
+
+    DIRECTIONS = {"N": (0, 1), "S": (0, -1), "E": (-1, 0), "W": (1, 0)}
+
+    def __init__(
+        self,
+        host: str = "192.168.1.100",
+        port: int = 9997,
+        serial_port: Optional[str] = None,
+        baudrate: int = 57600,
+    ):
+        """
+        Initialize guide channel client.
+
+        Args:
+            host: Controller IP address
+            port: GUIDE_CHANNEL_PORT on the controller
+            serial_port: Use this serial device (SERIAL_B) instead of UDP
+            baudrate: SERIAL_B_BAUD_DEFAULT
+        """
+        self.host = host
+        self.port = port
+        self.serial_port = serial_port
+        self.baudrate = baudrate
+
+        self._socket: Optional[socket.socket] = None
+        self._serial: Optional[serial.Serial] = None
+        self._sequence = 0
+        self.packets_sent = 0
+
+    def open(self) -> bool:
+        """Open the UDP socket or serial port; the next packet restarts the stream."""
+        try:
+            if self.serial_port:
+                self._serial = serial.Serial(port=self.serial_port, baudrate=self.baudrate, timeout=0)
+            else:
+                self._socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+                self._socket.setblocking(False)
+                self._socket.connect((self.host, self.port))
+        except (OSError, serial.SerialException) as e:
+            logger.error(f"Guide channel open failed: {e}")
+            self.close()
+            return False
+
+        self._sequence = 0
+        logger.info(f"Guide channel open ({self.serial_port or f'{self.host}:{self.port}'})")
+        return True
+
+    def close(self):
+        """Close the transport."""
+        if self._socket:
+            self._socket.close()
+            self._socket = None
+        if self._serial:
+            self._serial.close()
+            self._serial = None
+
+    @property
+    def is_open(self) -> bool:
+        return self._socket is not None or self._serial is not None
+
+    def _send(self, kind: GuideKind, axis1: int, axis2: int, duration_us: int = 0) -> bool:
+        if not self.is_open:
+            return False
+
+        host_time_us = time.monotonic_ns() // 1000
+        frame = encode_frame(
+            FrameType.GUIDE,
+            build_guide_payload(self._sequence, host_time_us, kind, axis1, axis2, duration_us),
+        )
+        try:
+            if self._socket:
+                self._socket.send(frame)
+            else:
+                self._serial.write(frame)
+        except (OSError, serial.SerialException) as e:
+            logger.warning(f"Guide packet send failed: {e}")
+            return False
+
+        # Skip 0 on wrap; it marks a restarted stream
+        self._sequence = (self._sequence + 1) & 0xFFFFFFFF or 1
+        self.packets_sent += 1
+        return True
+
+    def pulse(self, ra_ms: float = 0.0, dec_ms: float = 0.0) -> bool:
+        """
+        Send one guide pulse on both axes at the controller's guide rate.
+        An axis left at 0 keeps any pulse still running on it, as with :Mg.
+
+        Args:
+            ra_ms: Signed RA pulse in milliseconds, positive west
+            dec_ms: Signed Dec pulse in milliseconds, positive north
+
+        Returns:
+            True if the packet was sent
+        """
+        return self._send(GuideKind.PULSE, round(ra_ms * 1000), round(dec_ms * 1000))
+
+    def guide(self, direction: str, duration_ms: float) -> bool:
+        """
+        Send a PHD2-style single-direction pulse.
+
+        Args:
+            direction: "N", "S", "E" or "W"
+            duration_ms: Pulse length in milliseconds
+        """
+        try:
+            ra, dec = self.DIRECTIONS[direction.upper()]
+        except KeyError:
+            raise ValueError(f"Unknown guide direction: {direction}")
+        return self.pulse(ra_ms=ra * duration_ms, dec_ms=dec * duration_ms)
+
+    def set_rate(self, ra_arcsec_s: float, dec_arcsec_s: float, duration_s: float = 0.0) -> bool:
+        """
+        Apply a guide rate offset.
+
+        Args:
+            ra_arcsec_s: RA offset in arcsec/second, positive west
+            dec_arcsec_s: Dec offset in arcsec/second, positive north
+            duration_s: How long to apply it; 0 holds while packets keep arriving
+
+        Returns:
+            True if the packet was sent
+        """
+        return self._send(
+            GuideKind.RATE,
+            round(ra_arcsec_s * 1000),
+            round(dec_arcsec_s * 1000),
+            round(duration_s * 1_000_000),
+        )
+
+    def stop(self) -> bool:
+        """Cancel any running pulse or rate offset."""
+        return self._send(GuideKind.STOP, 0, 0)
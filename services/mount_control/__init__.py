@@ -11,16 +11,39 @@ from .lx200 import (
     PierSide,
     TrackingRate,
     MountStatus,
+    SessionPriority,
     ra_to_hours,
     dec_to_degrees,
     hours_to_ra,
     degrees_to_dec,
 )
 
+from .nightwatch_protocol import (
+    FrameType,
+    FrameError,
+    StatusFrame,
+    PECModel,
+    DriverSnapshot,
+    TraceRecord,
+    QueuedTarget,
+    TargetEvent,
+    SplineKnot,
+    encode_frame,
+    decode_frame,
+)
+
+from .telemetry import (
+    TelemetrySample,
+    TelemetrySubscriber,
+)
+
 from .onstepx_extended import (
     OnStepXExtended,
     PECStatus,
     DriverStatus,
+    EncoderLoopStatus,
+    StallGuardCalibration,
+    ClockMapping,
     create_onstepx_extended,
 )
 
@@ -31,13 +54,32 @@ __all__ = [
     "PierSide",
     "TrackingRate",
     "MountStatus",
+    "SessionPriority",
     "ra_to_hours",
     "dec_to_degrees",
     "hours_to_ra",
     "degrees_to_dec",
+    # NIGHTWATCH binary protocol
+    "FrameType",
+    "FrameError",
+    "StatusFrame",
+    "PECModel",
+    "DriverSnapshot",
+    "TraceRecord",
+    "QueuedTarget",
+    "TargetEvent",
+    "SplineKnot",
+    "encode_frame",
+    "decode_frame",
+    # Telemetry push stream
+    "TelemetrySample",
+    "TelemetrySubscriber",
     # OnStepX extended
     "OnStepXExtended",
     "PECStatus",
     "DriverStatus",
+    "EncoderLoopStatus",
+    "StallGuardCalibration",
+    "ClockMapping",
     "create_onstepx_extended",
 ]
@@ -19,8 +19,17 @@ from dataclasses import dataclass
 from enum import Enum
 from typing import Optional, Tuple, TYPE_CHECKING
 
+from .nightwatch_protocol import (
+    FRAME_HEADER_SIZE,
+    FrameError,
+    StatusFrame,
+    frame_size_from_header,
+    parse_status_frame,
+)
+
 if TYPE_CHECKING:
     from services.encoder.encoder_bridge import EncoderBridge
+    from .telemetry import TelemetrySubscriber
 
 logger = logging.getLogger(__name__)
 
@@ -36,6 +45,13 @@ class PierSide(Enum):
     UNKNOWN = "?"
 
 
+class SessionPriority(Enum):
+    """Command server priority class (NIGHTWATCH firmware CMD_SERVER)."""
+    SAFETY = 0   # Safety monitor; stop/park jump every queue
+    CONTROL = 1  # Firmware default for a new session
+    QUERY = 2    # Pollers; served only when nothing else is queued
+
+
 class TrackingRate(Enum):
     SIDEREAL = "TQ"
     LUNAR = "TL"
@@ -58,6 +74,8 @@ class MountStatus:
     pier_side: PierSide
     altitude: Optional[float] = None
     azimuth: Optional[float] = None
+    axis1_driver_status: Optional[int] = None  # TMC5160 DRV_STATUS (status frame only)
+    axis2_driver_status: Optional[int] = None
 
 
 class LX200Client:
@@ -67,11 +85,45 @@ class LX200Client:
     Supports both serial (USB) and TCP/IP connections to the controller.
     Optionally integrates with EncoderBridge for high-resolution position
     feedback and periodic error correction.
+
+    With use_status_frame=True, get_status() issues a single :NWS# query
+    (NIGHTWATCH firmware with STATUS_FRAME_BINARY ON) and falls back to the
+    individual LX200 queries if the controller does not answer with a frame.
+
+    With a TelemetrySubscriber attached, get_corrected_position() reads the
+    latest pushed sample instead of querying the mount.
+
+    NIGHTWATCH firmware with CMD_SERVER ON accepts several TCP sessions, so
+    each service should hold its own client. session_priority is claimed
+    with :NWCP# right after connecting; stock firmware ignores it.
+
+    On serial, serial_upgrade_baud negotiates a faster SERIAL_A rate with
+    :NWBR#/:NWBK# after opening at baudrate and switches get_status() to the
+    binary status frame. The controller drops back to its default rate after
+    SERIAL_BAUD_IDLE_S of silence; the client then negotiates again before
+    its next command, and also after any command that fails on the
+    upgraded link.
     """
 
     TERMINATOR = "#"
     COMMAND_TIMEOUT = 5.0
 
+    # NIGHTWATCH firmware extension commands
+    CMD_STATUS_FRAME = "NWS"
+    CMD_SESSION_PRIORITY = "NWCP"
+    CMD_SERIAL_BAUD = "NWBR"
+    CMD_SERIAL_BAUD_CONFIRM = "NWBK"
+    SERIAL_HANDSHAKE_TIMEOUT = 0.25
+    # Draining a failed binary reply on TCP
+    FLUSH_TIMEOUT = 0.05
+    FLUSH_MAX_READS = 64
+    # Firmware SERIAL_BAUD_CONFIRM_MS / SERIAL_BAUD_IDLE_MS
+    SERIAL_BAUD_CONFIRM_S = 0.5
+    SERIAL_BAUD_IDLE_S = 5.0
+    # Renegotiate this long before the idle revert is due, and wait this
+    # long past the confirm window before trusting an unconfirmed revert
+    SERIAL_BAUD_MARGIN = 0.5
+
     def __init__(
         self,
         connection_type: ConnectionType = ConnectionType.TCP,
@@ -80,12 +132,22 @@ class LX200Client:
         serial_port: str = "/dev/ttyUSB0",
         baudrate: int = 9600,
         encoder_bridge: Optional["EncoderBridge"] = None,
+        use_status_frame: bool = False,
+        telemetry: Optional["TelemetrySubscriber"] = None,
+        session_priority: Optional[SessionPriority] = None,
+        serial_upgrade_baud: Optional[int] = None,
     ):
         self.connection_type = connection_type
         self.host = host
         self.port = port
         self.serial_port = serial_port
         self.baudrate = baudrate
+        self.use_status_frame = use_status_frame
+        self.session_priority = session_priority
+        self.serial_upgrade_baud = serial_upgrade_baud
+
+        # Optional push telemetry (TELEMETRY_STREAM firmware option)
+        self.telemetry = telemetry
 
         # Optional encoder feedback for position correction
         self.encoder = encoder_bridge
@@ -94,21 +156,32 @@ class LX200Client:
         self._connection = None
         self._lock = threading.Lock()
         self._connected = False
+        self._baud_upgraded = False
+        self._serial_activity = 0.0  # monotonic time of the last serial exchange
+        # :NWS# answered on this connection / first try got no frame
+        self._status_frame_seen = False
+        self._status_frame_unsupported = False
 
     def connect(self) -> bool:
         """Establish connection to mount controller."""
         with self._lock:
+            self._status_frame_seen = False
+            self._status_frame_unsupported = False
             try:
                 if self.connection_type == ConnectionType.TCP:
                     self._connection = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
                     self._connection.settimeout(self.COMMAND_TIMEOUT)
                     self._connection.connect((self.host, self.port))
+                    if self.session_priority is not None:
+                        self._claim_session_priority()
                 else:
                     self._connection = serial.Serial(
                         port=self.serial_port,
                         baudrate=self.baudrate,
                         timeout=self.COMMAND_TIMEOUT
                     )
+                    if self.serial_upgrade_baud and self.serial_upgrade_baud != self.baudrate:
+                        self._negotiate_baud()
 
                 self._connected = True
                 return True
@@ -117,6 +190,97 @@ class LX200Client:
                 self._connected = False
                 return False
 
+    def claim_session_priority(self, priority: SessionPriority) -> bool:
+        """
+        Move this client's TCP session to a command server class.
+
+        The class is kept and claimed again on every reconnect. Returns
+        True if the controller accepted it; False on serial, when not
+        connected, or on stock firmware.
+        """
+        with self._lock:
+            self.session_priority = priority
+            if not self._connected or self.connection_type != ConnectionType.TCP:
+                return False
+            try:
+                return self._claim_session_priority()
+            except Exception as e:
+                logger.warning(f"Session priority claim failed: {e}")
+                return False
+
+    def _claim_session_priority(self) -> bool:
+        """Set this session's command server class; caller holds the lock."""
+        command = f":{self.CMD_SESSION_PRIORITY}{self.session_priority.value}{self.TERMINATOR}"
+        self._connection.sendall(command.encode('ascii'))
+        response = self._receive_tcp()
+        if response != "1":
+            logger.warning(f"Controller did not accept session priority "
+                           f"{self.session_priority.name}: {response!r}")
+            return False
+        return True
+
+    def _serial_exchange(self, command: str) -> str:
+        """One short-timeout command on the open serial port; caller holds the lock."""
+        self._connection.reset_input_buffer()
+        self._connection.write(f":{command}{self.TERMINATOR}".encode('ascii'))
+        return self._connection.read_until(b'#').decode('ascii', errors='replace').rstrip('#')
+
+    def _negotiate_baud(self) -> bool:
+        """
+        Move SERIAL_A to serial_upgrade_baud; caller holds the lock.
+
+        Falls back to probing the target rate directly in case the controller
+        is still there from a previous session. On failure the port is left
+        at baudrate.
+        """
+        target = self.serial_upgrade_baud
+        self._connection.baudrate = self.baudrate
+        self._baud_upgraded = False
+        self._connection.timeout = self.SERIAL_HANDSHAKE_TIMEOUT
+        try:
+            accepted = self._serial_exchange(f"{self.CMD_SERIAL_BAUD}{target}") == "1"
+            switched_at = time.monotonic()
+            self._connection.baudrate = target
+            # Sent at once, so it lands well inside SERIAL_BAUD_CONFIRM_MS
+            if self._serial_exchange(self.CMD_SERIAL_BAUD_CONFIRM) == "1":
+                self.use_status_frame = True
+                self._baud_upgraded = True
+                self._serial_activity = time.monotonic()
+                logger.info(f"Serial link upgraded to {target} baud")
+                return True
+            self._connection.baudrate = self.baudrate
+            if accepted:
+                # Unconfirmed; wait clearly past the controller's revert
+                wait = self.SERIAL_BAUD_CONFIRM_S + self.SERIAL_BAUD_MARGIN - (time.monotonic() - switched_at)
+                time.sleep(max(wait, 0.0))
+            logger.warning(f"Serial baud upgrade to {target} failed; staying at {self.baudrate}")
+            return False
+        finally:
+            self._connection.timeout = self.COMMAND_TIMEOUT
+
+    def _serial_before_command(self):
+        """Renegotiate an upgraded link the controller has reverted for idling; caller holds the lock."""
+        if not self._baud_upgraded:
+            return
+        if time.monotonic() - self._serial_activity > self.SERIAL_BAUD_IDLE_S - self.SERIAL_BAUD_MARGIN:
+            logger.info("Serial link idle past the controller's revert, renegotiating")
+            self._negotiate_baud()
+
+    def _serial_after_command(self, ok: bool):
+        """Track activity; a failure on an upgraded link renegotiates. Caller holds the lock."""
+        if ok:
+            self._serial_activity = time.monotonic()
+        elif self._baud_upgraded:
+            logger.info(f"Command failed at {self._connection.baudrate} baud, renegotiating")
+            self._negotiate_baud()
+
+    @property
+    def serial_baudrate(self) -> Optional[int]:
+        """Current serial line rate, or None on TCP / when disconnected."""
+        if self.connection_type != ConnectionType.SERIAL or not self._connected:
+            return None
+        return self._connection.baudrate
+
     def disconnect(self):
         """Close connection to mount controller."""
         with self._lock:
@@ -139,12 +303,16 @@ class LX200Client:
                     self._connection.sendall(full_cmd.encode('ascii'))
                     response = self._receive_tcp()
                 else:
+                    self._serial_before_command()
                     self._connection.write(full_cmd.encode('ascii'))
                     response = self._receive_serial()
+                    self._serial_after_command(bool(response))
 
                 return response
             except Exception as e:
                 print(f"Command failed: {e}")
+                if self.connection_type == ConnectionType.SERIAL:
+                    self._serial_after_command(False)
                 return None
 
     def _receive_tcp(self) -> str:
@@ -164,6 +332,100 @@ class LX200Client:
         response = self._connection.read_until(b'#')
         return response.decode('ascii').rstrip('#')
 
+    def _send_binary_command(self, command: str) -> Optional[bytes]:
+        """Send a text command whose reply is a NIGHTWATCH binary frame."""
+        if not self._connected:
+            return None
+
+        with self._lock:
+            try:
+                full_cmd = f":{command}{self.TERMINATOR}"
+
+                if self.connection_type == ConnectionType.TCP:
+                    self._connection.sendall(full_cmd.encode('ascii'))
+                    return self._receive_frame_tcp()
+                else:
+                    self._serial_before_command()
+                    self._connection.write(full_cmd.encode('ascii'))
+                    frame = self._receive_frame_serial()
+                    self._serial_after_command(True)
+                    return frame
+            except (FrameError, OSError, serial.SerialException) as e:
+                logger.warning(f"Binary command {command} failed: {e}")
+                self._flush_input()
+                if self.connection_type == ConnectionType.SERIAL:
+                    self._serial_after_command(False)
+                return None
+
+    def _flush_input(self):
+        """
+        Drop whatever is left of a failed reply; caller holds the lock.
+
+        Otherwise the tail of a short or mis-sized frame is read as the
+        reply to the next command.
+        """
+        try:
+            if self.connection_type == ConnectionType.SERIAL:
+                self._connection.reset_input_buffer()
+                return
+            self._connection.settimeout(self.FLUSH_TIMEOUT)
+            try:
+                for _ in range(self.FLUSH_MAX_READS):
+                    if not self._connection.recv(4096):
+                        break
+            except OSError:
+                pass  # drained
+            finally:
+                self._connection.settimeout(self.COMMAND_TIMEOUT)
+        except (OSError, serial.SerialException) as e:
+            logger.debug(f"Input flush failed: {e}")
+
+    def _send_frame_command(self, command: str, frame: bytes) -> Optional[str]:
+        """Send a text command followed by one binary frame (bulk upload)."""
+        if not self._connected:
+            return None
+
+        with self._lock:
+            try:
+                data = f":{command}{self.TERMINATOR}".encode('ascii') + frame
+
+                if self.connection_type == ConnectionType.TCP:
+                    self._connection.sendall(data)
+                    return self._receive_tcp()
+                else:
+                    self._serial_before_command()
+                    self._connection.write(data)
+                    response = self._receive_serial()
+                    self._serial_after_command(bool(response))
+                    return response
+            except (OSError, serial.SerialException) as e:
+                logger.warning(f"Frame upload {command} failed: {e}")
+                if self.connection_type == ConnectionType.SERIAL:
+                    self._serial_after_command(False)
+                return None
+
+    def _receive_frame_tcp(self) -> bytes:
+        """Receive exactly one length-prefixed frame over TCP."""
+        data = b""
+        needed = FRAME_HEADER_SIZE
+        while len(data) < needed:
+            chunk = self._connection.recv(needed - len(data))
+            if not chunk:
+                raise FrameError("Connection closed mid-frame")
+            data += chunk
+            if needed == FRAME_HEADER_SIZE and len(data) >= FRAME_HEADER_SIZE:
+                needed = frame_size_from_header(data)
+        return data[:needed]
+
+    def _receive_frame_serial(self) -> bytes:
+        """Receive exactly one length-prefixed frame over serial."""
+        header = self._connection.read(FRAME_HEADER_SIZE)
+        size = frame_size_from_header(header)
+        rest = self._connection.read(size - FRAME_HEADER_SIZE)
+        if len(rest) != size - FRAME_HEADER_SIZE:
+            raise FrameError("Serial timeout mid-frame")
+        return header + rest
+
     # =========================================================================
     # POSITION QUERIES
     # =========================================================================
@@ -193,8 +455,43 @@ class LX200Client:
             return PierSide.WEST
         return PierSide.UNKNOWN
 
+    def get_status_frame(self) -> Optional[StatusFrame]:
+        """
+        Get the batched binary status frame (:NWS#) in one round trip.
+
+        Returns:
+            StatusFrame, or None if the controller did not return a valid frame
+        """
+        frame = self._send_binary_command(self.CMD_STATUS_FRAME)
+        if not frame:
+            return None
+        try:
+            return parse_status_frame(frame)
+        except FrameError as e:
+            logger.warning(f"Invalid status frame: {e}")
+            with self._lock:
+                self._flush_input()
+            return None
+
     def get_status(self) -> Optional[MountStatus]:
-        """Get comprehensive mount status."""
+        """
+        Get comprehensive mount status.
+
+        If the first :NWS# on a connection gets no frame (stock firmware),
+        later calls go straight to the LX200 queries until the next
+        connect() instead of waiting out COMMAND_TIMEOUT every time.
+        """
+        if self.use_status_frame and not self._status_frame_unsupported:
+            frame = self.get_status_frame()
+            if frame:
+                self._status_frame_seen = True
+                return self._status_from_frame(frame)
+            if not self._status_frame_seen:
+                self._status_frame_unsupported = True
+                logger.info("Controller did not answer :NWS#; using LX200 queries on this connection")
+            else:
+                logger.debug("Status frame unavailable, falling back to LX200 queries")
+
         ra = self.get_ra()
         dec = self.get_dec()
 
@@ -230,6 +527,54 @@ class LX200Client:
             pier_side=self.get_pier_side()
         )
 
+    def _status_from_frame(self, frame: StatusFrame) -> MountStatus:
+        """Convert a binary status frame to MountStatus."""
+        ra_h, ra_m, ra_s = self._degrees_to_ra_components(frame.ra_degrees)
+        dec_d, dec_m, dec_s = self._degrees_to_dec_components(frame.dec_degrees)
+        pier_side = {"E": PierSide.EAST, "W": PierSide.WEST}.get(frame.pier_side, PierSide.UNKNOWN)
+
+        return MountStatus(
+            ra_hours=ra_h,
+            ra_minutes=ra_m,
+            ra_seconds=ra_s,
+            dec_degrees=dec_d,
+            dec_minutes=dec_m,
+            dec_seconds=dec_s,
+            is_tracking=frame.is_tracking,
+            is_slewing=frame.is_slewing,
+            is_parked=frame.is_parked,
+            pier_side=pier_side,
+            altitude=frame.altitude,
+            azimuth=frame.azimuth,
+            axis1_driver_status=frame.axis1_driver_status,
+            axis2_driver_status=frame.axis2_driver_status,
+        )
+
+    def _status_from_telemetry(self) -> Optional[MountStatus]:
+        """MountStatus from the latest fresh telemetry sample, if any."""
+        if not self.telemetry:
+            return None
+        sample = self.telemetry.get_fresh_sample()
+        if not sample:
+            return None
+
+        ra_h, ra_m, ra_s = self._degrees_to_ra_components(sample.ra_degrees)
+        dec_d, dec_m, dec_s = self._degrees_to_dec_components(sample.dec_degrees)
+        pier_side = {"E": PierSide.EAST, "W": PierSide.WEST}.get(sample.pier_side, PierSide.UNKNOWN)
+
+        return MountStatus(
+            ra_hours=ra_h,
+            ra_minutes=ra_m,
+            ra_seconds=ra_s,
+            dec_degrees=dec_d,
+            dec_minutes=dec_m,
+            dec_seconds=dec_s,
+            is_tracking=sample.is_tracking,
+            is_slewing=sample.is_slewing,
+            is_parked=sample.is_parked,
+            pier_side=pier_side,
+        )
+
     async def get_corrected_position(self) -> Optional[MountStatus]:
         """
         Get position with encoder correction applied.
@@ -237,11 +582,13 @@ class LX200Client:
         Uses the EncoderBridge to provide high-resolution absolute position
         feedback, correcting for harmonic drive periodic error and backlash.
         If no encoder is configured, returns the standard mount position.
+        The mount position comes from the telemetry stream when a fresh
+        sample is available, avoiding any LX200 round trip.
 
         Returns:
             MountStatus with encoder-corrected coordinates, or None if read failed
         """
-        mount_pos = self.get_status()
+        mount_pos = self._status_from_telemetry() or self.get_status()
         if not mount_pos or not self.encoder:
             return mount_pos
 
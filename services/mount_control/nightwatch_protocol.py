@@ -0,0 +1,615 @@
+"""
+NIGHTWATCH Binary Protocol
+
+Frame encoding and decoding for the NIGHTWATCH OnStepX firmware extensions
+(firmware/onstepx_config/nightwatch/Frame.h). Binary frames carry replies and
+uploads that would otherwise take many LX200 text round trips.
+
+Frame layout (little-endian):
+    2 bytes  sync "NW"
+    1 byte   frame type
+    2 bytes  payload length
+    n bytes  payload
+    2 bytes  CRC-16/CCITT-FALSE over type, length and payload
+"""
+
+import struct
+from dataclasses import dataclass, field
+from enum import IntEnum
+from typing import Dict, List, Optional, Tuple
+
+FRAME_SYNC = b"NW"
+FRAME_HEADER_SIZE = 5
+FRAME_TRAILER_SIZE = 2
+FRAME_OVERHEAD = FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE
+
+MAS_PER_DEGREE = 3_600_000.0
+
+
+class FrameType(IntEnum):
+    """Binary frame types (must match FrameType in Frame.h)."""
+    STATUS = 0x01
+    TELEMETRY = 0x02
+    PEC_MODEL = 0x03
+    DRIVER_STATUS = 0x04
+    POINTING_MODEL = 0x05
+    GUIDE = 0x06
+    TRACE = 0x07
+    TARGET_QUEUE = 0x08
+    TARGET_EVENT = 0x09
+    SPLINE_TRACK = 0x0A
+
+
+class FrameError(ValueError):
+    """Raised when a binary frame fails validation."""
+
+
+def crc16(data: bytes, crc: int = 0xFFFF) -> int:
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_frame(frame_type: int, payload: bytes) -> bytes:
+    """Wrap a payload into a complete frame."""
+    if len(payload) > 0xFFFF:
+        raise FrameError(f"Payload too large: {len(payload)} bytes")
+    body = struct.pack("<BH", frame_type, len(payload)) + payload
+    return FRAME_SYNC + body + struct.pack("<H", crc16(body))
+
+
+def frame_size_from_header(header: bytes) -> int:
+    """Total frame size given at least the first FRAME_HEADER_SIZE bytes."""
+    if len(header) < FRAME_HEADER_SIZE:
+        raise FrameError("Incomplete frame header")
+    if header[:2] != FRAME_SYNC:
+        raise FrameError(f"Bad frame sync: {header[:2]!r}")
+    (length,) = struct.unpack_from("<H", header, 3)
+    return length + FRAME_OVERHEAD
+
+
+def decode_frame(frame: bytes) -> Tuple[int, bytes]:
+    """
+    Validate a frame and return (frame_type, payload).
+
+    Raises:
+        FrameError: If sync, length or CRC do not match
+    """
+    size = frame_size_from_header(frame)
+    if len(frame) != size:
+        raise FrameError(f"Frame length mismatch: expected {size}, got {len(frame)}")
+    body = frame[2:-FRAME_TRAILER_SIZE]
+    (received_crc,) = struct.unpack_from("<H", frame, size - FRAME_TRAILER_SIZE)
+    if crc16(body) != received_crc:
+        raise FrameError("Frame CRC mismatch")
+    return frame[2], frame[FRAME_HEADER_SIZE:-FRAME_TRAILER_SIZE]
+
+
+# =============================================================================
+# STATUS FRAME
+# =============================================================================
+
+STATUS_PAYLOAD = struct.Struct("<IIiiIBBII")
+
+# Status flag bits (StatusFlag in StatusFrame.h)
+STATUS_TRACKING = 0x01
+STATUS_SLEWING = 0x02
+STATUS_PARKED = 0x04
+STATUS_PARKING = 0x08
+STATUS_AT_HOME = 0x10
+STATUS_GUIDING = 0x20
+STATUS_FAULT = 0x40
+STATUS_ENCODER_SLIP = 0x80
+
+
+@dataclass
+class StatusFrame:
+    """Decoded :NWS# batched status frame."""
+    controller_millis: int
+    ra_degrees: float
+    dec_degrees: float
+    altitude: float
+    azimuth: float
+    pier_side: str  # "E", "W" or "?"
+    flags: int
+    axis1_driver_status: int
+    axis2_driver_status: int
+
+    @property
+    def is_tracking(self) -> bool:
+        return bool(self.flags & STATUS_TRACKING)
+
+    @property
+    def is_slewing(self) -> bool:
+        return bool(self.flags & STATUS_SLEWING)
+
+    @property
+    def is_parked(self) -> bool:
+        return bool(self.flags & STATUS_PARKED)
+
+    @property
+    def has_fault(self) -> bool:
+        return bool(self.flags & STATUS_FAULT)
+
+    @property
+    def has_encoder_slip(self) -> bool:
+        return bool(self.flags & STATUS_ENCODER_SLIP)
+
+
+_PIER_CODES = {0: "?", 1: "E", 2: "W"}
+
+
+def parse_status_payload(payload: bytes) -> StatusFrame:
+    """Decode a FrameType.STATUS payload."""
+    if len(payload) != STATUS_PAYLOAD.size:
+        raise FrameError(f"Status payload must be {STATUS_PAYLOAD.size} bytes, got {len(payload)}")
+    millis, ra, dec, alt, az, pier, flags, drv1, drv2 = STATUS_PAYLOAD.unpack(payload)
+    return StatusFrame(
+        controller_millis=millis,
+        ra_degrees=ra / MAS_PER_DEGREE,
+        dec_degrees=dec / MAS_PER_DEGREE,
+        altitude=alt / MAS_PER_DEGREE,
+        azimuth=az / MAS_PER_DEGREE,
+        pier_side=_PIER_CODES.get(pier, "?"),
+        flags=flags,
+        axis1_driver_status=drv1,
+        axis2_driver_status=drv2,
+    )
+
+
+def parse_status_frame(frame: bytes) -> Optional[StatusFrame]:
+    """Decode a complete status frame, or None if it is not a status frame."""
+    frame_type, payload = decode_frame(frame)
+    if frame_type != FrameType.STATUS:
+        return None
+    return parse_status_payload(payload)
+
+
+def build_status_payload(status: StatusFrame) -> bytes:
+    """Encode a status payload (used by simulators and tests)."""
+    pier = {"E": 1, "W": 2}.get(status.pier_side, 0)
+    return STATUS_PAYLOAD.pack(
+        status.controller_millis,
+        int(round((status.ra_degrees % 360.0) * MAS_PER_DEGREE)),
+        int(round(status.dec_degrees * MAS_PER_DEGREE)),
+        int(round(status.altitude * MAS_PER_DEGREE)),
+        int(round((status.azimuth % 360.0) * MAS_PER_DEGREE)),
+        pier,
+        status.flags,
+        status.axis1_driver_status,
+        status.axis2_driver_status,
+    )
+
+
+# =============================================================================
+# PEC MODEL
+# =============================================================================
+
+PEC_HEADER = struct.Struct("<BBHH")
+PEC_KIND_LUT = 1
+PEC_KIND_FOURIER = 2
+_CAS_LIMIT = 32767  # int16 centiarcseconds (±327.67")
+
+
+@dataclass
+class PECModel:
+    """
+    Harmonic drive PEC model for one axis (firmware PecModel.h).
+
+    kind "lut": corrections_arcsec is an interpolated table spanning
+    1/cycles_per_rev of an output-shaft revolution.
+    kind "fourier": terms are (cycles per output rev, cos ", sin ").
+    Corrections are added to the commanded axis position.
+    """
+    axis: int
+    kind: str
+    corrections_arcsec: List[float] = field(default_factory=list)
+    cycles_per_rev: int = 1
+    terms: List[Tuple[int, float, float]] = field(default_factory=list)
+
+
+def _to_cas(arcsec: float) -> int:
+    cas = int(round(arcsec * 100))
+    if abs(cas) > _CAS_LIMIT:
+        raise FrameError(f"PEC correction {arcsec}\" outside ±327.67\"")
+    return cas
+
+
+def encode_pec_model(model: PECModel) -> bytes:
+    """Encode a PEC model as a FrameType.PEC_MODEL payload."""
+    if model.axis not in (1, 2):
+        raise FrameError(f"Invalid PEC axis: {model.axis}")
+    if model.kind == "lut":
+        if not model.corrections_arcsec or model.cycles_per_rev < 1:
+            raise FrameError("LUT model needs corrections and cycles_per_rev >= 1")
+        values = [_to_cas(v) for v in model.corrections_arcsec]
+        header = PEC_HEADER.pack(model.axis, PEC_KIND_LUT, len(values), model.cycles_per_rev)
+        return header + struct.pack(f"<{len(values)}h", *values)
+    if model.kind == "fourier":
+        if not model.terms:
+            raise FrameError("Fourier model needs at least one term")
+        body = b"".join(
+            struct.pack("<Hhh", cycles, _to_cas(c), _to_cas(s)) for cycles, c, s in model.terms
+        )
+        return PEC_HEADER.pack(model.axis, PEC_KIND_FOURIER, len(model.terms), 1) + body
+    raise FrameError(f"Unknown PEC model kind: {model.kind}")
+
+
+def decode_pec_model(payload: bytes) -> PECModel:
+    """Decode a FrameType.PEC_MODEL payload."""
+    if len(payload) < PEC_HEADER.size:
+        raise FrameError("PEC payload too short")
+    axis, kind, count, cycles = PEC_HEADER.unpack_from(payload)
+    body = payload[PEC_HEADER.size:]
+    if kind == PEC_KIND_LUT:
+        if len(body) != 2 * count:
+            raise FrameError("PEC LUT length mismatch")
+        values = struct.unpack(f"<{count}h", body)
+        return PECModel(
+            axis=axis,
+            kind="lut",
+            corrections_arcsec=[v / 100.0 for v in values],
+            cycles_per_rev=cycles,
+        )
+    if kind == PEC_KIND_FOURIER:
+        if len(body) != 6 * count:
+            raise FrameError("PEC Fourier length mismatch")
+        terms = [
+            (c, cos / 100.0, sin / 100.0)
+            for c, cos, sin in struct.iter_unpack("<Hhh", body)
+        ]
+        return PECModel(axis=axis, kind="fourier", terms=terms)
+    raise FrameError(f"Unknown PEC model kind: {kind}")
+
+
+# =============================================================================
+# DRIVER STATUS
+# =============================================================================
+
+DRIVER_STATUS_HEADER = struct.Struct("<I")
+DRIVER_STATUS_AXIS = struct.Struct("<IHBBI")
+DRIVER_STATUS_PAYLOAD_SIZE = DRIVER_STATUS_HEADER.size + 2 * DRIVER_STATUS_AXIS.size
+DRIVER_STATUS_AGE_INVALID = 0xFFFFFFFF
+
+
+@dataclass
+class DriverSnapshot:
+    """Cached TMC5160 DRV_STATUS for one axis (firmware DriverStatusCache.h)."""
+    axis: int
+    drv_status: int
+    sg_result: int  # StallGuard2 load value, 0-1023 (low = high load)
+    cs_actual: int  # Actual current scale, 0-31
+    spi_status: int
+    age_ms: Optional[int]  # Snapshot age, None if the controller has no valid reply
+
+    @property
+    def valid(self) -> bool:
+        return self.age_ms is not None
+
+    @property
+    def current_scale(self) -> float:
+        """Coil current as a fraction of the programmed IRUN (CoolStep scaling)."""
+        return (self.cs_actual + 1) / 32.0
+
+
+def parse_driver_status_payload(payload: bytes) -> Tuple[int, List[DriverSnapshot]]:
+    """Decode a FrameType.DRIVER_STATUS payload into (controller millis, [axis1, axis2])."""
+    if len(payload) != DRIVER_STATUS_PAYLOAD_SIZE:
+        raise FrameError(
+            f"Driver status payload must be {DRIVER_STATUS_PAYLOAD_SIZE} bytes, got {len(payload)}"
+        )
+    (millis,) = DRIVER_STATUS_HEADER.unpack_from(payload)
+    snapshots = []
+    for index in range(2):
+        drv, sg, cs, spi, age = DRIVER_STATUS_AXIS.unpack_from(
+            payload, DRIVER_STATUS_HEADER.size + index * DRIVER_STATUS_AXIS.size
+        )
+        snapshots.append(DriverSnapshot(
+            axis=index + 1,
+            drv_status=drv,
+            sg_result=sg,
+            cs_actual=cs,
+            spi_status=spi,
+            age_ms=None if age == DRIVER_STATUS_AGE_INVALID else age,
+        ))
+    return millis, snapshots
+
+
+def build_driver_status_payload(millis: int, snapshots: List[DriverSnapshot]) -> bytes:
+    """Encode a driver status payload (used by simulators and tests)."""
+    body = DRIVER_STATUS_HEADER.pack(millis)
+    for snap in snapshots:
+        age = DRIVER_STATUS_AGE_INVALID if snap.age_ms is None else snap.age_ms
+        body += DRIVER_STATUS_AXIS.pack(snap.drv_status, snap.sg_result, snap.cs_actual,
+                                        snap.spi_status, age)
+    return body
+
+
+# =============================================================================
+# POINTING MODEL
+# =============================================================================
+
+# Term ids (PointingTerm in PointingModel.h)
+POINTING_TERM_IDS = {
+    "IH": 1, "ID": 2, "CH": 3, "NP": 4, "MA": 5, "ME": 6, "TF": 7,
+    "HHSH": 8, "HHCH": 9, "HDSD": 10, "HDCD": 11,
+}
+_POINTING_TERM_NAMES = {v: k for k, v in POINTING_TERM_IDS.items()}
+POINTING_TERM = struct.Struct("<Bi")
+
+
+def encode_pointing_model(terms: Dict[str, float]) -> bytes:
+    """Encode pointing model coefficients (arcseconds) as a FrameType.POINTING_MODEL payload."""
+    body = b""
+    for name, arcsec in terms.items():
+        if name not in POINTING_TERM_IDS:
+            raise FrameError(f"Unknown pointing term: {name}")
+        mas = int(round(arcsec * 1000))
+        if not -0x80000000 <= mas <= 0x7FFFFFFF:
+            raise FrameError(f"Pointing term {name} out of range: {arcsec}\"")
+        body += POINTING_TERM.pack(POINTING_TERM_IDS[name], mas)
+    return struct.pack("<B", len(terms)) + body
+
+
+def decode_pointing_model(payload: bytes) -> Dict[str, float]:
+    """Decode a FrameType.POINTING_MODEL payload to coefficients in arcseconds."""
+    if not payload or len(payload) != 1 + POINTING_TERM.size * payload[0]:
+        raise FrameError("Pointing model length mismatch")
+    terms = {}
+    for term_id, mas in POINTING_TERM.iter_unpack(payload[1:]):
+        if term_id not in _POINTING_TERM_NAMES:
+            raise FrameError(f"Unknown pointing term id: {term_id}")
+        terms[_POINTING_TERM_NAMES[term_id]] = mas / 1000.0
+    return terms
+
+
+# =============================================================================
+# MOTION TRACE
+# =============================================================================
+
+TRACE_DOWNLOAD_HEADER = struct.Struct("<IIHH")
+TRACE_RECORD_HEAD = struct.Struct("<IBBBB")
+TRACE_TICK_BODY = struct.Struct("<iiiHH")
+TRACE_EVENT_BODY = struct.Struct("<iiiHH")
+TRACE_RECORD_SIZE = 24
+
+# TraceKind / TraceChannel / TraceEvent in TraceRecorder.h
+TRACE_TICK = 1
+TRACE_COMMAND = 2
+TRACE_EVENT = 3
+
+TRACE_CH_AXIS1 = 0x01
+TRACE_CH_AXIS2 = 0x02
+TRACE_CH_COMMANDS = 0x04
+TRACE_CH_EVENTS = 0x08
+TRACE_CH_ALL = 0x0F
+
+TRACE_EVENT_NAMES = {
+    1: "mark", 2: "trigger", 3: "goto_start", 4: "goto_end",
+    5: "slip", 6: "guide", 7: "limit",
+}
+
+
+@dataclass
+class TraceRecord:
+    """One TraceRecorder.h record; fields not used by its kind stay at their defaults."""
+    time_us: int
+    kind: int
+    axis: int = 0
+    steps: int = 0
+    encoder: int = 0
+    rate_steps_per_s: float = 0.0
+    pec_phase: float = 0.0  # fraction of a PEC cycle
+    sg_result: int = 0
+    cs_actual: int = 0
+    flags: int = 0
+    command: str = ""
+    event: str = ""
+    args: Tuple[int, int, int] = (0, 0, 0)
+
+
+def _parse_trace_record(data: bytes, offset: int) -> TraceRecord:
+    time_us, kind, b0, b1, b2 = TRACE_RECORD_HEAD.unpack_from(data, offset)
+    body = offset + TRACE_RECORD_HEAD.size
+    if kind == TRACE_TICK:
+        steps, encoder, rate, pec, sg = TRACE_TICK_BODY.unpack_from(data, body)
+        return TraceRecord(time_us=time_us, kind=kind, axis=b0, steps=steps, encoder=encoder,
+                           rate_steps_per_s=rate / 1000.0, pec_phase=pec / 65536.0,
+                           sg_result=sg, cs_actual=b1, flags=b2)
+    if kind == TRACE_COMMAND:
+        text = data[body:body + 16].split(b"\0", 1)[0].decode("ascii", errors="replace")
+        return TraceRecord(time_us=time_us, kind=kind, command=text)
+    if kind == TRACE_EVENT:
+        a, b, c, _, _ = TRACE_EVENT_BODY.unpack_from(data, body)
+        return TraceRecord(time_us=time_us, kind=kind, axis=b1,
+                           event=TRACE_EVENT_NAMES.get(b0, str(b0)), args=(a, b, c))
+    raise FrameError(f"Unknown trace record kind: {kind}")
+
+
+def decode_trace_payload(payload: bytes) -> Tuple[int, int, int, List[TraceRecord]]:
+    """
+    Decode a FrameType.TRACE payload into (first, records held, count, records).
+
+    count is the number of ring slots in this chunk; records can be shorter
+    when a slot was claimed but never completed.
+    """
+    if len(payload) < TRACE_DOWNLOAD_HEADER.size:
+        raise FrameError("Trace payload too short")
+    first, held, count, size = TRACE_DOWNLOAD_HEADER.unpack_from(payload)
+    if size != TRACE_RECORD_SIZE or len(payload) != TRACE_DOWNLOAD_HEADER.size + count * size:
+        raise FrameError("Trace payload length mismatch")
+    records = [
+        _parse_trace_record(payload, TRACE_DOWNLOAD_HEADER.size + i * size)
+        for i in range(count)
+        # Records claimed but never completed (kind 0) are skipped
+        if payload[TRACE_DOWNLOAD_HEADER.size + i * size + 4] != 0
+    ]
+    return first, held, count, records
+
+
+# =============================================================================
+# TARGET QUEUE
+# =============================================================================
+
+TARGET_QUEUE_HEADER = struct.Struct("<BB")
+TARGET_QUEUE_ENTRY = struct.Struct("<IIiHH")
+TARGET_EVENT_PAYLOAD = struct.Struct("<IQIBBHiiI")
+
+# TargetEvent in TargetQueue.h
+TARGET_EVENT_NAMES = {
+    1: "started", 2: "slew_done", 3: "settled", 4: "settle_timeout",
+    5: "done", 6: "failed", 7: "aborted", 8: "empty",
+}
+
+
+@dataclass
+class QueuedTarget:
+    """One entry of a TargetQueue.h upload."""
+    target_id: int  # u32, echoed in every event for this target
+    ra_hours: float
+    dec_degrees: float
+    dwell_seconds: int = 0  # 0 holds the target until OnStepXExtended.next_target()
+    tolerance_arcsec: Optional[float] = None  # None uses TARGET_SETTLE_ARCSEC
+
+
+@dataclass
+class TargetEvent:
+    """Pushed FrameType.TARGET_EVENT."""
+    sequence: int
+    controller_time_us: int
+    target_id: int  # 0 for "empty"
+    event: str
+    remaining: int  # Targets still queued after this one
+    detail: int  # Goto error code for "failed"
+    axis1_residual_arcsec: float
+    axis2_residual_arcsec: float
+    elapsed_ms: int  # Since this target's goto started
+
+
+def encode_target_queue(targets: List[QueuedTarget], append: bool = False) -> bytes:
+    """Encode targets as a FrameType.TARGET_QUEUE payload."""
+    if len(targets) > 255:
+        raise FrameError("At most 255 targets per upload")
+    body = TARGET_QUEUE_HEADER.pack(len(targets), 1 if append else 0)
+    for t in targets:
+        if not 0 <= t.target_id <= 0xFFFFFFFF or not 0 <= t.dwell_seconds <= 0xFFFF:
+            raise FrameError(f"Target {t.target_id} id or dwell out of range")
+        tolerance = 0
+        if t.tolerance_arcsec is not None:
+            tolerance = int(round(t.tolerance_arcsec * 100))
+            if not 1 <= tolerance <= 0xFFFF:
+                raise FrameError(f"Target {t.target_id} tolerance out of range: {t.tolerance_arcsec}\"")
+        ra_mas = int(round((t.ra_hours % 24.0) * 15.0 * MAS_PER_DEGREE)) % int(360 * MAS_PER_DEGREE)
+        dec_mas = int(round(t.dec_degrees * MAS_PER_DEGREE))
+        body += TARGET_QUEUE_ENTRY.pack(t.target_id, ra_mas, dec_mas, t.dwell_seconds, tolerance)
+    return body
+
+
+def parse_target_event_payload(payload: bytes) -> TargetEvent:
+    """Decode a FrameType.TARGET_EVENT payload."""
+    if len(payload) != TARGET_EVENT_PAYLOAD.size:
+        raise FrameError(
+            f"Target event payload must be {TARGET_EVENT_PAYLOAD.size} bytes, got {len(payload)}"
+        )
+    seq, ts, target_id, event, remaining, detail, r1, r2, elapsed = TARGET_EVENT_PAYLOAD.unpack(payload)
+    return TargetEvent(
+        sequence=seq,
+        controller_time_us=ts,
+        target_id=target_id,
+        event=TARGET_EVENT_NAMES.get(event, str(event)),
+        remaining=remaining,
+        detail=detail,
+        axis1_residual_arcsec=r1 / 1000.0,
+        axis2_residual_arcsec=r2 / 1000.0,
+        elapsed_ms=elapsed,
+    )
+
+
+# =============================================================================
+# SPLINE TRACK (SplineTrack.h)
+# =============================================================================
+
+SPLINE_HEADER = struct.Struct("<BBHQ")
+SPLINE_KNOT = struct.Struct("<Iiiii")
+
+# SplineFrame in SplineTrack.h
+SPLINE_FRAMES = {"radec": 0, "altaz": 1}
+_I32_LIMIT = 0x7FFFFFFF
+
+
+@dataclass
+class SplineKnot:
+    """One cubic Hermite knot of a SplineTrack.h path."""
+    time_s: float  # Since the track start time
+    c1_degrees: float  # RA or Az, unwrapped (may leave 0..360)
+    c2_degrees: float  # Dec or Alt
+    c1_rate: float  # degrees/second
+    c2_rate: float
+
+
+def spline_knots_from_samples(samples: List[Tuple[float, float, float]]) -> List[SplineKnot]:
+    """
+    Turn a sampled path into Hermite knots.
+
+    Rates come from finite differences (central inside, one-sided at the
+    ends), so the spline passes through every sample with a continuous rate.
+    c1 is unwrapped across 0/360 degrees.
+
+    Args:
+        samples: (time_s, c1_degrees, c2_degrees) in increasing time order,
+                 c1/c2 as RA/Dec or Az/Alt in degrees
+
+    Returns:
+        Knots for encode_spline_track()
+    """
+    if len(samples) < 2:
+        raise FrameError("A spline track needs at least two samples")
+    times = [float(t) for t, _, _ in samples]
+    if any(b <= a for a, b in zip(times, times[1:])):
+        raise FrameError("Spline samples must have increasing times")
+
+    c1 = [float(samples[0][1])]
+    for _, value, _ in samples[1:]:
+        # Take the shorter way round from the previous sample
+        c1.append(c1[-1] + ((value - c1[-1] + 180.0) % 360.0 - 180.0))
+    c2 = [float(v) for _, _, v in samples]
+
+    def rate(values: List[float], i: int) -> float:
+        lo = max(i - 1, 0)
+        hi = min(i + 1, len(values) - 1)
+        return (values[hi] - values[lo]) / (times[hi] - times[lo])
+
+    return [SplineKnot(times[i], c1[i], c2[i], rate(c1, i), rate(c2, i)) for i in range(len(samples))]
+
+
+def encode_spline_track(knots: List[SplineKnot], frame: str = "radec", start_time_us: int = 0) -> bytes:
+    """
+    Encode knots as a FrameType.SPLINE_TRACK payload.
+
+    Args:
+        knots: Path knots, first at or after time 0
+        frame: "radec" or "altaz"
+        start_time_us: Controller time of t = 0 (the TelemetrySample
+                       timestamp clock); 0 starts on OnStepXExtended.start_spline_track()
+    """
+    if frame not in SPLINE_FRAMES:
+        raise FrameError(f"Unknown spline frame: {frame}")
+    if not 2 <= len(knots) <= 0xFFFF:
+        raise FrameError("A spline track needs at least two knots")
+    body = SPLINE_HEADER.pack(SPLINE_FRAMES[frame], 0, len(knots), start_time_us)
+    last_ms = -1
+    for k in knots:
+        t_ms = int(round(k.time_s * 1000))
+        if t_ms <= last_ms or t_ms > 0xFFFFFFFF:
+            raise FrameError(f"Knot time out of order or range: {k.time_s} s")
+        last_ms = t_ms
+        values = [int(round(v * MAS_PER_DEGREE)) for v in
+                  (k.c1_degrees, k.c2_degrees, k.c1_rate, k.c2_rate)]
+        if any(abs(v) > _I32_LIMIT for v in values):
+            raise FrameError(f"Knot at {k.time_s} s out of range")
+        body += SPLINE_KNOT.pack(t_ms, *values)
+    return body
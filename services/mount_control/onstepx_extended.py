@@ -13,9 +13,27 @@ Reference: https://github.com/hjd1964/OnStepX-Plugins
 
 import logging
 from dataclasses import dataclass
-from typing import Optional
-
-from .lx200 import LX200Client, ConnectionType
+from typing import Dict, List, Optional
+
+from .lx200 import LX200Client, ConnectionType, SessionPriority
+from .nightwatch_protocol import (
+    DriverSnapshot,
+    FrameError,
+    FrameType,
+    PECModel,
+    QueuedTarget,
+    SplineKnot,
+    decode_frame,
+    decode_pec_model,
+    encode_frame,
+    encode_pec_model,
+    encode_pointing_model,
+    encode_spline_track,
+    encode_target_queue,
+    TraceRecord,
+    decode_trace_payload,
+    parse_driver_status_payload,
+)
 
 logger = logging.getLogger(__name__)
 
@@ -47,6 +65,73 @@ class DriverStatus:
     current_ma: Optional[int]  # Motor current in mA
 
 
+@dataclass
+class EncoderLoopStatus:
+    """On-controller encoder closed-loop state for one axis (EncoderLoop.h)."""
+
+    axis: int  # Axis number (1=RA, 2=DEC)
+    state: str  # "disabled", "engaged" or "slip"
+    error_arcsec: float  # Commanded minus encoder position
+    correction_steps: int  # Net correction steps since engage
+    slip_count: int  # Slips detected since boot
+
+    @property
+    def engaged(self) -> bool:
+        return self.state == "engaged"
+
+    @property
+    def slipped(self) -> bool:
+        return self.state == "slip"
+
+
+@dataclass
+class StallGuardPoint:
+    """One velocity of a StallGuard calibration sweep."""
+
+    rate_deg_s: float  # Axis rate
+    sg_mean: int  # Mean unloaded SG_RESULT
+    sg_min: int  # Minimum unloaded SG_RESULT
+    threshold: int  # Stall threshold, 0 = detection off at this rate
+
+
+@dataclass
+class StallGuardCalibration:
+    """StallGuard calibration state for one axis (StallGuardCal.h)."""
+
+    axis: int  # Axis number (1=RA, 2=DEC)
+    state: str  # "none", "running", "done" or "failed"
+    point: int  # Sweep point in progress while running
+    points: int  # Sweep points in total
+    crossover_deg_s: float  # StealthChop -> SpreadCycle crossover rate
+    table: List[StallGuardPoint]  # Calibrated points (empty until done)
+
+    @property
+    def calibrated(self) -> bool:
+        return self.state == "done"
+
+
+@dataclass
+class ClockMapping:
+    """Controller clock to UTC mapping (TimeDiscipline.h)."""
+
+    state: str  # "unsynced", "acquiring", "locked" or "holdover"
+    controller_time_us: int  # One point of the mapping...
+    utc_time_us: int  # ...and its UTC, Unix microseconds
+    ppb: int  # Learned controller crystal error
+    last_offset_us: int
+    last_delay_us: int
+    sample_age_s: int
+
+    @property
+    def synced(self) -> bool:
+        return self.state in ("locked", "holdover")
+
+    def to_utc_us(self, controller_time_us: int) -> int:
+        """UTC (Unix µs) of any controller timestamp: telemetry, trace, target events."""
+        elapsed = controller_time_us - self.controller_time_us
+        return self.utc_time_us + elapsed + elapsed * self.ppb // 1_000_000_000
+
+
 class OnStepXExtended(LX200Client):
     """
     Extended OnStepX commands beyond standard LX200.
@@ -74,13 +159,86 @@ class OnStepXExtended(LX200Client):
     CMD_PEC_WRITE_EEPROM = "$QZW"
     CMD_PEC_READ_EEPROM = "$QZR"
 
+    # NIGHTWATCH PEC model transfer (firmware PecModel.h)
+    CMD_MODEL_UPLOAD = "NWU"
+    CMD_PEC_MODEL_DOWNLOAD = "NWPD"
+
     # Extended Status Commands
     CMD_GET_DRIVER_STATUS = "GXU"
     CMD_GET_EXTENDED_STATUS = "GX"
 
+    # NIGHTWATCH cached driver snapshot (firmware DriverStatusCache.h)
+    CMD_DRIVER_SNAPSHOT = "NWDS"
+
+    # NIGHTWATCH StallGuard calibration (firmware StallGuardCal.h)
+    CMD_STALLGUARD_CAL_START = "NWSC"
+    CMD_STALLGUARD_CAL_STATUS = "NWSQ"
+    CMD_STALLGUARD_CAL_POINT = "NWSP"
+
     # Tracking Rate Commands
     CMD_SET_TRACKING_OFFSET = "ST"
 
+    # NIGHTWATCH encoder closed loop (firmware EncoderLoop.h)
+    CMD_ENCODER_LOOP_ENABLE = "NWEL"
+    CMD_ENCODER_LOOP_STATUS = "NWEQ"
+    CMD_ENCODER_LOOP_CLEAR_SLIP = "NWER"
+
+    # NIGHTWATCH goto mode (firmware CoordinatedGoto.h)
+    CMD_GOTO_MODE = "NWGM"
+
+    # NIGHTWATCH pointing model (firmware PointingModel.h, uploaded with CMD_MODEL_UPLOAD)
+    CMD_POINTING_MODEL = "NWPM"
+
+    # NIGHTWATCH refraction tables (firmware RefractionTable.h)
+    CMD_REFRACTION_WEATHER = "NWRW"
+
+    # NIGHTWATCH guide channel counters (firmware GuideChannel.h)
+    CMD_GUIDE_CHANNEL_STATUS = "NWGQ"
+
+    # NIGHTWATCH motion trace recorder (firmware TraceRecorder.h)
+    CMD_TRACE_ARM = "NWTA"
+    CMD_TRACE_STOP = "NWTS"
+    CMD_TRACE_MARK = "NWTM"
+    CMD_TRACE_TRIGGER = "NWTT"
+    CMD_TRACE_STATUS = "NWTQ"
+    CMD_TRACE_DOWNLOAD = "NWTD"
+
+    # NIGHTWATCH timing-budget probes (firmware Benchmark.h, BENCHMARK builds)
+    CMD_BENCHMARK_QUERY = "NWBQ"
+    CMD_BENCHMARK_RESET = "NWBZ"
+
+    # NIGHTWATCH target queue (firmware TargetQueue.h, uploaded with CMD_MODEL_UPLOAD)
+    CMD_TARGET_NEXT = "NWQN"
+    CMD_TARGET_CLEAR = "NWQC"
+    CMD_TARGET_STATUS = "NWQQ"
+
+    # NIGHTWATCH spline track mode (firmware SplineTrack.h, uploaded with CMD_MODEL_UPLOAD)
+    CMD_SPLINE_START = "NWKS"
+    CMD_SPLINE_STOP = "NWKX"
+    CMD_SPLINE_STATUS = "NWKQ"
+
+    # NIGHTWATCH disciplined clock (firmware TimeDiscipline.h)
+    CMD_CLOCK_STATUS = "NWYQ"
+
+    # NIGHTWATCH calibration store (firmware FlashStore.h)
+    CMD_STORE_SAVE = "NWFW"
+    CMD_STORE_STATUS = "NWFQ"
+
+    # NIGHTWATCH warm start (firmware WarmStart.h)
+    CMD_WARM_START_STATUS = "NWWQ"
+    CMD_WARM_START_INVALIDATE = "NWWX"
+
+    # NIGHTWATCH safety park fast path (firmware SafetyPark.h)
+    CMD_SAFETY_HEARTBEAT = "NWHB"
+    CMD_SAFETY_PARK = "NWHP"
+    CMD_SAFETY_CLEAR = "NWHC"
+    CMD_SAFETY_STATUS = "NWHQ"
+
+    # NIGHTWATCH backlash compensation (firmware BacklashComp.h)
+    CMD_BACKLASH_CALIBRATE = "NWLC"
+    CMD_BACKLASH_SET = "NWLS"
+    CMD_BACKLASH_STATUS = "NWLQ"
+
     def __init__(
         self,
         connection_type: ConnectionType = ConnectionType.TCP,
@@ -88,6 +246,8 @@ class OnStepXExtended(LX200Client):
         port: int = 9999,
         serial_port: str = "/dev/ttyUSB0",
         baudrate: int = 9600,
+        session_priority: Optional[SessionPriority] = None,
+        serial_upgrade_baud: Optional[int] = None,
     ):
         """
         Initialize OnStepX Extended client.
@@ -98,6 +258,8 @@ class OnStepXExtended(LX200Client):
             port: Port number for TCP connection
             serial_port: Serial port path
             baudrate: Serial baud rate
+            session_priority: Command server class for this TCP session
+            serial_upgrade_baud: SERIAL_A rate to negotiate after connecting
         """
         super().__init__(
             connection_type=connection_type,
@@ -105,6 +267,8 @@ class OnStepXExtended(LX200Client):
             port=port,
             serial_port=serial_port,
             baudrate=baudrate,
+            session_priority=session_priority,
+            serial_upgrade_baud=serial_upgrade_baud,
         )
 
     # =========================================================================
@@ -232,6 +396,11 @@ class OnStepXExtended(LX200Client):
         """
         Save PEC data to EEPROM for persistence across power cycles.
 
+        With PEC_MODEL set to LUT or FOURIER this saves the uploaded
+        per-axis models rather than the worm-period buffer. With FLASH_STORE
+        firmware the save is queued to the calibration store and this returns
+        before it is on flash; see get_store_status().
+
         Returns:
             True if saved successfully
         """
@@ -245,6 +414,57 @@ class OnStepXExtended(LX200Client):
 
         return success
 
+    async def pec_upload_model(self, model: PECModel) -> bool:
+        """
+        Upload a per-axis harmonic drive PEC model in one frame.
+
+        The firmware checks the model against its compiled PEC_MODEL and
+        PEC_LUT_POINTS / PEC_FOURIER_TERMS and rejects a mismatch.
+
+        Args:
+            model: LUT or Fourier model for axis 1 (RA) or 2 (Dec)
+
+        Returns:
+            True if the controller accepted the model
+        """
+        try:
+            frame = encode_frame(FrameType.PEC_MODEL, encode_pec_model(model))
+        except FrameError as e:
+            logger.error(f"Invalid PEC model: {e}")
+            return False
+
+        response = self._send_frame_command(self.CMD_MODEL_UPLOAD, frame)
+        success = response == "1"
+
+        if success:
+            logger.info(f"PEC {model.kind} model uploaded for axis {model.axis}")
+        else:
+            logger.warning(f"PEC model upload for axis {model.axis} rejected")
+
+        return success
+
+    async def pec_download_model(self, axis: int = 1) -> Optional[PECModel]:
+        """
+        Download the active PEC model for an axis.
+
+        Args:
+            axis: Axis number (1=RA, 2=DEC)
+
+        Returns:
+            PECModel, or None if no model is loaded
+        """
+        frame = self._send_binary_command(f"{self.CMD_PEC_MODEL_DOWNLOAD}{axis}")
+        if not frame:
+            return None
+        try:
+            frame_type, payload = decode_frame(frame)
+            if frame_type != FrameType.PEC_MODEL:
+                return None
+            return decode_pec_model(payload)
+        except FrameError as e:
+            logger.warning(f"Invalid PEC model frame: {e}")
+            return None
+
     # =========================================================================
     # DRIVER DIAGNOSTICS
     # =========================================================================
@@ -254,7 +474,9 @@ class OnStepXExtended(LX200Client):
         Get TMC stepper driver status.
 
         Reads diagnostic information from the TMC5160/TMC2130 driver
-        including fault conditions and current settings.
+        including fault conditions and current settings. NIGHTWATCH
+        firmware answers from its cached DRV_STATUS snapshot, so the
+        query costs no SPI time on the controller.
 
         Args:
             axis: Axis number (1=RA/Az, 2=DEC/Alt)
@@ -306,6 +528,109 @@ class OnStepXExtended(LX200Client):
             "axis2_dec": axis2,
         }
 
+    async def get_driver_snapshot(self) -> Optional[Dict[str, DriverSnapshot]]:
+        """
+        Get the cached DRV_STATUS, SG_RESULT and CS_ACTUAL of both axes.
+
+        One :NWDS# round trip returns both axes from the controller's
+        background-polled snapshot, including its age.
+
+        Returns:
+            Dictionary with axis1_ra and axis2_dec DriverSnapshot, or None
+            if the controller did not return a driver status frame
+        """
+        frame = self._send_binary_command(self.CMD_DRIVER_SNAPSHOT)
+        if not frame:
+            return None
+        try:
+            frame_type, payload = decode_frame(frame)
+            if frame_type != FrameType.DRIVER_STATUS:
+                return None
+            _, (axis1, axis2) = parse_driver_status_payload(payload)
+        except FrameError as e:
+            logger.warning(f"Invalid driver status frame: {e}")
+            return None
+
+        return {
+            "axis1_ra": axis1,
+            "axis2_dec": axis2,
+        }
+
+    # =========================================================================
+    # STALLGUARD CALIBRATION
+    # =========================================================================
+
+    _STALLGUARD_CAL_STATES = {0: "none", 1: "running", 2: "done", 3: "failed"}
+
+    async def start_stallguard_calibration(self, axis: int = 1) -> bool:
+        """
+        Start a StallGuard calibration sweep on one axis.
+
+        The controller runs the axis at a series of rates (alternating
+        direction, a few degrees of travel), records SG_RESULT at each, and
+        derives per-velocity stall thresholds and the StealthChop to
+        SpreadCycle crossover. The result is saved to controller EEPROM.
+        Only run with the mount unparked, idle and clear to move.
+
+        Args:
+            axis: Axis number (1=RA, 2=DEC)
+
+        Returns:
+            True if the sweep started
+        """
+        response = self._send_command(f"{self.CMD_STALLGUARD_CAL_START}{axis}")
+        success = response == "1"
+
+        if success:
+            logger.info(f"StallGuard calibration started on axis {axis}")
+        else:
+            logger.warning(f"Failed to start StallGuard calibration on axis {axis}: {response}")
+
+        return success
+
+    async def get_stallguard_calibration(self, axis: int = 1) -> Optional[StallGuardCalibration]:
+        """
+        Get StallGuard calibration progress and, once done, the table.
+
+        Args:
+            axis: Axis number (1=RA, 2=DEC)
+
+        Returns:
+            StallGuardCalibration, or None if unavailable
+        """
+        response = self._send_command(f"{self.CMD_STALLGUARD_CAL_STATUS}{axis}")
+        if not response:
+            return None
+        try:
+            state, point, points, crossover = (int(v) for v in response.split(","))
+        except ValueError:
+            logger.warning(f"Failed to parse StallGuard calibration status: {response}")
+            return None
+
+        calibration = StallGuardCalibration(
+            axis=axis,
+            state=self._STALLGUARD_CAL_STATES.get(state, "none"),
+            point=point,
+            points=points,
+            crossover_deg_s=crossover / 1000.0,
+            table=[],
+        )
+        if calibration.calibrated:
+            for index in range(points):
+                reply = self._send_command(f"{self.CMD_STALLGUARD_CAL_POINT}{axis}{index}")
+                try:
+                    rate, sg_mean, sg_min, threshold = (int(v) for v in reply.split(","))
+                except (AttributeError, ValueError):
+                    logger.warning(f"Failed to parse StallGuard point {index}: {reply}")
+                    break
+                calibration.table.append(StallGuardPoint(
+                    rate_deg_s=rate / 1000.0,
+                    sg_mean=sg_mean,
+                    sg_min=sg_min,
+                    threshold=threshold,
+                ))
+        return calibration
+
     # =========================================================================
     # TRACKING RATE FINE-TUNING
     # =========================================================================
@@ -351,6 +676,839 @@ class OnStepXExtended(LX200Client):
                 pass
         return None
 
+    # =========================================================================
+    # ENCODER CLOSED LOOP
+    # =========================================================================
+
+    _ENCODER_LOOP_STATES = {0: "disabled", 1: "engaged", 2: "slip"}
+
+    async def set_encoder_loop(self, enabled: bool) -> bool:
+        """
+        Engage or disable on-controller encoder closed-loop tracking.
+
+        While engaged the controller compares step and AXIS*_ENCODER
+        positions at ENCODER_LOOP_HZ and issues correction steps itself,
+        replacing the host-side get_pointing_error() correction loop.
+
+        Args:
+            enabled: True to engage (latches the current position), False to disable
+
+        Returns:
+            True if the controller accepted the command
+        """
+        response = self._send_command(f"{self.CMD_ENCODER_LOOP_ENABLE}{1 if enabled else 0}")
+        success = response == "1"
+
+        if success:
+            logger.info(f"Encoder closed loop {'engaged' if enabled else 'disabled'}")
+        else:
+            logger.warning(f"Failed to set encoder closed loop: {response}")
+
+        return success
+
+    async def get_encoder_loop_status(self, axis: int = 1) -> Optional[EncoderLoopStatus]:
+        """
+        Get encoder closed-loop state for an axis.
+
+        Args:
+            axis: Axis number (1=RA, 2=DEC)
+
+        Returns:
+            EncoderLoopStatus, or None if unavailable
+        """
+        response = self._send_command(f"{self.CMD_ENCODER_LOOP_STATUS}{axis}")
+        if not response:
+            return None
+
+        try:
+            state, error_mas, corrections, slips = (int(v) for v in response.split(","))
+        except ValueError:
+            logger.warning(f"Failed to parse encoder loop status: {response}")
+            return None
+
+        return EncoderLoopStatus(
+            axis=axis,
+            state=self._ENCODER_LOOP_STATES.get(state, "disabled"),
+            error_arcsec=error_mas / 1000.0,
+            correction_steps=corrections,
+            slip_count=slips,
+        )
+
+    async def clear_encoder_slip(self) -> bool:
+        """
+        Clear a latched encoder slip so the loop can be engaged again.
+
+        Returns:
+            True if cleared
+        """
+        response = self._send_command(self.CMD_ENCODER_LOOP_CLEAR_SLIP)
+        return response == "1"
+
+    # =========================================================================
+    # GOTO MODE
+    # =========================================================================
+
+    async def set_coordinated_goto(self, enabled: bool) -> bool:
+        """
+        Select coordinated (both axes arrive together) or independent gotos.
+
+        Coordinated gotos also merge the meridian-flip waypoint leg with the
+        Dec move when GOTO_FLIP_OVERLAP allows, shortening flip slews.
+
+        Args:
+            enabled: True for coordinated, False for independent axis profiles
+
+        Returns:
+            True if the controller accepted the mode
+        """
+        response = self._send_command(f"{self.CMD_GOTO_MODE}{1 if enabled else 0}")
+        success = response == "1"
+
+        if success:
+            logger.info(f"Goto mode: {'coordinated' if enabled else 'independent'}")
+        else:
+            logger.warning(f"Failed to set goto mode: {response}")
+
+        return success
+
+    async def get_coordinated_goto(self) -> Optional[bool]:
+        """
+        Get the current goto mode.
+
+        Returns:
+            True if coordinated, False if independent, None if unavailable
+        """
+        response = self._send_command(self.CMD_GOTO_MODE)
+        if response in ("0", "1"):
+            return response == "1"
+        return None
+
+    # =========================================================================
+    # POINTING MODEL
+    # =========================================================================
+
+    _POINTING_MODEL_STATES = {0: "none", 1: "loaded", 2: "active"}
+
+    async def upload_pointing_model(self, terms: Dict[str, float], enable: bool = True) -> bool:
+        """
+        Upload a fitted pointing model and optionally enable it.
+
+        The controller applies the model in its coordinate transform before
+        every goto and removes it from reported positions. Coefficients come
+        from services.astrometry.pointing_model.fit_pointing_model().
+
+        Args:
+            terms: Coefficients in arcseconds by term name (IH, ID, CH, ...)
+            enable: Enable the model once accepted
+
+        Returns:
+            True if the controller accepted (and, if requested, enabled) the model
+        """
+        try:
+            frame = encode_frame(FrameType.POINTING_MODEL, encode_pointing_model(terms))
+        except FrameError as e:
+            logger.error(f"Invalid pointing model: {e}")
+            return False
+
+        response = self._send_frame_command(self.CMD_MODEL_UPLOAD, frame)
+        if response != "1":
+            logger.warning(f"Pointing model upload rejected: {response}")
+            return False
+
+        logger.info(f"Pointing model uploaded ({len(terms)} terms)")
+        if enable:
+            return await self.set_pointing_model(True)
+        return True
+
+    async def set_pointing_model(self, enabled: bool) -> bool:
+        """
+        Enable or disable the loaded pointing model.
+
+        Disable it while collecting observations for a new fit.
+
+        Args:
+            enabled: True to apply the model, False for raw mount coordinates
+
+        Returns:
+            True if the controller accepted the command
+        """
+        response = self._send_command(f"{self.CMD_POINTING_MODEL}{1 if enabled else 0}")
+        success = response == "1"
+
+        if success:
+            logger.info(f"Pointing model {'enabled' if enabled else 'disabled'}")
+        else:
+            logger.warning(f"Failed to set pointing model: {response}")
+
+        return success
+
+    async def get_pointing_model_state(self) -> Optional[str]:
+        """
+        Get the pointing model state.
+
+        Returns:
+            "none", "loaded" (disabled) or "active", or None if unavailable
+        """
+        response = self._send_command(self.CMD_POINTING_MODEL)
+        try:
+            return self._POINTING_MODEL_STATES[int(response)]
+        except (TypeError, ValueError, KeyError):
+            return None
+
+    # =========================================================================
+    # REFRACTION
+    # =========================================================================
+
+    INHG_TO_HPA = 33.8639
+
+    async def set_refraction_weather(self, temperature_c: float, pressure_hpa: float) -> bool:
+        """
+        Push station temperature and pressure for refraction tracking.
+
+        The controller rebuilds its refraction tables when the values move
+        by more than about 0.5 °C / 1 hPa and falls back to a standard
+        atmosphere if pushes stop for 15 minutes.
+
+        Args:
+            temperature_c: Ambient temperature (-40 to 50 °C)
+            pressure_hpa: Station (absolute, not sea-level) pressure (500 to 1100 hPa)
+
+        Returns:
+            True if the controller accepted the values
+        """
+        if not -40.0 <= temperature_c <= 50.0 or not 500.0 <= pressure_hpa <= 1100.0:
+            logger.warning(f"Refraction weather out of range: {temperature_c} °C, {pressure_hpa} hPa")
+            return False
+
+        response = self._send_command(
+            f"{self.CMD_REFRACTION_WEATHER}{temperature_c:.1f},{pressure_hpa:.1f}"
+        )
+        success = response == "1"
+
+        if success:
+            logger.debug(f"Refraction weather set to {temperature_c:.1f} °C, {pressure_hpa:.1f} hPa")
+        else:
+            logger.warning(f"Failed to set refraction weather: {response}")
+
+        return success
+
+    async def push_refraction_weather(self, conditions) -> bool:
+        """
+        Forward weather service conditions to the refraction tables.
+
+        Suitable as a UnifiedWeatherService callback:
+        weather.register_callback(mount.push_refraction_weather)
+
+        Only a measured station pressure (station_pressure_inhg) is sent.
+        pressure_inhg is sea-level relative and defaults to 29.92 when the
+        gateway reports nothing; at altitude either would put the tables
+        further off than the controller's own standard atmosphere.
+
+        Args:
+            conditions: UnifiedConditions with temperature_c and station_pressure_inhg
+
+        Returns:
+            True if values were sent and accepted, False if missing or rejected
+        """
+        station_pressure = getattr(conditions, "station_pressure_inhg", None)
+        if conditions.temperature_c is None or station_pressure is None:
+            return False
+        return await self.set_refraction_weather(
+            conditions.temperature_c, station_pressure * self.INHG_TO_HPA
+        )
+
+    async def get_refraction_weather(self) -> Optional[dict]:
+        """
+        Get the weather the refraction tables were built for.
+
+        Returns:
+            Dict with temperature_c, pressure_hpa and live (False when the
+            controller is on its standard-atmosphere fallback), or None
+        """
+        response = self._send_command(self.CMD_REFRACTION_WEATHER)
+        try:
+            temperature, pressure, live = response.split(",")
+            return {
+                "temperature_c": float(temperature),
+                "pressure_hpa": float(pressure),
+                "live": live == "1",
+            }
+        except (AttributeError, ValueError):
+            return None
+
+    # =========================================================================
+    # GUIDE CHANNEL
+    # =========================================================================
+
+    async def get_guide_channel_stats(self) -> Optional[dict]:
+        """
+        Get guide channel counters.
+
+        Pulses themselves go through services.guiding.GuideChannelClient;
+        this reads back what the controller did with them.
+
+        Returns:
+            Dict with applied, late, stale, bad and last_latency_us, or None
+        """
+        response = self._send_command(self.CMD_GUIDE_CHANNEL_STATUS)
+        try:
+            applied, late, stale, bad, latency = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "applied": applied,
+            "late": late,
+            "stale": stale,
+            "bad": bad,
+            "last_latency_us": latency,
+        }
+
+    # =========================================================================
+    # MOTION TRACE
+    # =========================================================================
+
+    _TRACE_STATES = {0: "idle", 1: "armed", 2: "stopped"}
+
+    async def arm_trace(self, channels: int = 0x0F, decimate: int = 1,
+                        post_trigger: int = 0) -> bool:
+        """
+        Start a fresh controller-side motion trace.
+
+        Args:
+            channels: TRACE_CH_* mask (axis1, axis2, commands, events)
+            decimate: Keep every n-th control tick sample per axis
+            post_trigger: Records kept after a trigger before recording
+                stops; 0 records until stop_trace()
+
+        Returns:
+            True if the controller armed the recorder
+        """
+        response = self._send_command(f"{self.CMD_TRACE_ARM}{channels},{decimate},{post_trigger}")
+        success = response == "1"
+        if success:
+            logger.info(f"Trace armed (channels 0x{channels:02X}, decimate {decimate})")
+        else:
+            logger.warning(f"Trace arm rejected: {response!r}")
+        return success
+
+    async def stop_trace(self) -> bool:
+        """Stop recording; the trace can then be downloaded."""
+        return self._send_command(self.CMD_TRACE_STOP) == "1"
+
+    async def mark_trace(self, marker: int) -> bool:
+        """Insert a host marker event (e.g. exposure start) into the trace."""
+        return self._send_command(f"{self.CMD_TRACE_MARK}{marker}") == "1"
+
+    async def trigger_trace(self) -> bool:
+        """Start the post-trigger countdown set by arm_trace()."""
+        return self._send_command(self.CMD_TRACE_TRIGGER) == "1"
+
+    async def get_trace_status(self) -> Optional[dict]:
+        """
+        Get trace recorder state.
+
+        Returns:
+            Dict with state, records, capacity, overwritten and channels, or None
+        """
+        response = self._send_command(self.CMD_TRACE_STATUS)
+        try:
+            state, records, capacity, overwritten, channels = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "state": self._TRACE_STATES.get(state, "unknown"),
+            "records": records,
+            "capacity": capacity,
+            "overwritten": overwritten,
+            "channels": channels,
+        }
+
+    async def download_trace(self) -> Optional[List[TraceRecord]]:
+        """
+        Download a stopped trace, oldest record first.
+
+        Fetched in TRACE_DOWNLOAD_RECORDS chunks with :NWTD<first>#. The
+        controller returns nothing while still recording, so call
+        stop_trace() first.
+
+        Returns:
+            List of TraceRecord, or None on a transfer error
+        """
+        records: List[TraceRecord] = []
+        first = 0
+        while True:
+            frame = self._send_binary_command(f"{self.CMD_TRACE_DOWNLOAD}{first}")
+            if not frame:
+                return None
+            try:
+                frame_type, payload = decode_frame(frame)
+                if frame_type != FrameType.TRACE:
+                    return None
+                start, held, count, chunk = decode_trace_payload(payload)
+            except FrameError as e:
+                logger.warning(f"Invalid trace frame: {e}")
+                return None
+            records.extend(chunk)
+            first = start + count
+            if count == 0 or first >= held:
+                return records
+
+    # =========================================================================
+    # TARGET QUEUE
+    # =========================================================================
+
+    _TARGET_QUEUE_STATES = {0: "idle", 1: "slewing", 2: "settling", 3: "dwell"}
+
+    async def upload_targets(self, targets: List[QueuedTarget], append: bool = False) -> bool:
+        """
+        Hand the next targets to the controller's queue.
+
+        The controller slews to each in turn, reports started, slew_done,
+        settled (from encoder residuals) and done as TargetEvent pushes on
+        the telemetry stream, and starts the next goto as soon as the dwell
+        ends. Replacing keeps a target that is already running.
+
+        Args:
+            targets: Targets in observing order
+            append: Add behind the queued targets instead of replacing them
+
+        Returns:
+            True if the controller accepted the whole list
+        """
+        try:
+            frame = encode_frame(FrameType.TARGET_QUEUE, encode_target_queue(targets, append))
+        except FrameError as e:
+            logger.error(f"Invalid target queue: {e}")
+            return False
+
+        response = self._send_frame_command(self.CMD_MODEL_UPLOAD, frame)
+        if response != "1":
+            logger.warning(f"Target queue upload rejected: {response}")
+            return False
+        logger.info(f"Queued {len(targets)} targets{' (appended)' if append else ''}")
+        return True
+
+    async def next_target(self) -> bool:
+        """End the current target's dwell (exposures done) and move on."""
+        return self._send_command(self.CMD_TARGET_NEXT) == "1"
+
+    async def clear_targets(self) -> bool:
+        """Drop all queued targets; a slew in progress is not stopped."""
+        return self._send_command(self.CMD_TARGET_CLEAR) == "1"
+
+    async def get_target_queue_status(self) -> Optional[dict]:
+        """
+        Get target queue state.
+
+        Returns:
+            Dict with state, target_id, queued and event_sequence, or None
+        """
+        response = self._send_command(self.CMD_TARGET_STATUS)
+        try:
+            state, target_id, queued, sequence = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "state": self._TARGET_QUEUE_STATES.get(state, "unknown"),
+            "target_id": target_id,
+            "queued": queued,
+            "event_sequence": sequence,
+        }
+
+    # =========================================================================
+    # SPLINE TRACK
+    # =========================================================================
+
+    _SPLINE_STATES = {0: "idle", 1: "loaded", 2: "lead_in", 3: "following", 4: "done", 5: "fault"}
+
+    async def upload_spline_track(
+        self, knots: List[SplineKnot], frame: str = "radec", start_time_us: int = 0
+    ) -> bool:
+        """
+        Upload a fast-mover path for the controller to follow.
+
+        The controller evaluates the spline every slice and drives both axes
+        at variable rate within AXIS*_SLEW_RATE_DESIRED, so satellites and
+        bolide follow-ups need no stream of gotos. Build knots from sampled
+        positions with nightwatch_protocol.spline_knots_from_samples().
+
+        Args:
+            knots: Path knots (RA/Dec or Az/Alt in degrees, rates in deg/s)
+            frame: "radec" or "altaz"
+            start_time_us: Controller time of t = 0; 0 starts on start_spline_track()
+
+        Returns:
+            True if the controller accepted the path (refused while one is running)
+        """
+        try:
+            frame_bytes = encode_frame(FrameType.SPLINE_TRACK, encode_spline_track(knots, frame, start_time_us))
+        except FrameError as e:
+            logger.error(f"Invalid spline track: {e}")
+            return False
+
+        response = self._send_frame_command(self.CMD_MODEL_UPLOAD, frame_bytes)
+        if response != "1":
+            logger.warning(f"Spline track upload rejected: {response}")
+            return False
+        logger.info(f"Uploaded {frame} spline track: {len(knots)} knots, "
+                    f"{knots[-1].time_s - knots[0].time_s:.1f} s")
+        return True
+
+    async def start_spline_track(self) -> bool:
+        """Start following the uploaded path (after a lead-in to its first knot)."""
+        response = self._send_command(self.CMD_SPLINE_START)
+        if response != "1":
+            logger.warning(f"Spline track start rejected: {response}")
+            return False
+        return True
+
+    async def stop_spline_track(self) -> bool:
+        """Stop following; the path stays loaded."""
+        return self._send_command(self.CMD_SPLINE_STOP) == "1"
+
+    async def get_spline_track_status(self) -> Optional[dict]:
+        """
+        Get spline track state.
+
+        Returns:
+            Dict with state, elapsed_ms (negative during the lead-in),
+            axis1/axis2 lag in arcsec, clipped_slices and underruns, or None
+        """
+        response = self._send_command(self.CMD_SPLINE_STATUS)
+        try:
+            state, elapsed, lag1, lag2, clipped, underruns = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "state": self._SPLINE_STATES.get(state, "unknown"),
+            "elapsed_ms": elapsed,
+            "axis1_lag_arcsec": lag1 / 1000.0,
+            "axis2_lag_arcsec": lag2 / 1000.0,
+            "clipped_slices": clipped,
+            "underruns": underruns,
+        }
+
+    # =========================================================================
+    # TIMING BENCHMARK
+    # =========================================================================
+
+    _BENCHMARK_FIELDS = ("count", "overruns", "min_ns", "p50_ns", "p99_ns",
+                         "p999_ns", "max_ns", "mean_ns", "budget_ns")
+
+    async def get_benchmark_report(self) -> Optional[Dict[str, dict]]:
+        """
+        Read every timing probe of a BENCHMARK firmware build.
+
+        Returns:
+            Dict of probe name (step_isr, encoder, lx200_parse, ...) to a
+            dict of count, overruns and times in ns; None when the firmware
+            was built without BENCHMARK
+        """
+        try:
+            probes = int(self._send_command(self.CMD_BENCHMARK_QUERY))
+        except (TypeError, ValueError):
+            return None
+        if probes <= 0:
+            return None
+
+        report = {}
+        for probe in range(probes):
+            response = self._send_command(f"{self.CMD_BENCHMARK_QUERY}{probe}")
+            try:
+                name, *values = response.split(",")
+                report[name] = dict(zip(self._BENCHMARK_FIELDS, (int(v) for v in values)))
+            except (AttributeError, ValueError):
+                return None
+            if len(report[name]) != len(self._BENCHMARK_FIELDS):
+                return None
+        return report
+
+    async def reset_benchmark(self) -> bool:
+        """Clear all timing probes, e.g. after a Config.h change is flashed."""
+        return self._send_command(self.CMD_BENCHMARK_RESET) == "1"
+
+    # =========================================================================
+    # CLOCK DISCIPLINE
+    # =========================================================================
+
+    _CLOCK_STATES = {0: "unsynced", 1: "acquiring", 2: "locked", 3: "holdover"}
+
+    async def get_clock_mapping(self) -> Optional[ClockMapping]:
+        """
+        Get the controller clock to UTC mapping.
+
+        With TIME_DISCIPLINE firmware every controller timestamp converts to
+        UTC through ClockMapping.to_utc_us(), so camera exposures can be
+        matched against telemetry or trace samples without a time query per
+        exposure. Telemetry samples already carry utc_time_us.
+
+        Returns:
+            ClockMapping, or None if the firmware has no clock discipline
+        """
+        response = self._send_command(self.CMD_CLOCK_STATUS)
+        try:
+            state, controller, utc, ppb, offset, delay, age = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return ClockMapping(
+            state=self._CLOCK_STATES.get(state, "unknown"),
+            controller_time_us=controller,
+            utc_time_us=utc,
+            ppb=ppb,
+            last_offset_us=offset,
+            last_delay_us=delay,
+            sample_age_s=age,
+        )
+
+    # =========================================================================
+    # CALIBRATION STORE
+    # =========================================================================
+
+    _STORE_STATES = {0: "offline", 1: "idle", 2: "erasing", 3: "programming", 4: "verifying"}
+
+    async def save_calibration(self, key: Optional[int] = None) -> bool:
+        """
+        Queue calibration records for the flash store.
+
+        Args:
+            key: Store key (1-2 PEC axis, 3 pointing model, 4-5 StallGuard
+                axis, 6 park), or None for every key
+
+        Returns:
+            True if the save was queued; it completes in the background
+        """
+        cmd = self.CMD_STORE_SAVE if key is None else f"{self.CMD_STORE_SAVE}{key}"
+        success = self._send_command(cmd) == "1"
+
+        if success:
+            logger.info(f"Calibration save queued ({'all' if key is None else f'key {key}'})")
+        else:
+            logger.warning("Calibration store refused the save")
+
+        return success
+
+    async def get_store_status(self) -> Optional[dict]:
+        """
+        Get the calibration store state.
+
+        Returns:
+            Dict with state, blocks_used, blocks, live_bytes, pending (keys
+            still to be written), saves, max_erase_count and errors, or None
+            if the firmware has no FLASH_STORE
+        """
+        response = self._send_command(self.CMD_STORE_STATUS)
+        try:
+            state, used, blocks, live, pending, saves, erases, errors = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "state": self._STORE_STATES.get(state, "unknown"),
+            "blocks_used": used,
+            "blocks": blocks,
+            "live_bytes": live,
+            "pending": [key for key in range(1, 16) if pending & (1 << key)],
+            "saves": saves,
+            "max_erase_count": erases,
+            "errors": errors,
+        }
+
+    # =========================================================================
+    # WARM START
+    # =========================================================================
+
+    _WARM_START_RESULTS = {
+        0: "cold_no_record",
+        1: "cold_encoder",
+        2: "cold_moved",
+        3: "cold_moving",
+        4: "warm",
+        5: "warm_coarse",
+    }
+    _WARM_RECORD_KINDS = {0: "invalid", 1: "moving", 2: "stopped", 3: "tracking", 4: "parked"}
+
+    async def get_warm_start_status(self) -> Optional[dict]:
+        """
+        Get how the controller came up after its last reset.
+
+        "warm" restored the saved position without homing; "warm_coarse"
+        carried RA on by the absolute encoder after a reset while tracking,
+        so sync (plate solve) before imaging. Cold results homed.
+
+        Returns:
+            Dict with result, warm, needs_sync, record (checkpoint kind),
+            axis1_delta_counts, axis2_delta_counts and checkpoints, or None
+            if the firmware has no WARM_START
+        """
+        response = self._send_command(self.CMD_WARM_START_STATUS)
+        try:
+            result, kind, delta1, delta2, checkpoints = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "result": self._WARM_START_RESULTS.get(result, "unknown"),
+            "warm": result in (4, 5),
+            "needs_sync": result == 5,
+            "record": self._WARM_RECORD_KINDS.get(kind, "unknown"),
+            "axis1_delta_counts": delta1,
+            "axis2_delta_counts": delta2,
+            "checkpoints": checkpoints,
+        }
+
+    async def invalidate_warm_start(self) -> bool:
+        """
+        Discard the position checkpoint so the next boot homes.
+
+        Use after the mount was moved by hand (clutches released) while
+        the controller was off or unreferenced.
+        """
+        success = self._send_command(self.CMD_WARM_START_INVALIDATE) == "1"
+        if success:
+            logger.info("Warm start checkpoint invalidated, next boot homes")
+        return success
+
+    # =========================================================================
+    # SAFETY PARK
+    # =========================================================================
+
+    _SAFETY_PARK_STATES = {0: "clear", 1: "stopping", 2: "parking", 3: "parked", 4: "fault"}
+    _SAFETY_PARK_CAUSES = {0x01: "input", 0x02: "heartbeat", 0x04: "host"}
+
+    async def safety_heartbeat(self, arm: bool = True) -> bool:
+        """
+        Feed the controller's safety heartbeat.
+
+        Once armed, the controller parks by itself if no heartbeat arrives
+        for SAFETY_HEARTBEAT_TIMEOUT_MS (30 s in Config.h), so a dead host
+        or network parks the mount as well.
+
+        Args:
+            arm: False disarms the timeout, for an orderly host shutdown
+        """
+        cmd = self.CMD_SAFETY_HEARTBEAT if arm else f"{self.CMD_SAFETY_HEARTBEAT}0"
+        return self._send_command(cmd) == "1"
+
+    async def safety_park(self) -> bool:
+        """
+        Park through the controller's fast path.
+
+        The rapid stop starts within one safety sample and the park follows
+        as soon as both axes are stopped; the trip stays latched until
+        clear_safety_park().
+        """
+        success = self._send_command(self.CMD_SAFETY_PARK) == "1"
+        if success:
+            logger.warning("Safety park requested")
+        return success
+
+    async def clear_safety_park(self) -> bool:
+        """Clear a latched safety park; refused while the park input is asserted."""
+        success = self._send_command(self.CMD_SAFETY_CLEAR) == "1"
+        if not success:
+            logger.warning("Safety park not cleared (input asserted or still parking)")
+        return success
+
+    async def get_safety_park_status(self) -> Optional[dict]:
+        """
+        Get the safety park state.
+
+        Returns:
+            Dict with state, causes, input_active, heartbeat_age_ms,
+            worst_stop_latency_us, worst_park_latency_ms, trips and
+            park_failures (parks refused, aborted or stopped short; 0 from
+            firmware that does not report them), or None if the firmware
+            has no SAFETY_PARK
+        """
+        response = self._send_command(self.CMD_SAFETY_STATUS)
+        try:
+            values = [int(v) for v in response.split(",")]
+            if len(values) == 7:
+                values.append(0)
+            state, causes, active, age, stop_us, park_ms, trips, park_failures = values
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "state": self._SAFETY_PARK_STATES.get(state, "unknown"),
+            "causes": [name for bit, name in self._SAFETY_PARK_CAUSES.items() if causes & bit],
+            "input_active": bool(active),
+            "heartbeat_age_ms": age,
+            "worst_stop_latency_us": stop_us,
+            "worst_park_latency_ms": park_ms,
+            "trips": trips,
+            "park_failures": park_failures,
+        }
+
+    # =========================================================================
+    # BACKLASH COMPENSATION
+    # =========================================================================
+
+    _BACKLASH_STATES = {0: "none", 1: "running", 2: "done", 3: "failed"}
+
+    async def start_backlash_calibration(self, axis: int = 2) -> bool:
+        """
+        Measure the backlash of one axis on the controller.
+
+        The axis sweeps about 1.5 degrees forward and back at
+        BACKLASH_CAL_RATE while the motor encoder is compared with the
+        AS5600 on the output shaft; the slack found is then taken up on
+        every tracking or guide reversal. Only run with the mount unparked,
+        idle and clear to move.
+
+        Args:
+            axis: Axis number (1=RA, 2=DEC)
+
+        Returns:
+            True if the sweep started
+        """
+        response = self._send_command(f"{self.CMD_BACKLASH_CALIBRATE}{axis}")
+        success = response == "1"
+
+        if success:
+            logger.info(f"Backlash calibration started on axis {axis}")
+        else:
+            logger.warning(f"Failed to start backlash calibration on axis {axis}: {response}")
+
+        return success
+
+    async def set_backlash(self, axis: int, arcsec: float) -> bool:
+        """
+        Set the backlash of one axis from a host-side measurement.
+
+        Args:
+            axis: Axis number (1=RA, 2=DEC)
+            arcsec: Slack at the output shaft; 0 turns compensation off
+
+        Returns:
+            True if accepted (refused above BACKLASH_MAX_ARCSEC)
+        """
+        mas = max(0, int(round(arcsec * 1000)))
+        success = self._send_command(f"{self.CMD_BACKLASH_SET}{axis}{mas}") == "1"
+        if not success:
+            logger.warning(f"Backlash of {arcsec:.1f}\" refused on axis {axis}")
+        return success
+
+    async def get_backlash_status(self, axis: int = 2) -> Optional[dict]:
+        """
+        Get the backlash measurement and takeup state of one axis.
+
+        Returns:
+            Dict with state, backlash_steps, backlash_arcsec,
+            takeup_rate_steps_s, takeup_s and takeups, or None if the
+            firmware has no BACKLASH_COMP
+        """
+        response = self._send_command(f"{self.CMD_BACKLASH_STATUS}{axis}")
+        try:
+            state, steps, mas, rate, takeups = (int(v) for v in response.split(","))
+        except (AttributeError, ValueError):
+            return None
+        return {
+            "state": self._BACKLASH_STATES.get(state, "unknown"),
+            "backlash_steps": steps,
+            "backlash_arcsec": mas / 1000.0,
+            "takeup_rate_steps_s": rate,
+            "takeup_s": steps / rate if rate else 0.0,
+            "takeups": takeups,
+        }
+
     # =========================================================================
     # EXTENDED STATUS
     # =========================================================================
@@ -442,6 +1600,8 @@ def create_onstepx_extended(
     port: int = 9999,
     use_tcp: bool = True,
     serial_port: str = "/dev/ttyUSB0",
+    session_priority: Optional[SessionPriority] = None,
+    serial_upgrade_baud: Optional[int] = None,
 ) -> OnStepXExtended:
     """
     Create OnStepXExtended client with convenient defaults.
@@ -451,6 +1611,8 @@ def create_onstepx_extended(
         port: Port number for TCP connection
         use_tcp: Use TCP if True, serial if False
         serial_port: Serial port path (if use_tcp=False)
+        session_priority: Command server class (e.g. SAFETY for the safety monitor)
+        serial_upgrade_baud: Faster SERIAL_A rate (e.g. 921600) when use_tcp=False
 
     Returns:
         Configured OnStepXExtended instance
@@ -462,6 +1624,8 @@ def create_onstepx_extended(
         host=host,
         port=port,
         serial_port=serial_port,
+        session_priority=session_priority,
+        serial_upgrade_baud=serial_upgrade_baud,
     )
 
 
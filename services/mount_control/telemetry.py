@@ -0,0 +1,335 @@
+"""
+NIGHTWATCH Mount Telemetry Subscriber
+
+Async UDP subscriber for the firmware telemetry push stream
+(firmware/onstepx_config/nightwatch/TelemetryStream.h). The controller pushes
+timestamped RA/Dec, step counts and AXIS*_ENCODER counts at
+TELEMETRY_STREAM_HZ, so position consumers read the latest sample instead of
+issuing LX200 queries, and the command socket stays free for commands.
+Target queue events (TargetQueue.h) arrive on the same stream.
+
+Example:
+    >>> telemetry = TelemetrySubscriber(host="192.168.1.100")
+    >>> await telemetry.start()
+    >>> mount = LX200Client(telemetry=telemetry)
+    >>> position = await mount.get_corrected_position()  # no LX200 round trip
+"""
+
+import asyncio
+import logging
+import struct
+import time
+from dataclasses import dataclass
+from typing import Callable, List, Optional
+
+from .nightwatch_protocol import (
+    MAS_PER_DEGREE,
+    STATUS_ENCODER_SLIP,
+    STATUS_PARKED,
+    STATUS_SLEWING,
+    STATUS_TRACKING,
+    FrameError,
+    FrameType,
+    TargetEvent,
+    decode_frame,
+    parse_target_event_payload,
+)
+
+logger = logging.getLogger(__name__)
+
+TELEMETRY_PAYLOAD = struct.Struct("<IQiiiiIiBB")
+# Appended by TimeDiscipline firmware: UTC of the sample, Unix microseconds
+TELEMETRY_UTC = struct.Struct("<Q")
+
+_PIER_CODES = {0: "?", 1: "E", 2: "W"}
+
+
+@dataclass
+class TelemetrySample:
+    """One pushed telemetry sample."""
+    sequence: int
+    controller_time_us: int  # Controller timestamp (microseconds)
+    axis1_steps: int
+    axis2_steps: int
+    axis1_encoder: int  # AXIS1_ENCODER counts
+    axis2_encoder: int  # AXIS2_ENCODER counts
+    ra_degrees: float
+    dec_degrees: float
+    flags: int
+    pier_side: str  # "E", "W" or "?"
+    received_at: float = 0.0  # Local monotonic receive time
+    utc_time_us: Optional[int] = None  # Unix microseconds, None if the controller clock is unsynced
+
+    @property
+    def is_tracking(self) -> bool:
+        return bool(self.flags & STATUS_TRACKING)
+
+    @property
+    def is_slewing(self) -> bool:
+        return bool(self.flags & STATUS_SLEWING)
+
+    @property
+    def is_parked(self) -> bool:
+        return bool(self.flags & STATUS_PARKED)
+
+    @property
+    def has_encoder_slip(self) -> bool:
+        return bool(self.flags & STATUS_ENCODER_SLIP)
+
+
+def parse_telemetry_payload(payload: bytes) -> TelemetrySample:
+    """Decode a FrameType.TELEMETRY payload."""
+    if len(payload) not in (TELEMETRY_PAYLOAD.size, TELEMETRY_PAYLOAD.size + TELEMETRY_UTC.size):
+        raise FrameError(
+            f"Telemetry payload must be {TELEMETRY_PAYLOAD.size} or "
+            f"{TELEMETRY_PAYLOAD.size + TELEMETRY_UTC.size} bytes, got {len(payload)}"
+        )
+    seq, ts, s1, s2, e1, e2, ra, dec, flags, pier = TELEMETRY_PAYLOAD.unpack_from(payload)
+    utc = None
+    if len(payload) > TELEMETRY_PAYLOAD.size:
+        utc = TELEMETRY_UTC.unpack_from(payload, TELEMETRY_PAYLOAD.size)[0] or None
+    return TelemetrySample(
+        sequence=seq,
+        controller_time_us=ts,
+        axis1_steps=s1,
+        axis2_steps=s2,
+        axis1_encoder=e1,
+        axis2_encoder=e2,
+        ra_degrees=ra / MAS_PER_DEGREE,
+        dec_degrees=dec / MAS_PER_DEGREE,
+        flags=flags,
+        pier_side=_PIER_CODES.get(pier, "?"),
+        utc_time_us=utc,
+    )
+
+
+class _TelemetryProtocol(asyncio.DatagramProtocol):
+    """asyncio glue forwarding datagrams to the subscriber."""
+
+    def __init__(self, subscriber: "TelemetrySubscriber"):
+        self.subscriber = subscriber
+
+    def datagram_received(self, data: bytes, addr):
+        self.subscriber.handle_datagram(data)
+
+    def error_received(self, exc):
+        logger.debug(f"Telemetry socket error: {exc}")
+
+
+class TelemetrySubscriber:
+    """
+    Subscriber for the controller's UDP telemetry stream.
+
+    Sends a subscribe datagram on start and re-sends it every
+    resubscribe_interval seconds so the controller keeps streaming.
+    Out-of-order and duplicate datagrams are dropped by sequence number.
+    A controller reboot restarts its sequence numbers, so a datagram that
+    goes back by more than RESTART_GAP, whose controller clock is more
+    than RESTART_CLOCK_S behind, or that arrives after RESTART_SILENCE_S
+    without an accepted one, starts the stream over instead.
+    """
+
+    SUBSCRIBE_MESSAGE = b"NWSUB"
+    UNSUBSCRIBE_MESSAGE = b"NWUNSUB"
+
+    # Beyond UDP reordering, which spans a few datagrams and milliseconds
+    RESTART_GAP = 64
+    RESTART_CLOCK_S = 1.0
+    RESTART_SILENCE_S = 2.0
+
+    def __init__(
+        self,
+        host: str = "192.168.1.100",
+        port: int = 9998,
+        resubscribe_interval: float = 2.0,
+        max_age: float = 0.5,
+    ):
+        """
+        Initialize telemetry subscriber.
+
+        Args:
+            host: Controller IP address
+            port: TELEMETRY_STREAM_PORT on the controller
+            resubscribe_interval: Seconds between subscribe keepalives
+            max_age: Samples older than this (seconds) are considered stale
+        """
+        self.host = host
+        self.port = port
+        self.resubscribe_interval = resubscribe_interval
+        self.max_age = max_age
+
+        self._transport: Optional[asyncio.DatagramTransport] = None
+        self._keepalive_task: Optional[asyncio.Task] = None
+        self._latest: Optional[TelemetrySample] = None
+        self._callbacks: List[Callable[[TelemetrySample], None]] = []
+        self._new_sample = asyncio.Event()
+        self.samples_received = 0
+        self.samples_dropped = 0
+        self._event_callbacks: List[Callable[[TargetEvent], None]] = []
+        self._last_event_sequence: Optional[int] = None
+        self._last_event_time_us = 0
+        self._last_event_at = 0.0
+        self.events_lost = 0
+        self.restarts = 0
+
+    async def start(self) -> bool:
+        """Open the UDP socket and subscribe to the stream."""
+        loop = asyncio.get_running_loop()
+        try:
+            self._transport, _ = await loop.create_datagram_endpoint(
+                lambda: _TelemetryProtocol(self),
+                remote_addr=(self.host, self.port),
+            )
+        except OSError as e:
+            logger.error(f"Telemetry subscribe to {self.host}:{self.port} failed: {e}")
+            return False
+
+        self._transport.sendto(self.SUBSCRIBE_MESSAGE)
+        self._keepalive_task = asyncio.create_task(self._keepalive())
+        logger.info(f"Subscribed to telemetry stream at {self.host}:{self.port}")
+        return True
+
+    async def stop(self):
+        """Unsubscribe and close the socket."""
+        if self._keepalive_task:
+            self._keepalive_task.cancel()
+            try:
+                await self._keepalive_task
+            except asyncio.CancelledError:
+                pass
+            self._keepalive_task = None
+        if self._transport:
+            try:
+                self._transport.sendto(self.UNSUBSCRIBE_MESSAGE)
+            except OSError:
+                pass
+            self._transport.close()
+            self._transport = None
+        logger.info("Telemetry stream stopped")
+
+    @property
+    def is_running(self) -> bool:
+        return self._transport is not None
+
+    async def _keepalive(self):
+        while True:
+            await asyncio.sleep(self.resubscribe_interval)
+            if self._transport:
+                self._transport.sendto(self.SUBSCRIBE_MESSAGE)
+
+    def handle_datagram(self, data: bytes) -> Optional[TelemetrySample]:
+        """
+        Decode one datagram and publish it if it is newer than the last sample.
+
+        Returns:
+            The accepted sample, or None if the datagram was invalid or stale
+        """
+        try:
+            frame_type, payload = decode_frame(data)
+            if frame_type == FrameType.TARGET_EVENT:
+                self._handle_target_event(parse_target_event_payload(payload))
+                return None
+            if frame_type != FrameType.TELEMETRY:
+                return None
+            sample = parse_telemetry_payload(payload)
+        except FrameError as e:
+            logger.debug(f"Dropping invalid telemetry datagram: {e}")
+            self.samples_dropped += 1
+            return None
+
+        now = time.monotonic()
+        if self._latest is not None:
+            # Sequence is a wrapping u32; accept only forward progress
+            delta = (sample.sequence - self._latest.sequence) & 0xFFFFFFFF
+            if delta == 0 or delta >= 0x80000000:
+                if not self._restarted(delta, sample.controller_time_us,
+                                       self._latest.controller_time_us, self._latest.received_at, now):
+                    self.samples_dropped += 1
+                    return None
+                logger.info(f"Telemetry stream restarted at sequence {sample.sequence}")
+
+        sample.received_at = now
+        self._latest = sample
+        self.samples_received += 1
+        self._new_sample.set()
+
+        for callback in self._callbacks:
+            try:
+                callback(sample)
+            except Exception as e:
+                logger.error(f"Telemetry callback error: {e}")
+        return sample
+
+    @property
+    def latest(self) -> Optional[TelemetrySample]:
+        """Most recent sample regardless of age."""
+        return self._latest
+
+    def get_fresh_sample(self, max_age: Optional[float] = None) -> Optional[TelemetrySample]:
+        """Most recent sample if it is younger than max_age seconds."""
+        sample = self._latest
+        if sample is None:
+            return None
+        limit = self.max_age if max_age is None else max_age
+        if time.monotonic() - sample.received_at > limit:
+            return None
+        return sample
+
+    async def wait_for_sample(self, timeout: float = 1.0) -> Optional[TelemetrySample]:
+        """Wait for the next sample to arrive."""
+        self._new_sample.clear()
+        try:
+            await asyncio.wait_for(self._new_sample.wait(), timeout)
+        except asyncio.TimeoutError:
+            return None
+        return self._latest
+
+    def _restarted(self, delta: int, time_us: int, last_time_us: int, last_at: float, now: float) -> bool:
+        """Whether a datagram that does not move the sequence forward starts a new stream."""
+        restarted = (
+            (-delta) & 0xFFFFFFFF > self.RESTART_GAP
+            or last_time_us - time_us > self.RESTART_CLOCK_S * 1e6
+            or now - last_at > self.RESTART_SILENCE_S
+        )
+        if restarted:
+            self.restarts += 1
+        return restarted
+
+    def _handle_target_event(self, event: TargetEvent):
+        now = time.monotonic()
+        if self._last_event_sequence is not None:
+            delta = (event.sequence - self._last_event_sequence) & 0xFFFFFFFF
+            if delta == 0 or delta >= 0x80000000:
+                if not self._restarted(delta, event.controller_time_us,
+                                       self._last_event_time_us, self._last_event_at, now):
+                    return
+            else:
+                # Gaps mean lost datagrams; OnStepXExtended.get_target_queue_status() resyncs
+                self.events_lost += delta - 1
+        self._last_event_sequence = event.sequence
+        self._last_event_time_us = event.controller_time_us
+        self._last_event_at = now
+
+        for callback in self._event_callbacks:
+            try:
+                callback(event)
+            except Exception as e:
+                logger.error(f"Target event callback error: {e}")
+
+    def register_event_callback(self, callback: Callable[[TargetEvent], None]):
+        """Register callback invoked for every target queue event."""
+        self._event_callbacks.append(callback)
+
+    def unregister_event_callback(self, callback: Callable[[TargetEvent], None]):
+        """Remove a previously registered target event callback."""
+        if callback in self._event_callbacks:
+            self._event_callbacks.remove(callback)
+
+    def register_callback(self, callback: Callable[[TelemetrySample], None]):
+        """Register callback invoked for every accepted sample."""
+        self._callbacks.append(callback)
+
+    def unregister_callback(self, callback: Callable[[TelemetrySample], None]):
+        """Remove a previously registered callback."""
+        if callback in self._callbacks:
+            self._callbacks.remove(callback)
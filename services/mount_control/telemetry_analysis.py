@@ -0,0 +1,519 @@
+"""
+NIGHTWATCH Telemetry Analytics
+
+Whole-night analysis of the telemetry push stream (TelemetryStream.h).
+EncoderBridge.get_position_error() compares one sample per call, which is
+far too slow for hours of data per night. Here samples from
+TelemetrySubscriber are appended to a columnar on-disk log: one raw
+little-endian file per field, read back through numpy memory maps. Every
+analysis then runs as array operations over the whole night:
+
+    periodic_error()   binned encoder-minus-step error over output-shaft
+                       phase, Welch periodogram (batched rfft), integer
+                       harmonic DFT and a least-squares fit of the
+                       strongest harmonics
+    backlash()         error jump across axis direction reversals
+    slip_statistics()  slip flags, error jumps and lost datagrams
+
+PeriodicErrorResult.to_pec_model() gives a PECModel for
+OnStepXExtended.pec_upload_model(). For pointing runs, TelemetryLog.position_at()
+gives the mount position at plate-solve mid-exposure times
+(observation_from_solve()), taken from the log instead of a query per frame.
+
+Needs numpy, so it is imported directly, not from services.mount_control.
+
+Example:
+    >>> log = TelemetryLog("/data/telemetry/2026-10-14")
+    >>> telemetry.register_callback(log.append)
+    >>> ...
+    >>> log.flush()
+    >>> result = periodic_error(log, AXIS1_CALIBRATION)
+    >>> await mount.pec_upload_model(result.to_pec_model())
+"""
+
+import json
+import logging
+import os
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Sequence, Tuple
+
+import numpy as np
+
+from .nightwatch_protocol import (
+    MAS_PER_DEGREE,
+    STATUS_ENCODER_SLIP,
+    STATUS_SLEWING,
+    STATUS_TRACKING,
+    PECModel,
+)
+from .telemetry import TelemetrySample
+
+logger = logging.getLogger(__name__)
+
+ARCSEC_PER_REV = 1_296_000.0
+SIDEREAL_ARCSEC_PER_S = 15.041067
+
+LOG_VERSION = 1
+
+# Column name -> little-endian dtype
+LOG_COLUMNS: Dict[str, str] = {
+    "sequence": "<u4",
+    "controller_time_us": "<u8",
+    "utc_time_us": "<u8",  # 0 while the controller clock is unsynced
+    "axis1_steps": "<i4",
+    "axis2_steps": "<i4",
+    "axis1_encoder": "<i4",
+    "axis2_encoder": "<i4",
+    "ra_mas": "<u4",
+    "dec_mas": "<i4",
+    "flags": "u1",
+    "pier": "u1",  # 0 unknown, 1 east, 2 west
+}
+
+_PIER_CODES = {"?": 0, "E": 1, "W": 2}
+
+MIN_SEGMENT_BINS = 16  # Shorter tracking runs carry no usable periodic error
+
+
+# =============================================================================
+# AXIS CALIBRATION
+# =============================================================================
+
+@dataclass(frozen=True)
+class AxisCalibration:
+    """
+    Step and encoder scale of one axis (AxisGeometry.h, PecModel.h OutputPhase).
+
+    Output-shaft phase is taken from the encoder exactly as the firmware's
+    PEC model indexes it, so fitted harmonics line up with the controller.
+    """
+    axis: int
+    steps_per_rev: int  # Tracking microsteps per output revolution
+    encoder_counts_per_rev: int  # AXIS*_ENCODER_PPR x reduction
+    encoder_origin: int = 0  # AXIS*_ENCODER_ORIGIN
+    harmonic_ratio: int = 100  # Wave generator turns per output revolution
+
+
+# Config.h: 200 steps x 16 microsteps x 27 x 100 (RA), x 27 x 80 (Dec), 8192 PPR
+AXIS1_CALIBRATION = AxisCalibration(1, 200 * 16 * 27 * 100, 8192 * 27 * 100, 0, 100)
+AXIS2_CALIBRATION = AxisCalibration(2, 200 * 16 * 27 * 80, 8192 * 27 * 80, 0, 80)
+
+
+# =============================================================================
+# COLUMNAR LOG
+# =============================================================================
+
+class TelemetryLog:
+    """
+    Append-only columnar telemetry log in one directory.
+
+    append() buffers samples and every flush_every samples writes each
+    column to its own file; reads map the files with np.memmap, so a night
+    never has to fit in memory. Register append() as a TelemetrySubscriber
+    callback.
+
+    A crash part way through flush() leaves some columns longer than
+    others; opening the log truncates every column to the shortest, so
+    rows stay aligned across files.
+    """
+
+    def __init__(self, path: str, flush_every: int = 4096):
+        self.path = path
+        self.flush_every = flush_every
+        self._buffer: List[Tuple] = []
+        os.makedirs(path, exist_ok=True)
+        schema_path = os.path.join(path, "schema.json")
+        if os.path.exists(schema_path):
+            with open(schema_path) as f:
+                schema = json.load(f)
+            if schema.get("version") != LOG_VERSION or schema.get("columns") != LOG_COLUMNS:
+                raise ValueError(f"Telemetry log {path} has an incompatible schema")
+            self._truncate_to_shortest()
+        else:
+            with open(schema_path, "w") as f:
+                json.dump({"version": LOG_VERSION, "columns": LOG_COLUMNS}, f)
+
+    def append(self, sample: TelemetrySample):
+        """Buffer one sample; flushes every flush_every samples."""
+        self._buffer.append((
+            sample.sequence,
+            sample.controller_time_us,
+            sample.utc_time_us or 0,
+            sample.axis1_steps,
+            sample.axis2_steps,
+            sample.axis1_encoder,
+            sample.axis2_encoder,
+            int(round(sample.ra_degrees * MAS_PER_DEGREE)) % 0x100000000,
+            int(round(sample.dec_degrees * MAS_PER_DEGREE)),
+            sample.flags,
+            _PIER_CODES.get(sample.pier_side, 0),
+        ))
+        if len(self._buffer) >= self.flush_every:
+            self.flush()
+
+    def flush(self):
+        """Write buffered samples to the column files."""
+        if not self._buffer:
+            return
+        columns = list(zip(*self._buffer))
+        for (name, dtype), values in zip(LOG_COLUMNS.items(), columns):
+            with open(self._column_path(name), "ab") as f:
+                np.asarray(values, dtype=dtype).tofile(f)
+        self._buffer.clear()
+
+    def __len__(self) -> int:
+        return min(self._column_length(name) for name in LOG_COLUMNS)
+
+    def _column_length(self, name: str) -> int:
+        path = self._column_path(name)
+        if not os.path.exists(path):
+            return 0
+        return os.path.getsize(path) // np.dtype(LOG_COLUMNS[name]).itemsize
+
+    def _truncate_to_shortest(self):
+        """Drop rows, and partial values, that an interrupted flush wrote to only some columns."""
+        count = len(self)
+        for name, dtype in LOG_COLUMNS.items():
+            path = self._column_path(name)
+            size = count * np.dtype(dtype).itemsize
+            if os.path.exists(path) and os.path.getsize(path) != size:
+                logger.warning(f"Telemetry log {self.path}: truncating {name} to {count} samples")
+                os.truncate(path, size)
+
+    def column(self, name: str) -> np.ndarray:
+        """Read-only memory map of one column (flushed samples only)."""
+        dtype = np.dtype(LOG_COLUMNS[name])
+        count = len(self)
+        if count == 0:
+            return np.empty(0, dtype=dtype)
+        return np.memmap(self._column_path(name), dtype=dtype, mode="r", shape=(count,))
+
+    def position_at(self, utc_time_us: Sequence[int]) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """
+        Mount RA/Dec and pier side at the given UTC instants.
+
+        Interpolates between the bracketing samples, e.g. at plate-solve
+        mid-exposure times for observation_from_solve(). Needs a
+        TimeDiscipline-synced controller.
+
+        Returns:
+            (ra_deg, dec_deg, pier_west) arrays
+        """
+        utc = self.column("utc_time_us")
+        synced = np.flatnonzero(utc)
+        if synced.size < 2:
+            raise ValueError("Telemetry log has no UTC-stamped samples")
+        t = utc[synced].astype(np.float64)
+        query = np.asarray(utc_time_us, dtype=np.float64)
+        ra = self.column("ra_mas")[synced].astype(np.float64) / MAS_PER_DEGREE
+        # Unwrap so interpolation across 0h does not sweep the whole sky
+        ra = np.degrees(np.unwrap(np.radians(ra)))
+        ra_at = np.mod(np.interp(query, t, ra), 360.0)
+        dec_at = np.interp(query, t, self.column("dec_mas")[synced].astype(np.float64) / MAS_PER_DEGREE)
+        nearest = np.clip(np.searchsorted(t, query), 0, t.size - 1)
+        pier_west = self.column("pier")[synced][nearest] == _PIER_CODES["W"]
+        return ra_at, dec_at, pier_west
+
+    def _column_path(self, name: str) -> str:
+        return os.path.join(self.path, f"{name}.bin")
+
+
+# =============================================================================
+# SHARED HELPERS
+# =============================================================================
+
+def tracking_segments(log: TelemetryLog, max_gap_s: float = 5.0, min_samples: int = 64) -> List[slice]:
+    """
+    Runs of plain sidereal tracking: tracking, not slewing, no slip flag and
+    no gap longer than max_gap_s between samples.
+    """
+    flags = log.column("flags")
+    if flags.size == 0:
+        return []
+    good = ((flags & STATUS_TRACKING) != 0) & ((flags & (STATUS_SLEWING | STATUS_ENCODER_SLIP)) == 0)
+    t = log.column("controller_time_us").astype(np.int64)
+    gap = np.diff(t) > int(max_gap_s * 1e6)
+    prev_ok = np.concatenate(([False], good[:-1] & ~gap))
+    next_ok = np.concatenate((good[1:] & ~gap, [False]))
+    starts = np.flatnonzero(good & ~prev_ok)
+    stops = np.flatnonzero(good & ~next_ok) + 1
+    return [slice(a, b) for a, b in zip(starts, stops) if b - a >= min_samples]
+
+
+def axis_error_arcsec(log: TelemetryLog, calibration: AxisCalibration) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Encoder-minus-step position of one axis and its output-shaft phase.
+
+    Returns:
+        (error_arcsec, phase_rev): error with an arbitrary constant offset
+        (both counters have their own zero); phase in revolutions, unwrapped
+    """
+    a = calibration.axis
+    steps = log.column(f"axis{a}_steps").astype(np.float64)
+    phase = (log.column(f"axis{a}_encoder").astype(np.float64) - calibration.encoder_origin) \
+        / calibration.encoder_counts_per_rev
+    error = (phase - steps / calibration.steps_per_rev) * ARCSEC_PER_REV
+    return error, phase
+
+
+def _harmonic_power(phase_rev: np.ndarray, error: np.ndarray, cycles: np.ndarray, chunk: int = 2048) -> np.ndarray:
+    """|DFT|^2 of error at integer cycles/rev over irregular phases, in chunks of bins."""
+    total = np.zeros(cycles.size, dtype=np.complex128)
+    for i in range(0, phase_rev.size, chunk):
+        basis = np.exp(-2j * np.pi * np.outer(cycles, phase_rev[i:i + chunk]))
+        total += basis @ error[i:i + chunk]
+    return np.abs(total) ** 2
+
+
+def _window_median(values: np.ndarray, centers: np.ndarray, start: int, stop: int) -> np.ndarray:
+    """Median of values[c + start : c + stop] for every c, windows clipped to the array."""
+    offsets = np.arange(start, stop)
+    index = np.clip(centers[:, None] + offsets[None, :], 0, values.size - 1)
+    return np.median(values[index], axis=1)
+
+
+# =============================================================================
+# PERIODIC ERROR
+# =============================================================================
+
+@dataclass
+class PeriodicErrorResult:
+    """Periodic error of one axis over output-shaft phase."""
+    axis: int
+    frequencies: np.ndarray  # Periodogram bins, cycles per output revolution
+    power: np.ndarray  # Averaged periodogram, arcsec^2 per bin
+    terms: List[Tuple[int, float, float]] = field(default_factory=list)  # (cycles/rev, cos ", sin ") of the error
+    rms_arcsec: float = 0.0  # Detrended error
+    residual_rms_arcsec: float = 0.0  # After removing the fitted terms
+    samples: int = 0
+
+    def evaluate(self, phase_rev: np.ndarray) -> np.ndarray:
+        """Fitted error at output-shaft phases, arcseconds."""
+        phase_rev = np.asarray(phase_rev, dtype=np.float64)
+        total = np.zeros_like(phase_rev)
+        for cycles, c, s in self.terms:
+            angle = 2 * np.pi * cycles * phase_rev
+            total += c * np.cos(angle) + s * np.sin(angle)
+        return total
+
+    def to_pec_model(self, kind: str = "fourier", lut_points: int = 8192,
+                     cycles_per_rev: Optional[int] = None) -> PECModel:
+        """
+        PEC model cancelling the fitted error (corrections are its negative).
+
+        Args:
+            kind: "fourier" (every fitted term) or "lut" (PEC_MODEL_LUT firmware)
+            lut_points: PEC_LUT_POINTS
+            cycles_per_rev: LUT period; defaults to the strongest term. Only
+                terms that are multiples of it fit in the table.
+        """
+        if not self.terms:
+            raise ValueError(f"No periodic error fitted for axis {self.axis}")
+        if kind == "fourier":
+            return PECModel(axis=self.axis, kind="fourier",
+                            terms=[(cycles, -c, -s) for cycles, c, s in self.terms])
+        if kind == "lut":
+            if cycles_per_rev is None:
+                cycles_per_rev = max(self.terms, key=lambda t: t[1] ** 2 + t[2] ** 2)[0]
+            table_phase = np.arange(lut_points) / (lut_points * cycles_per_rev)
+            periodic = [t for t in self.terms if t[0] % cycles_per_rev == 0]
+            table = PeriodicErrorResult(self.axis, self.frequencies, self.power, periodic).evaluate(table_phase)
+            return PECModel(axis=self.axis, kind="lut", corrections_arcsec=list(-table),
+                            cycles_per_rev=cycles_per_rev)
+        raise ValueError(f"Unknown PEC model kind: {kind}")
+
+
+def periodic_error(
+    log: TelemetryLog,
+    calibration: AxisCalibration,
+    terms: int = 24,
+    harmonics: Optional[Sequence[int]] = None,
+    max_cycles_per_rev: Optional[int] = None,
+    samples_per_cycle: int = 8,
+    window_bins: int = 4096,
+) -> PeriodicErrorResult:
+    """
+    Periodogram and harmonic fit of the periodic error of one axis.
+
+    Tracking segments are detrended (rate and offset), averaged into
+    uniform output-phase bins, then cut into Hann windows whose rfft power
+    is averaged (Welch) for the reported periodogram. The strongest integer
+    harmonics, or the given ones, are fitted by least squares over all
+    bins at once.
+
+    Args:
+        calibration: Axis scales
+        terms: Harmonics to fit (PEC_FOURIER_TERMS)
+        harmonics: Cycles/rev to fit instead of picking periodogram peaks
+        max_cycles_per_rev: Highest harmonic resolved; defaults to
+            2 x 2 x harmonic ratio (above the wave generator's 2x term)
+        samples_per_cycle: Phase bins per cycle of max_cycles_per_rev
+        window_bins: Welch window length in bins
+    """
+    if max_cycles_per_rev is None:
+        max_cycles_per_rev = 4 * calibration.harmonic_ratio
+    bin_rev = 1.0 / (max_cycles_per_rev * samples_per_cycle)
+    error, phase = axis_error_arcsec(log, calibration)
+
+    bin_phase: List[np.ndarray] = []
+    bin_error: List[np.ndarray] = []
+    for seg in tracking_segments(log):
+        p, e = phase[seg], error[seg]
+        if abs(p[-1] - p[0]) < MIN_SEGMENT_BINS * bin_rev:
+            continue
+        e = e - np.polyval(np.polyfit(p - p[0], e, 1), p - p[0])
+        index = np.floor((p - p.min()) / bin_rev).astype(np.int64)
+        counts = np.bincount(index)
+        sums = np.bincount(index, weights=e)
+        filled = counts > 0
+        centers = p.min() + (np.arange(counts.size) + 0.5) * bin_rev
+        # Empty bins (a dropped datagram) are interpolated from their neighbours
+        means = np.interp(centers, centers[filled], sums[filled] / counts[filled])
+        bin_phase.append(centers)
+        bin_error.append(means)
+
+    if not bin_phase:
+        logger.warning(f"Axis {calibration.axis}: no tracking segment long enough for periodic error")
+        return PeriodicErrorResult(calibration.axis, np.empty(0), np.empty(0))
+
+    # Welch periodogram: every half-overlapping window of every segment long
+    # enough for one, in one batched rfft. A night of RA tracking covers well
+    # under one output revolution, so the window is usually the longest segment.
+    length = min(window_bins, max(b.size for b in bin_error))
+    stack = np.vstack([b[i:i + length] for b in bin_error if b.size >= length
+                       for i in range(0, b.size - length + 1, max(1, length // 2))])
+    taper = np.hanning(length)
+    spectrum = np.fft.rfft((stack - stack.mean(axis=1, keepdims=True)) * taper, axis=1)
+    power = (np.abs(spectrum) ** 2).mean(axis=0) * 2 / (taper ** 2).sum()
+    frequencies = np.fft.rfftfreq(length, d=bin_rev)
+
+    all_phase = np.concatenate(bin_phase)
+    all_error = np.concatenate(bin_error)
+    if harmonics is None:
+        # A night spans a fraction of an output revolution, far too little for
+        # the Welch bins to resolve integer harmonics; pick from a DFT at every
+        # integer cycles/rev instead, local maxima only so one line is one term
+        candidates = np.arange(1, max_cycles_per_rev + 1)
+        line = _harmonic_power(all_phase, all_error, candidates)
+        peaks = np.flatnonzero(np.r_[True, line[1:] > line[:-1]] & np.r_[line[:-1] >= line[1:], True])
+        harmonics = sorted(int(candidates[i]) for i in peaks[np.argsort(line[peaks])[::-1][:terms]])
+    if not harmonics:
+        return PeriodicErrorResult(calibration.axis, frequencies, power, samples=int(all_error.size))
+    harmonics = [int(h) for h in harmonics]
+
+    angle = 2 * np.pi * all_phase[:, None] * np.asarray(harmonics, dtype=np.float64)[None, :]
+    design = np.hstack((np.cos(angle), np.sin(angle), np.ones((all_phase.size, 1))))
+    coefficients, *_ = np.linalg.lstsq(design, all_error, rcond=None)
+    count = len(harmonics)
+    fitted = [(h, float(coefficients[i]), float(coefficients[count + i])) for i, h in enumerate(harmonics)]
+    residual = all_error - design @ coefficients
+
+    result = PeriodicErrorResult(
+        axis=calibration.axis,
+        frequencies=frequencies,
+        power=power,
+        terms=fitted,
+        rms_arcsec=float(np.std(all_error)),
+        residual_rms_arcsec=float(np.std(residual)),
+        samples=int(all_error.size),
+    )
+    logger.info(
+        f"Axis {calibration.axis} periodic error: {result.rms_arcsec:.2f}\" RMS, "
+        f"{result.residual_rms_arcsec:.2f}\" after {count} terms"
+    )
+    return result
+
+
+# =============================================================================
+# BACKLASH
+# =============================================================================
+
+@dataclass
+class BacklashResult:
+    """Backlash of one axis from direction reversals."""
+    axis: int
+    reversals: int
+    backlash_arcsec: float  # Median error jump across a reversal
+    spread_arcsec: float  # Median absolute deviation of the jumps
+    takeup_s: float  # Time to take it up at track_backlash_rate x sidereal
+
+
+def backlash(
+    log: TelemetryLog,
+    calibration: AxisCalibration,
+    window: int = 32,
+    track_backlash_rate: float = 25.0,
+) -> BacklashResult:
+    """
+    Error jump across every direction reversal of one axis (guiding, Dec
+    corrections, RA reversals after a flip).
+
+    Args:
+        window: Samples either side of a reversal; the first half of the
+            after-window is skipped while the slack is being taken up
+        track_backlash_rate: TRACK_BACKLASH_RATE in Config.h
+    """
+    error, _ = axis_error_arcsec(log, calibration)
+    steps = log.column(f"axis{calibration.axis}_steps").astype(np.int64)
+    direction = np.sign(np.diff(steps))
+    # Carry the last moving direction through stationary samples
+    moving = np.where(direction != 0, np.arange(direction.size), 0)
+    np.maximum.accumulate(moving, out=moving)
+    held = direction[moving]
+    # Sample at which the axis turned round
+    reversal = np.flatnonzero((held[1:] != held[:-1]) & (held[1:] != 0) & (held[:-1] != 0)) + 1
+    reversal = reversal[(reversal >= window) & (reversal + window <= error.size)]
+    if reversal.size == 0:
+        return BacklashResult(calibration.axis, 0, 0.0, 0.0, 0.0)
+    before = _window_median(error, reversal, -window, 0)
+    after = _window_median(error, reversal, window // 2, window)
+    jumps = np.abs(after - before)
+    amount = float(np.median(jumps))
+    return BacklashResult(
+        axis=calibration.axis,
+        reversals=int(reversal.size),
+        backlash_arcsec=amount,
+        spread_arcsec=float(np.median(np.abs(jumps - amount))),
+        takeup_s=amount / (track_backlash_rate * SIDEREAL_ARCSEC_PER_S),
+    )
+
+
+# =============================================================================
+# SLIP STATISTICS
+# =============================================================================
+
+@dataclass
+class SlipStatistics:
+    """Slip and data-quality counts for one axis over the log."""
+    axis: int
+    slip_events: int  # Rising edges of STATUS_ENCODER_SLIP
+    error_jumps: int  # Sample-to-sample error steps above the threshold while tracking
+    max_jump_arcsec: float
+    lost_samples: int  # Telemetry sequence gaps
+    samples: int
+
+
+def slip_statistics(log: TelemetryLog, calibration: AxisCalibration, jump_arcsec: float = 20.0) -> SlipStatistics:
+    """
+    Slip counts for one axis.
+
+    Args:
+        jump_arcsec: Error step treated as a slip (ENCODER_LOOP_SLIP_ARCSEC)
+    """
+    flags = log.column("flags")
+    count = int(flags.size)
+    if count < 2:
+        return SlipStatistics(calibration.axis, 0, 0, 0.0, 0, count)
+    slip = (flags & STATUS_ENCODER_SLIP) != 0
+    tracking = ((flags[1:] & STATUS_TRACKING) != 0) & ((flags[1:] & STATUS_SLEWING) == 0)
+    error, _ = axis_error_arcsec(log, calibration)
+    steps = np.abs(np.diff(error))[tracking]
+    gaps = np.diff(log.column("sequence").astype(np.int64)) % 0x100000000
+    return SlipStatistics(
+        axis=calibration.axis,
+        slip_events=int(np.count_nonzero(slip[1:] & ~slip[:-1]) + int(slip[0])),
+        error_jumps=int(np.count_nonzero(steps > jump_arcsec)),
+        max_jump_arcsec=float(steps.max()) if steps.size else 0.0,
+        lost_samples=int(np.sum(gaps[gaps > 1] - 1)),
+        samples=count,
+    )
@@ -1157,6 +1157,41 @@ class SafetyMonitor:
         except Exception as e:
             logger.error(f"Failed to execute safety action: {e}")
 
+    def _claim_safety_session(self):
+        """
+        Put the mount client's session in the firmware's safety class.
+
+        On a NIGHTWATCH command server only a safety session gets :hP#
+        ahead of every queued command, so the monitor's parks do not wait
+        behind other services' traffic. Give the monitor its own client.
+        """
+        claim = getattr(self.mount, "claim_session_priority", None)
+        if claim is None:
+            return
+        try:
+            from services.mount_control.lx200 import SessionPriority
+            if not claim(SessionPriority.SAFETY):
+                logger.info("Mount session not in the safety class (stock firmware or not connected yet)")
+        except Exception as e:
+            logger.warning(f"Mount safety session claim failed: {e}")
+
+    async def _mount_heartbeat(self, arm: bool = True):
+        """
+        Feed the mount controller's safety heartbeat, if it has one.
+
+        With SAFETY_PARK firmware the controller parks by itself once the
+        heartbeats stop, so a hung monitor or a dead network still parks.
+        """
+        heartbeat = getattr(self.mount, "safety_heartbeat", None)
+        if heartbeat is None:
+            return
+        try:
+            result = heartbeat(arm)
+            if asyncio.iscoroutine(result):
+                await result
+        except Exception as e:
+            logger.warning(f"Mount safety heartbeat failed: {e}")
+
     async def _notify_callbacks(self, status: SafetyStatus):
         """Notify registered callbacks of status change."""
         for callback in self._callbacks:
@@ -1177,6 +1212,7 @@ class SafetyMonitor:
         """
         logger.info("Safety monitor started")
         self._running = True
+        self._claim_safety_session()
 
         last_action = None
 
@@ -1222,8 +1258,13 @@ class SafetyMonitor:
             except Exception as e:
                 logger.error(f"Safety monitor error: {e}")
 
+            # Every pass, so the firmware timeout spans several missed polls
+            await self._mount_heartbeat()
+
             await asyncio.sleep(poll_interval)
 
+        await self._mount_heartbeat(arm=False)
+
     def stop(self):
         """Stop the monitoring loop."""
         self._running = False
@@ -46,6 +46,46 @@ class ScheduleReason(Enum):
     MERIDIAN_TRANSIT = "meridian_transit"
 
 
+def scurve_move_seconds(distance_deg: float, rate: float, accel: float, jerk: float) -> float:
+    """
+    Duration of a rest-to-rest jerk-limited move.
+
+    Mirrors SCurveProfile in firmware/onstepx_config/nightwatch/SCurvePlanner.h:
+    seven segments, with the peak velocity lowered when the move is too short
+    to reach the goto rate.
+
+    Args:
+        distance_deg: Axis travel in degrees
+        rate: Peak velocity (degrees/second)
+        accel: Peak acceleration (degrees/second²)
+        jerk: Jerk limit (degrees/second³)
+
+    Returns:
+        Move duration in seconds
+    """
+    if distance_deg <= 0:
+        return 0.0
+
+    def accel_phase(v: float) -> tuple[float, float]:
+        a = min(accel, math.sqrt(v * jerk))
+        t = 2 * a / jerk + (v / a - a / jerk)
+        return t, v * t / 2  # time and distance from rest to v
+
+    v = rate
+    t_acc, d_acc = accel_phase(v)
+    if 2 * d_acc > distance_deg:
+        lo, hi = 0.0, rate
+        for _ in range(48):
+            v = (lo + hi) / 2
+            if 2 * accel_phase(v)[1] > distance_deg:
+                hi = v
+            else:
+                lo = v
+        v = lo
+        t_acc, d_acc = accel_phase(v)
+    return 2 * t_acc + max(0.0, distance_deg - 2 * d_acc) / v
+
+
 # =============================================================================
 # Data Classes
 # =============================================================================
@@ -79,6 +119,13 @@ class SchedulingConstraints:
     prefer_user_favorites: bool = True
     consider_history: bool = True
 
+    # Transition constraints (between consecutive targets)
+    transition_buffer_minutes: float = 5.0  # Used when no slew model is set
+    slew_rate_deg_s: float = 4.0  # Firmware GOTO_RATE
+    slew_accel_deg_s2: float = 2.0  # Firmware GOTO_ACCELERATION
+    slew_jerk_deg_s3: Optional[float] = None  # Firmware AXIS*_JERK; enables S-curve estimate
+    settle_seconds: float = 30.0  # Settle + plate solve after each slew
+
 
 @dataclass
 class ScheduledTarget:
@@ -294,8 +341,12 @@ class ObservingScheduler:
         current_time = constraints.start_time or obs_time
         end_time = constraints.end_time or (obs_time + timedelta(hours=8))
         total_minutes = 0.0
+        previous: Optional[CandidateTarget] = None
 
         for candidate in filtered:
+            if previous is not None:
+                current_time += self._transition_time(previous, candidate, constraints)
+
             # Check if we have time remaining
             remaining = (end_time - current_time).total_seconds() / 60
             if remaining < constraints.min_observation_minutes:
@@ -327,8 +378,9 @@ class ObservingScheduler:
             )
             scheduled_targets.append(scheduled)
 
-            current_time += timedelta(minutes=duration + 5)  # 5 min buffer
+            current_time += timedelta(minutes=duration)
             total_minutes += duration
+            previous = candidate
 
         return ScheduleResult(
             targets=scheduled_targets,
@@ -472,6 +524,35 @@ class ObservingScheduler:
 
         return candidates
 
+    def _transition_time(
+        self,
+        previous: CandidateTarget,
+        candidate: CandidateTarget,
+        constraints: SchedulingConstraints,
+    ) -> timedelta:
+        """
+        Time between the end of one observation and the start of the next.
+
+        With slew_jerk_deg_s3 set this is the firmware S-curve goto time for
+        the slower axis plus settle time; otherwise the fixed buffer.
+        """
+        if constraints.slew_jerk_deg_s3 is None:
+            return timedelta(minutes=constraints.transition_buffer_minutes)
+
+        ra_delta = abs(candidate.ra_hours - previous.ra_hours) * 15.0
+        ra_delta = min(ra_delta, 360.0 - ra_delta)
+        dec_delta = abs(candidate.dec_degrees - previous.dec_degrees)
+
+        # Both axes slew concurrently; the longer move sets the time
+        slew = max(
+            scurve_move_seconds(
+                distance, constraints.slew_rate_deg_s,
+                constraints.slew_accel_deg_s2, constraints.slew_jerk_deg_s3,
+            )
+            for distance in (ra_delta, dec_delta)
+        )
+        return timedelta(seconds=slew + constraints.settle_seconds)
+
     def _calculate_altitude(
         self,
         ra_hours: float,
@@ -0,0 +1,484 @@
+"""
+NIGHTWATCH Firmware Replay Simulator
+
+MountSimulator answers LX200 with a loose model of a mount. This module
+drives the host replay build of the firmware instead
+(firmware/onstepx_config/sim/MountReplay.cpp). That program compiles the
+real Config.h geometry, SCurvePlanner, CoordinatedGoto and PecModel
+headers, and replays a trace in virtual time, far faster than real time.
+
+    FirmwareReplay     builds MountReplay for one Config.h variant, with
+                       overrides patched into a private copy of Config.h and
+                       cached by source hash, then runs traces through it
+    ReplayTrace        event script: recorded LX200 commands
+                       (TraceRecorder downloads or (time, command) pairs),
+                       telemetry samples to probe at, target queues,
+                       periodic error terms and PEC model uploads
+    ReplayResult       gotos, refusals, stops, meridian limits, probes, the
+                       PEC residual and the summary (slews per hour, ...)
+
+Typical overnight uses: compare GOTO_ACCELERATION or AXIS*_JERK variants on
+the same survey, or check a new PEC model against the periodic error
+measured by telemetry_analysis.periodic_error().
+
+Example:
+    >>> trace = ReplayTrace(lst_deg=120.0)
+    >>> for ra, dec in survey:
+    ...     trace.queue(0.0, ra, dec, dwell_s=120.0)
+    >>> baseline = FirmwareReplay().run(trace)
+    >>> faster = FirmwareReplay(overrides={"GOTO_ACCELERATION": 3.0}).run(trace)
+    >>> faster.slews_per_hour - baseline.slews_per_hour
+
+Needs a C++17 host compiler (CXX, else c++).
+"""
+
+import argparse
+import hashlib
+import json
+import logging
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+from dataclasses import dataclass, field
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple, Union
+
+from services.mount_control.nightwatch_protocol import (
+    TRACE_COMMAND,
+    PECModel,
+    TraceRecord,
+    encode_pec_model,
+)
+from services.mount_control.telemetry import TelemetrySample
+
+logger = logging.getLogger(__name__)
+
+FIRMWARE_DIR = os.path.normpath(
+    os.path.join(os.path.dirname(__file__), "..", "..", "firmware", "onstepx_config")
+)
+REPLAY_SOURCE = os.path.join("sim", "MountReplay.cpp")
+DEFAULT_BUILD_DIR = os.path.join(tempfile.gettempdir(), "nightwatch-replay")
+
+
+class ReplayBuildError(RuntimeError):
+    """MountReplay failed to compile for a Config.h variant."""
+
+
+# =============================================================================
+# TRACE
+# =============================================================================
+
+def _sexagesimal(text: str) -> Optional[float]:
+    """Parse "HH:MM:SS", "HH:MM.T" or "sDD*MM:SS" style LX200 values."""
+    match = re.match(r"\s*([+-]?)(\d+)[^\d]+(\d+(?:\.\d+)?)(?:[^\d]+(\d+(?:\.\d+)?))?", text)
+    if match is None:
+        return None
+    sign, whole, minutes, seconds = match.groups()
+    value = int(whole) + float(minutes) / 60.0 + float(seconds or 0) / 3600.0
+    return -value if sign == "-" else value
+
+
+def _unwrapped_seconds(times_us: Sequence[int], origin_us: int) -> List[float]:
+    """
+    Seconds from origin_us for a time-ordered run of 32-bit controller
+    micros() stamps, which wrap every 71.6 minutes.
+    """
+    seconds = []
+    elapsed = None
+    previous = origin_us
+    for time_us in times_us:
+        delta = (time_us - previous) & 0xFFFFFFFF
+        if elapsed is None and delta >= 1 << 31:
+            delta -= 1 << 32  # a run may start shortly before the origin
+        elapsed = delta if elapsed is None else elapsed + delta
+        previous = time_us
+        seconds.append(elapsed / 1e6)
+    return seconds
+
+
+class ReplayTrace:
+    """Event script for MountReplay; times in seconds from the trace origin."""
+
+    def __init__(self, lst_deg: float = 0.0):
+        self._events: List[Tuple[float, int, str]] = []
+        self.samples: List[TelemetrySample] = []
+        self.origin_us: Optional[int] = None
+        self.ignored_commands = 0
+        self._pending_ra: Optional[float] = None  # :Sr / :Sd until :MS
+        self._pending_dec: Optional[float] = None
+        self.lst(0.0, lst_deg)
+
+    def _add(self, time_s: float, text: str) -> "ReplayTrace":
+        self._events.append((time_s, len(self._events), text))
+        return self
+
+    def lst(self, time_s: float, lst_deg: float) -> "ReplayTrace":
+        return self._add(time_s, f"lst {lst_deg % 360.0:.6f}")
+
+    def goto(self, time_s: float, ra_deg: float, dec_deg: float) -> "ReplayTrace":
+        return self._add(time_s, f"goto {ra_deg:.6f} {dec_deg:.6f}")
+
+    def queue(self, time_s: float, ra_deg: float, dec_deg: float, dwell_s: float = 0.0) -> "ReplayTrace":
+        return self._add(time_s, f"queue {ra_deg:.6f} {dec_deg:.6f} {dwell_s:.3f}")
+
+    def track(self, time_s: float, enabled: bool = True) -> "ReplayTrace":
+        return self._add(time_s, f"track {1 if enabled else 0}")
+
+    def stop(self, time_s: float) -> "ReplayTrace":
+        return self._add(time_s, "stop")
+
+    def park(self, time_s: float) -> "ReplayTrace":
+        return self._add(time_s, "park")
+
+    def unpark(self, time_s: float) -> "ReplayTrace":
+        return self._add(time_s, "unpark")
+
+    def periodic_error(self, time_s: float, cycles_per_rev: int, cos_arcsec: float,
+                       sin_arcsec: float) -> "ReplayTrace":
+        """Inject an axis1 periodic error term (cycles per output revolution)."""
+        return self._add(time_s, f"pe {cycles_per_rev} {cos_arcsec:.4f} {sin_arcsec:.4f}")
+
+    def pec_model(self, time_s: float, model: PECModel) -> "ReplayTrace":
+        """Upload a PEC model, as OnStepXExtended.pec_upload_model() does."""
+        return self._add(time_s, f"pec {encode_pec_model(model).hex()}")
+
+    def probe(self, time_s: float) -> "ReplayTrace":
+        return self._add(time_s, "probe")
+
+    def end(self, time_s: float) -> "ReplayTrace":
+        return self._add(time_s, "end")
+
+    def command(self, time_s: float, command: str) -> bool:
+        """
+        Add one recorded LX200 command. Target, goto, stop, park and tracking
+        commands map to events; anything else is counted in ignored_commands.
+        """
+        text = command.strip().lstrip(":").rstrip("#")
+        if text.startswith("Sr"):
+            hours = _sexagesimal(text[2:])
+            if hours is not None:
+                self._pending_ra = hours * 15.0
+                return True
+        elif text.startswith("Sd"):
+            degrees = _sexagesimal(text[2:])
+            if degrees is not None:
+                self._pending_dec = degrees
+                return True
+        elif text == "MS":
+            if self._pending_ra is not None and self._pending_dec is not None:
+                self.goto(time_s, self._pending_ra, self._pending_dec)
+                return True
+        elif text == "Q":
+            self.stop(time_s)
+            return True
+        elif text == "hP":
+            self.park(time_s)
+            return True
+        elif text == "hR":
+            self.unpark(time_s)
+            return True
+        elif text in ("Te", "Td"):
+            self.track(time_s, text == "Te")
+            return True
+        self.ignored_commands += 1
+        return False
+
+    @classmethod
+    def from_commands(cls, commands: Iterable[Tuple[float, str]], lst_deg: float = 0.0) -> "ReplayTrace":
+        """Trace from (seconds, LX200 command) pairs."""
+        trace = cls(lst_deg)
+        for time_s, command in commands:
+            trace.command(time_s, command)
+        return trace
+
+    @classmethod
+    def from_trace_records(cls, records: Sequence[TraceRecord], lst_deg: float = 0.0) -> "ReplayTrace":
+        """
+        Trace from OnStepXExtended.download_trace() records. The first record
+        is the origin; lst_deg is the local sidereal time at that record.
+        """
+        trace = cls(lst_deg)
+        if not records:
+            return trace
+        trace.origin_us = records[0].time_us
+        times = _unwrapped_seconds([r.time_us for r in records], trace.origin_us)
+        for time_s, record in zip(times, records):
+            if record.kind == TRACE_COMMAND:
+                trace.command(time_s, record.command)
+        return trace
+
+    def add_samples(self, samples: Sequence[TelemetrySample]) -> "ReplayTrace":
+        """
+        Probe the simulation at each telemetry sample, on the controller clock
+        the trace records share; ReplayResult.pointing_residuals() compares.
+        """
+        if not samples:
+            return self
+        if self.origin_us is None:
+            self.origin_us = samples[0].controller_time_us
+        times = _unwrapped_seconds([s.controller_time_us for s in samples], self.origin_us)
+        for time_s, sample in zip(times, samples):
+            self.probe(max(time_s, 0.0))
+            self.samples.append(sample)
+        return self
+
+    def duration_s(self) -> float:
+        return max((t for t, _, _ in self._events), default=0.0)
+
+    def text(self) -> str:
+        """Events sorted by time, insertion order kept for equal times."""
+        return "".join(f"{t:.6f} {event}\n" for t, _, event in sorted(self._events))
+
+
+# =============================================================================
+# RESULT
+# =============================================================================
+
+@dataclass
+class ReplayGoto:
+    """One completed goto."""
+    goto_id: int
+    start_s: float
+    end_s: float
+    pier_side: str
+    legs: int
+
+    @property
+    def duration_s(self) -> float:
+        return self.end_s - self.start_s
+
+
+@dataclass
+class ReplayProbe:
+    """Simulated state at a probe time."""
+    time_s: float
+    state: str
+    ra_degrees: float
+    dec_degrees: float
+    pier_side: str
+    axis1_degrees: float
+    axis2_degrees: float
+
+
+@dataclass
+class ReplayResult:
+    """Everything MountReplay reported for one trace."""
+    gotos: List[ReplayGoto] = field(default_factory=list)
+    refused: List[Tuple[int, float, str]] = field(default_factory=list)
+    stops: List[Tuple[float, float]] = field(default_factory=list)
+    limits: List[float] = field(default_factory=list)
+    probes: List[ReplayProbe] = field(default_factory=list)
+    pec: Optional[Tuple[int, float, float]] = None  # samples, raw rms ", corrected rms "
+    errors: List[Tuple[int, str]] = field(default_factory=list)
+    summary: Dict[str, float] = field(default_factory=dict)
+
+    @property
+    def slews_per_hour(self) -> float:
+        return self.summary.get("slews_per_hour", 0.0)
+
+    @property
+    def speedup(self) -> float:
+        """Simulated seconds per wall-clock second."""
+        return self.summary.get("speedup", 0.0)
+
+    def pointing_residuals(self, samples: Sequence[TelemetrySample]) -> List[float]:
+        """Arcsec between each probe and the recorded sample it was taken for."""
+        residuals = []
+        for probe, sample in zip(self.probes, samples):
+            dec1, dec2 = math.radians(probe.dec_degrees), math.radians(sample.dec_degrees)
+            dra = math.radians(probe.ra_degrees - sample.ra_degrees)
+            cos_sep = math.sin(dec1) * math.sin(dec2) + math.cos(dec1) * math.cos(dec2) * math.cos(dra)
+            residuals.append(math.degrees(math.acos(max(-1.0, min(1.0, cos_sep)))) * 3600.0)
+        return residuals
+
+
+def parse_output(text: str) -> ReplayResult:
+    """Parse MountReplay stdout."""
+    result = ReplayResult()
+    for line in text.splitlines():
+        fields = line.split()
+        if not fields:
+            continue
+        kind, args = fields[0], fields[1:]
+        try:
+            if kind == "goto":
+                result.gotos.append(ReplayGoto(int(args[0]), float(args[1]), float(args[2]), args[3], int(args[4])))
+            elif kind == "refused":
+                result.refused.append((int(args[0]), float(args[1]), args[2]))
+            elif kind == "stopped":
+                result.stops.append((float(args[0]), float(args[1])))
+            elif kind == "limit":
+                result.limits.append(float(args[0]))
+            elif kind == "probe":
+                result.probes.append(ReplayProbe(
+                    float(args[0]), args[1], float(args[2]), float(args[3]), args[4],
+                    float(args[5]), float(args[6]),
+                ))
+            elif kind == "pec":
+                result.pec = (int(args[0]), float(args[1]), float(args[2]))
+            elif kind == "error":
+                result.errors.append((int(args[0]), " ".join(args[1:])))
+            elif kind == "summary":
+                result.summary = {k: float(v) for k, v in (a.split("=", 1) for a in args)}
+        except (IndexError, ValueError):
+            logger.warning(f"Unparsed replay output: {line}")
+    return result
+
+
+# =============================================================================
+# BUILD AND RUN
+# =============================================================================
+
+class FirmwareReplay:
+    """MountReplay built for one Config.h variant."""
+
+    def __init__(
+        self,
+        overrides: Optional[Dict[str, Union[str, float, int]]] = None,
+        firmware_dir: str = FIRMWARE_DIR,
+        build_dir: str = DEFAULT_BUILD_DIR,
+        compiler: Optional[str] = None,
+    ):
+        """
+        Args:
+            overrides: Config.h values to replace (NAME -> value); names not
+                defined in Config.h are passed as -D, overriding the
+                NightwatchConfig.h defaults
+            firmware_dir: Directory holding Config.h and nightwatch/
+            build_dir: Cache of built variants
+            compiler: C++ compiler (default CXX, else c++)
+        """
+        self.overrides = {k: str(v) for k, v in (overrides or {}).items()}
+        self.firmware_dir = firmware_dir
+        self.build_dir = build_dir
+        self.compiler = compiler or os.environ.get("CXX") or shutil.which("c++") or "g++"
+        self._binary: Optional[str] = None
+
+    def _patched_config(self) -> Tuple[str, List[str]]:
+        """Config.h text with overrides applied, and the -D flags for the rest."""
+        with open(os.path.join(self.firmware_dir, "Config.h")) as f:
+            config = f.read()
+        defines = []
+        for name, value in sorted(self.overrides.items()):
+            pattern = re.compile(rf"^(#define\s+{re.escape(name)}\s+)(?:\S.*?)(\s*//.*)?$", re.MULTILINE)
+            config, count = pattern.subn(lambda m: f"{m.group(1)}{value}{m.group(2) or ''}", config)
+            if count == 0:
+                defines.append(f"-D{name}={value}")
+        return config, defines
+
+    def _variant_key(self, config: str, defines: List[str]) -> str:
+        digest = hashlib.sha256()
+        digest.update(self.compiler.encode())
+        digest.update(config.encode())
+        digest.update(" ".join(defines).encode())
+        sources = [REPLAY_SOURCE] + sorted(
+            os.path.join("nightwatch", name)
+            for name in os.listdir(os.path.join(self.firmware_dir, "nightwatch"))
+            if name.endswith(".h")
+        )
+        for source in sources:
+            with open(os.path.join(self.firmware_dir, source), "rb") as f:
+                digest.update(f.read())
+        return digest.hexdigest()[:16]
+
+    def build(self) -> str:
+        """Compile the variant if not cached; returns the executable path."""
+        if self._binary is not None:
+            return self._binary
+        config, defines = self._patched_config()
+        variant = os.path.join(self.build_dir, self._variant_key(config, defines))
+        binary = os.path.join(variant, "mount_replay")
+        if not os.path.exists(binary):
+            # The headers include "../Config.h" relative to themselves, so
+            # the variant mirrors the firmware layout around its Config.h
+            for sub in ("nightwatch", "sim"):
+                shutil.copytree(os.path.join(self.firmware_dir, sub),
+                                os.path.join(variant, sub), dirs_exist_ok=True)
+            with open(os.path.join(variant, "Config.h"), "w") as f:
+                f.write(config)
+            command = [
+                self.compiler, "-std=gnu++17", "-O2", *defines,
+                "-I", variant,
+                os.path.join(variant, REPLAY_SOURCE),
+                "-o", binary + ".tmp",
+            ]
+            logger.info(f"Building MountReplay variant {os.path.basename(variant)}")
+            try:
+                proc = subprocess.run(command, capture_output=True, text=True)
+            except OSError as e:
+                raise ReplayBuildError(f"Cannot run {self.compiler}: {e}") from e
+            if proc.returncode != 0:
+                raise ReplayBuildError(proc.stderr.strip() or f"{self.compiler} exited {proc.returncode}")
+            os.replace(binary + ".tmp", binary)
+        self._binary = binary
+        return binary
+
+    def run(self, trace: Union[ReplayTrace, str], timeout: Optional[float] = None) -> ReplayResult:
+        """Replay a trace (ReplayTrace or MountReplay event text)."""
+        binary = self.build()
+        text = trace.text() if isinstance(trace, ReplayTrace) else trace
+        proc = subprocess.run([binary], input=text, capture_output=True, text=True, timeout=timeout)
+        if proc.returncode != 0:
+            raise RuntimeError(f"MountReplay exited {proc.returncode}: {proc.stderr.strip()}")
+        result = parse_output(proc.stdout)
+        for line, reason in result.errors:
+            logger.warning(f"Replay event line {line}: {reason}")
+        return result
+
+    def slews_per_hour(self, targets: Sequence[Tuple[float, float]], dwell_s: float,
+                       lst_deg: float = 0.0) -> float:
+        """
+        Scheduler throughput: targets (RA, Dec degrees) queued back to back,
+        each dwelling dwell_s after its settle.
+        """
+        trace = ReplayTrace(lst_deg)
+        for ra, dec in targets:
+            trace.queue(0.0, ra, dec, dwell_s)
+        result = self.run(trace)
+        if not result.gotos:
+            return 0.0
+        # Up to the end of the last dwell, not the last event
+        span = result.gotos[-1].end_s + dwell_s - result.gotos[0].start_s
+        return len(result.gotos) * 3600.0 / span if span > 0 else 0.0
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    parser = argparse.ArgumentParser(description="Replay a trace through the host firmware build")
+    parser.add_argument("trace", help="MountReplay event file, or '-' for stdin")
+    parser.add_argument("--commands", action="store_true",
+                        help="trace holds '<seconds> <LX200 command>' lines instead of events")
+    parser.add_argument("--lst", type=float, default=0.0, help="local sidereal time at t=0, degrees")
+    parser.add_argument("--set", action="append", default=[], metavar="NAME=VALUE",
+                        help="override a Config.h / NightwatchConfig.h value")
+    parser.add_argument("--build-dir", default=DEFAULT_BUILD_DIR)
+    args = parser.parse_args(argv)
+
+    overrides = dict(item.split("=", 1) for item in args.set)
+    text = sys.stdin.read() if args.trace == "-" else open(args.trace).read()
+    if args.commands:
+        pairs = []
+        for line in text.splitlines():
+            parts = line.split(None, 1)
+            if len(parts) == 2:
+                pairs.append((float(parts[0]), parts[1]))
+        trace: Union[ReplayTrace, str] = ReplayTrace.from_commands(pairs, args.lst)
+    else:
+        trace = text
+
+    result = FirmwareReplay(overrides, build_dir=args.build_dir).run(trace)
+    print(json.dumps({
+        "summary": result.summary,
+        "gotos": [[g.goto_id, g.start_s, g.end_s, g.pier_side, g.legs] for g in result.gotos],
+        "refused": result.refused,
+        "limits": result.limits,
+        "pec": result.pec,
+        "errors": result.errors,
+    }, indent=2))
+    return 1 if result.errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -87,6 +87,7 @@ class WeatherData:
     rain_sensor_status: str = "ok"  # Sensor health status
     sky_quality_mpsas: Optional[float] = None  # Mag per square arcsec (Step 203)
     sky_brightness: Optional[str] = None  # "excellent", "good", "fair", "poor"
+    station_pressure_inhg: Optional[float] = None  # Measured absolute (WH25 "abs"); None if not reported
 
 
 class EcowittClient:
@@ -156,6 +157,18 @@ class EcowittClient:
             logger.error(f"Weather fetch failed: {e}")
             return None
 
+    @staticmethod
+    def _parse_station_pressure(wh25: list) -> Optional[float]:
+        """Absolute barometer reading in inHg from the WH25 block, e.g. "24.17 inHg" or "818.5 hPa"."""
+        for item in wh25:
+            try:
+                value, unit = str(item["abs"]).split()
+                value = float(value)
+            except (KeyError, ValueError):
+                continue
+            return value / 33.8639 if unit.lower() == "hpa" else value
+        return None
+
     def _parse_response(self, data: dict) -> WeatherData:
         """Parse Ecowitt API response into WeatherData."""
         # Extract common fields (structure varies by firmware version)
@@ -205,6 +218,7 @@ class EcowittClient:
 
         # Parse pressure
         pressure = get_common("0x03", 29.92)
+        station_pressure = self._parse_station_pressure(data.get("wh25", []))
 
         # Assess conditions
         wind_condition = self._assess_wind(wind_speed, wind_gust)
@@ -236,7 +250,8 @@ class EcowittClient:
             pressure_trend=self._get_pressure_trend_for_data(pressure),
             condition=condition,
             wind_condition=wind_condition,
-            safe_to_observe=safe
+            safe_to_observe=safe,
+            station_pressure_inhg=station_pressure,
         )
 
         self._latest_data = weather
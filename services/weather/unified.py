@@ -69,7 +69,8 @@ class UnifiedConditions:
     wind_speed_mph: Optional[float] = None
     wind_gust_mph: Optional[float] = None
     wind_direction: Optional[str] = None
-    pressure_inhg: Optional[float] = None
+    pressure_inhg: Optional[float] = None          # Relative; 29.92 if the gateway sends none
+    station_pressure_inhg: Optional[float] = None  # Measured absolute, for refraction
 
     # Rain detection (combined from both sensors)
     is_raining: bool = False
@@ -302,6 +303,7 @@ class UnifiedWeatherService:
             conditions.wind_gust_mph = ecowitt.wind_gust_mph
             conditions.wind_direction = ecowitt.wind_direction_str
             conditions.pressure_inhg = ecowitt.pressure_inhg
+            conditions.station_pressure_inhg = ecowitt.station_pressure_inhg
             conditions.ecowitt_rain = ecowitt.is_raining
             conditions.rain_rate_in_hr = ecowitt.rain_rate_in_hr
             conditions.solar_radiation_wm2 = ecowitt.solar_radiation_wm2
@@ -21,6 +21,8 @@ from nightwatch.health import (
     HealthStatus,
     ServiceHealth,
     StartupSequence,
+    check_mount_health,
+    parse_metrics,
 )
 from nightwatch.main import (
     GracefulShutdown,
@@ -308,6 +310,64 @@ class TestHealthCheckResult:
         assert result.summary == "2/3 services healthy"
 
 
+class TestMountMetrics:
+    """Tests for the mount health check from controller /metrics."""
+
+    PAGE = (
+        "# TYPE nightwatch_uptime_seconds gauge\n"
+        "nightwatch_uptime_seconds 120\n"
+        'nightwatch_loop_interval_us{stat="mean"} 850\n'
+        'nightwatch_loop_interval_us{stat="max"} 1900\n'
+        'nightwatch_driver_sg_result{axis="1"} 321\n'
+        'nightwatch_driver_overtemp_warning{axis="1"} 0\n'
+        'nightwatch_driver_overtemp{axis="1"} 0\n'
+        'nightwatch_cmd_latency_seconds_bucket{class="control",le="+Inf"} 4\n'
+    )
+
+    @pytest.fixture
+    def config(self) -> NightwatchConfig:
+        """Create test configuration with a network mount."""
+        return NightwatchConfig(mount={"type": "onstepx", "host": "192.168.1.100", "metrics_port": 80})
+
+    def test_parse_metrics(self) -> None:
+        """Test labelled and unlabelled samples are parsed."""
+        metrics = parse_metrics(self.PAGE + "malformed{\n")
+
+        assert metrics["nightwatch_uptime_seconds"][()] == 120
+        assert metrics["nightwatch_loop_interval_us"][(("stat", "max"),)] == 1900
+        assert metrics["nightwatch_cmd_latency_seconds_bucket"][(("class", "control"), ("le", "+Inf"))] == 4
+
+    @pytest.mark.asyncio
+    async def test_healthy_from_metrics(self, config: NightwatchConfig) -> None:
+        """Test a nominal scrape skips the command port."""
+        with patch("nightwatch.health.fetch_metrics", AsyncMock(return_value=(parse_metrics(self.PAGE), 3.0, "ok"))), \
+                patch("nightwatch.health.check_tcp_connection", AsyncMock()) as tcp:
+            health = await check_mount_health(config)
+
+        assert health.status == HealthStatus.HEALTHY
+        assert health.details["sg_result"] == {"1": 321}
+        tcp.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_overtemp_is_unhealthy(self, config: NightwatchConfig) -> None:
+        """Test a driver overtemperature flag fails the check."""
+        page = self.PAGE.replace('overtemp{axis="1"} 0', 'overtemp{axis="1"} 1')
+        with patch("nightwatch.health.fetch_metrics", AsyncMock(return_value=(parse_metrics(page), 3.0, "ok"))):
+            health = await check_mount_health(config)
+
+        assert health.status == HealthStatus.UNHEALTHY
+
+    @pytest.mark.asyncio
+    async def test_falls_back_to_command_port(self, config: NightwatchConfig) -> None:
+        """Test older firmware without /metrics is checked over TCP."""
+        with patch("nightwatch.health.fetch_metrics", AsyncMock(return_value=(None, 0.0, "HTTP 404"))), \
+                patch("nightwatch.health.check_tcp_connection", AsyncMock(return_value=(True, 2.0, "Connected"))):
+            health = await check_mount_health(config)
+
+        assert health.status == HealthStatus.HEALTHY
+        assert health.details["port"] == 9999
+
+
 class TestConfigIntegration:
     """Tests for configuration loading integration."""
 
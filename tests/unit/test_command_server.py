@@ -0,0 +1,88 @@
+"""
+Unit tests for the NIGHTWATCH multi-session command server
+(firmware CommandServer.h, host-built through sim/CommandReplay.cpp).
+"""
+
+import os
+import shutil
+import subprocess
+
+import pytest
+
+from services.simulators.firmware_replay import FIRMWARE_DIR
+
+COMPILER = os.environ.get("CXX") or shutil.which("c++") or shutil.which("g++")
+
+needs_compiler = pytest.mark.skipif(COMPILER is None, reason="no host C++ compiler")
+
+
+@pytest.fixture(scope="module")
+def command_replay(tmp_path_factory):
+    """CommandReplay built once for the module."""
+    binary = str(tmp_path_factory.mktemp("command_replay") / "command_replay")
+    subprocess.run(
+        [COMPILER, "-std=gnu++17", "-O2", "-I", FIRMWARE_DIR,
+         os.path.join(FIRMWARE_DIR, "sim", "CommandReplay.cpp"), "-o", binary],
+        check=True, capture_output=True,
+    )
+    return binary
+
+
+def replay(binary, events):
+    """Run CommandReplay; returns (executed (session, command) list, summary dict)."""
+    proc = subprocess.run([binary], input="\n".join(events) + "\n",
+                          capture_output=True, text=True, check=True)
+    executed, summary = [], {}
+    for line in proc.stdout.splitlines():
+        fields = line.split()
+        if fields[0] == "exec":
+            executed.append((int(fields[1]), fields[2]))
+        elif fields[0] == "summary":
+            summary = {k: int(v) for k, v in (f.split("=") for f in fields[1:])}
+    return executed, summary
+
+
+# =============================================================================
+# Urgent Command Tests
+# =============================================================================
+
+@needs_compiler
+class TestUrgentCommands:
+    """Unit tests for stops and parks that bypass the session queues."""
+
+    def test_stop_purges_queued_goto(self, command_replay):
+        """Test a goto queued before a stop never runs after it."""
+        executed, summary = replay(command_replay, [
+            "0 :NWCP2#",
+            "1 :NWCP0#",
+            "poll 3",
+            # Session 0 is read first: its goto queues behind a query
+            "0 :GR#:Sr05:30:00#:Sd+10*00:00#:MS#",
+            "1 :Q#",
+        ])
+
+        assert executed[-2:] == [(1, "Q"), (0, "GR")]
+        assert not any(command in ("Sr05:30:00", "Sd+10*00:00", "MS") for _, command in executed)
+        assert summary["purged"] == 3
+
+    def test_safety_park_purges_other_sessions(self, command_replay):
+        """Test a safety :hP# drops queued motion from every session."""
+        executed, summary = replay(command_replay, [
+            "0 :NWCP2#",
+            "1 :NWCP1#",
+            "2 :NWCP0#",
+            "poll 4",
+            "0 :Me#:GD#",
+            "1 :hR#:NWKS#",
+            "2 :hP#",
+        ])
+
+        assert executed[-2:] == [(2, "hP"), (0, "GD")]
+        assert summary["purged"] == 3
+
+    def test_target_set_keeps_its_colons(self, command_replay):
+        """Test ':' inside a command is text, not a new command."""
+        executed, summary = replay(command_replay, ["0 :Sr05:30:00#:MS#"])
+
+        assert executed == [(0, "Sr05:30:00"), (0, "MS")]
+        assert summary["purged"] == 0
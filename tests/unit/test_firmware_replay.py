@@ -0,0 +1,196 @@
+"""
+Unit tests for the NIGHTWATCH firmware replay simulator (host-built
+MountReplay driven from recorded traces).
+"""
+
+import math
+import shutil
+
+import pytest
+
+from services.mount_control.nightwatch_protocol import (
+    TRACE_COMMAND,
+    PECModel,
+    TraceRecord,
+)
+from services.mount_control.telemetry import TelemetrySample
+from services.simulators.firmware_replay import (
+    FirmwareReplay,
+    ReplayTrace,
+    parse_output,
+)
+
+needs_compiler = pytest.mark.skipif(
+    shutil.which("c++") is None and shutil.which("g++") is None,
+    reason="no host C++ compiler",
+)
+
+
+@pytest.fixture(scope="module")
+def build_dir(tmp_path_factory):
+    """Variant cache shared by the module so each config builds once."""
+    return str(tmp_path_factory.mktemp("replay"))
+
+
+# =============================================================================
+# Trace and Output Tests
+# =============================================================================
+
+class TestReplayTrace:
+    """Unit tests for trace construction and output parsing."""
+
+    def test_lx200_commands_map_to_events(self):
+        """Test target, goto and stop commands become events."""
+        trace = ReplayTrace.from_commands([
+            (1.0, ":Sr05:30:00#"),
+            (1.1, ":Sd-10*15:00#"),
+            (1.2, ":MS#"),
+            (5.0, ":Q#"),
+            (6.0, ":GR#"),
+        ], lst_deg=100.0)
+
+        lines = trace.text().splitlines()
+
+        assert lines[0] == "0.000000 lst 100.000000"
+        assert lines[1] == "1.200000 goto 82.500000 -10.250000"
+        assert lines[2] == "5.000000 stop"
+        assert trace.ignored_commands == 1
+
+    def test_trace_records_unwrap_controller_clock(self):
+        """Test record times across the 32-bit micros() wrap."""
+        records = [
+            TraceRecord(time_us=0xFFFF0000, kind=TRACE_COMMAND, command=":Sr01:00:00#"),
+            TraceRecord(time_us=0xFFFF0000, kind=TRACE_COMMAND, command=":Sd+20*00:00#"),
+            TraceRecord(time_us=0x00010000, kind=TRACE_COMMAND, command=":MS#"),
+        ]
+
+        trace = ReplayTrace.from_trace_records(records)
+
+        assert trace.duration_s() == pytest.approx(0x20000 / 1e6)
+        assert "goto 15.000000 20.000000" in trace.text()
+
+    def test_parse_output(self):
+        """Test every MountReplay output line."""
+        result = parse_output(
+            "goto 1 0.000 17.469 W 1\n"
+            "refused 2 20.000 dec_limit\n"
+            "stopped 30.000 31.500\n"
+            "limit 10770.000\n"
+            "probe 40.000 idle 130.0 40.0 W 120.0 40.0\n"
+            "pec 100 3.000 0.100\n"
+            "error 7 unknown event\n"
+            "garbage\n"
+            "summary sim_s=99.4 gotos=1 slews_per_hour=72.4 speedup=15000\n"
+        )
+
+        assert result.gotos[0].duration_s == pytest.approx(17.469)
+        assert result.gotos[0].pier_side == "W"
+        assert result.refused == [(2, 20.0, "dec_limit")]
+        assert result.stops == [(30.0, 31.5)]
+        assert result.limits == [10770.0]
+        assert result.probes[0].state == "idle"
+        assert result.pec == (100, 3.0, 0.1)
+        assert result.errors == [(7, "unknown event")]
+        assert result.slews_per_hour == pytest.approx(72.4)
+        assert result.speedup == pytest.approx(15000)
+
+
+# =============================================================================
+# Simulation Tests
+# =============================================================================
+
+@needs_compiler
+class TestFirmwareReplay:
+    """Unit tests against the compiled Config.h motion layer."""
+
+    def test_gotos_and_refusal(self, build_dir):
+        """Test gotos complete and a target past an overridden Dec limit is refused."""
+        trace = (ReplayTrace(lst_deg=100.0)
+                 .goto(0.0, 130.0, 40.0)
+                 .goto(60.0, 200.0, -20.0)
+                 .goto(120.0, 100.0, -60.0))
+
+        result = FirmwareReplay({"AXIS2_LIMIT_MIN": -30}, build_dir=build_dir).run(trace)
+
+        assert [g.goto_id for g in result.gotos] == [1, 2]
+        assert all(g.duration_s > 0 for g in result.gotos)
+        assert result.refused == [(3, 120.0, "dec_limit")]
+        assert result.speedup > 1.0
+
+    def test_flips_count_only_between_sides(self, build_dir):
+        """Test leaving home or park picks a side without counting a flip."""
+        trace = (ReplayTrace(lst_deg=100.0)
+                 .probe(0.0)
+                 .goto(0.0, 130.0, 40.0)     # from home to the west side
+                 .goto(60.0, 60.0, 20.0)     # west -> east: a flip
+                 .park(120.0)
+                 .unpark(300.0)
+                 .goto(300.0, 130.0, 40.0))  # from park to the west side
+
+        result = FirmwareReplay(build_dir=build_dir).run(trace)
+
+        assert result.probes[0].pier_side == "N"
+        assert [g.pier_side for g in result.gotos] == ["W", "E", "W"]
+        assert result.summary["flips"] == 1
+
+    def test_tracking_stops_at_meridian_limit(self, build_dir):
+        """Test tracking an east target ends at the past-meridian limit."""
+        trace = ReplayTrace(lst_deg=100.0).goto(0.0, 130.0, 40.0).end(6 * 3600.0)
+
+        result = FirmwareReplay(build_dir=build_dir).run(trace)
+
+        # HA -30 deg to +15 deg past the meridian is three sidereal hours
+        assert len(result.limits) == 1
+        assert result.limits[0] == pytest.approx(3 * 3590.17, abs=30.0)
+
+    def test_faster_profile_raises_throughput(self, build_dir):
+        """Test a Config.h override changes the benchmark."""
+        targets = [(130.0, 40.0), (200.0, -20.0), (60.0, 60.0), (150.0, 10.0)]
+
+        base = FirmwareReplay(build_dir=build_dir).slews_per_hour(targets, 60.0, lst_deg=100.0)
+        fast = FirmwareReplay(
+            {"GOTO_ACCELERATION": 4.0, "AXIS1_JERK": 12.0, "AXIS2_JERK": 12.0},
+            build_dir=build_dir,
+        ).slews_per_hour(targets, 60.0, lst_deg=100.0)
+
+        assert fast > base > 0
+
+    def test_pec_model_cancels_periodic_error(self, build_dir):
+        """Test the uploaded LUT lowers the tracking residual."""
+        # One wave-generator period over Config.h PEC_LUT_POINTS entries
+        model = PECModel(
+            axis=1, kind="lut", cycles_per_rev=100,
+            corrections_arcsec=[-3.0 * math.cos(2 * math.pi * i / 8192) for i in range(8192)],
+        )
+        trace = (ReplayTrace(lst_deg=100.0)
+                 .goto(0.0, 80.0, 20.0)
+                 .periodic_error(0.0, 100, 3.0, 0.0)
+                 .pec_model(0.0, model)
+                 .end(1800.0))
+
+        result = FirmwareReplay(build_dir=build_dir).run(trace)
+
+        samples, raw, corrected = result.pec
+        assert samples > 0
+        assert raw == pytest.approx(3.0 / 2 ** 0.5, rel=0.2)
+        assert corrected < 0.2 * raw
+
+    def test_pointing_residuals(self, build_dir):
+        """Test probes line up with recorded telemetry."""
+        samples = [
+            TelemetrySample(
+                sequence=i, controller_time_us=int(t * 1e6), axis1_steps=0, axis2_steps=0,
+                axis1_encoder=0, axis2_encoder=0, ra_degrees=130.0, dec_degrees=40.0,
+                flags=0, pier_side="W",
+            )
+            for i, t in enumerate([100.0, 200.0])
+        ]
+        trace = ReplayTrace(lst_deg=100.0).goto(0.0, 130.0, 40.0)
+        trace.origin_us = 0
+        trace.add_samples(samples)
+
+        result = FirmwareReplay(build_dir=build_dir).run(trace)
+        residuals = result.pointing_residuals(trace.samples)
+
+        assert [p.state for p in result.probes] == ["idle", "idle"]
+        assert max(residuals) < 1.0
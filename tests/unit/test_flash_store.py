@@ -0,0 +1,78 @@
+"""
+Unit tests for the NIGHTWATCH log-structured calibration store
+(firmware FlashStore.h, host-built through sim/StoreReplay.cpp).
+"""
+
+import os
+import shutil
+import subprocess
+
+import pytest
+
+from services.simulators.firmware_replay import FIRMWARE_DIR
+
+COMPILER = os.environ.get("CXX") or shutil.which("c++") or shutil.which("g++")
+
+needs_compiler = pytest.mark.skipif(COMPILER is None, reason="no host C++ compiler")
+
+# Three 1 KB blocks of four 200-byte records each: a handful of saves keeps
+# the last block spare and reclaims the oldest
+SMALL_RING = ["-DFLASH_STORE_BLOCKS=3", "-DFLASH_STORE_BLOCK_SIZE=1024", "-DFLASH_STORE_MAX_RECORD=256"]
+
+
+@pytest.fixture(scope="module")
+def store_replay(tmp_path_factory):
+    """StoreReplay built once for the module on the small ring."""
+    binary = str(tmp_path_factory.mktemp("store_replay") / "store_replay")
+    subprocess.run(
+        [COMPILER, "-std=gnu++17", "-O2", *SMALL_RING, "-I", FIRMWARE_DIR,
+         os.path.join(FIRMWARE_DIR, "sim", "StoreReplay.cpp"), "-o", binary],
+        check=True, capture_output=True,
+    )
+    return binary
+
+
+def replay(binary, events):
+    """Run StoreReplay; returns its output lines."""
+    proc = subprocess.run([binary], input="\n".join(events) + "\n",
+                          capture_output=True, text=True, check=True)
+    return proc.stdout.splitlines()
+
+
+def status_fields(line):
+    """:NWFQ# reply of a status line as ints."""
+    return [int(v) for v in line.split()[1].rstrip("#").split(",")]
+
+
+# =============================================================================
+# Reclaim Tests
+# =============================================================================
+
+@needs_compiler
+class TestReclaim:
+    """Unit tests for reclaiming the oldest block into the spare."""
+
+    def test_verify_failure_mid_reclaim_restarts_it(self, store_replay):
+        """Test a bad relocated copy is retried instead of deadlocking the store."""
+        events = ["save 1 200 17", "save 2 200 34", "run", "fail 1"]
+        for value in range(1, 11):
+            events += [f"save 3 200 {value}", "run"]
+        events += ["status", "get 1", "get 2", "get 3", "reboot", "get 1", "get 2", "get 3"]
+
+        lines = replay(store_replay, events)
+
+        assert "stuck" not in lines
+        state, _, _, _, pending, _, _, errors = status_fields(lines[0])
+        assert (state, pending, errors) == (1, 0, 1)
+        # Keys 1 and 2 were only ever in the reclaimed block
+        assert lines[1:4] == ["get 1 200 17 1", "get 2 200 34 1", "get 3 200 10 1"]
+        assert lines[4:7] == lines[1:4]
+
+    def test_verify_failure_outside_reclaim_moves_on(self, store_replay):
+        """Test an ordinary save that reads back wrong is retried in the next block."""
+        lines = replay(store_replay, ["fail 4", "save 4 100 5", "run", "status", "reboot", "get 4"])
+
+        assert "stuck" not in lines
+        state, used, _, _, pending, saves, _, errors = status_fields(lines[0])
+        assert (state, used, pending, saves, errors) == (1, 2, 0, 1, 1)
+        assert lines[1] == "get 4 100 5 1"
@@ -0,0 +1,133 @@
+"""
+Unit tests for the NIGHTWATCH guide channel client.
+
+Packets must match FRAME_GUIDE in firmware/onstepx_config/nightwatch/GuideChannel.h.
+"""
+
+from unittest.mock import MagicMock, patch
+
+import pytest
+
+from services.guiding.guide_channel import (
+    GUIDE_PAYLOAD,
+    GuideChannelClient,
+    GuideKind,
+    build_guide_payload,
+    parse_guide_payload,
+)
+from services.mount_control.nightwatch_protocol import FrameType, decode_frame
+
+
+def _sent_packet(mock_socket, call=-1):
+    frame_type, payload = decode_frame(mock_socket.send.call_args_list[call][0][0])
+    assert frame_type == FrameType.GUIDE
+    return parse_guide_payload(payload)
+
+
+@pytest.fixture
+def mock_socket():
+    return MagicMock()
+
+
+@pytest.fixture
+def channel(mock_socket):
+    with patch("socket.socket", return_value=mock_socket):
+        client = GuideChannelClient(host="192.168.1.100", port=9997)
+        assert client.open() is True
+    return client
+
+
+# =============================================================================
+# Payload Tests
+# =============================================================================
+
+class TestGuidePayload:
+    """Test FRAME_GUIDE payload layout."""
+
+    def test_size(self):
+        assert GUIDE_PAYLOAD.size == 25
+
+    def test_round_trip(self):
+        payload = build_guide_payload(7, 123456789, GuideKind.RATE, -1500, 250, 2_000_000)
+        assert parse_guide_payload(payload) == (7, 123456789, GuideKind.RATE, -1500, 250, 2_000_000)
+
+    def test_out_of_range(self):
+        with pytest.raises(ValueError):
+            build_guide_payload(1, 0, GuideKind.PULSE, 2**31, 0)
+
+
+# =============================================================================
+# Client Tests
+# =============================================================================
+
+class TestGuideChannelClient:
+    """Test guide packet sending."""
+
+    def test_open_connects_udp(self, channel, mock_socket):
+        mock_socket.connect.assert_called_once_with(("192.168.1.100", 9997))
+        mock_socket.setblocking.assert_called_once_with(False)
+
+    def test_pulse(self, channel, mock_socket):
+        assert channel.pulse(ra_ms=-35.5, dec_ms=12.0) is True
+
+        seq, host_us, kind, ra, dec, duration = _sent_packet(mock_socket)
+        assert seq == 0
+        assert host_us > 0
+        assert kind == GuideKind.PULSE
+        assert (ra, dec, duration) == (-35500, 12000, 0)
+
+    def test_sequence_increments(self, channel, mock_socket):
+        channel.pulse(ra_ms=1.0)
+        channel.pulse(ra_ms=1.0)
+        channel.stop()
+
+        assert [_sent_packet(mock_socket, i)[0] for i in range(3)] == [0, 1, 2]
+        assert _sent_packet(mock_socket)[2] == GuideKind.STOP
+        assert channel.packets_sent == 3
+
+    def test_sequence_skips_zero_on_wrap(self, channel, mock_socket):
+        channel._sequence = 0xFFFFFFFF
+        channel.pulse(ra_ms=1.0)
+        channel.pulse(ra_ms=1.0)
+
+        assert _sent_packet(mock_socket)[0] == 1
+
+    def test_guide_directions(self, channel, mock_socket):
+        expected = {"N": (0, 120000), "S": (0, -120000), "E": (-120000, 0), "W": (120000, 0)}
+        for direction, axes in expected.items():
+            channel.guide(direction, 120.0)
+            assert _sent_packet(mock_socket)[3:5] == axes
+
+    def test_unknown_direction(self, channel):
+        with pytest.raises(ValueError):
+            channel.guide("X", 10.0)
+
+    def test_set_rate(self, channel, mock_socket):
+        channel.set_rate(1.5, -0.25, duration_s=2.0)
+
+        _, _, kind, ra, dec, duration = _sent_packet(mock_socket)
+        assert kind == GuideKind.RATE
+        assert (ra, dec, duration) == (1500, -250, 2_000_000)
+
+    def test_send_error(self, channel, mock_socket):
+        mock_socket.send.side_effect = OSError("unreachable")
+        assert channel.pulse(ra_ms=1.0) is False
+        assert channel.packets_sent == 0
+
+    def test_not_open(self):
+        assert GuideChannelClient().pulse(ra_ms=1.0) is False
+
+    @patch("serial.Serial")
+    def test_serial_transport(self, mock_serial_class):
+        port = MagicMock()
+        mock_serial_class.return_value = port
+
+        client = GuideChannelClient(serial_port="/dev/ttyACM1")
+        assert client.open() is True
+        client.pulse(dec_ms=5.0)
+
+        frame_type, payload = decode_frame(port.write.call_args[0][0])
+        assert frame_type == FrameType.GUIDE
+        assert parse_guide_payload(payload)[4] == 5000
+        client.close()
+        port.close.assert_called_once()
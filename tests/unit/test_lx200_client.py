@@ -18,11 +18,35 @@ from services.mount_control.lx200 import (
     PierSide,
     TrackingRate,
     MountStatus,
+    SessionPriority,
     ra_to_hours,
     dec_to_degrees,
     hours_to_ra,
     degrees_to_dec,
 )
+from services.mount_control.nightwatch_protocol import (
+    FrameType,
+    StatusFrame,
+    build_status_payload,
+    encode_frame,
+    parse_status_frame,
+)
+
+
+def _status_frame_bytes(**overrides) -> bytes:
+    values = dict(
+        controller_millis=1000,
+        ra_degrees=187.5,  # 12h30m00s
+        dec_degrees=45.5,  # +45*30:00
+        altitude=60.0,
+        azimuth=180.0,
+        pier_side="E",
+        flags=0x01,
+        axis1_driver_status=0x80000000,
+        axis2_driver_status=0,
+    )
+    values.update(overrides)
+    return encode_frame(FrameType.STATUS, build_status_payload(StatusFrame(**values)))
 
 
 class TestConnectionType:
@@ -215,6 +239,67 @@ class TestLX200ClientTCPConnection:
         mock_socket.close.assert_called_once()
 
 
+class TestLX200ClientSessionPriority:
+    """Test claiming a command server priority class on connect."""
+
+    @patch("socket.socket")
+    def test_no_priority_sends_nothing(self, mock_socket_class):
+        mock_socket = MagicMock()
+        mock_socket_class.return_value = mock_socket
+
+        LX200Client(connection_type=ConnectionType.TCP).connect()
+
+        mock_socket.sendall.assert_not_called()
+
+    @patch("socket.socket")
+    def test_safety_priority_claimed(self, mock_socket_class):
+        mock_socket = MagicMock()
+        mock_socket.recv.return_value = b"1#"
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(
+            connection_type=ConnectionType.TCP,
+            session_priority=SessionPriority.SAFETY,
+        )
+
+        assert client.connect() is True
+        mock_socket.sendall.assert_called_once_with(b":NWCP0#")
+
+    @patch("socket.socket")
+    def test_stock_firmware_stays_connected(self, mock_socket_class):
+        mock_socket = MagicMock()
+        mock_socket.recv.return_value = b"0#"
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(
+            connection_type=ConnectionType.TCP,
+            session_priority=SessionPriority.QUERY,
+        )
+
+        assert client.connect() is True
+        assert client._connected is True
+        mock_socket.sendall.assert_called_once_with(b":NWCP2#")
+
+    @patch("socket.socket")
+    def test_claim_after_connect(self, mock_socket_class):
+        mock_socket = MagicMock()
+        mock_socket.recv.return_value = b"1#"
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(connection_type=ConnectionType.TCP)
+        client.connect()
+
+        assert client.claim_session_priority(SessionPriority.SAFETY) is True
+        assert client.session_priority == SessionPriority.SAFETY
+        mock_socket.sendall.assert_called_once_with(b":NWCP0#")
+
+    def test_claim_before_connect_is_kept(self):
+        client = LX200Client(connection_type=ConnectionType.TCP)
+
+        assert client.claim_session_priority(SessionPriority.SAFETY) is False
+        assert client.session_priority == SessionPriority.SAFETY
+
+
 class TestLX200ClientSerialConnection:
     """Test serial connection handling."""
 
@@ -261,6 +346,127 @@ class TestLX200ClientSerialConnection:
         mock_serial.close.assert_called_once()
 
 
+class TestLX200ClientSerialBaudUpgrade:
+    """Test SERIAL_A baud negotiation on connect, after idling and after failures."""
+
+    def _client(self):
+        return LX200Client(
+            connection_type=ConnectionType.SERIAL,
+            serial_port="/dev/ttyUSB0",
+            baudrate=9600,
+            serial_upgrade_baud=921600,
+        )
+
+    @patch("serial.Serial")
+    def test_upgrade_success(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"1#", b"1#"]
+        mock_serial_class.return_value = mock_serial
+
+        client = self._client()
+
+        assert client.connect() is True
+        writes = [call[0][0] for call in mock_serial.write.call_args_list]
+        assert writes == [b":NWBR921600#", b":NWBK#"]
+        assert mock_serial.baudrate == 921600
+        assert mock_serial.timeout == 5.0
+        assert client.use_status_frame is True
+        assert client.serial_baudrate == 921600
+
+    @patch("time.sleep")
+    @patch("serial.Serial")
+    def test_unconfirmed_falls_back(self, mock_serial_class, mock_sleep):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"1#", b""]
+        mock_serial_class.return_value = mock_serial
+
+        client = self._client()
+
+        assert client.connect() is True
+        assert mock_serial.baudrate == 9600
+        assert client.use_status_frame is False
+        mock_sleep.assert_called_once()
+
+    @patch("serial.Serial")
+    def test_controller_already_upgraded(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"", b"1#"]
+        mock_serial_class.return_value = mock_serial
+
+        client = self._client()
+
+        assert client.connect() is True
+        assert mock_serial.baudrate == 921600
+        assert client.use_status_frame is True
+
+    @patch("serial.Serial")
+    def test_idle_link_renegotiated(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"1#", b"1#", b"1#", b"1#", b"12:00:00#"]
+        mock_serial_class.return_value = mock_serial
+
+        client = self._client()
+        with patch("services.mount_control.lx200.time.monotonic", return_value=100.0):
+            client.connect()
+        with patch("services.mount_control.lx200.time.monotonic", return_value=106.0):
+            assert client.get_ra() == "12:00:00"
+
+        writes = [call[0][0] for call in mock_serial.write.call_args_list]
+        assert writes == [b":NWBR921600#", b":NWBK#", b":NWBR921600#", b":NWBK#", b":GR#"]
+        assert mock_serial.baudrate == 921600
+
+    @patch("serial.Serial")
+    def test_active_link_not_renegotiated(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"1#", b"1#", b"12:00:00#", b"+10*00:00#"]
+        mock_serial_class.return_value = mock_serial
+
+        client = self._client()
+        with patch("services.mount_control.lx200.time.monotonic", return_value=100.0):
+            client.connect()
+        with patch("services.mount_control.lx200.time.monotonic", return_value=103.0):
+            client.get_ra()
+        with patch("services.mount_control.lx200.time.monotonic", return_value=106.0):
+            client.get_dec()
+
+        assert mock_serial.write.call_count == 4
+
+    @patch("serial.Serial")
+    def test_failed_command_renegotiates(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"1#", b"1#", b"", b"", b"1#"]
+        mock_serial_class.return_value = mock_serial
+
+        client = self._client()
+        client.connect()
+
+        assert not client.get_ra()
+        writes = [call[0][0] for call in mock_serial.write.call_args_list]
+        assert writes[2:] == [b":GR#", b":NWBR921600#", b":NWBK#"]
+        assert mock_serial.baudrate == 921600
+
+    @patch("time.sleep")
+    @patch("serial.Serial")
+    def test_unconfirmed_waits_past_confirm_window(self, mock_serial_class, mock_sleep):
+        mock_serial = MagicMock()
+        mock_serial.read_until.side_effect = [b"1#", b""]
+        mock_serial_class.return_value = mock_serial
+
+        self._client().connect()
+
+        assert mock_sleep.call_args[0][0] > LX200Client.SERIAL_BAUD_CONFIRM_S
+
+    @patch("serial.Serial")
+    def test_no_upgrade_by_default(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial_class.return_value = mock_serial
+
+        client = LX200Client(connection_type=ConnectionType.SERIAL)
+
+        assert client.connect() is True
+        mock_serial.write.assert_not_called()
+
+
 class TestLX200ClientCommands:
     """Test LX200 command sending."""
 
@@ -1035,6 +1241,161 @@ class TestLX200ClientEncoderIntegration:
         assert result is None
 
 
+class TestLX200ClientStatusFrame:
+    """Test batched binary status frame (:NWS#)."""
+
+    def test_status_frame_disabled_by_default(self):
+        client = LX200Client()
+        assert client.use_status_frame is False
+
+    @patch("socket.socket")
+    def test_get_status_frame_tcp(self, mock_socket_class):
+        mock_socket = MagicMock()
+        mock_socket.recv.return_value = _status_frame_bytes()
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(connection_type=ConnectionType.TCP)
+        client.connect()
+        frame = client.get_status_frame()
+
+        mock_socket.sendall.assert_called_with(b":NWS#")
+        assert frame.ra_degrees == pytest.approx(187.5)
+        assert frame.is_tracking is True
+
+    @patch("socket.socket")
+    def test_get_status_frame_tcp_split_chunks(self, mock_socket_class):
+        data = _status_frame_bytes()
+        mock_socket = MagicMock()
+        mock_socket.recv.side_effect = [data[:3], data[3:20], data[20:]]
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(connection_type=ConnectionType.TCP)
+        client.connect()
+        frame = client.get_status_frame()
+
+        assert frame is not None
+        assert frame.pier_side == "E"
+
+    @patch("serial.Serial")
+    def test_get_status_frame_serial(self, mock_serial_class):
+        data = _status_frame_bytes()
+        mock_serial = MagicMock()
+        mock_serial.read.side_effect = [data[:5], data[5:]]
+        mock_serial_class.return_value = mock_serial
+
+        client = LX200Client(connection_type=ConnectionType.SERIAL)
+        client.connect()
+        frame = client.get_status_frame()
+
+        mock_serial.write.assert_called_with(b":NWS#")
+        assert frame.dec_degrees == pytest.approx(45.5)
+
+    @patch("socket.socket")
+    def test_get_status_frame_corrupt(self, mock_socket_class):
+        data = bytearray(_status_frame_bytes())
+        data[10] ^= 0xFF
+        mock_socket = MagicMock()
+        mock_socket.recv.return_value = bytes(data)
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(connection_type=ConnectionType.TCP)
+        client.connect()
+
+        assert client.get_status_frame() is None
+
+    @patch("socket.socket")
+    def test_get_status_uses_single_round_trip(self, mock_socket_class):
+        mock_socket = MagicMock()
+        mock_socket.recv.return_value = _status_frame_bytes(flags=0x02)
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(connection_type=ConnectionType.TCP, use_status_frame=True)
+        client.connect()
+        status = client.get_status()
+
+        assert mock_socket.sendall.call_count == 1
+        assert status.ra_hours == 12.0
+        assert status.ra_minutes == 30.0
+        assert status.dec_degrees == 45.0
+        assert status.dec_minutes == 30.0
+        assert status.is_tracking is False
+        assert status.is_slewing is True
+        assert status.pier_side == PierSide.EAST
+        assert status.altitude == pytest.approx(60.0)
+        assert status.azimuth == pytest.approx(180.0)
+        assert status.axis1_driver_status == 0x80000000
+
+    @patch.object(LX200Client, "get_status_frame", return_value=None)
+    @patch.object(LX200Client, "get_ra", return_value="12:30:45")
+    @patch.object(LX200Client, "get_dec", return_value="+45*30:15")
+    @patch.object(LX200Client, "is_tracking", return_value=True)
+    @patch.object(LX200Client, "is_slewing", return_value=False)
+    @patch.object(LX200Client, "is_parked", return_value=False)
+    @patch.object(LX200Client, "get_pier_side", return_value=PierSide.WEST)
+    def test_get_status_falls_back_to_lx200(self, *mocks):
+        client = LX200Client(use_status_frame=True)
+        status = client.get_status()
+
+        assert status.ra_seconds == 45.0
+        assert status.pier_side == PierSide.WEST
+
+    @patch("socket.socket")
+    def test_failed_frame_flushes_input(self, mock_socket_class):
+        data = bytearray(_status_frame_bytes())
+        data[10] ^= 0xFF
+        mock_socket = MagicMock()
+        mock_socket.recv.side_effect = [bytes(data), b"stale", socket.timeout(), b"12:30:45#"]
+        mock_socket_class.return_value = mock_socket
+
+        client = LX200Client(connection_type=ConnectionType.TCP)
+        client.connect()
+
+        assert client.get_status_frame() is None
+        assert client.get_ra() == "12:30:45"
+        mock_socket.settimeout.assert_called_with(LX200Client.COMMAND_TIMEOUT)
+
+    @patch("serial.Serial")
+    def test_serial_frame_timeout_flushes_input(self, mock_serial_class):
+        mock_serial = MagicMock()
+        mock_serial.read.side_effect = [b"0#"]
+        mock_serial_class.return_value = mock_serial
+
+        client = LX200Client(connection_type=ConnectionType.SERIAL)
+        client.connect()
+
+        assert client.get_status_frame() is None
+        mock_serial.reset_input_buffer.assert_called_once()
+
+    @patch.object(LX200Client, "get_status_frame", return_value=None)
+    @patch.object(LX200Client, "get_ra", return_value="12:30:45")
+    @patch.object(LX200Client, "get_dec", return_value="+45*30:15")
+    @patch.object(LX200Client, "is_tracking", return_value=True)
+    @patch.object(LX200Client, "is_slewing", return_value=False)
+    @patch.object(LX200Client, "is_parked", return_value=False)
+    @patch.object(LX200Client, "get_pier_side", return_value=PierSide.WEST)
+    def test_stock_firmware_status_frame_tried_once(self, *mocks):
+        client = LX200Client(use_status_frame=True)
+        client.get_status()
+        client.get_status()
+
+        assert mocks[-1].call_count == 1
+
+    def test_status_frame_miss_after_success_keeps_trying(self):
+        client = LX200Client(use_status_frame=True)
+        frame = parse_status_frame(_status_frame_bytes())
+        with patch.object(LX200Client, "get_status_frame", side_effect=[frame, None, frame]) as mock_frame, \
+                patch.object(LX200Client, "get_ra", return_value=None):
+            client.get_status()
+            client.get_status()
+            client.get_status()
+
+        assert mock_frame.call_count == 3
+
+    def test_get_status_frame_not_connected(self):
+        client = LX200Client()
+        assert client.get_status_frame() is None
+
+
 class TestConvenienceFunctions:
     """Test module-level convenience functions."""
 
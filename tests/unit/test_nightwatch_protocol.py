@@ -0,0 +1,372 @@
+"""
+Unit tests for the NIGHTWATCH binary protocol.
+
+Tests frame encoding/decoding, the batched status frame, the PEC model,
+driver status, pointing model, motion trace and target queue payloads
+shared with firmware/onstepx_config/nightwatch/Frame.h, StatusFrame.h,
+PecModel.h, DriverStatusCache.h, PointingModel.h, TraceRecorder.h and
+TargetQueue.h.
+"""
+
+import struct
+
+import pytest
+
+from services.mount_control.nightwatch_protocol import (
+    DRIVER_STATUS_PAYLOAD_SIZE,
+    FRAME_OVERHEAD,
+    TRACE_COMMAND,
+    TRACE_EVENT,
+    TRACE_TICK,
+    DriverSnapshot,
+    FrameError,
+    FrameType,
+    PECModel,
+    QueuedTarget,
+    SplineKnot,
+    StatusFrame,
+    build_driver_status_payload,
+    build_status_payload,
+    crc16,
+    decode_frame,
+    decode_pec_model,
+    decode_pointing_model,
+    decode_trace_payload,
+    encode_frame,
+    encode_pec_model,
+    encode_pointing_model,
+    encode_spline_track,
+    encode_target_queue,
+    frame_size_from_header,
+    parse_driver_status_payload,
+    parse_status_frame,
+    parse_status_payload,
+    parse_target_event_payload,
+    spline_knots_from_samples,
+)
+
+
+def _sample_status(**overrides) -> StatusFrame:
+    values = dict(
+        controller_millis=123456,
+        ra_degrees=187.5,
+        dec_degrees=-12.25,
+        altitude=45.0,
+        azimuth=200.125,
+        pier_side="W",
+        flags=0x01,
+        axis1_driver_status=0x80000000,
+        axis2_driver_status=0x01000000,
+    )
+    values.update(overrides)
+    return StatusFrame(**values)
+
+
+class TestCrc16:
+    """Test CRC-16/CCITT-FALSE implementation."""
+
+    def test_check_value(self):
+        # Standard check value for CRC-16/CCITT-FALSE
+        assert crc16(b"123456789") == 0x29B1
+
+    def test_empty(self):
+        assert crc16(b"") == 0xFFFF
+
+
+class TestFrameEncoding:
+    """Test generic frame encode/decode."""
+
+    def test_round_trip(self):
+        frame = encode_frame(FrameType.STATUS, b"\x01\x02#\x03")
+        frame_type, payload = decode_frame(frame)
+        assert frame_type == FrameType.STATUS
+        assert payload == b"\x01\x02#\x03"
+
+    def test_frame_layout(self):
+        frame = encode_frame(0x7F, b"abc")
+        assert frame[:2] == b"NW"
+        assert frame[2] == 0x7F
+        assert struct.unpack_from("<H", frame, 3)[0] == 3
+        assert len(frame) == 3 + FRAME_OVERHEAD
+
+    def test_size_from_header(self):
+        frame = encode_frame(1, bytes(30))
+        assert frame_size_from_header(frame[:5]) == len(frame)
+
+    def test_bad_sync_rejected(self):
+        frame = bytearray(encode_frame(1, b"x"))
+        frame[0] = ord("X")
+        with pytest.raises(FrameError):
+            decode_frame(bytes(frame))
+
+    def test_bad_crc_rejected(self):
+        frame = bytearray(encode_frame(1, b"payload"))
+        frame[6] ^= 0xFF
+        with pytest.raises(FrameError):
+            decode_frame(bytes(frame))
+
+    def test_truncated_rejected(self):
+        frame = encode_frame(1, b"payload")
+        with pytest.raises(FrameError):
+            decode_frame(frame[:-1])
+
+    def test_payload_too_large(self):
+        with pytest.raises(FrameError):
+            encode_frame(1, bytes(0x10000))
+
+
+class TestStatusFrame:
+    """Test batched status frame payload."""
+
+    def test_payload_size(self):
+        assert len(build_status_payload(_sample_status())) == 30
+
+    def test_round_trip(self):
+        status = _sample_status()
+        frame = encode_frame(FrameType.STATUS, build_status_payload(status))
+        decoded = parse_status_frame(frame)
+
+        assert decoded.controller_millis == 123456
+        assert decoded.ra_degrees == pytest.approx(187.5)
+        assert decoded.dec_degrees == pytest.approx(-12.25)
+        assert decoded.altitude == pytest.approx(45.0)
+        assert decoded.azimuth == pytest.approx(200.125)
+        assert decoded.pier_side == "W"
+        assert decoded.axis1_driver_status == 0x80000000
+        assert decoded.axis2_driver_status == 0x01000000
+
+    def test_flags(self):
+        decoded = parse_status_payload(build_status_payload(_sample_status(flags=0x06)))
+        assert decoded.is_tracking is False
+        assert decoded.is_slewing is True
+        assert decoded.is_parked is True
+        assert decoded.has_fault is False
+
+    def test_encoder_slip_flag(self):
+        status = parse_status_payload(build_status_payload(_sample_status(flags=0x81)))
+        assert status.has_encoder_slip is True
+        assert status.is_tracking is True
+
+    def test_unknown_pier_code(self):
+        payload = bytearray(build_status_payload(_sample_status()))
+        payload[20] = 9
+        assert parse_status_payload(bytes(payload)).pier_side == "?"
+
+    def test_wrong_frame_type_returns_none(self):
+        frame = encode_frame(0x55, build_status_payload(_sample_status()))
+        assert parse_status_frame(frame) is None
+
+    def test_short_payload_rejected(self):
+        with pytest.raises(FrameError):
+            parse_status_payload(bytes(10))
+
+
+class TestPECModel:
+    """Test PEC model payload encoding."""
+
+    def test_lut_layout(self):
+        model = PECModel(axis=1, kind="lut", corrections_arcsec=[1.5, -2.25, 0.0], cycles_per_rev=200)
+        payload = encode_pec_model(model)
+        assert payload[:6] == struct.pack("<BBHH", 1, 1, 3, 200)
+        assert struct.unpack("<3h", payload[6:]) == (150, -225, 0)
+
+    def test_lut_round_trip(self):
+        model = PECModel(axis=2, kind="lut", corrections_arcsec=[0.01 * i for i in range(64)],
+                         cycles_per_rev=160)
+        decoded = decode_pec_model(encode_pec_model(model))
+        assert decoded.axis == 2
+        assert decoded.kind == "lut"
+        assert decoded.cycles_per_rev == 160
+        assert decoded.corrections_arcsec == pytest.approx(model.corrections_arcsec)
+
+    def test_fourier_round_trip(self):
+        model = PECModel(axis=1, kind="fourier", terms=[(100, 3.5, -1.25), (200, 0.5, 0.75)])
+        payload = encode_pec_model(model)
+        assert len(payload) == 6 + 2 * 6
+        decoded = decode_pec_model(payload)
+        assert decoded.kind == "fourier"
+        assert decoded.terms == [(100, 3.5, -1.25), (200, 0.5, 0.75)]
+
+    def test_correction_out_of_range(self):
+        with pytest.raises(FrameError):
+            encode_pec_model(PECModel(axis=1, kind="lut", corrections_arcsec=[400.0]))
+
+    def test_invalid_axis(self):
+        with pytest.raises(FrameError):
+            encode_pec_model(PECModel(axis=3, kind="lut", corrections_arcsec=[0.0]))
+
+    def test_unknown_kind(self):
+        with pytest.raises(FrameError):
+            encode_pec_model(PECModel(axis=1, kind="worm"))
+
+    def test_length_mismatch_rejected(self):
+        payload = encode_pec_model(PECModel(axis=1, kind="lut", corrections_arcsec=[1.0, 2.0]))
+        with pytest.raises(FrameError):
+            decode_pec_model(payload[:-1])
+
+
+class TestDriverStatus:
+    """Test the cached driver status payload."""
+
+    def test_payload_size_matches_firmware(self):
+        assert DRIVER_STATUS_PAYLOAD_SIZE == 28
+
+    def test_round_trip(self):
+        snapshots = [
+            DriverSnapshot(axis=1, drv_status=0x80000123, sg_result=0x123, cs_actual=0,
+                           spi_status=0x08, age_ms=12),
+            DriverSnapshot(axis=2, drv_status=0x01150042, sg_result=0x42, cs_actual=21,
+                           spi_status=0x04, age_ms=37),
+        ]
+        millis, decoded = parse_driver_status_payload(build_driver_status_payload(5000, snapshots))
+        assert millis == 5000
+        assert decoded == snapshots
+
+    def test_invalid_snapshot_age(self):
+        payload = bytearray(build_driver_status_payload(0, [
+            DriverSnapshot(axis=1, drv_status=0, sg_result=0, cs_actual=0, spi_status=0, age_ms=None),
+            DriverSnapshot(axis=2, drv_status=0, sg_result=0, cs_actual=0, spi_status=0, age_ms=0),
+        ]))
+        assert payload[12:16] == b"\xff\xff\xff\xff"
+        _, (axis1, axis2) = parse_driver_status_payload(bytes(payload))
+        assert axis1.valid is False
+        assert axis2.valid is True
+
+    def test_wrong_size_rejected(self):
+        with pytest.raises(FrameError):
+            parse_driver_status_payload(bytes(DRIVER_STATUS_PAYLOAD_SIZE - 1))
+
+    def test_current_scale(self):
+        snap = DriverSnapshot(axis=1, drv_status=0, sg_result=0, cs_actual=15, spi_status=0, age_ms=0)
+        assert snap.current_scale == 0.5
+
+
+class TestPointingModelPayload:
+    """Test pointing model payload encoding."""
+
+    def test_layout(self):
+        payload = encode_pointing_model({"IH": 12.345, "TF": -1.5})
+        assert payload[0] == 2
+        assert struct.unpack_from("<Bi", payload, 1) == (1, 12345)
+        assert struct.unpack_from("<Bi", payload, 6) == (7, -1500)
+
+    def test_round_trip(self):
+        terms = {"IH": 1.0, "ID": -2.0, "CH": 30.25, "NP": 4.0, "MA": -60.0, "ME": 45.5, "HDCD": 0.75}
+        assert decode_pointing_model(encode_pointing_model(terms)) == terms
+
+    def test_unknown_term(self):
+        with pytest.raises(FrameError):
+            encode_pointing_model({"ZZ": 1.0})
+
+    def test_length_mismatch(self):
+        with pytest.raises(FrameError):
+            decode_pointing_model(encode_pointing_model({"IH": 1.0})[:-1])
+
+
+def _trace_payload(first, held, records):
+    return struct.pack("<IIHH", first, held, len(records), 24) + b"".join(records)
+
+
+class TestTracePayload:
+    """Test motion trace download decoding."""
+
+    def test_tick_record(self):
+        tick = struct.pack("<IBBBBiiiHH", 1000, TRACE_TICK, 2, 16, 0x02, -5, 7, 15041, 32768, 400)
+        first, held, count, (record,) = decode_trace_payload(_trace_payload(0, 1, [tick]))
+        assert (first, held, count) == (0, 1, 1)
+        assert record.kind == TRACE_TICK
+        assert record.axis == 2
+        assert record.steps == -5
+        assert record.encoder == 7
+        assert record.rate_steps_per_s == pytest.approx(15.041)
+        assert record.pec_phase == 0.5
+        assert record.sg_result == 400
+        assert record.cs_actual == 16
+        assert record.flags == 0x02
+
+    def test_command_and_event_records(self):
+        command = struct.pack("<IBBBB", 2000, TRACE_COMMAND, 2, 0, 0) + b"MS".ljust(16, b"\0")
+        event = struct.pack("<IBBBBiiiHH", 2001, TRACE_EVENT, 5, 1, 0, -120, 0, 0, 0, 0)
+        _, _, _, (cmd, ev) = decode_trace_payload(_trace_payload(4, 6, [command, event]))
+        assert cmd.command == "MS"
+        assert ev.event == "slip"
+        assert ev.axis == 1
+        assert ev.args == (-120, 0, 0)
+
+    def test_incomplete_slot_skipped(self):
+        _, _, count, records = decode_trace_payload(_trace_payload(0, 1, [bytes(24)]))
+        assert count == 1
+        assert records == []
+
+    def test_length_mismatch(self):
+        with pytest.raises(FrameError):
+            decode_trace_payload(_trace_payload(0, 1, [bytes(24)])[:-1])
+
+
+class TestTargetQueuePayload:
+    """Test target queue upload and event payloads."""
+
+    def test_upload_layout(self):
+        payload = encode_target_queue([
+            QueuedTarget(target_id=42, ra_hours=6.0, dec_degrees=-30.5, dwell_seconds=600,
+                         tolerance_arcsec=1.5),
+            QueuedTarget(target_id=43, ra_hours=23.999999, dec_degrees=89.0),
+        ], append=True)
+        assert payload[:2] == bytes([2, 1])
+        assert struct.unpack_from("<IIiHH", payload, 2) == (42, 324_000_000, -109_800_000, 600, 150)
+        target_id, ra, dec, dwell, tolerance = struct.unpack_from("<IIiHH", payload, 18)
+        assert ra < 1_296_000_000
+        assert (dwell, tolerance) == (0, 0)
+
+    def test_upload_range_checks(self):
+        with pytest.raises(FrameError):
+            encode_target_queue([QueuedTarget(target_id=1, ra_hours=0, dec_degrees=0, dwell_seconds=70000)])
+        with pytest.raises(FrameError):
+            encode_target_queue([QueuedTarget(target_id=1, ra_hours=0, dec_degrees=0, tolerance_arcsec=0.001)])
+
+    def test_event(self):
+        payload = struct.pack("<IQIBBHiiI", 9, 5_000_000, 42, 3, 4, 0, 850, -1200, 48_250)
+        event = parse_target_event_payload(payload)
+        assert event.event == "settled"
+        assert event.target_id == 42
+        assert event.remaining == 4
+        assert event.axis1_residual_arcsec == 0.85
+        assert event.axis2_residual_arcsec == -1.2
+        assert event.elapsed_ms == 48_250
+
+    def test_event_wrong_size(self):
+        with pytest.raises(FrameError):
+            parse_target_event_payload(bytes(31))
+
+
+class TestSplineTrackPayload:
+    """Test spline track uploads and knot fitting."""
+
+    def test_upload_layout(self):
+        payload = encode_spline_track([
+            SplineKnot(0.0, 10.0, -5.0, 1.5, -0.25),
+            SplineKnot(2.5, 13.75, -5.5, 1.5, 0.0),
+        ], frame="altaz", start_time_us=123_456_789)
+        assert struct.unpack_from("<BBHQ", payload) == (1, 0, 2, 123_456_789)
+        assert struct.unpack_from("<Iiiii", payload, 12) == (0, 36_000_000, -18_000_000, 5_400_000, -900_000)
+        assert struct.unpack_from("<I", payload, 32) == (2500,)
+        assert len(payload) == 12 + 2 * 20
+
+    def test_upload_checks(self):
+        knot = SplineKnot(0.0, 0.0, 0.0, 0.0, 0.0)
+        with pytest.raises(FrameError):
+            encode_spline_track([knot])
+        with pytest.raises(FrameError):
+            encode_spline_track([knot, knot])
+        with pytest.raises(FrameError):
+            encode_spline_track([knot, SplineKnot(1.0, 0.0, 0.0, 0.0, 0.0)], frame="galactic")
+
+    def test_knots_from_samples(self):
+        knots = spline_knots_from_samples([(0.0, 358.0, 10.0), (1.0, 0.0, 12.0), (2.0, 2.0, 14.0)])
+        assert [k.c1_degrees for k in knots] == [358.0, 360.0, 362.0]
+        assert [k.c1_rate for k in knots] == [2.0, 2.0, 2.0]
+        assert knots[1].c2_rate == 2.0
+
+    def test_knots_need_increasing_time(self):
+        with pytest.raises(FrameError):
+            spline_knots_from_samples([(0.0, 0.0, 0.0), (0.0, 1.0, 1.0)])
@@ -450,6 +450,86 @@ class TestPECRecording:
         assert result is False
 
 
+# =============================================================================
+# PEC Model Transfer Tests
+# =============================================================================
+
+class TestPECModelTransfer:
+    """Tests for harmonic drive PEC model upload and download."""
+
+    @pytest.mark.asyncio
+    async def test_upload_lut_model(self, connected_client, mock_socket):
+        """Test the model goes out as :NWU# followed by one frame."""
+        from services.mount_control.nightwatch_protocol import (
+            FrameType, PECModel, decode_frame, decode_pec_model,
+        )
+        mock_socket.recv = Mock(return_value=b"1#")
+        model = PECModel(axis=1, kind="lut", corrections_arcsec=[0.5, -0.5, 1.0, 0.0],
+                         cycles_per_rev=100)
+
+        result = await connected_client.pec_upload_model(model)
+
+        assert result is True
+        sent = mock_socket.sendall.call_args[0][0]
+        assert sent.startswith(b":NWU#")
+        frame_type, payload = decode_frame(sent[len(b":NWU#"):])
+        assert frame_type == FrameType.PEC_MODEL
+        assert decode_pec_model(payload).corrections_arcsec == [0.5, -0.5, 1.0, 0.0]
+
+    @pytest.mark.asyncio
+    async def test_upload_rejected(self, connected_client, mock_socket):
+        """Test firmware rejection of a model that does not match PEC_MODEL."""
+        from services.mount_control.nightwatch_protocol import PECModel
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        result = await connected_client.pec_upload_model(
+            PECModel(axis=1, kind="fourier", terms=[(100, 1.0, 0.0)])
+        )
+
+        assert result is False
+
+    @pytest.mark.asyncio
+    async def test_upload_invalid_model_not_sent(self, connected_client, mock_socket):
+        """Test an unencodable model is rejected locally."""
+        from services.mount_control.nightwatch_protocol import PECModel
+
+        result = await connected_client.pec_upload_model(
+            PECModel(axis=1, kind="lut", corrections_arcsec=[1000.0])
+        )
+
+        assert result is False
+        mock_socket.sendall.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_download_model(self, connected_client, mock_socket):
+        """Test downloading the active model for an axis."""
+        from services.mount_control.nightwatch_protocol import (
+            FrameType, PECModel, encode_frame, encode_pec_model,
+        )
+        model = PECModel(axis=2, kind="fourier", terms=[(80, 2.0, -1.0)])
+        mock_socket.recv = Mock(
+            return_value=encode_frame(FrameType.PEC_MODEL, encode_pec_model(model))
+        )
+
+        result = await connected_client.pec_download_model(axis=2)
+
+        assert result == model
+        assert b":NWPD2#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_download_wrong_frame_type(self, connected_client, mock_socket):
+        """Test a non-PEC frame is ignored."""
+        from services.mount_control.nightwatch_protocol import FrameType, encode_frame
+        mock_socket.recv = Mock(return_value=encode_frame(FrameType.STATUS, bytes(30)))
+
+        assert await connected_client.pec_download_model() is None
+
+    @pytest.mark.asyncio
+    async def test_download_not_connected(self, onstepx_client):
+        """Test download without a connection."""
+        assert await onstepx_client.pec_download_model() is None
+
+
 # =============================================================================
 # Driver Status Tests
 # =============================================================================
@@ -555,6 +635,99 @@ class TestDriverStatusCommands:
         assert result["axis1_ra"].standstill is True
         assert result["axis2_dec"].stallguard is True
 
+    @pytest.mark.asyncio
+    async def test_get_driver_snapshot(self, connected_client, mock_socket):
+        """Test both axes arrive in one :NWDS# frame."""
+        from services.mount_control.nightwatch_protocol import (
+            DriverSnapshot, FrameType, build_driver_status_payload, encode_frame,
+        )
+        snapshots = [
+            DriverSnapshot(axis=1, drv_status=0x80000200, sg_result=0x200, cs_actual=0,
+                           spi_status=0, age_ms=10),
+            DriverSnapshot(axis=2, drv_status=0x01140010, sg_result=0x10, cs_actual=20,
+                           spi_status=0, age_ms=60),
+        ]
+        mock_socket.recv = Mock(return_value=encode_frame(
+            FrameType.DRIVER_STATUS, build_driver_status_payload(1000, snapshots)
+        ))
+
+        result = await connected_client.get_driver_snapshot()
+
+        assert mock_socket.sendall.call_args[0][0] == b":NWDS#"
+        assert result["axis1_ra"].sg_result == 0x200
+        assert result["axis2_dec"].cs_actual == 20
+        assert result["axis2_dec"].age_ms == 60
+
+    @pytest.mark.asyncio
+    async def test_get_driver_snapshot_wrong_frame(self, connected_client, mock_socket):
+        """Test a frame of another type is ignored."""
+        from services.mount_control.nightwatch_protocol import FrameType, encode_frame
+        mock_socket.recv = Mock(return_value=encode_frame(FrameType.STATUS, bytes(30)))
+
+        assert await connected_client.get_driver_snapshot() is None
+
+    @pytest.mark.asyncio
+    async def test_get_driver_snapshot_not_connected(self, onstepx_client):
+        """Test snapshot query without a connection."""
+        assert await onstepx_client.get_driver_snapshot() is None
+
+
+# =============================================================================
+# StallGuard Calibration Tests
+# =============================================================================
+
+class TestStallGuardCalibration:
+    """Unit tests for StallGuard threshold calibration."""
+
+    @pytest.mark.asyncio
+    async def test_start_calibration(self, connected_client, mock_socket):
+        """Test starting a sweep on axis 2."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.start_stallguard_calibration(axis=2) is True
+        assert b":NWSC2#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_start_rejected(self, connected_client, mock_socket):
+        """Test firmware refusing a sweep (e.g. while slewing)."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.start_stallguard_calibration() is False
+
+    @pytest.mark.asyncio
+    async def test_status_running(self, connected_client, mock_socket):
+        """Test progress while the sweep runs; no table is fetched."""
+        mock_socket.recv = Mock(return_value=b"1,3,8,0#")
+
+        cal = await connected_client.get_stallguard_calibration(axis=1)
+
+        assert cal.state == "running"
+        assert cal.point == 3
+        assert cal.points == 8
+        assert cal.table == []
+        assert mock_socket.sendall.call_count == 1
+
+    @pytest.mark.asyncio
+    async def test_status_done_with_table(self, connected_client, mock_socket):
+        """Test the calibrated table is read point by point."""
+        mock_socket.recv = Mock(side_effect=[b"2,0,2,2420#", b"1537,95,92,0#", b"2420,148,145,72#"])
+
+        cal = await connected_client.get_stallguard_calibration(axis=1)
+
+        assert cal.calibrated is True
+        assert cal.crossover_deg_s == pytest.approx(2.42)
+        assert len(cal.table) == 2
+        assert cal.table[1].threshold == 72
+        assert cal.table[0].rate_deg_s == pytest.approx(1.537)
+        assert b":NWSP11#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_status_unparseable(self, connected_client, mock_socket):
+        """Test stock firmware without the command."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_stallguard_calibration() is None
+
 
 # =============================================================================
 # Tracking Rate Offset Tests
@@ -644,6 +817,698 @@ class TestTrackingOffset:
         assert result is None
 
 
+# =============================================================================
+# Encoder Closed Loop Tests
+# =============================================================================
+
+class TestEncoderLoop:
+    """Unit tests for the on-controller encoder closed loop."""
+
+    @pytest.mark.asyncio
+    async def test_engage(self, connected_client, mock_socket):
+        """Test engaging the loop."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        result = await connected_client.set_encoder_loop(True)
+
+        assert result is True
+        assert b":NWEL1#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_disable(self, connected_client, mock_socket):
+        """Test disabling the loop."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.set_encoder_loop(False) is True
+        assert b":NWEL0#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_engage_rejected(self, connected_client, mock_socket):
+        """Test engage refused (e.g. ENCODER_LOOP OFF or slewing)."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.set_encoder_loop(True) is False
+
+    @pytest.mark.asyncio
+    async def test_status_engaged(self, connected_client, mock_socket):
+        """Test parsing an engaged axis status."""
+        mock_socket.recv = Mock(return_value=b"1,-150,41,0#")
+
+        status = await connected_client.get_encoder_loop_status(axis=2)
+
+        assert b":NWEQ2#" in mock_socket.sendall.call_args[0][0]
+        assert status.axis == 2
+        assert status.engaged is True
+        assert status.error_arcsec == pytest.approx(-0.15)
+        assert status.correction_steps == 41
+        assert status.slip_count == 0
+
+    @pytest.mark.asyncio
+    async def test_status_slip(self, connected_client, mock_socket):
+        """Test a latched slip."""
+        mock_socket.recv = Mock(return_value=b"2,74880,41,1#")
+
+        status = await connected_client.get_encoder_loop_status()
+
+        assert status.slipped is True
+        assert status.error_arcsec == pytest.approx(74.88)
+        assert status.slip_count == 1
+
+    @pytest.mark.asyncio
+    async def test_status_invalid(self, connected_client, mock_socket):
+        """Test an unparseable reply."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_encoder_loop_status() is None
+
+    @pytest.mark.asyncio
+    async def test_clear_slip(self, connected_client, mock_socket):
+        """Test clearing a latched slip."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.clear_encoder_slip() is True
+        assert b":NWER#" in mock_socket.sendall.call_args[0][0]
+
+
+# =============================================================================
+# Goto Mode Tests
+# =============================================================================
+
+class TestGotoMode:
+    """Unit tests for coordinated goto mode."""
+
+    @pytest.mark.asyncio
+    async def test_enable_coordinated(self, connected_client, mock_socket):
+        """Test selecting coordinated gotos."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.set_coordinated_goto(True) is True
+        assert b":NWGM1#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_set_rejected(self, connected_client, mock_socket):
+        """Test mode change refused (e.g. during a goto)."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.set_coordinated_goto(False) is False
+
+    @pytest.mark.asyncio
+    async def test_get_mode(self, connected_client, mock_socket):
+        """Test querying the goto mode."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.get_coordinated_goto() is True
+        assert b":NWGM#" in mock_socket.sendall.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_get_mode_unavailable(self, connected_client, mock_socket):
+        """Test stock firmware without the command."""
+        mock_socket.recv = Mock(return_value=b"#")
+
+        assert await connected_client.get_coordinated_goto() is None
+
+
+# =============================================================================
+# Pointing Model Tests
+# =============================================================================
+
+class TestPointingModel:
+    """Unit tests for pointing model upload and control."""
+
+    @pytest.mark.asyncio
+    async def test_upload_and_enable(self, connected_client, mock_socket):
+        """Test the model goes out as :NWU# plus one frame, then :NWPM1#."""
+        from services.mount_control.nightwatch_protocol import (
+            FrameType, decode_frame, decode_pointing_model,
+        )
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        result = await connected_client.upload_pointing_model({"IH": 12.5, "MA": -30.0})
+
+        assert result is True
+        upload = mock_socket.sendall.call_args_list[0][0][0]
+        assert upload.startswith(b":NWU#")
+        frame_type, payload = decode_frame(upload[len(b":NWU#"):])
+        assert frame_type == FrameType.POINTING_MODEL
+        assert decode_pointing_model(payload) == {"IH": 12.5, "MA": -30.0}
+        assert mock_socket.sendall.call_args[0][0] == b":NWPM1#"
+
+    @pytest.mark.asyncio
+    async def test_upload_without_enable(self, connected_client, mock_socket):
+        """Test uploading a model without switching it on."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.upload_pointing_model({"ID": 1.0}, enable=False) is True
+        assert mock_socket.sendall.call_count == 1
+
+    @pytest.mark.asyncio
+    async def test_upload_rejected(self, connected_client, mock_socket):
+        """Test firmware without POINTING_MODEL rejecting the frame."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.upload_pointing_model({"IH": 1.0}) is False
+        assert mock_socket.sendall.call_count == 1
+
+    @pytest.mark.asyncio
+    async def test_unknown_term_not_sent(self, connected_client, mock_socket):
+        """Test an unknown term is rejected locally."""
+        assert await connected_client.upload_pointing_model({"XX": 1.0}) is False
+        mock_socket.sendall.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_get_state(self, connected_client, mock_socket):
+        """Test querying the model state."""
+        mock_socket.recv = Mock(return_value=b"2#")
+
+        assert await connected_client.get_pointing_model_state() == "active"
+        assert mock_socket.sendall.call_args[0][0] == b":NWPM#"
+
+    @pytest.mark.asyncio
+    async def test_get_state_unavailable(self, connected_client, mock_socket):
+        """Test stock firmware without the command."""
+        mock_socket.recv = Mock(return_value=b"#")
+
+        assert await connected_client.get_pointing_model_state() is None
+
+
+# =============================================================================
+# Refraction Tests
+# =============================================================================
+
+class TestRefractionWeather:
+    """Unit tests for refraction weather pushes."""
+
+    @pytest.mark.asyncio
+    async def test_set_weather(self, connected_client, mock_socket):
+        """Test temperature and pressure command format."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.set_refraction_weather(-3.25, 815.04) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWRW-3.2,815.0#"
+
+    @pytest.mark.asyncio
+    async def test_out_of_range_not_sent(self, connected_client, mock_socket):
+        """Test implausible values are rejected locally."""
+        assert await connected_client.set_refraction_weather(10.0, 29.92) is False
+        mock_socket.sendall.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_push_from_conditions(self, connected_client, mock_socket):
+        """Test forwarding weather service conditions in hPa."""
+        from types import SimpleNamespace
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        conditions = SimpleNamespace(temperature_c=8.0, pressure_inhg=29.90, station_pressure_inhg=24.17)
+        assert await connected_client.push_refraction_weather(conditions) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWRW8.0,818.5#"
+
+    @pytest.mark.asyncio
+    async def test_relative_pressure_not_pushed(self, connected_client, mock_socket):
+        """Test sea-level or defaulted pressure never reaches the tables."""
+        from types import SimpleNamespace
+
+        conditions = SimpleNamespace(temperature_c=8.0, pressure_inhg=29.92, station_pressure_inhg=None)
+        assert await connected_client.push_refraction_weather(conditions) is False
+        mock_socket.sendall.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_push_missing_data(self, connected_client, mock_socket):
+        """Test conditions without pressure are skipped."""
+        from types import SimpleNamespace
+
+        conditions = SimpleNamespace(temperature_c=8.0, pressure_inhg=None)
+        assert await connected_client.push_refraction_weather(conditions) is False
+        mock_socket.sendall.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_get_weather(self, connected_client, mock_socket):
+        """Test parsing the weather in use."""
+        mock_socket.recv = Mock(return_value=b"10.0,818.5,0#")
+
+        weather = await connected_client.get_refraction_weather()
+
+        assert weather == {"temperature_c": 10.0, "pressure_hpa": 818.5, "live": False}
+        assert mock_socket.sendall.call_args[0][0] == b":NWRW#"
+
+    @pytest.mark.asyncio
+    async def test_get_weather_unavailable(self, connected_client, mock_socket):
+        """Test stock firmware without the command."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_refraction_weather() is None
+
+
+# =============================================================================
+# Guide Channel Tests
+# =============================================================================
+
+class TestGuideChannelStats:
+    """Unit tests for guide channel counters."""
+
+    @pytest.mark.asyncio
+    async def test_get_stats(self, connected_client, mock_socket):
+        """Test parsing the counters."""
+        mock_socket.recv = Mock(return_value=b"1520,3,1,0,412#")
+
+        stats = await connected_client.get_guide_channel_stats()
+
+        assert stats == {"applied": 1520, "late": 3, "stale": 1, "bad": 0, "last_latency_us": 412}
+        assert mock_socket.sendall.call_args[0][0] == b":NWGQ#"
+
+    @pytest.mark.asyncio
+    async def test_stats_unavailable(self, connected_client, mock_socket):
+        """Test firmware without GUIDE_CHANNEL."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_guide_channel_stats() is None
+
+
+# =============================================================================
+# Motion Trace Tests
+# =============================================================================
+
+def _trace_frame(first, held, count):
+    import struct
+    from services.mount_control.nightwatch_protocol import FrameType, encode_frame
+    records = b"".join(
+        struct.pack("<IBBBBiiiHH", first + i, 1, 1, 0, 0, first + i, 0, 0, 0, 0)
+        for i in range(count)
+    )
+    return encode_frame(FrameType.TRACE, struct.pack("<IIHH", first, held, count, 24) + records)
+
+
+class TestMotionTrace:
+    """Unit tests for the controller trace recorder."""
+
+    @pytest.mark.asyncio
+    async def test_arm(self, connected_client, mock_socket):
+        """Test arm command format."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.arm_trace(channels=0x03, decimate=2, post_trigger=500) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWTA3,2,500#"
+
+    @pytest.mark.asyncio
+    async def test_arm_rejected(self, connected_client, mock_socket):
+        """Test firmware without TRACE_RECORDER."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.arm_trace() is False
+
+    @pytest.mark.asyncio
+    async def test_status(self, connected_client, mock_socket):
+        """Test status parsing."""
+        mock_socket.recv = Mock(return_value=b"2,65536,65536,1200,15#")
+
+        status = await connected_client.get_trace_status()
+
+        assert status == {"state": "stopped", "records": 65536, "capacity": 65536,
+                          "overwritten": 1200, "channels": 15}
+
+    @pytest.mark.asyncio
+    async def test_download_in_chunks(self, connected_client, mock_socket):
+        """Test chunked download until all held records are read."""
+        mock_socket.recv = Mock(side_effect=[_trace_frame(0, 5, 3), _trace_frame(3, 5, 2)])
+
+        records = await connected_client.download_trace()
+
+        assert [r.steps for r in records] == [0, 1, 2, 3, 4]
+        sent = [call[0][0] for call in mock_socket.sendall.call_args_list]
+        assert sent[-2:] == [b":NWTD0#", b":NWTD3#"]
+
+    @pytest.mark.asyncio
+    async def test_download_while_recording(self, connected_client, mock_socket):
+        """Test the empty frame returned while armed."""
+        mock_socket.recv = Mock(return_value=_trace_frame(0, 0, 0))
+
+        assert await connected_client.download_trace() == []
+
+
+# =============================================================================
+# Target Queue Tests
+# =============================================================================
+
+class TestTargetQueue:
+    """Unit tests for the onboard target queue."""
+
+    @pytest.mark.asyncio
+    async def test_upload(self, connected_client, mock_socket):
+        """Test the upload frame follows :NWU#."""
+        from services.mount_control.nightwatch_protocol import (
+            FrameType, QueuedTarget, decode_frame,
+        )
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        targets = [QueuedTarget(target_id=1, ra_hours=5.5, dec_degrees=-5.4, dwell_seconds=300),
+                   QueuedTarget(target_id=2, ra_hours=13.4, dec_degrees=47.2)]
+        assert await connected_client.upload_targets(targets) is True
+
+        sent = mock_socket.sendall.call_args[0][0]
+        assert sent.startswith(b":NWU#")
+        frame_type, payload = decode_frame(sent[5:])
+        assert frame_type == FrameType.TARGET_QUEUE
+        assert payload[:2] == bytes([2, 0])
+
+    @pytest.mark.asyncio
+    async def test_upload_rejected(self, connected_client, mock_socket):
+        """Test a queue the controller cannot hold."""
+        from services.mount_control.nightwatch_protocol import QueuedTarget
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        targets = [QueuedTarget(target_id=1, ra_hours=0, dec_degrees=0)]
+        assert await connected_client.upload_targets(targets, append=True) is False
+
+    @pytest.mark.asyncio
+    async def test_next_and_clear(self, connected_client, mock_socket):
+        """Test queue control commands."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.next_target() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWQN#"
+        assert await connected_client.clear_targets() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWQC#"
+
+    @pytest.mark.asyncio
+    async def test_status(self, connected_client, mock_socket):
+        """Test status parsing."""
+        mock_socket.recv = Mock(return_value=b"2,42,5,17#")
+
+        status = await connected_client.get_target_queue_status()
+
+        assert status == {"state": "settling", "target_id": 42, "queued": 5, "event_sequence": 17}
+
+
+# =============================================================================
+# Spline Track Tests
+# =============================================================================
+
+class TestSplineTrack:
+    """Unit tests for spline track mode."""
+
+    @pytest.mark.asyncio
+    async def test_upload(self, connected_client, mock_socket):
+        """Test the upload frame follows :NWU#."""
+        from services.mount_control.nightwatch_protocol import (
+            FrameType, decode_frame, spline_knots_from_samples,
+        )
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        knots = spline_knots_from_samples([(0.0, 120.0, 30.0), (1.0, 121.5, 31.0), (2.0, 123.0, 32.0)])
+        assert await connected_client.upload_spline_track(knots, frame="altaz") is True
+
+        sent = mock_socket.sendall.call_args[0][0]
+        assert sent.startswith(b":NWU#")
+        frame_type, payload = decode_frame(sent[5:])
+        assert frame_type == FrameType.SPLINE_TRACK
+        assert payload[:4] == bytes([1, 0, 3, 0])
+
+    @pytest.mark.asyncio
+    async def test_upload_invalid(self, connected_client, mock_socket):
+        """Test a path that cannot be encoded is not sent."""
+        from services.mount_control.nightwatch_protocol import SplineKnot
+
+        knots = [SplineKnot(0.0, 0.0, 0.0, 0.0, 0.0)]
+        assert await connected_client.upload_spline_track(knots) is False
+        mock_socket.sendall.assert_not_called()
+
+    @pytest.mark.asyncio
+    async def test_start_stop(self, connected_client, mock_socket):
+        """Test track control commands."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.start_spline_track() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWKS#"
+        assert await connected_client.stop_spline_track() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWKX#"
+
+    @pytest.mark.asyncio
+    async def test_start_rejected(self, connected_client, mock_socket):
+        """Test starting with nothing uploaded."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.start_spline_track() is False
+
+    @pytest.mark.asyncio
+    async def test_status(self, connected_client, mock_socket):
+        """Test status parsing."""
+        mock_socket.recv = Mock(return_value=b"3,12500,-850,120,4,0#")
+
+        status = await connected_client.get_spline_track_status()
+
+        assert status == {
+            "state": "following", "elapsed_ms": 12500, "axis1_lag_arcsec": -0.85,
+            "axis2_lag_arcsec": 0.12, "clipped_slices": 4, "underruns": 0,
+        }
+
+
+# =============================================================================
+# Timing Benchmark Tests
+# =============================================================================
+
+class TestTimingBenchmark:
+    """Unit tests for the BENCHMARK build probes."""
+
+    @pytest.mark.asyncio
+    async def test_report(self, connected_client, mock_socket):
+        """Test reading all probes."""
+        mock_socket.recv = Mock(side_effect=[
+            b"2#",
+            b"step_isr,120000,0,180,410,1230,2100,3050,455,5000#",
+            b"encoder,6000,2,900,2300,8100,12000,412000,2500,400000#",
+        ])
+
+        report = await connected_client.get_benchmark_report()
+
+        assert list(report) == ["step_isr", "encoder"]
+        assert report["step_isr"]["p99_ns"] == 1230
+        assert report["encoder"]["overruns"] == 2
+        assert report["encoder"]["budget_ns"] == 400000
+        sent = [call[0][0] for call in mock_socket.sendall.call_args_list]
+        assert sent[-3:] == [b":NWBQ#", b":NWBQ0#", b":NWBQ1#"]
+
+    @pytest.mark.asyncio
+    async def test_report_unavailable(self, connected_client, mock_socket):
+        """Test firmware built without BENCHMARK."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_benchmark_report() is None
+
+    @pytest.mark.asyncio
+    async def test_reset(self, connected_client, mock_socket):
+        """Test probe reset."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.reset_benchmark() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWBZ#"
+
+
+# =============================================================================
+# Clock Discipline Tests
+# =============================================================================
+
+class TestClockDiscipline:
+    """Unit tests for the disciplined controller clock."""
+
+    @pytest.mark.asyncio
+    async def test_mapping(self, connected_client, mock_socket):
+        """Test status parsing and controller-to-UTC conversion."""
+        mock_socket.recv = Mock(return_value=b"2,5000000,1760000000000000,40000,-12,180,20#")
+
+        mapping = await connected_client.get_clock_mapping()
+
+        assert mock_socket.sendall.call_args[0][0] == b":NWYQ#"
+        assert mapping.state == "locked"
+        assert mapping.synced is True
+        assert mapping.last_delay_us == 180
+        # 10 s later on a crystal 40 ppm slow: 400 us more UTC
+        assert mapping.to_utc_us(15_000_000) == 1760000010000400
+
+    @pytest.mark.asyncio
+    async def test_unavailable(self, connected_client, mock_socket):
+        """Test firmware without TIME_DISCIPLINE."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_clock_mapping() is None
+
+
+# =============================================================================
+# Calibration Store Tests
+# =============================================================================
+
+class TestCalibrationStore:
+    """Unit tests for the flash calibration store."""
+
+    @pytest.mark.asyncio
+    async def test_save(self, connected_client, mock_socket):
+        """Test queuing all keys and a single key."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.save_calibration() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWFW#"
+        assert await connected_client.save_calibration(3) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWFW3#"
+
+    @pytest.mark.asyncio
+    async def test_status(self, connected_client, mock_socket):
+        """Test store status parsing."""
+        mock_socket.recv = Mock(return_value=b"3,4,16,1890,10,52,7,0#")
+
+        status = await connected_client.get_store_status()
+
+        assert mock_socket.sendall.call_args[0][0] == b":NWFQ#"
+        assert status["state"] == "programming"
+        assert status["blocks_used"] == 4
+        assert status["live_bytes"] == 1890
+        assert status["pending"] == [1, 3]
+        assert status["max_erase_count"] == 7
+
+    @pytest.mark.asyncio
+    async def test_unavailable(self, connected_client, mock_socket):
+        """Test firmware without FLASH_STORE."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_store_status() is None
+
+
+# =============================================================================
+# Warm Start Tests
+# =============================================================================
+
+class TestWarmStart:
+    """Unit tests for the absolute-encoder warm start."""
+
+    @pytest.mark.asyncio
+    async def test_status_warm_coarse(self, connected_client, mock_socket):
+        """Test a warm start after a reset while tracking."""
+        mock_socket.recv = Mock(return_value=b"5,3,2,-1,418#")
+
+        status = await connected_client.get_warm_start_status()
+
+        assert mock_socket.sendall.call_args[0][0] == b":NWWQ#"
+        assert status["result"] == "warm_coarse"
+        assert status["warm"] is True
+        assert status["needs_sync"] is True
+        assert status["record"] == "tracking"
+        assert status["axis2_delta_counts"] == -1
+
+    @pytest.mark.asyncio
+    async def test_status_cold(self, connected_client, mock_socket):
+        """Test a cold start after the mount was moved."""
+        mock_socket.recv = Mock(return_value=b"2,2,140,0,12#")
+
+        status = await connected_client.get_warm_start_status()
+
+        assert status["result"] == "cold_moved"
+        assert status["warm"] is False
+
+    @pytest.mark.asyncio
+    async def test_invalidate(self, connected_client, mock_socket):
+        """Test discarding the checkpoint."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.invalidate_warm_start() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWWX#"
+
+
+# =============================================================================
+# Safety Park Tests
+# =============================================================================
+
+class TestSafetyPark:
+    """Unit tests for the controller-side safety park."""
+
+    @pytest.mark.asyncio
+    async def test_heartbeat(self, connected_client, mock_socket):
+        """Test arming and disarming the heartbeat."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.safety_heartbeat() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWHB#"
+        assert await connected_client.safety_heartbeat(arm=False) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWHB0#"
+
+    @pytest.mark.asyncio
+    async def test_park_and_clear(self, connected_client, mock_socket):
+        """Test the fast-path park and a refused clear."""
+        mock_socket.recv = Mock(return_value=b"1#")
+        assert await connected_client.safety_park() is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWHP#"
+
+        mock_socket.recv = Mock(return_value=b"0#")
+        assert await connected_client.clear_safety_park() is False
+        assert mock_socket.sendall.call_args[0][0] == b":NWHC#"
+
+    @pytest.mark.asyncio
+    async def test_status(self, connected_client, mock_socket):
+        """Test status parsing after a rain input trip."""
+        mock_socket.recv = Mock(return_value=b"3,5,1,4200,4000,2004,2#")
+
+        status = await connected_client.get_safety_park_status()
+
+        assert mock_socket.sendall.call_args[0][0] == b":NWHQ#"
+        assert status["state"] == "parked"
+        assert status["causes"] == ["input", "host"]
+        assert status["input_active"] is True
+        assert status["worst_stop_latency_us"] == 4000
+        assert status["park_failures"] == 0
+
+    @pytest.mark.asyncio
+    async def test_status_after_failed_park(self, connected_client, mock_socket):
+        """Test a park aborted short of the park position reports a fault."""
+        mock_socket.recv = Mock(return_value=b"4,4,0,0,1000,2004,1,1#")
+
+        status = await connected_client.get_safety_park_status()
+
+        assert status["state"] == "fault"
+        assert status["park_failures"] == 1
+
+
+# =============================================================================
+# Backlash Compensation Tests
+# =============================================================================
+
+class TestBacklashComp:
+    """Unit tests for backlash measurement and takeup."""
+
+    @pytest.mark.asyncio
+    async def test_start_calibration(self, connected_client, mock_socket):
+        """Test starting a measurement sweep."""
+        mock_socket.recv = Mock(return_value=b"1#")
+
+        assert await connected_client.start_backlash_calibration(2) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWLC2#"
+
+    @pytest.mark.asyncio
+    async def test_set_backlash(self, connected_client, mock_socket):
+        """Test a host-measured value is sent in milliarcseconds."""
+        mock_socket.recv = Mock(return_value=b"1#")
+        assert await connected_client.set_backlash(2, 36.0) is True
+        assert mock_socket.sendall.call_args[0][0] == b":NWLS236000#"
+
+        mock_socket.recv = Mock(return_value=b"0#")
+        assert await connected_client.set_backlash(1, 900.0) is False
+
+    @pytest.mark.asyncio
+    async def test_status(self, connected_client, mock_socket):
+        """Test status parsing of a measured axis."""
+        mock_socket.recv = Mock(return_value=b"2,192,36000,2005,14#")
+
+        status = await connected_client.get_backlash_status(2)
+
+        assert mock_socket.sendall.call_args[0][0] == b":NWLQ2#"
+        assert status["state"] == "done"
+        assert status["backlash_arcsec"] == pytest.approx(36.0)
+        assert status["takeup_s"] == pytest.approx(192 / 2005)
+        assert status["takeups"] == 14
+
+    @pytest.mark.asyncio
+    async def test_status_unsupported(self, connected_client, mock_socket):
+        """Test firmware without BACKLASH_COMP."""
+        mock_socket.recv = Mock(return_value=b"0#")
+
+        assert await connected_client.get_backlash_status(2) is None
+
+
 # =============================================================================
 # Extended Status Tests
 # =============================================================================
@@ -0,0 +1,150 @@
+"""
+Unit tests for the NIGHTWATCH pointing model fitter.
+
+Synthetic observations are generated from known coefficients with the same
+term definitions as firmware/onstepx_config/nightwatch/PointingModel.h and
+the fit must recover them.
+"""
+
+import math
+import random
+
+import pytest
+
+from services.astrometry.pointing_model import (
+    DEFAULT_TERMS,
+    PointingObservation,
+    correction,
+    fit_pointing_model,
+    observation_from_solve,
+    term_partials,
+)
+from services.astrometry.plate_solver import SolveResult, SolveStatus
+
+LATITUDE = 39.0
+TRUE_TERMS = {"IH": 120.0, "ID": -45.0, "CH": 30.0, "NP": -12.0, "MA": 90.0, "ME": -60.0, "TF": 8.0}
+
+
+def _observations(terms, count=40, noise_arcsec=0.0, seed=1):
+    rng = random.Random(seed)
+    observations = []
+    for i in range(count):
+        ha = rng.uniform(-80.0, 80.0)
+        dec = rng.uniform(-30.0, 80.0)
+        pier_west = ha > 0
+        dh, dd = correction(terms, ha, dec, LATITUDE, pier_west)
+        dh += rng.gauss(0, noise_arcsec) / math.cos(math.radians(dec))
+        dd += rng.gauss(0, noise_arcsec)
+        observations.append(PointingObservation(
+            ha_deg=ha,
+            dec_deg=dec,
+            mount_ha_deg=ha + dh / 3600.0,
+            mount_dec_deg=dec + dd / 3600.0,
+            pier_west=pier_west,
+        ))
+    return observations
+
+
+# =============================================================================
+# Term Tests
+# =============================================================================
+
+class TestTerms:
+    """Test individual term definitions."""
+
+    def test_index_terms(self):
+        assert term_partials("IH", 30.0, 20.0, LATITUDE, False) == (1.0, 0.0)
+        assert term_partials("ID", 30.0, 20.0, LATITUDE, True) == (0.0, -1.0)
+
+    def test_cone_flips_with_pier_side(self):
+        east = term_partials("CH", 10.0, 60.0, LATITUDE, False)
+        west = term_partials("CH", 10.0, 60.0, LATITUDE, True)
+        assert east[0] == pytest.approx(2.0)
+        assert west[0] == pytest.approx(-2.0)
+
+    def test_polar_terms_at_meridian(self):
+        ma = term_partials("MA", 0.0, 45.0, LATITUDE, False)
+        me = term_partials("ME", 0.0, 45.0, LATITUDE, False)
+        assert ma == pytest.approx((-1.0, 0.0))
+        assert me == pytest.approx((0.0, 1.0))
+
+    def test_pole_clamped(self):
+        dh, _ = term_partials("NP", 0.0, 90.0, LATITUDE, False)
+        assert math.isfinite(dh)
+
+    def test_unknown_term(self):
+        with pytest.raises(ValueError):
+            term_partials("XX", 0.0, 0.0, LATITUDE, False)
+
+
+# =============================================================================
+# Fit Tests
+# =============================================================================
+
+class TestFit:
+    """Test least-squares fitting."""
+
+    def test_recovers_exact_terms(self):
+        fit = fit_pointing_model(_observations(TRUE_TERMS), LATITUDE)
+        for name, value in TRUE_TERMS.items():
+            assert fit.terms[name] == pytest.approx(value, abs=1e-6)
+        assert fit.rms_arcsec < 1e-6
+        assert fit.observation_count == 40
+
+    def test_noisy_fit(self):
+        fit = fit_pointing_model(_observations(TRUE_TERMS, count=80, noise_arcsec=2.0), LATITUDE)
+        assert fit.terms["MA"] == pytest.approx(90.0, abs=3.0)
+        assert fit.terms["IH"] == pytest.approx(120.0, abs=5.0)
+        assert 1.0 < fit.rms_arcsec < 4.0
+
+    def test_subset_of_terms(self):
+        terms = {"IH": 50.0, "ID": 20.0}
+        fit = fit_pointing_model(_observations(terms, count=5), LATITUDE, terms=("IH", "ID"))
+        assert fit.terms["IH"] == pytest.approx(50.0)
+        assert fit.terms["ID"] == pytest.approx(20.0)
+
+    def test_harmonic_terms(self):
+        terms = dict(TRUE_TERMS, HHSH=5.0, HDCD=-3.0)
+        fit = fit_pointing_model(_observations(terms, count=60), LATITUDE,
+                                 terms=DEFAULT_TERMS + ("HHSH", "HDCD"))
+        assert fit.terms["HHSH"] == pytest.approx(5.0, abs=1e-6)
+        assert fit.terms["HDCD"] == pytest.approx(-3.0, abs=1e-6)
+
+    def test_too_few_observations(self):
+        with pytest.raises(ValueError):
+            fit_pointing_model(_observations(TRUE_TERMS, count=3), LATITUDE)
+
+    def test_degenerate_observations(self):
+        same = _observations(TRUE_TERMS, count=1) * 10
+        with pytest.raises(ValueError):
+            fit_pointing_model(same, LATITUDE)
+
+    def test_unknown_term(self):
+        with pytest.raises(ValueError):
+            fit_pointing_model(_observations(TRUE_TERMS), LATITUDE, terms=("IH", "QQ"))
+
+
+# =============================================================================
+# Plate Solve Integration Tests
+# =============================================================================
+
+class TestObservationFromSolve:
+    """Test building observations from plate solves."""
+
+    def test_successful_solve(self):
+        result = SolveResult(status=SolveStatus.SUCCESS, ra_deg=100.0, dec_deg=20.0)
+        obs = observation_from_solve(result, mount_ra_deg=100.01, mount_dec_deg=20.02,
+                                     lst_deg=130.0, pier_west=True)
+        assert obs.ha_deg == pytest.approx(30.0)
+        assert obs.mount_ha_deg == pytest.approx(29.99)
+        assert obs.mount_dec_deg == 20.02
+        assert obs.pier_west is True
+
+    def test_hour_angle_wraps(self):
+        result = SolveResult(status=SolveStatus.SUCCESS, ra_deg=350.0, dec_deg=0.0)
+        obs = observation_from_solve(result, 350.0, 0.0, lst_deg=10.0)
+        assert obs.ha_deg == pytest.approx(20.0)
+
+    def test_failed_solve(self):
+        result = SolveResult(status=SolveStatus.FAILED)
+        assert observation_from_solve(result, 0.0, 0.0, 0.0) is None
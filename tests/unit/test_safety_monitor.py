@@ -195,6 +195,50 @@ class TestSafetyMonitor:
         assert monitor._target_altitude == 45.0
 
 
+class TestMountHeartbeat:
+    """Tests for the controller safety heartbeat fed by the monitor loop."""
+
+    @pytest.mark.asyncio
+    async def test_run_feeds_and_disarms_heartbeat(self):
+        """Test that each pass sends a heartbeat and exit disarms it."""
+        mount = Mock()
+        mount.safety_heartbeat = AsyncMock(return_value=True)
+        monitor = SafetyMonitor(mount_controller=mount)
+
+        async def stop_after_first_pass(_):
+            monitor.stop()
+
+        with patch("asyncio.sleep", side_effect=stop_after_first_pass):
+            await monitor.run(poll_interval=10.0)
+
+        assert [c.args for c in mount.safety_heartbeat.call_args_list] == [(True,), (False,)]
+
+    @pytest.mark.asyncio
+    async def test_mount_without_heartbeat(self):
+        """Test plain LX200 mounts are left alone."""
+        monitor = SafetyMonitor(mount_controller=object())
+
+        await monitor._mount_heartbeat()
+
+    @pytest.mark.asyncio
+    async def test_run_claims_safety_session(self):
+        """Test the loop puts the mount session in the safety class so :hP# jumps the queues."""
+        from services.mount_control.lx200 import SessionPriority
+
+        mount = Mock()
+        mount.safety_heartbeat = AsyncMock(return_value=True)
+        mount.claim_session_priority = Mock(return_value=True)
+        monitor = SafetyMonitor(mount_controller=mount)
+
+        async def stop_after_first_pass(_):
+            monitor.stop()
+
+        with patch("asyncio.sleep", side_effect=stop_after_first_pass):
+            await monitor.run(poll_interval=10.0)
+
+        mount.claim_session_priority.assert_called_once_with(SessionPriority.SAFETY)
+
+
 class TestRainHoldoff:
     """Tests for Step 465 rain holdoff functionality."""
 
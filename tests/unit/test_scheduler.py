@@ -16,6 +16,7 @@ from services.scheduling.scheduler import (
     ScheduleReason,
     CandidateTarget,
     get_scheduler,
+    scurve_move_seconds,
 )
 
 
@@ -534,6 +535,45 @@ class TestEnums:
         assert ScheduleReason.HISTORICAL_SUCCESS.value == "historical_success"
 
 
+# =============================================================================
+# Slew Transition Tests
+# =============================================================================
+
+
+class TestSlewTransition:
+    """Tests for S-curve slew time between targets."""
+
+    def test_long_move_reaches_goto_rate(self):
+        """90° at 4°/s, 2°/s², 4°/s³: 2.5 s ramps each way plus 20 s cruise."""
+        assert scurve_move_seconds(90.0, 4.0, 2.0, 4.0) == pytest.approx(25.0)
+
+    def test_short_move_lowers_peak_rate(self):
+        """1° never reaches 4°/s: peaks at 1°/s with no cruise."""
+        assert scurve_move_seconds(1.0, 4.0, 2.0, 4.0) == pytest.approx(2.0, rel=1e-6)
+
+    def test_zero_distance(self):
+        """No move takes no time."""
+        assert scurve_move_seconds(0.0, 4.0, 2.0, 4.0) == 0.0
+
+    def test_fixed_buffer_without_jerk(self, scheduler):
+        """Without a slew model the legacy 5 minute buffer is used."""
+        a = CandidateTarget(target_id="A", target_name=None, ra_hours=0.0, dec_degrees=0.0)
+        b = CandidateTarget(target_id="B", target_name=None, ra_hours=6.0, dec_degrees=0.0)
+        gap = scheduler._transition_time(a, b, SchedulingConstraints())
+        assert gap == timedelta(minutes=5)
+
+    def test_scurve_transition(self, scheduler):
+        """With AXIS*_JERK set the gap is the slower axis slew plus settle."""
+        a = CandidateTarget(target_id="A", target_name=None, ra_hours=23.0, dec_degrees=10.0)
+        b = CandidateTarget(target_id="B", target_name=None, ra_hours=1.0, dec_degrees=20.0)
+        constraints = SchedulingConstraints(slew_jerk_deg_s3=4.0, settle_seconds=30.0)
+        gap = scheduler._transition_time(a, b, constraints)
+        # RA wraps: 30° (10 s), Dec 10° (5 s)
+        expected = scurve_move_seconds(30.0, 4.0, 2.0, 4.0) + 30.0
+        assert gap.total_seconds() == pytest.approx(expected)
+        assert gap < timedelta(minutes=1)
+
+
 # =============================================================================
 # Factory Function Tests
 # =============================================================================
@@ -0,0 +1,273 @@
+"""
+Unit tests for the mount telemetry push stream subscriber.
+
+Tests services/mount_control/telemetry.py against frames laid out as in
+firmware/onstepx_config/nightwatch/TelemetryStream.h.
+"""
+
+import asyncio
+from unittest.mock import MagicMock, patch
+
+import pytest
+
+from services.mount_control.lx200 import LX200Client, PierSide
+from services.mount_control.nightwatch_protocol import FrameType, encode_frame
+from services.mount_control.telemetry import (
+    TELEMETRY_PAYLOAD,
+    TelemetrySubscriber,
+    parse_telemetry_payload,
+)
+
+# Frame produced by TelemetryStream.h for sequence 0:
+# t=123456789012 us, steps (1, -2), encoder (3, -4), RA 10°, Dec -5°, tracking, west
+FIRMWARE_FRAME = bytes.fromhex(
+    "4e5702260000000000141a99be1c00000001000000feffffff03000000fcffffff"
+    "005125028057edfe0102a57e"
+)
+
+# Same sample from TIME_DISCIPLINE firmware, UTC 1760000000123456 us appended
+FIRMWARE_FRAME_UTC = bytes.fromhex(
+    "4e57022e0000000000141a99be1c00000001000000feffffff03000000fcffffff"
+    "005125028057edfe010240e2cfeeb5400600824e"
+)
+
+
+def _frame(sequence: int, ra_mas: int = 36_000_000, dec_mas: int = 0, flags: int = 0x01,
+           time_us: int = 1000) -> bytes:
+    payload = TELEMETRY_PAYLOAD.pack(sequence, time_us, 10, 20, 30, 40, ra_mas, dec_mas, flags, 1)
+    return encode_frame(FrameType.TELEMETRY, payload)
+
+
+class TestTelemetryPayload:
+    """Test telemetry payload decoding."""
+
+    def test_firmware_frame(self):
+        subscriber = TelemetrySubscriber()
+        sample = subscriber.handle_datagram(FIRMWARE_FRAME)
+
+        assert sample.sequence == 0
+        assert sample.controller_time_us == 123456789012
+        assert sample.axis1_steps == 1
+        assert sample.axis2_steps == -2
+        assert sample.axis1_encoder == 3
+        assert sample.axis2_encoder == -4
+        assert sample.ra_degrees == pytest.approx(10.0)
+        assert sample.dec_degrees == pytest.approx(-5.0)
+        assert sample.is_tracking is True
+        assert sample.pier_side == "W"
+
+    def test_payload_size(self):
+        assert TELEMETRY_PAYLOAD.size == 38
+
+    def test_firmware_frame_with_utc(self):
+        subscriber = TelemetrySubscriber()
+        sample = subscriber.handle_datagram(FIRMWARE_FRAME_UTC)
+
+        assert sample.controller_time_us == 123456789012
+        assert sample.utc_time_us == 1760000000123456
+        assert sample.pier_side == "W"
+
+    def test_unsynced_utc_is_none(self):
+        sample = parse_telemetry_payload(TELEMETRY_PAYLOAD.pack(0, 1, 0, 0, 0, 0, 0, 0, 0, 0) + bytes(8))
+        assert sample.utc_time_us is None
+        assert parse_telemetry_payload(TELEMETRY_PAYLOAD.pack(0, 1, 0, 0, 0, 0, 0, 0, 0, 0)).utc_time_us is None
+
+    def test_wrong_size_rejected(self):
+        from services.mount_control.nightwatch_protocol import FrameError
+        with pytest.raises(FrameError):
+            parse_telemetry_payload(bytes(10))
+
+
+class TestTelemetrySubscriber:
+    """Test datagram handling and freshness."""
+
+    def test_defaults(self):
+        subscriber = TelemetrySubscriber()
+        assert subscriber.port == 9998
+        assert subscriber.latest is None
+        assert subscriber.is_running is False
+
+    def test_corrupt_datagram_dropped(self):
+        subscriber = TelemetrySubscriber()
+        data = bytearray(_frame(1))
+        data[8] ^= 0xFF
+        assert subscriber.handle_datagram(bytes(data)) is None
+        assert subscriber.samples_dropped == 1
+
+    def test_other_frame_type_ignored(self):
+        subscriber = TelemetrySubscriber()
+        assert subscriber.handle_datagram(encode_frame(FrameType.STATUS, bytes(30))) is None
+
+    def test_out_of_order_dropped(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.handle_datagram(_frame(5))
+        assert subscriber.handle_datagram(_frame(4)) is None
+        assert subscriber.handle_datagram(_frame(5)) is None
+        assert subscriber.handle_datagram(_frame(6)).sequence == 6
+        assert subscriber.samples_received == 2
+
+    def test_controller_reboot_restarts_stream(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.handle_datagram(_frame(5000, time_us=600_000_000))
+        # Rebooted controller, first datagram after its sequence 0 lost
+        assert subscriber.handle_datagram(_frame(3, time_us=2_000_000)).sequence == 3
+        assert subscriber.handle_datagram(_frame(4, time_us=2_100_000)).sequence == 4
+        assert subscriber.restarts == 1
+
+    def test_clock_regression_restarts_stream(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.handle_datagram(_frame(10, time_us=600_000_000))
+        assert subscriber.handle_datagram(_frame(9, time_us=500_000)).sequence == 9
+
+    def test_silence_restarts_stream(self):
+        subscriber = TelemetrySubscriber()
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=100.0):
+            subscriber.handle_datagram(_frame(10))
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=100.1):
+            assert subscriber.handle_datagram(_frame(8)) is None
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=103.0):
+            assert subscriber.handle_datagram(_frame(8)).sequence == 8
+
+    def test_sequence_wraparound(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.handle_datagram(_frame(0xFFFFFFFF))
+        assert subscriber.handle_datagram(_frame(0)) is not None
+
+    def test_callbacks(self):
+        subscriber = TelemetrySubscriber()
+        received = []
+        subscriber.register_callback(received.append)
+        subscriber.handle_datagram(_frame(1))
+        subscriber.unregister_callback(received.append)
+        subscriber.handle_datagram(_frame(2))
+        assert [s.sequence for s in received] == [1]
+
+    def test_callback_error_does_not_break_stream(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.register_callback(MagicMock(side_effect=RuntimeError("boom")))
+        assert subscriber.handle_datagram(_frame(1)) is not None
+
+    def test_fresh_sample(self):
+        subscriber = TelemetrySubscriber(max_age=0.5)
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=100.0):
+            subscriber.handle_datagram(_frame(1))
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=100.2):
+            assert subscriber.get_fresh_sample() is not None
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=101.0):
+            assert subscriber.get_fresh_sample() is None
+            assert subscriber.latest is not None
+
+    @pytest.mark.asyncio
+    async def test_wait_for_sample(self):
+        subscriber = TelemetrySubscriber()
+        loop = asyncio.get_running_loop()
+        loop.call_later(0.01, subscriber.handle_datagram, _frame(7))
+        sample = await subscriber.wait_for_sample(timeout=1.0)
+        assert sample.sequence == 7
+
+    @pytest.mark.asyncio
+    async def test_wait_for_sample_timeout(self):
+        subscriber = TelemetrySubscriber()
+        assert await subscriber.wait_for_sample(timeout=0.01) is None
+
+    @pytest.mark.asyncio
+    async def test_start_sends_subscribe(self):
+        subscriber = TelemetrySubscriber(host="10.0.0.5", resubscribe_interval=60)
+        transport = MagicMock()
+        loop = asyncio.get_running_loop()
+
+        async def fake_endpoint(factory, remote_addr):
+            assert remote_addr == ("10.0.0.5", 9998)
+            return transport, factory()
+
+        with patch.object(loop, "create_datagram_endpoint", side_effect=fake_endpoint):
+            assert await subscriber.start() is True
+
+        transport.sendto.assert_called_with(b"NWSUB")
+        await subscriber.stop()
+        transport.sendto.assert_called_with(b"NWUNSUB")
+        transport.close.assert_called_once()
+
+    @pytest.mark.asyncio
+    async def test_start_failure(self):
+        subscriber = TelemetrySubscriber()
+        loop = asyncio.get_running_loop()
+        with patch.object(loop, "create_datagram_endpoint", side_effect=OSError("unreachable")):
+            assert await subscriber.start() is False
+
+
+def _event(sequence: int, event: int = 3, target_id: int = 42, time_us: int = 1000) -> bytes:
+    import struct
+    payload = struct.pack("<IQIBBHiiI", sequence, time_us, target_id, event, 2, 0, 100, -200, 5000)
+    return encode_frame(FrameType.TARGET_EVENT, payload)
+
+
+class TestTargetEvents:
+    """Test target queue events on the telemetry stream."""
+
+    def test_event_callback(self):
+        subscriber = TelemetrySubscriber()
+        received = []
+        subscriber.register_event_callback(received.append)
+        assert subscriber.handle_datagram(_event(1)) is None
+        assert received[0].event == "settled"
+        assert received[0].target_id == 42
+        assert subscriber.samples_dropped == 0
+
+    def test_lost_and_duplicate_events(self):
+        subscriber = TelemetrySubscriber()
+        received = []
+        subscriber.register_event_callback(received.append)
+        for sequence in (1, 2, 2, 5):
+            subscriber.handle_datagram(_event(sequence))
+        assert [e.sequence for e in received] == [1, 2, 5]
+        assert subscriber.events_lost == 2
+
+    def test_events_after_controller_reboot(self):
+        subscriber = TelemetrySubscriber()
+        received = []
+        subscriber.register_event_callback(received.append)
+        subscriber.handle_datagram(_event(300, time_us=900_000_000))
+        subscriber.handle_datagram(_event(1, time_us=5_000_000))
+        subscriber.handle_datagram(_event(2, time_us=6_000_000))
+        assert [e.sequence for e in received] == [300, 1, 2]
+        assert subscriber.events_lost == 0
+
+    def test_events_do_not_touch_samples(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.handle_datagram(_frame(1))
+        subscriber.handle_datagram(_event(1))
+        assert subscriber.latest.sequence == 1
+        assert subscriber.samples_received == 1
+
+
+class TestLX200TelemetryIntegration:
+    """Test LX200Client reading position from telemetry."""
+
+    @pytest.mark.asyncio
+    async def test_corrected_position_without_round_trip(self):
+        subscriber = TelemetrySubscriber()
+        subscriber.handle_datagram(_frame(1, ra_mas=int(187.5 * 3_600_000),
+                                         dec_mas=int(-12.5 * 3_600_000)))
+        client = LX200Client(telemetry=subscriber)
+
+        with patch.object(LX200Client, "_send_command") as send:
+            status = await client.get_corrected_position()
+            send.assert_not_called()
+
+        assert status.dec_degrees == -12.0
+        assert status.dec_minutes == 30.0
+        assert status.is_tracking is True
+        assert status.pier_side == PierSide.EAST
+
+    @pytest.mark.asyncio
+    async def test_stale_telemetry_falls_back_to_polling(self):
+        subscriber = TelemetrySubscriber(max_age=0.5)
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=100.0):
+            subscriber.handle_datagram(_frame(1))
+        client = LX200Client(telemetry=subscriber)
+
+        with patch("services.mount_control.telemetry.time.monotonic", return_value=200.0), \
+                patch.object(LX200Client, "get_status", return_value=None) as get_status:
+            assert await client.get_corrected_position() is None
+            get_status.assert_called_once()
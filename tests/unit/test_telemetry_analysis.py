@@ -0,0 +1,244 @@
+"""
+Unit tests for the NIGHTWATCH telemetry analytics (columnar log, periodic
+error, backlash and slip statistics).
+"""
+
+import math
+
+import pytest
+
+np = pytest.importorskip("numpy")
+
+from services.mount_control.nightwatch_protocol import (
+    STATUS_ENCODER_SLIP,
+    STATUS_SLEWING,
+    STATUS_TRACKING,
+)
+from services.mount_control.telemetry import TelemetrySample
+from services.mount_control.telemetry_analysis import (
+    ARCSEC_PER_REV,
+    AXIS1_CALIBRATION,
+    AXIS2_CALIBRATION,
+    TelemetryLog,
+    backlash,
+    periodic_error,
+    slip_statistics,
+    tracking_segments,
+)
+
+
+def _sample(seq, t_us, steps1=0, steps2=0, enc1=0, enc2=0, flags=STATUS_TRACKING,
+            ra=10.0, dec=20.0, pier="E", utc=None):
+    return TelemetrySample(
+        sequence=seq,
+        controller_time_us=t_us,
+        axis1_steps=steps1,
+        axis2_steps=steps2,
+        axis1_encoder=enc1,
+        axis2_encoder=enc2,
+        ra_degrees=ra,
+        dec_degrees=dec,
+        flags=flags,
+        pier_side=pier,
+        utc_time_us=utc,
+    )
+
+
+def _encoder(calibration, steps, error_arcsec):
+    """Encoder count for a step position plus an output error."""
+    revs = steps / calibration.steps_per_rev + error_arcsec / ARCSEC_PER_REV
+    return int(round(revs * calibration.encoder_counts_per_rev))
+
+
+# =============================================================================
+# Columnar Log Tests
+# =============================================================================
+
+class TestTelemetryLog:
+    """Unit tests for the on-disk columnar log."""
+
+    def test_append_flush_and_map(self, tmp_path):
+        """Test samples land in per-column files and map back."""
+        log = TelemetryLog(str(tmp_path), flush_every=3)
+        for i in range(5):
+            log.append(_sample(i, i * 100_000, steps1=i * 10, enc2=-i, pier="W"))
+
+        assert len(log) == 3  # two still buffered
+        log.flush()
+        assert len(log) == 5
+        assert list(log.column("axis1_steps")) == [0, 10, 20, 30, 40]
+        assert list(log.column("axis2_encoder")) == [0, -1, -2, -3, -4]
+        assert all(log.column("pier") == 2)
+
+    def test_reopen_appends(self, tmp_path):
+        """Test a reopened log continues the same files."""
+        log = TelemetryLog(str(tmp_path))
+        log.append(_sample(1, 0))
+        log.flush()
+        log = TelemetryLog(str(tmp_path))
+        log.append(_sample(2, 100_000))
+        log.flush()
+
+        assert list(log.column("sequence")) == [1, 2]
+
+    def test_reopen_after_interrupted_flush(self, tmp_path):
+        """Test columns a crash left at different lengths are cut back to the shortest."""
+        log = TelemetryLog(str(tmp_path))
+        for i in range(3):
+            log.append(_sample(i, i * 100_000, steps1=i))
+        log.flush()
+        # Crash between column files: two more rows in sequence, half a value in controller_time_us
+        with open(tmp_path / "sequence.bin", "ab") as f:
+            np.asarray([3, 4], dtype="<u4").tofile(f)
+        with open(tmp_path / "controller_time_us.bin", "ab") as f:
+            f.write(b"\x00" * 3)
+
+        log = TelemetryLog(str(tmp_path))
+        log.append(_sample(3, 300_000, steps1=3))
+        log.flush()
+
+        assert len(log) == 4
+        assert list(log.column("sequence")) == [0, 1, 2, 3]
+        assert list(log.column("axis1_steps")) == [0, 1, 2, 3]
+
+    def test_empty_log(self, tmp_path):
+        """Test columns of an empty log."""
+        log = TelemetryLog(str(tmp_path))
+
+        assert len(log) == 0
+        assert log.column("flags").size == 0
+        assert tracking_segments(log) == []
+
+    def test_position_at(self, tmp_path):
+        """Test interpolation at UTC instants across RA 0h."""
+        log = TelemetryLog(str(tmp_path))
+        log.append(_sample(1, 0, ra=359.9, dec=10.0, utc=1_000_000))
+        log.append(_sample(2, 1_000_000, ra=0.1, dec=12.0, utc=2_000_000, pier="W"))
+        log.flush()
+
+        ra, dec, west = log.position_at([1_500_000, 2_000_000])
+
+        assert min(ra[0], 360.0 - ra[0]) == pytest.approx(0.0, abs=1e-6)
+        assert dec[0] == pytest.approx(11.0)
+        assert bool(west[1]) is True
+
+    def test_segments_split_on_slew_and_gap(self, tmp_path):
+        """Test tracking runs end at slews and telemetry gaps."""
+        log = TelemetryLog(str(tmp_path))
+        t = 0
+        for i in range(300):
+            flags = STATUS_TRACKING | (STATUS_SLEWING if 100 <= i < 110 else 0)
+            t += 10_000_000 if i == 200 else 100_000
+            log.append(_sample(i, t, flags=flags))
+        log.flush()
+
+        segments = tracking_segments(log, max_gap_s=5.0, min_samples=10)
+
+        assert [(s.start, s.stop) for s in segments] == [(0, 100), (110, 200), (200, 300)]
+
+
+# =============================================================================
+# Periodic Error Tests
+# =============================================================================
+
+class TestPeriodicError:
+    """Unit tests for the harmonic fit over output-shaft phase."""
+
+    @pytest.fixture
+    def pe_log(self, tmp_path):
+        """Two hours of RA tracking at 10 Hz with 3" at 100 and 1.5" at 200 cycles/rev."""
+        cal = AXIS1_CALIBRATION
+        log = TelemetryLog(str(tmp_path))
+        rate = cal.steps_per_rev / 86164.0905
+        for i in range(72_000):
+            steps = int(round(i * 0.1 * rate))
+            theta = steps / cal.steps_per_rev
+            pe = 3.0 * math.cos(2 * math.pi * 100 * theta) + 1.5 * math.sin(2 * math.pi * 200 * theta)
+            log.append(_sample(i, i * 100_000, steps1=steps, enc1=_encoder(cal, steps, pe)))
+        log.flush()
+        return log
+
+    def test_fit_finds_wave_generator_terms(self, pe_log):
+        """Test the strongest harmonics and their amplitudes."""
+        result = periodic_error(pe_log, AXIS1_CALIBRATION, terms=2)
+
+        terms = {cycles: (c, s) for cycles, c, s in result.terms}
+        assert sorted(terms) == [100, 200]
+        assert terms[100][0] == pytest.approx(3.0, abs=0.3)
+        assert terms[200][1] == pytest.approx(1.5, abs=0.3)
+        assert result.residual_rms_arcsec < 0.3 * result.rms_arcsec
+        assert result.frequencies.size == result.power.size
+
+    def test_pec_models_cancel_the_error(self, pe_log):
+        """Test Fourier and LUT models are the negated fit."""
+        result = periodic_error(pe_log, AXIS1_CALIBRATION, harmonics=[100, 200])
+
+        fourier = result.to_pec_model()
+        assert fourier.kind == "fourier"
+        assert fourier.terms[0][0] == 100
+        assert fourier.terms[0][1] == pytest.approx(-3.0, abs=0.3)
+
+        lut = result.to_pec_model(kind="lut", lut_points=64)
+        assert lut.cycles_per_rev == 100
+        assert len(lut.corrections_arcsec) == 64
+        # Phase 0 of the 100 cycles/rev period: -(3 cos 0 + 1.5 sin 0)
+        assert lut.corrections_arcsec[0] == pytest.approx(-3.0, abs=0.4)
+
+    def test_no_tracking(self, tmp_path):
+        """Test a log without tracking gives an empty result."""
+        log = TelemetryLog(str(tmp_path))
+        log.append(_sample(1, 0, flags=STATUS_SLEWING))
+        log.flush()
+
+        result = periodic_error(log, AXIS1_CALIBRATION)
+
+        assert result.terms == []
+        with pytest.raises(ValueError):
+            result.to_pec_model()
+
+
+# =============================================================================
+# Backlash and Slip Tests
+# =============================================================================
+
+class TestBacklashAndSlip:
+    """Unit tests for reversal and slip statistics."""
+
+    def test_backlash_from_guiding_reversals(self, tmp_path):
+        """Test the error jump across Dec reversals."""
+        cal = AXIS2_CALIBRATION
+        log = TelemetryLog(str(tmp_path))
+        steps, direction = 0, 1
+        for i in range(1000):
+            if i and i % 100 == 0:
+                direction = -direction
+            steps += direction
+            # Output lags the motor by half the 30" slack either way
+            log.append(_sample(i, i * 100_000, steps2=steps, enc2=_encoder(cal, steps, -direction * 15.0)))
+        log.flush()
+
+        result = backlash(log, cal, track_backlash_rate=25)
+
+        assert result.reversals == 9
+        assert result.backlash_arcsec == pytest.approx(30.0, abs=0.5)
+        assert result.takeup_s == pytest.approx(30.0 / (25 * 15.041067), rel=0.05)
+
+    def test_slip_statistics(self, tmp_path):
+        """Test slip flags, error jumps and lost datagrams."""
+        cal = AXIS1_CALIBRATION
+        log = TelemetryLog(str(tmp_path))
+        seq = 0
+        for i in range(100):
+            seq += 3 if i == 50 else 1  # two datagrams lost
+            flags = STATUS_TRACKING | (STATUS_ENCODER_SLIP if 60 <= i < 65 else 0)
+            pe = 40.0 if i >= 70 else 0.0  # one 40" step
+            log.append(_sample(seq, i * 100_000, steps1=i, enc1=_encoder(cal, i, pe), flags=flags))
+        log.flush()
+
+        stats = slip_statistics(log, cal, jump_arcsec=20.0)
+
+        assert stats.slip_events == 1
+        assert stats.error_jumps == 1
+        assert stats.max_jump_arcsec == pytest.approx(40.0, abs=0.5)
+        assert stats.lost_samples == 2
+        assert stats.samples == 100
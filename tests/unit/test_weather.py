@@ -677,6 +677,25 @@ class TestPressureHistory:
         """Test pressure history is initially empty."""
         assert len(weather_client._pressure_history) == 0
 
+    def test_station_pressure_from_wh25(self, weather_client):
+        """Test the absolute barometer reading is kept apart from the relative one."""
+        data = weather_client._parse_response({
+            "common_list": [],
+            "wh25": [{"intemp": "68.0", "unit": "F", "abs": "24.17 inHg", "rel": "29.90 inHg"}],
+        })
+        assert data.station_pressure_inhg == pytest.approx(24.17)
+        assert data.pressure_inhg == 29.92
+
+    def test_station_pressure_in_hpa(self, weather_client):
+        """Test a gateway set to hPa."""
+        data = weather_client._parse_response({"wh25": [{"abs": "818.5 hPa"}]})
+        assert data.station_pressure_inhg == pytest.approx(24.17, abs=0.01)
+
+    def test_no_station_pressure(self, weather_client):
+        """Test a gateway without a barometer reports none."""
+        data = weather_client._parse_response({"common_list": []})
+        assert data.station_pressure_inhg is None
+
     def test_record_pressure(self, weather_client):
         """Test recording pressure adds to history."""
         from datetime import datetime